@@ -1329,6 +1329,84 @@ dds_reader_wait_for_historical_data(
         dds_entity_t reader,
         dds_duration_t max_wait);
 
+/**
+ * @brief Numbers of received samples discarded, by reason
+ */
+typedef struct dds_rx_drops
+{
+  /** delivery queue was full */
+  uint64_t queue_full;
+  /** sample had already been delivered or skipped */
+  uint64_t too_old;
+  /** reorder buffer was at its limit */
+  uint64_t reorder_full;
+  /** sample was already present in the reorder buffer */
+  uint64_t duplicate;
+  /** defragmentation buffer was at its limit */
+  uint64_t defrag_full;
+}
+dds_rx_drops_t;
+
+/**
+ * @brief Receive path statistics of a reader
+ *
+ * Counters cover the remote writers currently matched with the reader,
+ * samples from local writers are never discarded. Fields will only ever
+ * be added at the end.
+ */
+typedef struct dds_reader_rx_stats
+{
+  /** number of matched remote writers */
+  uint32_t matched_writers;
+  /** samples discarded by the receive buffers of the matched writers,
+      these buffers are shared by all readers of those writers */
+  dds_rx_drops_t writer_drops;
+  /** samples discarded while the reader was catching up on historical data */
+  dds_rx_drops_t reader_drops;
+  /** samples being defragmented / limit, summed over the matched writers */
+  uint32_t defrag_samples;
+  uint32_t defrag_max_samples;
+  /** samples held for reordering / limit, summed over the matched writers */
+  uint32_t reorder_samples;
+  uint32_t reorder_max_samples;
+  /** samples in the delivery queue / limit / high-water mark, of the
+      fullest queue used by the matched writers */
+  uint32_t dqueue_samples;
+  uint32_t dqueue_max_samples;
+  uint32_t dqueue_high_water;
+  /** receive buffer memory allocated / in use, of all receive threads */
+  uint64_t rbuf_bytes;
+  uint64_t rbuf_bytes_in_use;
+}
+dds_reader_rx_stats_t;
+
+/**
+ * @brief Get the receive path statistics of a reader
+ *
+ * The statistics are always maintained and are cheap to retrieve. It
+ * briefly locks the matched remote writers and therefore must not be
+ * called from a listener.
+ *
+ * @param[in]  reader  The reader to get the statistics of.
+ * @param[out] stats   Where to store the statistics.
+ *
+ * @returns A dds_return_t indicating success or failure
+ *
+ * @retval DDS_RETCODE_OK
+ *            Success
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *            One of the given arguments is not valid.
+ * @retval DDS_RETCODE_ILLEGAL_OPERATION
+ *            The operation is invoked on an inappropriate object.
+ * @retval DDS_RETCODE_ALREADY_DELETED
+ *            The entity has already been deleted.
+ */
+_Pre_satisfies_((reader & DDS_ENTITY_KIND_MASK) == DDS_KIND_READER)
+DDS_EXPORT dds_return_t
+dds_get_reader_rx_stats(
+        _In_ dds_entity_t reader,
+        _Out_ dds_reader_rx_stats_t *stats);
+
 /**
  * @brief Creates a new instance of a DDS writer.
  *
@@ -1783,6 +1861,41 @@ DDS_EXPORT void
 dds_write_flush(
         dds_entity_t writer);
 
+/**
+ * @brief Set the automatic batching of the samples written by a writer
+ *
+ * A writer with batching enabled holds back the samples it writes, so that
+ * consecutive samples are sent in a single message per destination. The
+ * message is sent once it reaches max_bytes, once it is full, or at most
+ * max_hold after the first sample in it was written, whichever comes first.
+ * This setting only affects the writer and plays no part in matching it
+ * with readers. It has no effect while write batching is enabled for all
+ * writers (@see dds_write_set_batch).
+ *
+ * @param[in]  writer     The writer entity.
+ * @param[in]  max_hold   Maximum time a sample is held back, 0 or DDS_INFINITY
+ *                        disables batching and sends held back samples.
+ * @param[in]  max_bytes  Size at which the message is sent, 0 for no limit
+ *                        other than the maximum message size.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK
+ *             Batching set successfully.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             The max_hold parameter is negative.
+ * @retval DDS_RETCODE_ILLEGAL_OPERATION
+ *             The operation is invoked on an inappropriate object.
+ * @retval DDS_RETCODE_ALREADY_DELETED
+ *             The entity has already been deleted.
+ */
+_Pre_satisfies_((writer & DDS_ENTITY_KIND_MASK) == DDS_KIND_WRITER)
+DDS_EXPORT dds_return_t
+dds_writer_set_batching(
+        _In_ dds_entity_t writer,
+        _In_ dds_duration_t max_hold,
+        _In_ uint32_t max_bytes);
+
 /**
  * @brief Write a CDR serialized value of a data instance
  *
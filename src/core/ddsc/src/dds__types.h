@@ -206,6 +206,15 @@ typedef struct dds_writer
   struct writer * m_wr;
   struct whc *m_whc; /* FIXME: ownership still with underlying DDSI writer (cos of DDSI built-in writers )*/
 
+  /* Batching of samples (dds_writer_set_batching): m_batch_xev flushes
+     m_xp at most m_batch_hold after the first sample was held back, or
+     the write sends it once it reaches m_batch_max_size bytes (0: no
+     limit); m_batch_pending is set while the flush is scheduled */
+  struct xevent *m_batch_xev;
+  dds_duration_t m_batch_hold;
+  uint32_t m_batch_max_size;
+  bool m_batch_pending;
+
   /* Status metrics */
 
   dds_liveliness_lost_status_t m_liveliness_lost_status;
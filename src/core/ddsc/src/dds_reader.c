@@ -22,6 +22,9 @@
 #include "dds__topic.h"
 #include "ddsi/q_entity.h"
 #include "ddsi/q_thread.h"
+#include "ddsi/q_ephash.h"
+#include "ddsi/q_globals.h"
+#include "ddsi/q_radmin.h"
 #include "dds__builtin.h"
 #include "ddsi/ddsi_sertopic.h"
 #include "ddsc/ddsc_project.h"
@@ -784,3 +787,107 @@ dds_return_t dds_get_requested_incompatible_qos_status (
 fail:
     return ret;
 }
+
+static void rx_drops_from_nn (dds_rx_drops_t *a, const struct nn_rx_drop_stats *b)
+{
+  a->queue_full += b->queue_full;
+  a->too_old += b->too_old;
+  a->reorder_full += b->reorder_full;
+  a->duplicate += b->duplicate;
+  a->defrag_full += b->defrag_full;
+}
+
+static void reader_rx_stats_pwr (dds_reader_rx_stats_t *stats, struct proxy_writer *pwr, const nn_guid_t *rdguid)
+{
+  struct nn_radmin_stats st;
+  struct nn_dqueue_stats dqst;
+  struct pwr_rd_match *m;
+  os_mutexLock (&pwr->e.lock);
+  nn_defrag_stats (pwr->defrag, &st);
+  stats->defrag_samples += st.n_samples;
+  stats->defrag_max_samples += st.max_samples;
+  rx_drops_from_nn (&stats->writer_drops, &st.drops);
+  nn_reorder_stats (pwr->reorder, &st);
+  stats->reorder_samples += st.n_samples;
+  stats->reorder_max_samples += st.max_samples;
+  rx_drops_from_nn (&stats->writer_drops, &st.drops);
+  if ((m = ut_avlLookup (&pwr_readers_treedef, &pwr->readers, rdguid)) != NULL)
+  {
+    nn_reorder_stats (m->u.not_in_sync.reorder, &st);
+    rx_drops_from_nn (&stats->reader_drops, &st.drops);
+  }
+  nn_dqueue_stats (pwr->dqueue, &dqst);
+  if (dqst.n_samples > stats->dqueue_samples)
+    stats->dqueue_samples = dqst.n_samples;
+  if (dqst.max_samples > stats->dqueue_max_samples)
+    stats->dqueue_max_samples = dqst.max_samples;
+  if (dqst.high_water > stats->dqueue_high_water)
+    stats->dqueue_high_water = dqst.high_water;
+  os_mutexUnlock (&pwr->e.lock);
+}
+
+_Pre_satisfies_((reader & DDS_ENTITY_KIND_MASK) == DDS_KIND_READER)
+dds_return_t dds_get_reader_rx_stats (
+        _In_ dds_entity_t reader,
+        _Out_ dds_reader_rx_stats_t *stats)
+{
+  struct thread_state1 * const thr = lookup_thread_state ();
+  const bool asleep = !vtime_awake_p (thr->vtime);
+  dds__retcode_t rc;
+  dds_reader *dds_rd;
+  struct reader *rd;
+  struct rd_pwr_match *m;
+  nn_guid_t pwrguid;
+
+  if (stats == NULL)
+    return DDS_ERRNO (DDS_RETCODE_BAD_PARAMETER);
+  /* Only pin the reader, like dds_reader_ddsi2direct: a listener invoked
+     by synchronous delivery runs with the proxy writer locked and may
+     lock the reader, so the reader must not be locked while locking the
+     proxy writers */
+  if (ut_handle_claim (reader, NULL, DDS_KIND_READER, (void **) &dds_rd) != UT_HANDLE_OK)
+  {
+    if ((rc = dds_valid_hdl (reader, DDS_KIND_READER)) == DDS_RETCODE_OK)
+      rc = DDS_RETCODE_ALREADY_DELETED;
+    DDS_ERROR ("Error occurred on claiming reader\n");
+    return DDS_ERRNO (rc);
+  }
+  memset (stats, 0, sizeof (*stats));
+  if (asleep)
+    thread_state_awake (thr);
+
+  /* the proxy writer must be locked without holding the DDSI reader lock
+     either, so walk the matched writers by GUID */
+  rd = dds_rd->m_rd;
+  memset (&pwrguid, 0, sizeof (pwrguid));
+  os_mutexLock (&rd->e.lock);
+  for (m = ut_avlLookupSuccEq (&rd_writers_treedef, &rd->writers, &pwrguid); m != NULL; m = ut_avlLookupSucc (&rd_writers_treedef, &rd->writers, &pwrguid))
+  {
+    struct proxy_writer *pwr;
+    pwrguid = m->pwr_guid;
+    os_mutexUnlock (&rd->e.lock);
+    if ((pwr = ephash_lookup_proxy_writer_guid (&pwrguid)) != NULL)
+    {
+      stats->matched_writers++;
+      reader_rx_stats_pwr (stats, pwr, &rd->e.guid);
+    }
+    os_mutexLock (&rd->e.lock);
+  }
+  os_mutexUnlock (&rd->e.lock);
+
+  for (unsigned i = 0; i < gv.n_recv_threads; i++)
+  {
+    struct nn_rbufpool_stats st;
+    if (gv.recv_threads[i].arg.rbpool == NULL)
+      continue;
+    nn_rbufpool_stats (gv.recv_threads[i].arg.rbpool, &st);
+    stats->rbuf_bytes += (uint64_t) st.n_rbufs * st.rbuf_size;
+    if (st.n_rbufs > st.n_spares)
+      stats->rbuf_bytes_in_use += (uint64_t) (st.n_rbufs - st.n_spares) * st.rbuf_size;
+  }
+
+  if (asleep)
+    thread_state_asleep (thr);
+  ut_handle_release (reader, dds_rd->m_entity.m_hdllink);
+  return DDS_RETCODE_OK;
+}
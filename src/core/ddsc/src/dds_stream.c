@@ -1196,9 +1196,19 @@ void dds_stream_write_sample (dds_stream_t * os, const void * data, const struct
 void dds_stream_from_serdata_default (_Out_ dds_stream_t * s, _In_ const struct ddsi_serdata_default *d)
 {
   s->m_failed = false;
-  s->m_buffer.p8 = (uint8_t*) d;
-  s->m_index = (uint32_t) offsetof (struct ddsi_serdata_default, data);
-  s->m_size = d->size + s->m_index;
+  if (d->fragchain == NULL)
+  {
+    s->m_buffer.p8 = (uint8_t*) d;
+    s->m_index = (uint32_t) offsetof (struct ddsi_serdata_default, data);
+    s->m_size = d->size + s->m_index;
+  }
+  else
+  {
+    /* payload referenced in the receive buffers, only readable if contiguous */
+    s->m_buffer.p8 = (uint8_t*) d->contig;
+    s->m_index = 0;
+    s->m_size = d->contig ? d->pos : 0;
+  }
   assert (d->hdr.identifier == CDR_LE || d->hdr.identifier == CDR_BE);
   s->m_endian = (d->hdr.identifier == CDR_LE);
 }
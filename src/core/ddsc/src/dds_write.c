@@ -25,6 +25,8 @@
 #include "ddsi/q_config.h"
 #include "ddsi/q_entity.h"
 #include "ddsi/q_radmin.h"
+#include "ddsi/q_xevent.h"
+#include "ddsi/q_time.h"
 
 dds_return_t dds_write (dds_entity_t writer, const void *data)
 {
@@ -74,6 +76,31 @@ dds_return_t dds_write_ts (dds_entity_t writer, const void *data, dds_time_t tim
   return ret;
 }
 
+static void send_or_hold (dds_writer *wr, struct nn_xpack *xp)
+{
+  /* Flush out write unless configured to batch, or the writer is set to
+     hold it back until the batch is large enough; in those cases only
+     the partially filled packet is held back, not any completed ones */
+  if (xp == NULL)
+    return;
+  if (config.whc_batch)
+  {
+    nn_xpack_send_completed (xp);
+    return;
+  }
+  if (wr && wr->m_batch_hold > 0 && (wr->m_batch_max_size == 0 || nn_xpack_size (xp) < wr->m_batch_max_size))
+  {
+    if (!wr->m_batch_pending)
+    {
+      wr->m_batch_pending = true;
+      resched_xevent_if_earlier (wr->m_batch_xev, add_duration_to_mtime (now_mt (), wr->m_batch_hold));
+    }
+    nn_xpack_send_completed (xp);
+    return;
+  }
+  nn_xpack_send (xp, false);
+}
+
 static dds_return_t try_store (struct rhc *rhc, const struct proxy_writer_info *pwr_info, struct ddsi_serdata *payload, struct ddsi_tkmap_instance *tk, dds_duration_t *max_block_ms)
 {
   while (!(ddsi_plugin.rhc_plugin.rhc_store_fn) (rhc, pwr_info, payload, tk))
@@ -181,9 +208,7 @@ dds_return_t dds_write_impl (dds_writer *wr, const void * data, dds_time_t tstam
 
   if (w_rc >= 0)
   {
-    /* Flush out write unless configured to batch */
-    if (!config.whc_batch)
-      nn_xpack_send (wr->m_xp, false);
+    send_or_hold (wr, wr->m_xp);
     ret = DDS_RETCODE_OK;
   } else if (w_rc == ERR_TIMEOUT) {
     DDS_ERROR ("The writer could not deliver data on time, probably due to a reader resources being full\n");
@@ -205,7 +230,7 @@ dds_return_t dds_write_impl (dds_writer *wr, const void * data, dds_time_t tstam
   return ret;
 }
 
-dds_return_t dds_writecdr_impl_lowlevel (struct writer *ddsi_wr, struct nn_xpack *xp, struct ddsi_serdata *d)
+static dds_return_t dds_writecdr_impl_common (dds_writer *wr, struct writer *ddsi_wr, struct nn_xpack *xp, struct ddsi_serdata *d)
 {
   struct thread_state1 * const thr = lookup_thread_state ();
   const bool asleep = !vtime_awake_p (thr->vtime);
@@ -220,9 +245,7 @@ dds_return_t dds_writecdr_impl_lowlevel (struct writer *ddsi_wr, struct nn_xpack
   tk = ddsi_tkmap_lookup_instance_ref (d);
   w_rc = write_sample_gc (xp, ddsi_wr, d, tk);
   if (w_rc >= 0) {
-    /* Flush out write unless configured to batch */
-    if (!config.whc_batch && xp != NULL)
-      nn_xpack_send (xp, false);
+    send_or_hold (wr, xp);
     ret = DDS_RETCODE_OK;
   } else if (w_rc == ERR_TIMEOUT) {
     DDS_ERROR ("The writer could not deliver data on time, probably due to a reader resources being full\n");
@@ -246,6 +269,11 @@ dds_return_t dds_writecdr_impl_lowlevel (struct writer *ddsi_wr, struct nn_xpack
   return ret;
 }
 
+dds_return_t dds_writecdr_impl_lowlevel (struct writer *ddsi_wr, struct nn_xpack *xp, struct ddsi_serdata *d)
+{
+  return dds_writecdr_impl_common (NULL, ddsi_wr, xp, d);
+}
+
 dds_return_t dds_writecdr_impl (dds_writer *wr, struct ddsi_serdata *d, dds_time_t tstamp, dds_write_action action)
 {
   if (wr->m_topic->filter_fn)
@@ -253,7 +281,7 @@ dds_return_t dds_writecdr_impl (dds_writer *wr, struct ddsi_serdata *d, dds_time
   /* Set if disposing or unregistering */
   d->statusinfo = ((action & DDS_WR_DISPOSE_BIT) ? NN_STATUSINFO_DISPOSE : 0) | ((action & DDS_WR_UNREGISTER_BIT) ? NN_STATUSINFO_UNREGISTER : 0);
   d->timestamp.v = tstamp;
-  return dds_writecdr_impl_lowlevel (wr->m_wr, wr->m_xp, d);
+  return dds_writecdr_impl_common (wr, wr->m_wr, wr->m_xp, d);
 }
 
 void dds_write_set_batch (bool enable)
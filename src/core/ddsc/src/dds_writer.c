@@ -15,6 +15,8 @@
 #include "ddsi/q_entity.h"
 #include "ddsi/q_thread.h"
 #include "ddsi/q_xmsg.h"
+#include "ddsi/q_xevent.h"
+#include "ddsi/q_time.h"
 #include "dds__writer.h"
 #include "dds__listener.h"
 #include "dds__qos.h"
@@ -171,19 +173,56 @@ static void dds_writer_status_cb (void *ventity, const status_cb_data_t *data)
   os_mutexUnlock (&entity->m_observers_lock);
 }
 
-static uint32_t
-get_bandwidth_limit(
-        nn_transport_priority_qospolicy_t transport_priority)
+/* Paced data goes out via the transmit connection of the channel,
+   which is the one that can carry departure times */
+static struct ddsi_pacer *
+get_pacer(
+        nn_transport_priority_qospolicy_t transport_priority,
+        ddsi_tran_conn_t *conn)
 {
-#ifdef DDSI_INCLUDE_NETWORK_CHANNELS
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
   struct config_channel_listelem *channel = find_channel (transport_priority);
-  return channel->data_bandwidth_limit;
+  if (channel->data_pacer)
+    *conn = channel->transmit_conn;
+  return channel->data_pacer;
 #else
   (void)transport_priority;
-  return 0;
+  (void)conn;
+  return NULL;
 #endif
 }
 
+static void
+dds_writer_batch_flush(
+        struct xevent *xev,
+        void *varg,
+        nn_mtime_t tnow)
+{
+    /* Runs on the event thread, which must not block on the writer: the
+     * application thread may be holding it while waiting for an ACK to
+     * a heartbeat the event thread is supposed to send.  So if the
+     * writer is locked, try again a bit later. */
+    const dds_entity_t writer = (dds_entity_t)(intptr_t)varg;
+    dds_entity *e;
+    void *raw;
+
+    if (ut_handle_claim(writer, NULL, DDS_KIND_WRITER, &raw) != UT_HANDLE_OK) {
+        return;
+    }
+    e = raw;
+    if (os_mutexTryLock(&e->m_mutex) != os_resultSuccess) {
+        resched_xevent_if_earlier(xev, add_duration_to_mtime(tnow, T_MILLISECOND));
+        ut_handle_release(writer, e->m_hdllink);
+    } else {
+        dds_writer *wr = (dds_writer *)e;
+        if (!ut_handle_is_closed(writer, e->m_hdllink)) {
+            wr->m_batch_pending = false;
+            nn_xpack_send(wr->m_xp, false);
+        }
+        dds_entity_unlock(e);
+    }
+}
+
 static dds_return_t
 dds_writer_close(
         dds_entity *e)
@@ -198,6 +237,10 @@ dds_writer_close(
     if (asleep) {
         thread_state_awake(thr);
     }
+    if (wr->m_batch_xev) {
+        delete_xevent (wr->m_batch_xev);
+        wr->m_batch_xev = NULL;
+    }
     if (thr) {
         nn_xpack_send (wr->m_xp, false);
     }
@@ -407,6 +450,7 @@ dds_create_writer(
     struct thread_state1 * const thr = lookup_thread_state();
     const bool asleep = !vtime_awake_p(thr->vtime);
     ddsi_tran_conn_t conn = gv.data_conn_uc;
+    struct ddsi_pacer *pacer;
     dds_return_t ret;
 
     /* Try claiming a participant. If that's not working, then it could be a subscriber. */
@@ -467,7 +511,12 @@ dds_create_writer(
 
     wr->m_topic = tp;
     dds_entity_add_ref_nolock(&tp->m_entity);
-    wr->m_xp = nn_xpack_new(conn, get_bandwidth_limit(wqos->transport_priority), config.xpack_send_async);
+    pacer = get_pacer(wqos->transport_priority, &conn);
+    wr->m_xp = nn_xpack_new(conn, pacer, config.xpack_send_async);
+    wr->m_batch_xev = NULL;
+    wr->m_batch_hold = 0;
+    wr->m_batch_max_size = 0;
+    wr->m_batch_pending = false;
     wr->m_entity.m_deriver.close = dds_writer_close;
     wr->m_entity.m_deriver.delete = dds_writer_delete;
     wr->m_entity.m_deriver.set_qos = dds_writer_qos_set;
@@ -645,3 +694,54 @@ dds_get_offered_incompatible_qos_status (
 fail:
     return ret;
 }
+
+_Pre_satisfies_(((writer & DDS_ENTITY_KIND_MASK) == DDS_KIND_WRITER))
+dds_return_t
+dds_writer_set_batching(
+        _In_ dds_entity_t writer,
+        _In_ dds_duration_t max_hold,
+        _In_ uint32_t max_bytes)
+{
+    struct thread_state1 * const thr = lookup_thread_state();
+    const bool asleep = !vtime_awake_p(thr->vtime);
+    dds__retcode_t rc;
+    dds_writer *wr;
+    dds_return_t ret = DDS_RETCODE_OK;
+
+    if (max_hold < 0) {
+        DDS_ERROR("Negative maximum hold time\n");
+        ret = DDS_ERRNO(DDS_RETCODE_BAD_PARAMETER);
+        goto fail;
+    }
+    rc = dds_writer_lock(writer, &wr);
+    if (rc != DDS_RETCODE_OK) {
+        DDS_ERROR("Error occurred on locking writer\n");
+        ret = DDS_ERRNO(rc);
+        goto fail;
+    }
+    if (asleep) {
+        thread_state_awake(thr);
+    }
+    if (max_hold == 0 || max_hold == DDS_INFINITY) {
+        /* An infinite hold time would never flush, so it disables batching
+         * just like a hold time of 0; send anything held back right away.
+         * The xevent stays around for as long as the writer does. */
+        wr->m_batch_hold = 0;
+        wr->m_batch_max_size = 0;
+        wr->m_batch_pending = false;
+        nn_xpack_send(wr->m_xp, false);
+    } else {
+        if (wr->m_batch_xev == NULL) {
+            nn_mtime_t never = { T_NEVER };
+            wr->m_batch_xev = qxev_callback(never, dds_writer_batch_flush, (void *) (intptr_t) writer);
+        }
+        wr->m_batch_hold = max_hold;
+        wr->m_batch_max_size = max_bytes;
+    }
+    if (asleep) {
+        thread_state_asleep(thr);
+    }
+    dds_writer_unlock(wr);
+fail:
+    return ret;
+}
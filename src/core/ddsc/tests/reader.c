@@ -17,6 +17,12 @@
 #include "RoundTrip.h"
 #include "CUnit/Test.h"
 #include "CUnit/Theory.h"
+#include "test-common.h"
+#include "ddsi/q_bswap.h"
+#include "ddsi/q_entity.h"
+#include "ddsi/q_ephash.h"
+#include "ddsi/q_globals.h"
+#include "ddsi/q_thread.h"
 
 /**************************************************************************************************
  *
@@ -3157,3 +3163,152 @@ CU_Test(ddsc_take_mask_wl, combination_of_states, .init=reader_init, .fini=reade
     CU_ASSERT_EQUAL_FATAL(ret, MAX_SAMPLES - expected_cnt);
 }
 /*************************************************************************************************/
+
+
+
+/**************************************************************************************************
+ *
+ * These will check the dds_get_reader_rx_stats() in various ways.
+ *
+ *************************************************************************************************/
+/*************************************************************************************************/
+CU_Test(ddsc_reader_rx_stats, local_writer, .init=reader_init, .fini=reader_fini)
+{
+    dds_reader_rx_stats_t stats;
+    dds_return_t ret;
+
+    /* Samples from the local writer bypass the receive path entirely. */
+    memset(&stats, 0xff, sizeof(stats));
+    ret = dds_get_reader_rx_stats(g_reader, &stats);
+    CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
+    CU_ASSERT_EQUAL(stats.matched_writers, 0);
+    CU_ASSERT_EQUAL(stats.writer_drops.too_old, 0);
+    CU_ASSERT_EQUAL(stats.writer_drops.duplicate, 0);
+    CU_ASSERT_EQUAL(stats.reader_drops.too_old, 0);
+    CU_ASSERT_EQUAL(stats.reorder_samples, 0);
+    CU_ASSERT_EQUAL(stats.dqueue_high_water, 0);
+    CU_ASSERT(stats.rbuf_bytes_in_use <= stats.rbuf_bytes);
+}
+/*************************************************************************************************/
+
+/*************************************************************************************************/
+CU_Test(ddsc_reader_rx_stats, null, .init=reader_init, .fini=reader_fini)
+{
+    dds_return_t ret;
+    ret = dds_get_reader_rx_stats(g_reader, NULL);
+    CU_ASSERT_EQUAL(dds_err_nr(ret), DDS_RETCODE_BAD_PARAMETER);
+}
+/*************************************************************************************************/
+
+/*************************************************************************************************/
+CU_Test(ddsc_reader_rx_stats, non_reader, .init=reader_init, .fini=reader_fini)
+{
+    dds_reader_rx_stats_t stats;
+    dds_return_t ret;
+    ret = dds_get_reader_rx_stats(g_writer, &stats);
+    CU_ASSERT_EQUAL(dds_err_nr(ret), DDS_RETCODE_ILLEGAL_OPERATION);
+}
+/*************************************************************************************************/
+
+/*************************************************************************************************/
+CU_Test(ddsc_reader_rx_stats, already_deleted, .init=reader_init, .fini=reader_fini)
+{
+    dds_reader_rx_stats_t stats;
+    dds_return_t ret;
+    dds_delete(g_reader);
+    ret = dds_get_reader_rx_stats(g_reader, &stats);
+    CU_ASSERT_EQUAL(dds_err_nr(ret), DDS_RETCODE_ALREADY_DELETED);
+}
+/*************************************************************************************************/
+
+/*************************************************************************************************/
+static void
+rx_stats_send_data(os_socket sock, const nn_guid_t *wrguid, int64_t seq, int32_t key)
+{
+    const nn_guid_prefix_t prefix = nn_hton_guid_prefix(wrguid->prefix);
+    const nn_entityid_t wrid = nn_hton_entityid(wrguid->entityid);
+    const uint32_t seqlow = (uint32_t) seq;
+    const int32_t seqhigh = (int32_t) (seq >> 32);
+    const int32_t payload[3] = { key, 0, 0 };
+    unsigned char buf[20 + 24 + 4 + sizeof(payload)];
+    uint16_t u16;
+    struct sockaddr_in addr;
+    size_t n;
+
+    /* RTPS header followed by a single little-endian DATA submessage,
+       addressed to all readers matching the proxy writer. */
+    memcpy(buf, "RTPS\x02\x01\x01\x10", 8);
+    memcpy(buf + 8, &prefix, 12);
+    buf[20] = 0x15;
+    buf[21] = 0x05;
+    u16 = (uint16_t) (sizeof(buf) - 24);
+    memcpy(buf + 22, &u16, 2);
+    memset(buf + 24, 0, 4);
+    u16 = 16;
+    memcpy(buf + 26, &u16, 2);
+    memset(buf + 28, 0, 4);
+    memcpy(buf + 32, &wrid, 4);
+    memcpy(buf + 36, &seqhigh, 4);
+    memcpy(buf + 40, &seqlow, 4);
+    memcpy(buf + 44, "\x00\x01\x00\x00", 4);
+    memcpy(buf + 48, payload, sizeof(payload));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) gv.loc_default_uc.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CU_ASSERT_FATAL(os_sockSendto(sock, buf, sizeof(buf), (struct sockaddr *)&addr, sizeof(addr), &n) == os_resultSuccess);
+    CU_ASSERT_EQUAL_FATAL(n, sizeof(buf));
+}
+
+CU_Test(ddsc_reader_rx_stats, remote_writer, .init=reader_init, .fini=reader_fini)
+{
+    dds_reader_rx_stats_t stats;
+    dds_return_t ret;
+    struct proxy_writer *pwr;
+    nn_guid_t wrguid;
+    char name[100];
+    os_socket sock;
+    int matched, n;
+
+    ret = dds_get_name(g_topic, name, sizeof(name));
+    CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
+    wrguid = create_proxy_endpoint(true, name, Space_Type1_desc.m_typename, false, 7399);
+
+    /* Matching completes asynchronously; data arriving before it does is
+       discarded without being counted. */
+    for (matched = 0, n = 0; !matched && n < 100; n++) {
+        thread_state_awake(lookup_thread_state());
+        if ((pwr = ephash_lookup_proxy_writer_guid(&wrguid)) != NULL) {
+            os_mutexLock(&pwr->e.lock);
+            matched = (pwr->local_matching_inprogress == 0);
+            os_mutexUnlock(&pwr->e.lock);
+        }
+        thread_state_asleep(lookup_thread_state());
+        if (!matched)
+            dds_sleepfor(DDS_MSECS(10));
+    }
+    CU_ASSERT_FATAL(matched);
+
+    /* Sequence number 1 a second time is older than the next expected one
+       and must be counted as a drop against the proxy writer. */
+    sock = os_sockNew(AF_INET, SOCK_DGRAM);
+    CU_ASSERT_FATAL(sock != OS_INVALID_SOCKET);
+    rx_stats_send_data(sock, &wrguid, 1, 100);
+    rx_stats_send_data(sock, &wrguid, 2, 101);
+    rx_stats_send_data(sock, &wrguid, 1, 100);
+    os_sockFree(sock);
+
+    for (n = 0; n < 100; n++) {
+        ret = dds_get_reader_rx_stats(g_reader, &stats);
+        CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
+        if (stats.writer_drops.too_old + stats.writer_drops.duplicate > 0)
+            break;
+        dds_sleepfor(DDS_MSECS(10));
+    }
+    CU_ASSERT_EQUAL(stats.matched_writers, 1);
+    CU_ASSERT_EQUAL(stats.writer_drops.too_old, 1);
+
+    delete_proxy_endpoint(&wrguid);
+}
+/*************************************************************************************************/
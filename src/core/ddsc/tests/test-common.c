@@ -9,7 +9,16 @@
  *
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
+#include <string.h>
+#include "os/os.h"
 #include "ddsc/dds.h"
+#include "ddsi/q_entity.h"
+#include "ddsi/q_addrset.h"
+#include "ddsi/q_globals.h"
+#include "ddsi/q_plist.h"
+#include "ddsi/q_thread.h"
+#include "ddsi/q_time.h"
+#include "test-common.h"
 
 const char*
 entity_kind_str(dds_entity_t ent) {
@@ -29,3 +38,77 @@ entity_kind_str(dds_entity_t ent) {
         default:                    return "(INVALID_ENTITY)";
     }
 }
+
+nn_guid_t
+create_proxy_endpoint(bool is_writer, const char *topic_name, const char *type_name, bool reliable, uint32_t port)
+{
+    static uint32_t count = 0;
+    struct thread_state1 * const thr = lookup_thread_state();
+    const bool asleep = !vtime_awake_p(thr->vtime);
+    nn_guid_t ppguid, guid;
+    nn_locator_t loc;
+    struct addrset *as;
+    nn_plist_t plist;
+
+    ppguid.prefix.u[0] = 0x74657374;
+    ppguid.prefix.u[1] = (uint32_t)os_getpid();
+    ppguid.prefix.u[2] = ++count;
+    ppguid.entityid.u = NN_ENTITYID_PARTICIPANT;
+    guid.prefix = ppguid.prefix;
+    guid.entityid.u = is_writer ? (0x100 | NN_ENTITYID_KIND_WRITER_WITH_KEY) : (0x100 | NN_ENTITYID_KIND_READER_WITH_KEY);
+
+    memset(&loc, 0, sizeof(loc));
+    loc.kind = NN_LOCATOR_KIND_UDPv4;
+    loc.port = port;
+    loc.address[12] = 127;
+    loc.address[15] = 1;
+
+    if (asleep) {
+        thread_state_awake(thr);
+    }
+    as = new_addrset();
+    add_to_addrset(as, &loc);
+    nn_plist_init_empty(&plist);
+    new_proxy_participant(&ppguid, 0, 0, NULL, ref_addrset(as), ref_addrset(as), &plist, T_NEVER, NN_VENDORID_ECLIPSE, CF_PROXYPP_NO_SPDP, now());
+
+    plist.qos.present |= QP_TOPIC_NAME | QP_TYPE_NAME | QP_RELIABILITY;
+    plist.qos.topic_name = os_strdup(topic_name);
+    plist.qos.type_name = os_strdup(type_name);
+    plist.qos.reliability.kind = reliable ? NN_RELIABLE_RELIABILITY_QOS : NN_BEST_EFFORT_RELIABILITY_QOS;
+    plist.qos.reliability.max_blocking_time = nn_to_ddsi_duration(DDS_MSECS(100));
+    if (is_writer) {
+        nn_xqos_mergein_missing(&plist.qos, &gv.default_xqos_wr);
+        new_proxy_writer(&ppguid, &guid, as, &plist, gv.user_dqueues[0], gv.xevents, now());
+    } else {
+        nn_xqos_mergein_missing(&plist.qos, &gv.default_xqos_rd);
+#ifdef DDSI_INCLUDE_SSM
+        new_proxy_reader(&ppguid, &guid, as, &plist, now(), 0);
+#else
+        new_proxy_reader(&ppguid, &guid, as, &plist, now());
+#endif
+    }
+    nn_plist_fini(&plist);
+    unref_addrset(as);
+    if (asleep) {
+        thread_state_asleep(thr);
+    }
+    return guid;
+}
+
+void
+delete_proxy_endpoint(const nn_guid_t *guid)
+{
+    struct thread_state1 * const thr = lookup_thread_state();
+    const bool asleep = !vtime_awake_p(thr->vtime);
+    nn_guid_t ppguid;
+
+    ppguid.prefix = guid->prefix;
+    ppguid.entityid.u = NN_ENTITYID_PARTICIPANT;
+    if (asleep) {
+        thread_state_awake(thr);
+    }
+    delete_proxy_participant_by_guid(&ppguid, now(), 0);
+    if (asleep) {
+        thread_state_asleep(thr);
+    }
+}
@@ -12,6 +12,17 @@
 #ifndef _TEST_COMMON_H_
 #define _TEST_COMMON_H_
 
+#include "ddsc/dds.h"
+#include "ddsi/q_rtps.h"
+
 const char *entity_kind_str(dds_entity_t ent);
 
+/* Creates a proxy participant with a single proxy reader or writer for the
+   given topic, as if discovered from a remote peer that is reachable at
+   127.0.0.1:port. Local entities exchange data with it over the network,
+   which is what allows testing the send and receive paths in a single
+   process. Returns the GUID of the proxy reader/writer. */
+nn_guid_t create_proxy_endpoint(bool is_writer, const char *topic_name, const char *type_name, bool reliable, uint32_t port);
+void delete_proxy_endpoint(const nn_guid_t *guid);
+
 #endif /* _TEST_COMMON_H_ */
@@ -16,6 +16,8 @@
 #include "RoundTrip.h"
 #include "Space.h"
 #include "os/os.h"
+#include "test-common.h"
+#include "ddsi/q_config.h"
 
 /* Tests in this file only concern themselves with very basic api tests of
    dds_write and dds_write_ts */
@@ -158,3 +160,235 @@ CU_Test(ddsc_write, simpletypes)
     dds_delete(top);
     dds_delete(par);
 }
+
+/* Receives RTPS messages sent to the socket for at most timeout, counting
+   the DATA submessages of user writers in each of them; returns the number
+   of DATA submessages in the first message containing any, and stores the
+   time of its arrival in *tfirst. */
+static int
+recv_data(os_socket sock, dds_duration_t timeout, dds_time_t *tfirst, int *total)
+{
+    const dds_time_t tend = dds_time() + timeout;
+    unsigned char buf[65536];
+    int first = 0;
+    dds_time_t tnow;
+
+    *total = 0;
+    while ((tnow = dds_time()) < tend) {
+        os_time to = { (os_timeSec) ((tend - tnow) / DDS_NSECS_IN_SEC), (int32_t) ((tend - tnow) % DDS_NSECS_IN_SEC) };
+        size_t n, off, fromlen = 0;
+        int ndata = 0;
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(sock, &fds);
+        if (os_sockSelect((int32_t)sock + 1, &fds, NULL, NULL, &to) <= 0) {
+            break;
+        }
+        if (os_sockRecvfrom(sock, buf, sizeof(buf), NULL, &fromlen, &n) != os_resultSuccess || n < 20) {
+            continue;
+        }
+        /* Skip the RTPS header; in a submessage header, bit 0 of the flags
+           gives the endianness of octetsToNextHeader. A DATA submessage
+           (0x15) from a user writer has an entity kind without the builtin
+           and vendor-specific bits. */
+        for (off = 20; off + 4 <= n; ) {
+            size_t len = (buf[off+1] & 1) ? (size_t)(buf[off+2] | (buf[off+3] << 8)) : (size_t)((buf[off+2] << 8) | buf[off+3]);
+            if (buf[off] == 0x15 && off + 16 <= n && (buf[off+15] & 0xc0) == 0) {
+                ndata++;
+            }
+            if (len == 0) {
+                break;
+            }
+            off += 4 + len;
+        }
+        if (ndata > 0 && first == 0) {
+            first = ndata;
+            *tfirst = dds_time();
+        }
+        *total += ndata;
+    }
+    return first;
+}
+
+CU_Test(ddsc_write, batching, .init = setup, .fini = teardown)
+{
+    const dds_duration_t hold = DDS_MSECS(200);
+    struct sockaddr_in addr;
+    dds_return_t status;
+    dds_entity_t wri;
+    dds_qos_t *qos;
+    dds_time_t t0, tfirst = 0;
+    nn_guid_t prd;
+    os_socket sock;
+    int first, total;
+
+    /* A proxy reader at a local socket gets the data over the network */
+    sock = os_sockNew(AF_INET, SOCK_DGRAM);
+    CU_ASSERT_FATAL(sock != OS_INVALID_SOCKET);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CU_ASSERT_FATAL(os_sockBind(sock, (struct sockaddr *)&addr, sizeof(addr)) == os_resultSuccess);
+    CU_ASSERT_FATAL(os_sockGetsockname(sock, (struct sockaddr *)&addr, sizeof(addr)) == os_resultSuccess);
+    prd = create_proxy_endpoint(false, "RoundTrip", RoundTripModule_DataType_desc.m_typename, false, ntohs(addr.sin_port));
+
+    /* A reliable writer sends right away when a heartbeat asks for an
+       acknowledgement, so use a best-effort one */
+    qos = dds_create_qos();
+    CU_ASSERT_FATAL(qos != NULL);
+    dds_qset_reliability(qos, DDS_RELIABILITY_BEST_EFFORT, 0);
+    wri = dds_create_writer(participant, topic, qos, NULL);
+    dds_delete_qos(qos);
+    CU_ASSERT_FATAL(wri > 0);
+
+    status = dds_writer_set_batching(wri, -1, 0);
+    CU_ASSERT_EQUAL(dds_err_nr(status), DDS_RETCODE_BAD_PARAMETER);
+    status = dds_writer_set_batching(topic, hold, 0);
+    CU_ASSERT_EQUAL(dds_err_nr(status), DDS_RETCODE_ILLEGAL_OPERATION);
+
+    /* Samples written in quick succession are held back for the hold
+       time, then all go out in a single message */
+    status = dds_writer_set_batching(wri, hold, 0);
+    CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    t0 = dds_time();
+    for (int i = 0; i < 10; i++) {
+        status = dds_write(wri, &data);
+        CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    }
+    first = recv_data(sock, hold + DDS_SECS(1), &tfirst, &total);
+    CU_ASSERT_EQUAL(first, 10);
+    CU_ASSERT_EQUAL(total, 10);
+    CU_ASSERT(tfirst - t0 >= hold - DDS_MSECS(10));
+
+    /* Reaching max_bytes sends the samples without waiting */
+    status = dds_writer_set_batching(wri, hold, 1);
+    CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    t0 = dds_time();
+    status = dds_write(wri, &data);
+    CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    first = recv_data(sock, hold / 2, &tfirst, &total);
+    CU_ASSERT_EQUAL(first, 1);
+    CU_ASSERT(tfirst - t0 < hold / 2);
+
+    /* An infinite hold time disables batching */
+    status = dds_writer_set_batching(wri, DDS_INFINITY, 0);
+    CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    t0 = dds_time();
+    status = dds_write(wri, &data);
+    CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    first = recv_data(sock, hold / 2, &tfirst, &total);
+    CU_ASSERT_EQUAL(first, 1);
+    CU_ASSERT(tfirst - t0 < hold / 2);
+
+    /* Deleting the writer sends whatever is held back */
+    status = dds_writer_set_batching(wri, DDS_SECS(10), 0);
+    CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    status = dds_write(wri, &data);
+    CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    status = dds_delete(wri);
+    CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    first = recv_data(sock, hold, &tfirst, &total);
+    CU_ASSERT_EQUAL(first, 1);
+
+    delete_proxy_endpoint(&prd);
+    os_sockFree(sock);
+}
+
+/* Receives RTPS messages sent to the socket until n DATA submessages of
+   user writers have arrived or the timeout expires, storing their writer
+   sequence numbers in seqs; returns the number received. */
+static int
+recv_seqs(os_socket sock, dds_duration_t timeout, int64_t *seqs, int n)
+{
+    const dds_time_t tend = dds_time() + timeout;
+    unsigned char buf[65536];
+    dds_time_t tnow;
+    int k = 0;
+
+    while (k < n && (tnow = dds_time()) < tend) {
+        os_time to = { (os_timeSec) ((tend - tnow) / DDS_NSECS_IN_SEC), (int32_t) ((tend - tnow) % DDS_NSECS_IN_SEC) };
+        size_t sz, off, fromlen = 0;
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(sock, &fds);
+        if (os_sockSelect((int32_t)sock + 1, &fds, NULL, NULL, &to) <= 0) {
+            break;
+        }
+        if (os_sockRecvfrom(sock, buf, sizeof(buf), NULL, &fromlen, &sz) != os_resultSuccess || sz < 20) {
+            continue;
+        }
+        /* See recv_data; the writer sequence number follows the writer id
+           at offset 16 of a DATA submessage, high word first. */
+        for (off = 20; off + 4 <= sz; ) {
+            const int le = buf[off+1] & 1;
+            size_t len = le ? (size_t)(buf[off+2] | (buf[off+3] << 8)) : (size_t)((buf[off+2] << 8) | buf[off+3]);
+            if (buf[off] == 0x15 && off + 24 <= sz && (buf[off+15] & 0xc0) == 0 && k < n) {
+                const unsigned char *p = buf + off + 16;
+                uint32_t hi = le ? (uint32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)) : (uint32_t)(((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+                uint32_t lo = le ? (uint32_t)(p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24)) : (uint32_t)(((uint32_t)p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7]);
+                seqs[k++] = ((int64_t)hi << 32) | lo;
+            }
+            if (len == 0) {
+                break;
+            }
+            off += 4 + len;
+        }
+    }
+    return k;
+}
+
+/* Run with SendAsync enabled and two send threads (see CMakeLists.txt) */
+#define NSOCKS 2
+#define NSAMPLES 200
+
+CU_Test(ddsc_write, send_async, .init = setup, .fini = teardown)
+{
+    static int64_t seqs[NSOCKS][NSAMPLES];
+    struct sockaddr_in addr;
+    dds_return_t status;
+    dds_entity_t wri;
+    dds_qos_t *qos;
+    nn_guid_t prd[NSOCKS];
+    os_socket sock[NSOCKS];
+    int i, k;
+
+    CU_ASSERT_FATAL(config.xpack_send_async);
+    CU_ASSERT_FATAL(config.xpack_send_async_threads == 2);
+
+    /* Proxy readers at different sockets are likely to be handled by
+       different send threads, each must get all data in order */
+    for (i = 0; i < NSOCKS; i++) {
+        sock[i] = os_sockNew(AF_INET, SOCK_DGRAM);
+        CU_ASSERT_FATAL(sock[i] != OS_INVALID_SOCKET);
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CU_ASSERT_FATAL(os_sockBind(sock[i], (struct sockaddr *)&addr, sizeof(addr)) == os_resultSuccess);
+        CU_ASSERT_FATAL(os_sockGetsockname(sock[i], (struct sockaddr *)&addr, sizeof(addr)) == os_resultSuccess);
+        prd[i] = create_proxy_endpoint(false, "RoundTrip", RoundTripModule_DataType_desc.m_typename, false, ntohs(addr.sin_port));
+    }
+
+    qos = dds_create_qos();
+    CU_ASSERT_FATAL(qos != NULL);
+    dds_qset_reliability(qos, DDS_RELIABILITY_BEST_EFFORT, 0);
+    wri = dds_create_writer(participant, topic, qos, NULL);
+    dds_delete_qos(qos);
+    CU_ASSERT_FATAL(wri > 0);
+
+    for (k = 0; k < NSAMPLES; k++) {
+        status = dds_write(wri, &data);
+        CU_ASSERT_EQUAL_FATAL(dds_err_nr(status), DDS_RETCODE_OK);
+    }
+    for (i = 0; i < NSOCKS; i++) {
+        CU_ASSERT_EQUAL(recv_seqs(sock[i], DDS_SECS(2), seqs[i], NSAMPLES), NSAMPLES);
+        for (k = 1; k < NSAMPLES; k++) {
+            CU_ASSERT_EQUAL_FATAL(seqs[i][k], seqs[i][k-1] + 1);
+        }
+    }
+
+    dds_delete(wri);
+    for (i = 0; i < NSOCKS; i++) {
+        delete_proxy_endpoint(&prd[i]);
+        os_sockFree(sock[i]);
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef _DDSI_PACER_H_
+#define _DDSI_PACER_H_
+
+#include "ddsi/q_time.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Token bucket for a bandwidth limit, shared by all xpacks sending
+   data subject to that limit (e.g., all writers mapped to a channel).
+   Instead of sleeping after the fact, it assigns each packet a
+   departure time, which the sender then either hands to the kernel or
+   waits for. */
+struct ddsi_pacer;
+
+/* rate in bytes/s, must be > 0 */
+struct ddsi_pacer *ddsi_pacer_new (const char *name, uint32_t rate);
+void ddsi_pacer_free (struct ddsi_pacer *pacer);
+const char *ddsi_pacer_name (const struct ddsi_pacer *pacer);
+
+/* Consumes size bytes worth of tokens and returns the time at which
+   the packet may depart, which is never earlier than tnow */
+nn_mtime_t ddsi_pacer_schedule (struct ddsi_pacer *pacer, nn_mtime_t tnow, size_t size);
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
@@ -68,6 +68,13 @@ struct ddsi_serdata_default {
   struct serdatapool *pool;
   struct ddsi_serdata_default *next; /* in pool->freelist */
 
+  /* non-NULL if the payload was left in the receive buffers rather than
+     copied into data: the (referenced) fragments holding the serialised
+     form, including the CDR header; contig points to the payload if it
+     is in a single, suitably aligned fragment */
+  struct nn_rdata *fragchain;
+  const char *contig;
+
   /* padding to ensure CDRHeader is at an offset 4 mod 8 from the
      start of the memory, so that data is 8-byte aligned provided
      serdata is 8-byte aligned */
@@ -0,0 +1,19 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef _DDSI_SHM_H_
+#define _DDSI_SHM_H_
+
+/* Shared-memory transport for participants on the same host, used in
+   addition to the UDP one; returns -1 if not supported on the platform */
+int ddsi_shm_init (void);
+
+#endif
@@ -34,10 +34,28 @@ typedef struct ddsi_tran_listener * ddsi_tran_listener_t;
 typedef struct ddsi_tran_factory * ddsi_tran_factory_t;
 typedef struct ddsi_tran_qos * ddsi_tran_qos_t;
 
+/* Receive buffer for a batched read: buf and len are set by the caller,
+   size, segsize and srcloc by the transport.  If segsize is not 0, buf
+   holds a number of packets from srcloc of segsize bytes each (the last
+   one may be shorter) that were coalesced by the kernel */
+
+struct ddsi_tran_rxbuf
+{
+  unsigned char *buf;
+  size_t len;
+  size_t size;
+  size_t segsize;
+  nn_locator_t srcloc;
+};
+
 /* Function pointer types */
 
 typedef ssize_t (*ddsi_tran_read_fn_t) (ddsi_tran_conn_t, unsigned char *, size_t, bool, nn_locator_t *);
+typedef ssize_t (*ddsi_tran_read_batch_fn_t) (ddsi_tran_conn_t, struct ddsi_tran_rxbuf *, size_t);
 typedef ssize_t (*ddsi_tran_write_fn_t) (ddsi_tran_conn_t, const nn_locator_t *, size_t, const os_iovec_t *, uint32_t);
+typedef ssize_t (*ddsi_tran_write_multi_fn_t) (ddsi_tran_conn_t, const nn_locator_t *, size_t, size_t, const os_iovec_t *, uint32_t, size_t *);
+typedef ssize_t (*ddsi_tran_write_gso_fn_t) (ddsi_tran_conn_t, const nn_locator_t *, size_t, const os_iovec_t *, size_t, uint32_t);
+typedef ssize_t (*ddsi_tran_write_txtime_fn_t) (ddsi_tran_conn_t, const nn_locator_t *, size_t, const os_iovec_t *, uint32_t, int64_t);
 typedef int (*ddsi_tran_locator_fn_t) (ddsi_tran_base_t, nn_locator_t *);
 typedef bool (*ddsi_tran_supports_fn_t) (int32_t);
 typedef os_socket (*ddsi_tran_handle_fn_t) (ddsi_tran_base_t);
@@ -101,7 +119,11 @@ struct ddsi_tran_conn
   /* Functions */
 
   ddsi_tran_read_fn_t m_read_fn;
+  ddsi_tran_read_batch_fn_t m_read_batch_fn; /* optional, NULL if not supported */
   ddsi_tran_write_fn_t m_write_fn;
+  ddsi_tran_write_multi_fn_t m_write_multi_fn; /* optional, NULL if not supported */
+  ddsi_tran_write_gso_fn_t m_write_gso_fn; /* optional, NULL if not supported */
+  ddsi_tran_write_txtime_fn_t m_write_txtime_fn; /* optional, NULL if not supported */
   ddsi_tran_peer_locator_fn_t m_peer_locator_fn;
   ddsi_tran_disable_multiplexing_fn_t m_disable_multiplexing_fn;
 
@@ -175,7 +197,9 @@ struct ddsi_tran_qos
   /* QoS Data */
 
   bool m_multicast;
+  bool m_reuseport;
   int m_diffserv;
+  bool m_txtime; /* departure times for paced sending, if configured */
 };
 
 void ddsi_tran_factories_fini (void);
@@ -220,9 +244,42 @@ inline int ddsi_conn_locator (ddsi_tran_conn_t conn, nn_locator_t * loc) {
 inline ssize_t ddsi_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags) {
   return conn->m_closed ? -1 : (conn->m_write_fn) (conn, dst, niov, iov, flags);
 }
+inline bool ddsi_conn_supports_write_multi (ddsi_tran_conn_t conn) {
+  return conn->m_write_multi_fn != 0;
+}
+/* Sends the same message to ndsts destinations, returns the number of
+   destinations it was sent to or -1 if it could not be sent to any;
+   *ncalls is set to the number of transmit operations that sent them */
+inline ssize_t ddsi_conn_write_multi (ddsi_tran_conn_t conn, const nn_locator_t *dsts, size_t ndsts, size_t niov, const os_iovec_t *iov, uint32_t flags, size_t *ncalls) {
+  *ncalls = 0;
+  return conn->m_closed ? -1 : (conn->m_write_multi_fn) (conn, dsts, ndsts, niov, iov, flags, ncalls);
+}
+inline bool ddsi_conn_supports_write_gso (ddsi_tran_conn_t conn) {
+  return conn->m_write_gso_fn != 0;
+}
+/* Sends the message in iov as a sequence of packets of segsize bytes
+   each (the last one may be shorter), returns the number of bytes sent
+   or -1 on error */
+inline ssize_t ddsi_conn_write_gso (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, size_t segsize, uint32_t flags) {
+  return conn->m_closed ? -1 : (conn->m_write_gso_fn) (conn, dst, niov, iov, segsize, flags);
+}
+inline bool ddsi_conn_supports_write_txtime (ddsi_tran_conn_t conn) {
+  return conn->m_write_txtime_fn != 0;
+}
+/* Sends the message with a departure time (in monotonic time), the
+   kernel holds on to it until then */
+inline ssize_t ddsi_conn_write_txtime (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags, int64_t txtime) {
+  return conn->m_closed ? -1 : (conn->m_write_txtime_fn) (conn, dst, niov, iov, flags, txtime);
+}
 inline ssize_t ddsi_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, nn_locator_t *srcloc) {
   return conn->m_closed ? -1 : conn->m_read_fn (conn, buf, len, allow_spurious, srcloc);
 }
+inline bool ddsi_conn_supports_read_batch (ddsi_tran_conn_t conn) {
+  return conn->m_read_batch_fn != 0;
+}
+inline ssize_t ddsi_conn_read_batch (ddsi_tran_conn_t conn, struct ddsi_tran_rxbuf *bufs, size_t nbufs) {
+  return conn->m_closed ? -1 : conn->m_read_batch_fn (conn, bufs, nbufs);
+}
 bool ddsi_conn_peer_locator (ddsi_tran_conn_t conn, nn_locator_t * loc);
 void ddsi_conn_disable_multiplexing (ddsi_tran_conn_t conn);
 void ddsi_conn_add_ref (ddsi_tran_conn_t conn);
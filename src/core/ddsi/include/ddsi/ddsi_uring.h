@@ -0,0 +1,19 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef _DDSI_URING_H_
+#define _DDSI_URING_H_
+
+/* Requires ddsi_udp_init to have been called first; returns -1 if io_uring
+   is not available, in which case the plain UDP factory remains in use */
+int ddsi_uring_init (void);
+
+#endif
@@ -15,4 +15,5 @@
 #define DROP_TOO_OLD 2
 #define DROP_REORDER_FULL 3
 #define DROP_DUPLICATE 4
+#define DROP_DEFRAG_FULL 5
 #endif
@@ -15,6 +15,12 @@
 #include <assert.h>
 #include <string.h>
 
+#if defined __AVX2__
+#include <immintrin.h>
+#elif defined __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "ddsi/q_unused.h"
 
 inline int nn_bitset_isset (unsigned numbits, const unsigned *bits, unsigned idx)
@@ -34,21 +40,161 @@ inline void nn_bitset_clear (UNUSED_ARG_NDEBUG (unsigned numbits), unsigned *bit
   bits[idx/32] &= ~(1u << (31 - (idx%32)));
 }
 
-inline void nn_bitset_zero (unsigned numbits, unsigned *bits)
+/* Bits are numbered from the most significant bit of the first word
+   onwards, as in the sequence number and fragment number sets of the
+   DDSI protocol.  The kernels below operate on a word (or a vector of
+   words) at a time, bits in the last word beyond numbits are ignored
+   by the searching and counting ones. */
+
+#if defined __GNUC__
+#define NN_BITSET_CLZ(x) ((unsigned) __builtin_clz (x))
+#define NN_BITSET_POPCOUNT(x) ((unsigned) __builtin_popcount (x))
+#else
+inline unsigned nn_bitset_clz_generic (unsigned x)
 {
-  memset (bits, 0, 4 * ((numbits + 31) / 32));
+  unsigned n = 0;
+  assert (x != 0);
+  while (!(x & 0x80000000u))
+  {
+    x <<= 1;
+    n++;
+  }
+  return n;
 }
 
-inline void nn_bitset_one (unsigned numbits, unsigned *bits)
+inline unsigned nn_bitset_popcount_generic (unsigned x)
+{
+  x = x - ((x >> 1) & 0x55555555u);
+  x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+  x = (x + (x >> 4)) & 0x0f0f0f0fu;
+  return (x * 0x01010101u) >> 24;
+}
+#define NN_BITSET_CLZ(x) nn_bitset_clz_generic (x)
+#define NN_BITSET_POPCOUNT(x) nn_bitset_popcount_generic (x)
+#endif
+
+/* Mask for bits lo .. 31 of a word, resp. for bits 0 .. hi-1 */
+#define NN_BITSET_MASK_FROM(lo) (~0u >> (lo))
+#define NN_BITSET_MASK_UPTO(hi) ((hi) == 0 ? 0u : ~0u << (32 - (hi)))
+
+inline unsigned nn_bitset_skip_words (const unsigned *bits, unsigned w, unsigned nw, unsigned pattern)
+{
+  /* Index of first word in [w,nw) that differs from pattern (all-zero
+     or all-one), or nw if none does.  Only long sets benefit from
+     vectorising it: acknack sets are at most 8 words long, but the
+     fragment bitmaps of large samples are much longer. */
+#if defined __AVX2__
+  {
+    const __m256i p = _mm256_set1_epi32 ((int) pattern);
+    for (; w + 8 <= nw; w += 8)
+    {
+      const __m256i v = _mm256_loadu_si256 ((const __m256i *) (bits + w));
+      if (_mm256_movemask_epi8 (_mm256_cmpeq_epi32 (v, p)) != -1)
+        break;
+    }
+  }
+#elif defined __SSE2__
+  {
+    const __m128i p = _mm_set1_epi32 ((int) pattern);
+    for (; w + 4 <= nw; w += 4)
+    {
+      const __m128i v = _mm_loadu_si128 ((const __m128i *) (bits + w));
+      if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (v, p)) != 0xffff)
+        break;
+    }
+  }
+#endif
+  while (w < nw && bits[w] == pattern)
+    w++;
+  return w;
+}
+
+inline unsigned nn_bitset_find_set (unsigned numbits, const unsigned *bits, unsigned idx)
+{
+  /* Index of first set bit >= idx, or numbits if there is none */
+  const unsigned nw = (numbits + 31) / 32;
+  unsigned w = idx / 32, x;
+  if (idx >= numbits)
+    return numbits;
+  if ((x = bits[w] & NN_BITSET_MASK_FROM (idx % 32)) == 0)
+  {
+    if ((w = nn_bitset_skip_words (bits, w + 1, nw, 0)) == nw)
+      return numbits;
+    x = bits[w];
+  }
+  idx = 32 * w + NN_BITSET_CLZ (x);
+  return (idx < numbits) ? idx : numbits;
+}
+
+inline unsigned nn_bitset_find_clear (unsigned numbits, const unsigned *bits, unsigned idx)
 {
-  memset (bits, 0xff, 4 * ((numbits + 31) / 32));
+  /* Index of first clear bit >= idx, or numbits if there is none */
+  const unsigned nw = (numbits + 31) / 32;
+  unsigned w = idx / 32, x;
+  if (idx >= numbits)
+    return numbits;
+  if ((x = ~bits[w] & NN_BITSET_MASK_FROM (idx % 32)) == 0)
+  {
+    if ((w = nn_bitset_skip_words (bits, w + 1, nw, ~0u)) == nw)
+      return numbits;
+    x = ~bits[w];
+  }
+  idx = 32 * w + NN_BITSET_CLZ (x);
+  return (idx < numbits) ? idx : numbits;
+}
+
+inline unsigned nn_bitset_count_range (UNUSED_ARG_NDEBUG (unsigned numbits), const unsigned *bits, unsigned lo, unsigned hi)
+{
+  /* Number of set bits in [lo,hi) */
+  const unsigned wlo = lo / 32, whi = hi / 32;
+  unsigned n, w;
+  assert (lo <= hi && hi <= numbits);
+  if (lo == hi)
+    return 0;
+  if (wlo == whi)
+    return NN_BITSET_POPCOUNT (bits[wlo] & NN_BITSET_MASK_FROM (lo % 32) & NN_BITSET_MASK_UPTO (hi % 32));
+  n = NN_BITSET_POPCOUNT (bits[wlo] & NN_BITSET_MASK_FROM (lo % 32));
+  for (w = wlo + 1; w < whi; w++)
+    n += NN_BITSET_POPCOUNT (bits[w]);
+  if (hi % 32)
+    n += NN_BITSET_POPCOUNT (bits[whi] & NN_BITSET_MASK_UPTO (hi % 32));
+  return n;
+}
+
+inline unsigned nn_bitset_count (unsigned numbits, const unsigned *bits)
+{
+  return nn_bitset_count_range (numbits, bits, 0, numbits);
+}
 
-  /* clear bits "accidentally" set */
+inline void nn_bitset_set_range (UNUSED_ARG_NDEBUG (unsigned numbits), unsigned *bits, unsigned lo, unsigned hi)
+{
+  /* Sets bits [lo,hi) */
+  const unsigned wlo = lo / 32, whi = hi / 32;
+  assert (lo <= hi && hi <= numbits);
+  if (lo == hi)
+    return;
+  if (wlo == whi)
+    bits[wlo] |= NN_BITSET_MASK_FROM (lo % 32) & NN_BITSET_MASK_UPTO (hi % 32);
+  else
   {
-    const unsigned k = numbits / 32;
-    const unsigned n = numbits % 32;
-    bits[k] &= ~(~0u >> n);
+    bits[wlo] |= NN_BITSET_MASK_FROM (lo % 32);
+    if (whi > wlo + 1)
+      memset (bits + wlo + 1, 0xff, 4 * (whi - wlo - 1));
+    if (hi % 32)
+      bits[whi] |= NN_BITSET_MASK_UPTO (hi % 32);
   }
 }
 
+inline void nn_bitset_zero (unsigned numbits, unsigned *bits)
+{
+  memset (bits, 0, 4 * ((numbits + 31) / 32));
+}
+
+inline void nn_bitset_one (unsigned numbits, unsigned *bits)
+{
+  /* bits in the last word beyond numbits are cleared */
+  nn_bitset_zero (numbits, bits);
+  nn_bitset_set_range (numbits, bits, 0, numbits);
+}
+
 #endif /* NN_BITSET_H */
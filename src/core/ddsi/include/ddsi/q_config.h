@@ -72,6 +72,9 @@ enum durability_cdr
 #define PARTICIPANT_INDEX_AUTO -1
 #define PARTICIPANT_INDEX_NONE -2
 
+/* maximum number of packets read in one go by a receive thread */
+#define MAX_RECV_BATCH_SIZE 64
+
 /* config_listelem must be an overlay for all used listelem types */
 struct config_listelem {
   struct config_listelem *next;
@@ -142,6 +145,8 @@ struct config_channel_listelem {
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
   uint32_t data_bandwidth_limit;
   uint32_t auxiliary_bandwidth_limit;
+  struct ddsi_pacer *data_pacer; /* NULL if unlimited */
+  struct ddsi_pacer *auxiliary_pacer; /* NULL if unlimited */
 #endif
   int    diffserv_field;
   struct thread_state1 *channel_reader_ts;  /* keeping an handle to the running thread for this channel */
@@ -173,6 +178,9 @@ struct config_thread_properties_listelem {
   os_schedClass sched_class;
   struct config_maybe_int32 sched_priority;
   struct config_maybe_uint32 stack_size;
+  os_cpuSet cpu_set;
+  os_numaPolicy numa_policy;
+  uint64_t numa_nodes;
 };
 
 struct config_peer_listelem
@@ -204,7 +212,9 @@ enum transport_selector {
   TRANS_UDP6,
   TRANS_TCP,
   TRANS_TCP6,
-  TRANS_RAWETH
+  TRANS_RAWETH,
+  TRANS_URING, /* UDP using io_uring, mapped to UDP + transport_uring */
+  TRANS_URING6
 };
 
 enum many_sockets_mode {
@@ -213,6 +223,20 @@ enum many_sockets_mode {
   MSM_MANY_UNICAST
 };
 
+enum rbuf_backing {
+  RBB_HEAP,
+  RBB_POPULATE,
+  RBB_HUGEPAGES
+};
+
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+enum pacing_txtime {
+  PTT_NONE,
+  PTT_MONOTONIC,
+  PTT_TAI
+};
+#endif
+
 #ifdef DDSI_INCLUDE_SSL
 struct ssl_min_version {
   int major;
@@ -238,6 +262,7 @@ struct config
   int tracingAppendToFile;
   unsigned allowMulticast;
   enum transport_selector transport_selector;
+  int transport_uring;
   enum boolean_default compat_use_ipv6;
   enum boolean_default compat_tcp_enable;
   int dontRoute;
@@ -266,13 +291,23 @@ struct config
   int noprogress_log_stacktraces;
   int prioritize_retransmit;
   int xpack_send_async;
+  int xpack_send_async_threads;
+  int xpack_send_gso;
+  int uring_send_polling;
   int multiple_recv_threads;
+  int data_uc_recv_threads;
   unsigned recv_thread_stop_maxretries;
+  int recv_batch_size;
+  int recv_gro;
+  int raweth_packet_ring;
+  int shm_transport;
 
   unsigned primary_reorder_maxsamples;
   unsigned secondary_reorder_maxsamples;
 
   unsigned delivery_queue_maxsamples;
+  int user_dqueues;
+  int xevent_queues;
 
   float servicelease_expiry_time;
   float servicelease_update_factor;
@@ -341,6 +376,8 @@ struct config
   int xmit_lossiness;           /**<< fraction of packets to drop on xmit, in units of 1e-3 */
   uint32_t rmsg_chunk_size;          /**<< size of a chunk in the receive buffer */
   uint32_t rbuf_size;                /* << size of a single receiver buffer */
+  enum rbuf_backing rbuf_backing;    /* << memory backing receive buffers */
+  unsigned rbuf_spares;              /* << number of empty receive buffers kept ready per pool */
   enum besmode besmode;
   int aggressive_keep_last_whc;
   int conservative_builtin_reader_startup;
@@ -349,6 +386,7 @@ struct config
   int unicast_response_to_spdp_messages;
   int synchronous_delivery_priority_threshold;
   int64_t synchronous_delivery_latency_bound;
+  int synchronous_delivery_adaptive;
 
   /* Write cache */
 
@@ -374,6 +412,7 @@ struct config
   int64_t ds_grace_period;
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
   uint32_t auxiliary_bandwidth_limit; /* bytes/second */
+  enum pacing_txtime pacing_txtime;
 #endif
   uint32_t max_queued_rexmit_bytes;
   unsigned max_queued_rexmit_msgs;
@@ -382,6 +421,7 @@ struct config
   int retry_on_reject_besteffort;
   int generate_keyhash;
   uint32_t max_sample_size;
+  uint32_t zerocopy_recv_threshold;
 
   /* compability options */
   enum nn_standards_conformance standards_conformance;
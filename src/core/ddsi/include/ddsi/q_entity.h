@@ -349,6 +349,8 @@ struct proxy_writer {
   os_atomic_uint32_t next_deliv_seq_lowword; /* lower 32-bits for next sequence number that will be delivered; for generating acks; 32-bit so atomic reads on all supported platforms */
   unsigned last_fragnum_reset: 1; /* iff set, heartbeat advertising last_seq as highest seq resets last_fragnum */
   unsigned deliver_synchronously: 1; /* iff 1, delivery happens straight from receive thread for non-historical data; else through delivery queue "dqueue" */
+  unsigned deliver_adaptively: 1; /* iff 1 (requires deliver_synchronously), delivery only happens straight from receive thread while none of our samples are waiting in "dqueue" */
+  unsigned sync_delivery_stalled: 1; /* iff 1, a synchronous delivery had to wait for a reader history cache, next samples go through "dqueue" */
   unsigned have_seen_heartbeat: 1; /* iff 1, we have received at least on heartbeat from this proxy writer */
   unsigned assert_pp_lease: 1; /* iff 1, renew the proxy-participant's lease when data comes in */
   unsigned local_matching_inprogress: 1; /* iff 1, we are still busy matching local readers; this is so we don't deliver incoming data to some but not all readers initially */
@@ -358,6 +360,10 @@ struct proxy_writer {
   struct nn_defrag *defrag; /* defragmenter for this proxy writer; FIXME: perhaps shouldn't be for historical data */
   struct nn_reorder *reorder; /* message reordering for this proxy writer, out-of-sync readers can have their own, see pwr_rd_match */
   struct nn_dqueue *dqueue; /* delivery queue for asynchronous delivery (historical data is always delivered asynchronously) */
+  os_atomic_uint32_t n_dqueued; /* number of non-historical samples in "dqueue" not yet delivered, only maintained if deliver_adaptively */
+  uint64_t n_delivered_sync; /* number of samples delivered straight from receive thread */
+  uint64_t n_delivered_async; /* number of non-historical samples handed to "dqueue" */
+  uint32_t n_sync_stalls; /* number of times synchronous delivery had to wait for a reader history cache */
   struct xeventq *evq; /* timed event queue to be used for ACK generation */
   struct local_reader_ary rdary; /* LOCAL readers for fast-pathing; if not fast-pathed, fall back to scanning local_readers */
   ddsi2direct_directread_cb_t ddsi2direct_cb;
@@ -50,6 +50,7 @@ struct ddsi_tran_factory;
 struct ut_thread_pool_s;
 struct debug_monitor;
 struct ddsi_tkmap;
+struct ddsi_pacer;
 
 typedef struct ospl_in_addr_node {
    nn_locator_t loc;
@@ -64,6 +65,8 @@ enum recvips_mode {
   RECVIPS_MODE_SOME             /* explicit list of interfaces; only one requiring recvips */
 };
 
+#define MAX_XEVENT_QUEUES 16
+
 #define N_LEASE_LOCKS_LG2 4
 #define N_LEASE_LOCKS ((int) (1 << N_LEASE_LOCKS_LG2))
 
@@ -75,10 +78,12 @@ enum recv_thread_mode {
 struct recv_thread_arg {
   enum recv_thread_mode mode;
   struct nn_rbufpool *rbpool;
+  int populated; /* 0 until the thread has allocated its receive buffers, then 1 (or -1 on failure) */
   union {
     struct {
       const nn_locator_t *loc;
       struct ddsi_tran_conn *conn;
+      os_sockWaitset ws; /* non-NULL iff conn shares its port with other sockets */
     } single;
     struct {
       os_sockWaitset ws;
@@ -100,8 +105,12 @@ struct q_globals {
      (guid_hash) */
   struct ephash *guid_hash;
 
-  /* Timed events admin */
+  /* Timed events admin: xevents is for discovery and the built-in
+     endpoints, (proxy) writers are spread over the xevent_shards based
+     on a hash of their GUID; xevent_shards[0] = xevents */
   struct xeventq *xevents;
+  unsigned n_xevent_shards;
+  struct xeventq *xevent_shards[MAX_XEVENT_QUEUES];
 
   /* Queue for garbage collection requests */
   struct gcreq_queue *gcreq_queue;
@@ -127,6 +136,22 @@ struct q_globals {
   struct ddsi_tran_conn * disc_conn_uc;
   struct ddsi_tran_conn * data_conn_uc;
 
+  /* Additional sockets bound to the data unicast port using
+     SO_REUSEPORT, each served by its own receive thread; the kernel
+     spreads incoming packets over data_conn_uc and these based on the
+     source address. */
+#define MAX_DATA_UC_RECV_THREADS 16
+#define MAX_USER_DQUEUES 16
+#define MAX_SENDQ_THREADS 16
+  unsigned n_data_conn_uc_shards;
+  struct ddsi_tran_conn * data_conn_uc_shards[MAX_DATA_UC_RECV_THREADS - 1];
+
+  /* Shared-memory connections on the same ports as disc_conn_uc and
+     data_conn_uc (NULL if not enabled); data_conn_shm is also used for
+     sending to shared-memory locators */
+  struct ddsi_tran_conn * disc_conn_shm;
+  struct ddsi_tran_conn * data_conn_shm;
+
   /* TCP listener */
 
   struct ddsi_tran_listener * listener;
@@ -190,6 +215,8 @@ struct q_globals {
   nn_locator_t loc_meta_uc;
   nn_locator_t loc_default_mc;
   nn_locator_t loc_default_uc;
+  nn_locator_t loc_meta_shm;
+  nn_locator_t loc_default_shm;
 
   /*
     Initial discovery address set, and the current discovery address
@@ -209,13 +236,16 @@ struct q_globals {
      trigger socket.) Receive buffer pool is per receive thread,
      it is only a global variable because it needs to be freed way later
      than the receive thread itself terminates */
-#define MAX_RECV_THREADS 3
+#define MAX_RECV_THREADS (2 + MAX_DATA_UC_RECV_THREADS)
   unsigned n_recv_threads;
   struct recv_thread {
     const char *name;
     struct thread_state1 *ts;
     struct recv_thread_arg arg;
   } recv_threads[MAX_RECV_THREADS];
+  /* Signalled (using "lock") when a receive thread has set "populated",
+     only used during start-up */
+  os_cond recv_threads_cond;
 
   /* Listener thread for connection based transports */
   struct thread_state1 *listen_ts;
@@ -272,8 +302,10 @@ struct q_globals {
   uint32_t networkQueueId;
   struct thread_state1 *channel_reader_ts;
 
-  /* Application data gets its own delivery queue */
-  struct nn_dqueue *user_dqueue;
+  /* Application data gets its own delivery queues, each proxy writer
+     is assigned to one of them based on a hash of its GUID */
+  unsigned n_user_dqueues;
+  struct nn_dqueue *user_dqueues[MAX_USER_DQUEUES];
 #endif
 
   /* Transmit side: pools for the serializer & transmit messages and a
@@ -288,13 +320,20 @@ struct q_globals {
      remove the need to include kernelModule.h) */
   uint32_t myNetworkId;
 
-  os_mutex sendq_lock;
-  os_cond sendq_cond;
-  unsigned sendq_length;
-  struct nn_xpack *sendq_head;
-  struct nn_xpack *sendq_tail;
-  int sendq_stop;
-  struct thread_state1 *sendq_ts;
+  unsigned n_sendqs;
+  struct nn_xpack_sendq *sendqs[MAX_SENDQ_THREADS];
+  struct nn_freelist *xpack_pool;
+
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  /* Token bucket for AuxiliaryBandwidthLimit of the global event
+     queue, NULL if unlimited */
+  struct ddsi_pacer *auxiliary_pacer;
+
+  /* Send queues of the token buckets for which the transmit connection
+     can't take departure times, each with a thread of its own so that
+     waiting for one bucket doesn't hold up any other traffic */
+  struct nn_xpack_sendq *paced_sendqs;
+#endif
 
 #ifdef DDSI_INCLUDE_ENCRYPTION
   /* Codecs needed for decoding incoming encrypted messages
@@ -39,6 +39,10 @@ int ddsi2_patmatch (const char *pat, const char *str);
 
 uint32_t crc32_calc (const void *buf, size_t length);
 
+/* Maps a GUID to one of n shards; anything needing all events or samples
+   of an entity to go through the same queue uses this to pick it */
+uint32_t guid_shard (const nn_guid_t *guid, uint32_t n);
+
 #if defined (__cplusplus)
 }
 #endif
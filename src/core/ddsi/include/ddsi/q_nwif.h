@@ -29,7 +29,7 @@ struct nn_interface {
   char *name;
 };
 
-int make_socket (os_socket *socket, unsigned short port, bool stream, bool reuse);
+int make_socket (os_socket *socket, unsigned short port, bool stream, bool reuse, bool reuseport);
 int find_own_ip (const char *requested_address);
 unsigned locator_to_hopefully_unique_uint32 (const nn_locator_t *src);
 
@@ -120,6 +120,7 @@ struct cdrstring {
 #define NN_LOCATOR_KIND_TCPv4 4
 #define NN_LOCATOR_KIND_TCPv6 8
 #define NN_LOCATOR_KIND_RAWETH 0x8000 /* proposed vendor-specific */
+#define NN_LOCATOR_KIND_SHM 0x8001 /* vendor-specific: same-host shared memory */
 #define NN_LOCATOR_KIND_UDPv4MCGEN 0x4fff0000
 #define NN_LOCATOR_PORT_INVALID 0
 
@@ -23,6 +23,7 @@ extern "C" {
 struct nn_rbufpool;
 struct nn_rbuf;
 struct nn_rmsg;
+struct nn_rst_shared;
 struct nn_rdata;
 struct nn_rsample;
 struct nn_rsample_chain;
@@ -47,6 +48,11 @@ struct nn_rmsg_chunk {
      nn_rmsg_setsize after receiving a packet from the kernel and
      before processing it.  */
   uint32_t size;
+
+  /* Maximum size of this chunk, normally the max_rmsg_size of the
+     rbuf, but less for rmsgs in a reserved batch (see
+     nn_rbufpool_batch_reserve).  */
+  uint32_t capacity;
   union {
     /* payload array stretched to whatever it really is */
     unsigned char payload[1];
@@ -93,6 +99,11 @@ struct nn_rmsg {
      the real packet. */
   struct nn_rmsg_chunk *lastchunk;
 
+  /* Receiver state shared with other messages by the rbuf pool's
+     cache, referenced by this message (see nn_rmsg_receiver_state) or
+     NULL. */
+  struct nn_rst_shared *rst_shared;
+
   struct nn_rmsg_chunk chunk;
 };
 #define NN_RMSG_PAYLOAD(m) ((m)->chunk.u.payload)
@@ -194,19 +205,60 @@ typedef int32_t nn_reorder_result_t;
 
 typedef void (*nn_dqueue_callback_t) (void *arg);
 
+/* Number of samples discarded by the receive path, by reason (the
+   DROP_... codes of probes-constants.h) */
+struct nn_rx_drop_stats {
+  uint64_t queue_full;   /* delivery queue full */
+  uint64_t too_old;      /* already delivered or skipped */
+  uint64_t reorder_full; /* reorder admin at its limit */
+  uint64_t duplicate;    /* already stored in the reorder admin */
+  uint64_t defrag_full;  /* defragmenter at its limit */
+};
+
+struct nn_radmin_stats {
+  uint32_t n_samples;
+  uint32_t max_samples;
+  struct nn_rx_drop_stats drops;
+};
+
+struct nn_dqueue_stats {
+  uint32_t n_samples;
+  uint32_t max_samples;
+  uint32_t high_water;
+};
+
+struct nn_rbufpool_stats {
+  uint32_t rbuf_size;
+  uint32_t n_rbufs;      /* allocated, including current and spares */
+  uint32_t n_spares;
+  uint32_t alloc_stalls;
+  uint32_t batch_drops;  /* received packets discarded for lack of an rmsg */
+};
+
+void nn_rx_drop_stats_add (struct nn_rx_drop_stats *a, const struct nn_rx_drop_stats *b);
+
 struct nn_rbufpool *nn_rbufpool_new (uint32_t rbuf_size, uint32_t max_rmsg_size);
 void nn_rbufpool_setowner (struct nn_rbufpool *rbp, os_threadId tid);
+int nn_rbufpool_populate (struct nn_rbufpool *rbp);
 void nn_rbufpool_free (struct nn_rbufpool *rbp);
+uint32_t nn_rbufpool_alloc_stalls (struct nn_rbufpool *rbp);
+void nn_rbufpool_stats (struct nn_rbufpool *rbp, struct nn_rbufpool_stats *st);
 
 struct nn_rmsg *nn_rmsg_new (struct nn_rbufpool *rbufpool);
 void nn_rmsg_setsize (struct nn_rmsg *rmsg, uint32_t size);
 void nn_rmsg_commit (struct nn_rmsg *rmsg);
 void nn_rmsg_free (struct nn_rmsg *rmsg);
 void *nn_rmsg_alloc (struct nn_rmsg *rmsg, uint32_t size);
+struct receiver_state *nn_rmsg_receiver_state (struct nn_rmsg *rmsg, const struct receiver_state *rst);
+
+uint32_t nn_rbufpool_batch_reserve (struct nn_rbufpool *rbp, uint32_t n, uint32_t bufsz, unsigned char **bufs);
+struct nn_rmsg *nn_rmsg_new_from_batch (struct nn_rbufpool *rbp, uint32_t idx, uint32_t size);
+void nn_rbufpool_batch_release (struct nn_rbufpool *rbp);
 
 struct nn_rdata *nn_rdata_new (struct nn_rmsg *rmsg, uint32_t start, uint32_t endp1, uint32_t submsg_offset, uint32_t payload_offset);
 struct nn_rdata *nn_rdata_newgap (struct nn_rmsg *rmsg);
 void nn_fragchain_adjust_refcount (struct nn_rdata *frag, int adjust);
+void nn_fragchain_ref (struct nn_rdata *frag);
 void nn_fragchain_unref (struct nn_rdata *frag);
 
 struct nn_defrag *nn_defrag_new (enum nn_defrag_drop_mode drop_mode, uint32_t max_samples);
@@ -214,6 +266,7 @@ void nn_defrag_free (struct nn_defrag *defrag);
 struct nn_rsample *nn_defrag_rsample (struct nn_defrag *defrag, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo);
 void nn_defrag_notegap (struct nn_defrag *defrag, seqno_t min, seqno_t maxp1);
 int nn_defrag_nackmap (struct nn_defrag *defrag, seqno_t seq, uint32_t maxfragnum, struct nn_fragment_number_set *map, uint32_t maxsz);
+void nn_defrag_stats (const struct nn_defrag *defrag, struct nn_radmin_stats *st);
 
 struct nn_reorder *nn_reorder_new (enum nn_reorder_mode mode, uint32_t max_samples);
 void nn_reorder_free (struct nn_reorder *r);
@@ -224,14 +277,17 @@ nn_reorder_result_t nn_reorder_gap (struct nn_rsample_chain *sc, struct nn_reord
 int nn_reorder_wantsample (struct nn_reorder *reorder, seqno_t seq);
 unsigned nn_reorder_nackmap (struct nn_reorder *reorder, seqno_t base, seqno_t maxseq, struct nn_sequence_number_set *map, uint32_t maxsz, int notail);
 seqno_t nn_reorder_next_seq (const struct nn_reorder *reorder);
+void nn_reorder_stats (const struct nn_reorder *reorder, struct nn_radmin_stats *st);
 
 struct nn_dqueue *nn_dqueue_new (const char *name, uint32_t max_samples, nn_dqueue_handler_t handler, void *arg);
 void nn_dqueue_free (struct nn_dqueue *q);
+const char *nn_dqueue_name (const struct nn_dqueue *q);
 void nn_dqueue_enqueue (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reorder_result_t rres);
 void nn_dqueue_enqueue1 (struct nn_dqueue *q, const nn_guid_t *rdguid, struct nn_rsample_chain *sc, nn_reorder_result_t rres);
 void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, void *arg);
 int  nn_dqueue_is_full (struct nn_dqueue *q);
 void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q);
+void nn_dqueue_stats (struct nn_dqueue *q, struct nn_dqueue_stats *st);
 
 #if defined (__cplusplus)
 }
@@ -26,6 +26,7 @@ struct pwr_rd_match;
 struct participant;
 struct proxy_participant;
 struct ddsi_tran_conn;
+struct ddsi_pacer;
 struct xevent;
 struct xeventq;
 struct proxy_writer;
@@ -36,7 +37,7 @@ struct xeventq *xeventq_new
   struct ddsi_tran_conn * conn,
   size_t max_queued_rexmit_bytes,
   size_t max_queued_rexmit_msgs,
-  uint32_t auxiliary_bandwidth_limit
+  struct ddsi_pacer *auxiliary_pacer
 );
 
 /* xeventq_free calls callback handlers with t = T_NEVER, at which point they are required to free
@@ -45,6 +46,22 @@ DDS_EXPORT void xeventq_free (struct xeventq *evq);
 DDS_EXPORT int xeventq_start (struct xeventq *evq, const char *name); /* <0 => error, =0 => ok */
 DDS_EXPORT void xeventq_stop (struct xeventq *evq);
 
+/* The queue for the heartbeats and retransmits of a writer, or the
+   acknacks for a proxy writer, picked from the event queues of
+   Internal/EventQueues based on a hash of its GUID */
+DDS_EXPORT struct xeventq *xeventq_for_guid (const nn_guid_t *guid);
+
+struct xeventq_stats {
+  uint64_t n_timed;    /* timed events handled */
+  uint64_t n_nontimed; /* messages and retransmits sent */
+  int64_t lag_sum;     /* ns that timed events were handled late, in total ... */
+  int64_t lag_max;     /* ... and at most */
+  size_t queued_rexmit_bytes;
+  size_t queued_rexmit_msgs;
+};
+
+DDS_EXPORT void xeventq_stats (struct xeventq *evq, struct xeventq_stats *st);
+
 DDS_EXPORT void qxev_msg (struct xeventq *evq, struct nn_xmsg *msg);
 DDS_EXPORT void qxev_pwr_entityid (struct proxy_writer * pwr, nn_guid_prefix_t * id);
 DDS_EXPORT void qxev_prd_entityid (struct proxy_reader * prd, nn_guid_prefix_t * id);
@@ -34,6 +34,7 @@ struct nn_xmsg_data;
 struct nn_xmsg;
 struct nn_xpack;
 struct ddsi_plist_sample;
+struct ddsi_pacer;
 
 struct nn_xmsg_marker {
   size_t offset;
@@ -141,12 +142,14 @@ int nn_xmsg_addpar_sentinel_ifparam (struct nn_xmsg *m);
 
 /* XPACK */
 
-struct nn_xpack * nn_xpack_new (ddsi_tran_conn_t conn, uint32_t bw_limit, bool async_mode);
+struct nn_xpack * nn_xpack_new (ddsi_tran_conn_t conn, struct ddsi_pacer *pacer, bool async_mode);
 void nn_xpack_free (struct nn_xpack *xp);
 void nn_xpack_send (struct nn_xpack *xp, bool immediately /* unused */);
+void nn_xpack_send_completed (struct nn_xpack *xp);
 int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flags);
 int64_t nn_xpack_maxdelay (const struct nn_xpack *xp);
 unsigned nn_xpack_packetid (const struct nn_xpack *xp);
+size_t nn_xpack_size (const struct nn_xpack *xp);
 
 /* SENDQ */
 void nn_xpack_sendq_init (void);
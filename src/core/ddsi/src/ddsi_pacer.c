@@ -0,0 +1,79 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <string.h>
+
+#include "os/os.h"
+#include "ddsi/ddsi_pacer.h"
+#include "ddsi/q_config.h"
+#include "ddsi/q_log.h"
+
+/* The bucket is represented by the time at which it will have been
+   drained ("tempty"), i.e., it is full whenever tempty <= tnow. Its
+   depth allows a burst of one maximum-sized message, or 1ms worth of
+   data at high rates, so that a packet need not wait for the sleep
+   granularity of the sender when the rate allows it to go now. */
+
+struct ddsi_pacer {
+  os_mutex lock;
+  uint32_t rate; /* bytes/s */
+  int64_t depth; /* ns */
+  nn_mtime_t tempty;
+  char *name;
+};
+
+static int64_t bytes_to_ns (uint32_t rate, size_t size)
+{
+  return (int64_t) ((double) size * 1e9 / rate);
+}
+
+struct ddsi_pacer *ddsi_pacer_new (const char *name, uint32_t rate)
+{
+  struct ddsi_pacer *pacer = os_malloc (sizeof (*pacer));
+  int64_t depth_msg;
+  assert (rate > 0);
+  os_mutexInit (&pacer->lock);
+  pacer->rate = rate;
+  depth_msg = bytes_to_ns (rate, config.max_msg_size);
+  pacer->depth = (depth_msg > T_MILLISECOND) ? depth_msg : T_MILLISECOND;
+  pacer->tempty.v = 0;
+  pacer->name = os_strdup (name);
+  DDS_LOG(DDS_LC_CONFIG, "pacer %s: %"PRIu32" bytes/s, burst %"PRId64"us\n", pacer->name, rate, pacer->depth / 1000);
+  return pacer;
+}
+
+void ddsi_pacer_free (struct ddsi_pacer *pacer)
+{
+  os_mutexDestroy (&pacer->lock);
+  os_free (pacer->name);
+  os_free (pacer);
+}
+
+const char *ddsi_pacer_name (const struct ddsi_pacer *pacer)
+{
+  return pacer->name;
+}
+
+nn_mtime_t ddsi_pacer_schedule (struct ddsi_pacer *pacer, nn_mtime_t tnow, size_t size)
+{
+  nn_mtime_t tdepart;
+  os_mutexLock (&pacer->lock);
+  if (pacer->tempty.v < tnow.v)
+    pacer->tempty = tnow;
+  /* may go once there is room in the bucket for it */
+  tdepart.v = pacer->tempty.v - pacer->depth;
+  if (tdepart.v < tnow.v)
+    tdepart = tnow;
+  pacer->tempty.v += bytes_to_ns (pacer->rate, size);
+  os_mutexUnlock (&pacer->lock);
+  return tdepart;
+}
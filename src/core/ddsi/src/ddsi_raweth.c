@@ -24,11 +24,34 @@
 #ifdef __linux
 #include <linux/if_packet.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <poll.h>
 #include <ifaddrs.h>
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
 
+#if defined TPACKET3_HDRLEN
+#define DDSI_RAWETH_RING 1
+/* Ring geometry: frames larger than a block can't be received through
+   the ring, 64kB covers even jumbo frames */
+#define RING_BLOCK_SIZE (1u << 16)
+#define RING_BLOCK_COUNT 64u
+#define RING_FRAME_SIZE 2048u
+#define RING_BLOCK_TIMEOUT_MS 1u
+/* TPACKET_ALIGN (sizeof (struct tpacket3_hdr)) without the signed arithmetic */
+#define RING_SLL_OFFSET ((sizeof (struct tpacket3_hdr) + TPACKET_ALIGNMENT - 1) & ~((size_t) TPACKET_ALIGNMENT - 1))
+
+struct ddsi_raweth_ring
+{
+  unsigned char *m_map;
+  size_t m_mapsize;
+  uint32_t m_block;   /* index of block currently being read */
+  uint32_t m_npkts;   /* number of frames remaining in m_block */
+  const struct tpacket3_hdr *m_pkt; /* next frame in m_block, NULL if m_block not yet owned */
+};
+#endif
+
 typedef struct ddsi_tran_factory * ddsi_raweth_factory_t;
 
 typedef struct ddsi_raweth_config
@@ -42,6 +65,9 @@ typedef struct ddsi_raweth_conn
   struct ddsi_tran_conn m_base;
   os_socket m_sock;
   int m_ifindex;
+#ifdef DDSI_RAWETH_RING
+  struct ddsi_raweth_ring *m_ring; /* NULL if not using a receive ring */
+#endif
 }
 * ddsi_raweth_conn_t;
 
@@ -63,6 +89,131 @@ static char *ddsi_raweth_to_string (ddsi_tran_factory_t tran, char *dst, size_t
   return dst;
 }
 
+static void set_srcloc (nn_locator_t *srcloc, const struct sockaddr_ll *src)
+{
+  srcloc->kind = NN_LOCATOR_KIND_RAWETH;
+  srcloc->port = ntohs (src->sll_protocol);
+  memset(srcloc->address, 0, 10);
+  memcpy(srcloc->address + 10, src->sll_addr, 6);
+}
+
+#ifdef DDSI_RAWETH_RING
+static struct tpacket_block_desc *ring_block (const struct ddsi_raweth_ring *ring, uint32_t idx)
+{
+  return (struct tpacket_block_desc *) (ring->m_map + (size_t) idx * RING_BLOCK_SIZE);
+}
+
+static int ring_new (os_socket sock, struct ddsi_raweth_ring **pring)
+{
+  struct ddsi_raweth_ring *ring;
+  struct tpacket_req3 req;
+  int version = TPACKET_V3;
+  void *map;
+
+  memset (&req, 0, sizeof (req));
+  req.tp_block_size = RING_BLOCK_SIZE;
+  req.tp_block_nr = RING_BLOCK_COUNT;
+  req.tp_frame_size = RING_FRAME_SIZE;
+  req.tp_frame_nr = (RING_BLOCK_SIZE / RING_FRAME_SIZE) * RING_BLOCK_COUNT;
+  req.tp_retire_blk_tov = RING_BLOCK_TIMEOUT_MS;
+  if (setsockopt (sock, SOL_PACKET, PACKET_VERSION, &version, sizeof (version)) == -1 ||
+      setsockopt (sock, SOL_PACKET, PACKET_RX_RING, &req, sizeof (req)) == -1)
+  {
+    DDS_WARNING("ddsi_raweth_create_conn: packet ring setup failed (errno %d), using recvmsg\n", os_getErrno ());
+    *pring = NULL;
+    return 0;
+  }
+  if ((map = mmap (NULL, (size_t) RING_BLOCK_SIZE * RING_BLOCK_COUNT, PROT_READ | PROT_WRITE, MAP_SHARED, sock, 0)) == MAP_FAILED)
+  {
+    /* frames now go to the ring, so there is no falling back to recvmsg */
+    DDS_ERROR("ddsi_raweth_create_conn: packet ring mmap failed (errno %d)\n", os_getErrno ());
+    return -1;
+  }
+  ring = os_malloc (sizeof (*ring));
+  ring->m_map = map;
+  ring->m_mapsize = (size_t) RING_BLOCK_SIZE * RING_BLOCK_COUNT;
+  ring->m_block = 0;
+  ring->m_npkts = 0;
+  ring->m_pkt = NULL;
+  *pring = ring;
+  return 0;
+}
+
+static void ring_free (struct ddsi_raweth_ring *ring)
+{
+  munmap (ring->m_map, ring->m_mapsize);
+  os_free (ring);
+}
+
+static void ring_release_block (struct ddsi_raweth_ring *ring)
+{
+  /* all frames have been copied out, hand the block back to the kernel */
+  struct tpacket_block_desc *bd = ring_block (ring, ring->m_block);
+  os_atomic_fence_rel ();
+  bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+  ring->m_block = (ring->m_block + 1) % RING_BLOCK_COUNT;
+  ring->m_pkt = NULL;
+}
+
+static ssize_t ddsi_raweth_conn_read_ring (ddsi_raweth_conn_t uc, unsigned char *buf, size_t len, nn_locator_t *srcloc)
+{
+  struct ddsi_raweth_ring * const ring = uc->m_ring;
+  const struct tpacket3_hdr *pkt;
+  const struct sockaddr_ll *src;
+  size_t n;
+
+  while (ring->m_pkt == NULL)
+  {
+    struct tpacket_block_desc *bd = ring_block (ring, ring->m_block);
+    if ((*(volatile uint32_t *) &bd->hdr.bh1.block_status & TP_STATUS_USER) == 0)
+    {
+      struct pollfd pfd;
+      int err;
+      pfd.fd = uc->m_sock;
+      pfd.events = POLLIN | POLLERR;
+      pfd.revents = 0;
+      if (poll (&pfd, 1, -1) == -1 && (err = os_getErrno ()) != os_sockEINTR)
+      {
+        DDS_ERROR("ddsi_raweth_conn_read: poll sock %d errno %d\n", (int) uc->m_sock, err);
+        return -1;
+      }
+      continue;
+    }
+    os_atomic_fence_acq ();
+    if (bd->hdr.bh1.num_pkts == 0)
+    {
+      ring->m_pkt = (const struct tpacket3_hdr *) bd;
+      ring_release_block (ring);
+      continue;
+    }
+    ring->m_npkts = bd->hdr.bh1.num_pkts;
+    ring->m_pkt = (const struct tpacket3_hdr *) ((const unsigned char *) bd + bd->hdr.bh1.offset_to_first_pkt);
+  }
+
+  pkt = ring->m_pkt;
+  src = (const struct sockaddr_ll *) ((const unsigned char *) pkt + RING_SLL_OFFSET);
+  n = pkt->tp_snaplen;
+  if (n > len || pkt->tp_snaplen < pkt->tp_len)
+  {
+    DDS_WARNING("[%02x:%02x:%02x:%02x:%02x:%02x]:%u => %u truncated to %u\n",
+                src->sll_addr[0], src->sll_addr[1], src->sll_addr[2],
+                src->sll_addr[3], src->sll_addr[4], src->sll_addr[5], ntohs (src->sll_protocol),
+                (unsigned) pkt->tp_len, (unsigned) (n > len ? len : n));
+    if (n > len)
+      n = len;
+  }
+  memcpy (buf, (const unsigned char *) pkt + pkt->tp_net, n);
+  if (srcloc)
+    set_srcloc (srcloc, src);
+
+  if (--ring->m_npkts > 0)
+    ring->m_pkt = (const struct tpacket3_hdr *) ((const unsigned char *) pkt + pkt->tp_next_offset);
+  else
+    ring_release_block (ring);
+  return (ssize_t) n;
+}
+#endif
+
 static ssize_t ddsi_raweth_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, nn_locator_t *srcloc)
 {
   int err;
@@ -73,6 +224,11 @@ static ssize_t ddsi_raweth_conn_read (ddsi_tran_conn_t conn, unsigned char * buf
   socklen_t srclen = (socklen_t) sizeof (src);
   (void) allow_spurious;
 
+#ifdef DDSI_RAWETH_RING
+  if (((ddsi_raweth_conn_t) conn)->m_ring)
+    return ddsi_raweth_conn_read_ring ((ddsi_raweth_conn_t) conn, buf, len, srcloc);
+#endif
+
   msg_iov.iov_base = (void*) buf;
   msg_iov.iov_len = len;
 
@@ -91,12 +247,7 @@ static ssize_t ddsi_raweth_conn_read (ddsi_tran_conn_t conn, unsigned char * buf
   if (ret > 0)
   {
     if (srcloc)
-    {
-      srcloc->kind = NN_LOCATOR_KIND_RAWETH;
-      srcloc->port = ntohs (src.sll_protocol);
-      memset(srcloc->address, 0, 10);
-      memcpy(srcloc->address + 10, src.sll_addr, 6);
-    }
+      set_srcloc (srcloc, &src);
 
     /* Check for udp packet truncation */
     if ((((size_t) ret) > len)
@@ -233,6 +384,14 @@ static ddsi_tran_conn_t ddsi_raweth_create_conn (uint32_t port, ddsi_tran_qos_t
   memset (uc, 0, sizeof (*uc));
   uc->m_sock = sock;
   uc->m_ifindex = addr.sll_ifindex;
+#ifdef DDSI_RAWETH_RING
+  if (config.raweth_packet_ring && ring_new (sock, &uc->m_ring) < 0)
+  {
+    close(sock);
+    os_free (uc);
+    return NULL;
+  }
+#endif
   ddsi_factory_conn_init (&ddsi_raweth_factory_g, &uc->m_base);
   uc->m_base.m_base.m_port = port;
   uc->m_base.m_base.m_trantype = DDSI_TRAN_CONN;
@@ -243,7 +402,11 @@ static ddsi_tran_conn_t ddsi_raweth_create_conn (uint32_t port, ddsi_tran_qos_t
   uc->m_base.m_write_fn = ddsi_raweth_conn_write;
   uc->m_base.m_disable_multiplexing_fn = 0;
 
+#ifdef DDSI_RAWETH_RING
+  DDS_TRACE("ddsi_raweth_create_conn %s socket %d port %u%s\n", mcast ? "multicast" : "unicast", uc->m_sock, uc->m_base.m_base.m_port, uc->m_ring ? " ring" : "");
+#else
   DDS_TRACE("ddsi_raweth_create_conn %s socket %d port %u\n", mcast ? "multicast" : "unicast", uc->m_sock, uc->m_base.m_base.m_port);
+#endif
   return uc ? &uc->m_base : NULL;
 }
 
@@ -302,6 +465,10 @@ static void ddsi_raweth_release_conn (ddsi_tran_conn_t conn)
     uc->m_sock,
     uc->m_base.m_base.m_port
   );
+#ifdef DDSI_RAWETH_RING
+  if (uc->m_ring)
+    ring_free (uc->m_ring);
+#endif
   os_sockFree (uc->m_sock);
   os_free (conn);
 }
@@ -206,6 +206,11 @@ static void serdata_default_free(struct ddsi_serdata *dcmn)
 {
   struct ddsi_serdata_default *d = (struct ddsi_serdata_default *)dcmn;
   assert(os_atomic_ld32(&d->c.refc) == 0);
+  if (d->fragchain)
+  {
+    nn_fragchain_unref (d->fragchain);
+    d->fragchain = NULL;
+  }
   if (!nn_freelist_push (&gv.serpool->freelist, d))
     dds_free (d);
 }
@@ -219,6 +224,8 @@ static void serdata_default_init(struct ddsi_serdata_default *d, const struct dd
 #endif
   d->hdr.identifier = tp->native_encoding_identifier;
   d->hdr.options = 0;
+  d->fragchain = NULL;
+  d->contig = NULL;
   memset (d->keyhash.m_hash, 0, sizeof (d->keyhash.m_hash));
   d->keyhash.m_set = 0;
   d->keyhash.m_iskey = 0;
@@ -244,6 +251,59 @@ static struct ddsi_serdata_default *serdata_default_new(const struct ddsi_sertop
   return d;
 }
 
+static const unsigned char *fragment_payload (const struct nn_rdata *frag)
+{
+  return NN_RMSG_PAYLOADOFF (frag->rmsg, NN_RDATA_PAYLOAD_OFF (frag));
+}
+
+/* Copy bytes [off,off+sz) of the serialised form referenced by d->fragchain, padding beyond the end with 0s */
+static void serdata_default_copy_fragchain (const struct ddsi_serdata_default *d, size_t off, size_t sz, void *buf)
+{
+  const struct nn_rdata *frag;
+  const size_t endp1 = off + sz;
+  char *dst = buf;
+  for (frag = d->fragchain; frag && off < endp1; frag = frag->nextfrag)
+  {
+    if (frag->maxp1 > off)
+    {
+      const size_t n = ((endp1 < frag->maxp1) ? endp1 : frag->maxp1) - off;
+      assert (frag->min <= off);
+      memcpy (dst, fragment_payload (frag) + off - frag->min, n);
+      dst += n;
+      off += n;
+    }
+  }
+  if (off < endp1)
+    memset (dst, 0, endp1 - off);
+}
+
+/* Address of bytes [off,off+sz) of the serialised form referenced by d->fragchain, or NULL if not in a single fragment */
+static const char *serdata_default_ref_fragchain (const struct ddsi_serdata_default *d, size_t off, size_t sz)
+{
+  const struct nn_rdata *frag;
+  for (frag = d->fragchain; frag && frag->min <= off; frag = frag->nextfrag)
+  {
+    if (off + sz <= frag->maxp1)
+      return (const char *) fragment_payload (frag) + off - frag->min;
+  }
+  return NULL;
+}
+
+static bool serdata_default_may_ref_fragchain (const struct ddsi_sertopic *tpcmn, enum ddsi_serdata_kind kind, const struct nn_rdata *fragchain, size_t size)
+{
+  /* Only for the CDR representation of application data: discovery data is tiny and
+     short-lived anyway. Key extraction needs a contiguous payload, so samples of topics
+     with a key are only referenced if they arrived in a single fragment. */
+  if (config.zerocopy_recv_threshold == 0 || size < config.zerocopy_recv_threshold || kind != SDK_DATA)
+    return false;
+  else if (tpcmn->serdata_ops == &ddsi_serdata_ops_cdr_nokey)
+    return true;
+  else if (tpcmn->serdata_ops == &ddsi_serdata_ops_cdr)
+    return fragchain->maxp1 >= size;
+  else
+    return false;
+}
+
 /* Construct a serdata from a fragchain received over the network */
 static struct ddsi_serdata_default *serdata_default_from_ser_common (const struct ddsi_sertopic *tpcmn, enum ddsi_serdata_kind kind, const struct nn_rdata *fragchain, size_t size)
 {
@@ -253,11 +313,39 @@ static struct ddsi_serdata_default *serdata_default_from_ser_common (const struc
 
   assert (fragchain->min == 0);
   assert (fragchain->maxp1 >= off); /* CDR header must be in first fragment */
-  (void)size;
 
-  memcpy (&d->hdr, NN_RMSG_PAYLOADOFF (fragchain->rmsg, NN_RDATA_PAYLOAD_OFF (fragchain)), sizeof (d->hdr));
+  memcpy (&d->hdr, fragment_payload (fragchain), sizeof (d->hdr));
   assert (d->hdr.identifier == CDR_LE || d->hdr.identifier == CDR_BE);
 
+  if (serdata_default_may_ref_fragchain (tpcmn, kind, fragchain, size))
+  {
+    /* Keep the payload where it is, the fragchain is only guaranteed to remain valid
+       during this call so it needs references of its own */
+    d->fragchain = (struct nn_rdata *) fragchain;
+    nn_fragchain_ref (d->fragchain);
+    d->pos = (uint32_t) size - off;
+    if (fragchain->maxp1 >= size)
+    {
+      const char *p = (const char *) fragment_payload (fragchain) + off;
+      if (((uintptr_t) p % 8) == 0)
+        d->contig = p;
+    }
+    if (d->contig == NULL && tp->nkeys > 0)
+    {
+      /* misaligned payload: key extraction needs a copy after all */
+      nn_fragchain_unref (d->fragchain);
+      d->fragchain = NULL;
+      d->pos = 0;
+    }
+    else
+    {
+      dds_stream_t is;
+      dds_stream_from_serdata_default (&is, d);
+      dds_stream_read_keyhash (&is, &d->keyhash, (const dds_topic_descriptor_t *)tp->type, false);
+      return d;
+    }
+  }
+
   while (fragchain)
   {
     assert (fragchain->min <= off);
@@ -265,7 +353,7 @@ static struct ddsi_serdata_default *serdata_default_from_ser_common (const struc
     if (fragchain->maxp1 > off)
     {
       /* only copy if this fragment adds data */
-      const unsigned char *payload = NN_RMSG_PAYLOADOFF (fragchain->rmsg, NN_RDATA_PAYLOAD_OFF (fragchain));
+      const unsigned char *payload = fragment_payload (fragchain);
       serdata_default_append_blob (&d, 1, fragchain->maxp1 - off, payload + off - fragchain->min);
       off = fragchain->maxp1;
     }
@@ -454,6 +542,7 @@ static struct ddsi_serdata *serdata_default_to_topicless (const struct ddsi_serd
       const struct dds_topic_descriptor *desc = tp->type;
       dds_stream_t is, os;
       uint32_t nbytes;
+      assert (d->fragchain == NULL || d->contig != NULL);
       dds_stream_from_serdata_default (&is, d);
       dds_stream_from_serdata_default (&os, d_tl);
       nbytes = dds_stream_extract_key (&is, &os, desc->m_ops, false);
@@ -475,7 +564,10 @@ static void serdata_default_to_ser (const struct ddsi_serdata *serdata_common, s
   const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *)serdata_common;
   assert (off < d->pos + sizeof(struct CDRHeader));
   assert (sz <= alignup_size (d->pos + sizeof(struct CDRHeader), 4) - off);
-  memcpy (buf, (char *)&d->hdr + off, sz);
+  if (d->fragchain)
+    serdata_default_copy_fragchain (d, off, sz, buf);
+  else
+    memcpy (buf, (char *)&d->hdr + off, sz);
 }
 
 static struct ddsi_serdata *serdata_default_to_ser_ref (const struct ddsi_serdata *serdata_common, size_t off, size_t sz, os_iovec_t *ref)
@@ -483,8 +575,18 @@ static struct ddsi_serdata *serdata_default_to_ser_ref (const struct ddsi_serdat
   const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *)serdata_common;
   assert (off < d->pos + sizeof(struct CDRHeader));
   assert (sz <= alignup_size (d->pos + sizeof(struct CDRHeader), 4) - off);
-  ref->iov_base = (char *)&d->hdr + off;
   ref->iov_len = (os_iov_len_t)sz;
+  if (d->fragchain == NULL)
+    ref->iov_base = (char *)&d->hdr + off;
+  else if ((ref->iov_base = (void *) serdata_default_ref_fragchain (d, off, sz)) == NULL)
+  {
+    /* range spans fragments (or the padding at the end): hand out a copy of just this range
+       instead, which will be freed by to_ser_unref */
+    struct ddsi_serdata_default *c = serdata_default_new ((const struct ddsi_sertopic_default *)d->c.topic, d->c.kind);
+    serdata_default_copy_fragchain (d, off, sz, serdata_default_append (&c, sz));
+    ref->iov_base = c->data;
+    return &c->c;
+  }
   return ddsi_serdata_ref(serdata_common);
 }
 
@@ -498,12 +600,22 @@ static bool serdata_default_to_sample_cdr (const struct ddsi_serdata *serdata_co
 {
   const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *)serdata_common;
   dds_stream_t is;
+  void *tmp = NULL;
   if (bufptr) abort(); else { (void)buflim; } /* FIXME: haven't implemented that bit yet! */
   dds_stream_from_serdata_default(&is, d);
+  if (d->fragchain && d->contig == NULL)
+  {
+    /* fragmented or misaligned payload in the receive buffers: this is where it gets copied */
+    tmp = os_malloc (d->pos);
+    serdata_default_copy_fragchain (d, sizeof (struct CDRHeader), d->pos, tmp);
+    is.m_buffer.pv = tmp;
+    is.m_size = d->pos;
+  }
   if (d->c.kind == SDK_KEY)
     dds_stream_read_key (&is, sample, (const dds_topic_descriptor_t*) ((struct ddsi_sertopic_default *)d->c.topic)->type);
   else
     dds_stream_read_sample (&is, sample, (const struct ddsi_sertopic_default *)d->c.topic);
+  os_free (tmp);
   return true; /* FIXME: can't conversion to sample fail? */
 }
 
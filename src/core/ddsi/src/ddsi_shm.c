@@ -0,0 +1,671 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include "os/os.h"
+#include "os/os_atomics.h"
+#include "ddsi/ddsi_tran.h"
+#include "ddsi/ddsi_shm.h"
+#include "ddsi/q_config.h"
+#include "ddsi/q_globals.h"
+#include "ddsi/q_log.h"
+
+#if defined __linux
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* The shared-memory transport carries the unicast traffic between
+   processes on the same host.  Every connection owns a segment named
+   after the host id and its port, in which it receives messages; the
+   port is that of the UDP connection it accompanies, and so is unique.
+
+   The segment holds a bounded multi-producer, single-consumer ring of
+   fixed-size slots, each with a sequence number that tells whether it
+   is free for the writer claiming it or ready for the reader (Vyukov's
+   bounded queue).  Writers claim a slot by advancing the tail, copy the
+   message into it and then publish it; if the ring is full the message
+   is dropped, just like UDP would when the socket buffer is full.
+
+   The receive threads wait for sockets, so each connection also has a
+   datagram socket in the abstract unix namespace that serves as a
+   doorbell and as the handle for the socket waitset.  The reader sets
+   "sleeping" once it runs out of messages, and only a writer that
+   resets it rings the doorbell, so a burst of messages costs a single
+   wakeup.  The doorbell is only drained when the ring is empty, which
+   keeps the socket readable while messages remain and so works with a
+   level-triggered waitset that calls read once per wakeup.
+
+   The host id is derived from the boot id, the identity of /dev/shm,
+   the network namespace and the effective user id: only processes that
+   agree on all of these can reach each other's segments and doorbells,
+   and it determines whether a shared-memory locator is usable.  */
+
+#define SHM_MAGIC 0x4d485343u /* "CSHM" */
+#define SHM_NSLOTS 64u
+#define SHM_SLOT_SIZE 65536u
+
+struct shm_ring {
+  uint32_t magic;
+  uint32_t nslots;
+  uint32_t slotsize;
+  os_atomic_uint32_t closed;   /* set when the owner goes away */
+  os_atomic_uint32_t sleeping; /* owner needs the doorbell rung */
+  char pad0[64 - 5 * sizeof (uint32_t)];
+  os_atomic_uint32_t tail;     /* next slot to be claimed by a writer */
+  char pad1[64 - sizeof (uint32_t)];
+};
+
+struct shm_slot {
+  os_atomic_uint32_t seq;
+  uint32_t len;
+  uint32_t srcport;
+  uint32_t pad;
+};
+
+#define SHM_MAX_MSG (SHM_SLOT_SIZE - sizeof (struct shm_slot))
+#define SHM_MAPSIZE (sizeof (struct shm_ring) + (size_t) SHM_NSLOTS * SHM_SLOT_SIZE)
+
+struct shm_peer {
+  uint32_t port;
+  struct shm_ring *ring;
+  struct sockaddr_un addr;
+  socklen_t addrlen;
+};
+
+typedef struct ddsi_shm_conn
+{
+  struct ddsi_tran_conn m_base;
+  os_socket m_sock;
+  struct shm_ring *m_ring;
+  uint32_t m_head;
+  struct sockaddr_un m_addr;
+  socklen_t m_addrlen;
+  char m_name[64];
+}
+* ddsi_shm_conn_t;
+
+struct ddsi_shm_config
+{
+  uint64_t hostid;
+  /* segments of peers written to, protected by lock */
+  os_rwlock lock;
+  uint32_t npeers, peers_size;
+  struct shm_peer *peers;
+};
+
+static struct ddsi_shm_config ddsi_shm_config_g;
+static struct ddsi_tran_factory ddsi_shm_factory_g;
+static os_atomic_uint32_t init_g = OS_ATOMIC_UINT32_INIT(0);
+
+static uint64_t fnv1a (uint64_t h, const void *data, size_t len)
+{
+  const unsigned char *p = data;
+  size_t i;
+  for (i = 0; i < len; i++)
+    h = (h ^ p[i]) * UINT64_C (1099511628211);
+  return h;
+}
+
+static int shm_host_id (uint64_t *hostid)
+{
+  uint64_t h = UINT64_C (14695981039346656037);
+  char bootid[64];
+  struct stat st;
+  uid_t uid = geteuid ();
+  ssize_t n;
+  int fd;
+  /* Without the boot id we can't tell processes in different containers
+     on different machines apart */
+  if ((fd = open ("/proc/sys/kernel/random/boot_id", O_RDONLY)) < 0)
+    return -1;
+  n = read (fd, bootid, sizeof (bootid));
+  close (fd);
+  if (n <= 0)
+    return -1;
+  h = fnv1a (h, bootid, (size_t) n);
+  if (stat ("/dev/shm", &st) < 0)
+    return -1;
+  h = fnv1a (h, &st.st_dev, sizeof (st.st_dev));
+  h = fnv1a (h, &st.st_ino, sizeof (st.st_ino));
+  if (stat ("/proc/self/ns/net", &st) == 0)
+    h = fnv1a (h, &st.st_ino, sizeof (st.st_ino));
+  h = fnv1a (h, &uid, sizeof (uid));
+  *hostid = h;
+  return 0;
+}
+
+static void shm_segment_name (char *dst, size_t size, uint32_t port)
+{
+  (void) snprintf (dst, size, "/cyclonedds-%016"PRIx64"-%u", ddsi_shm_config_g.hostid, port);
+}
+
+static void shm_doorbell_addr (struct sockaddr_un *addr, socklen_t *addrlen, uint32_t port)
+{
+  /* abstract namespace: leading nul byte, no terminator */
+  int n;
+  memset (addr, 0, sizeof (*addr));
+  addr->sun_family = AF_UNIX;
+  n = snprintf (addr->sun_path + 1, sizeof (addr->sun_path) - 1, "cyclonedds-%016"PRIx64"-%u", ddsi_shm_config_g.hostid, port);
+  *addrlen = (socklen_t) (offsetof (struct sockaddr_un, sun_path) + 1 + (size_t) n);
+}
+
+static struct shm_slot *shm_slot (struct shm_ring *ring, uint32_t idx)
+{
+  return (struct shm_slot *) ((char *) (ring + 1) + (size_t) (idx & (ring->nslots - 1)) * ring->slotsize);
+}
+
+static void copy_from_iov (unsigned char *dst, size_t niov, const os_iovec_t *iov, size_t off, size_t len)
+{
+  size_t i;
+  for (i = 0; i < niov && len > 0; i++)
+  {
+    if (off >= (size_t) iov[i].iov_len)
+      off -= (size_t) iov[i].iov_len;
+    else
+    {
+      size_t n = (size_t) iov[i].iov_len - off;
+      if (n > len)
+        n = len;
+      memcpy (dst, (const unsigned char *) iov[i].iov_base + off, n);
+      dst += n;
+      len -= n;
+      off = 0;
+    }
+  }
+}
+
+static int shm_enqueue (struct shm_ring *ring, uint32_t srcport, size_t niov, const os_iovec_t *iov, size_t off, size_t len)
+{
+  uint32_t pos = os_atomic_ld32 (&ring->tail);
+  struct shm_slot *slot;
+  for (;;)
+  {
+    int32_t dif;
+    slot = shm_slot (ring, pos);
+    dif = (int32_t) (os_atomic_ld32 (&slot->seq) - pos);
+    if (dif == 0 && os_atomic_cas32 (&ring->tail, pos, pos + 1))
+      break;
+    else if (dif < 0)
+      return -1;
+    pos = os_atomic_ld32 (&ring->tail);
+  }
+  os_atomic_fence_acq ();
+  copy_from_iov ((unsigned char *) (slot + 1), niov, iov, off, len);
+  slot->len = (uint32_t) len;
+  slot->srcport = srcport;
+  os_atomic_fence_rel ();
+  os_atomic_st32 (&slot->seq, pos + 1);
+  return 0;
+}
+
+static void shm_doorbell_ring (os_socket sock, const struct sockaddr_un *addr, socklen_t addrlen)
+{
+  char b = 0;
+  (void) sendto (sock, &b, 1, MSG_DONTWAIT, (const struct sockaddr *) addr, addrlen);
+}
+
+static void shm_notify (ddsi_shm_conn_t c, const struct shm_peer *peer)
+{
+  /* pairs with the fence between setting "sleeping" and checking for messages in read */
+  os_atomic_fence ();
+  if (os_atomic_ld32 (&peer->ring->sleeping) && os_atomic_cas32 (&peer->ring->sleeping, 1, 0))
+    shm_doorbell_ring (c->m_sock, &peer->addr, peer->addrlen);
+}
+
+static struct shm_ring *shm_map (int fd)
+{
+  void *map;
+  if ((map = mmap (NULL, SHM_MAPSIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    return NULL;
+  return map;
+}
+
+static struct shm_peer *shm_peer_lookup (uint32_t port)
+{
+  uint32_t i;
+  for (i = 0; i < ddsi_shm_config_g.npeers; i++)
+    if (ddsi_shm_config_g.peers[i].port == port)
+      return &ddsi_shm_config_g.peers[i];
+  return NULL;
+}
+
+static int shm_peer_open (uint32_t port)
+{
+  /* (Re)maps the segment of the peer with the given port, removes it from the
+     cache if it no longer exists; called with the lock held for writing */
+  struct shm_peer *peer = shm_peer_lookup (port);
+  struct shm_ring *ring = NULL;
+  char name[64];
+  struct stat st;
+  int fd;
+
+  if (peer && !os_atomic_ld32 (&peer->ring->closed))
+    return 0;
+  shm_segment_name (name, sizeof (name), port);
+  if ((fd = shm_open (name, O_RDWR, 0)) >= 0)
+  {
+    if (fstat (fd, &st) == 0 && (size_t) st.st_size == SHM_MAPSIZE && (ring = shm_map (fd)) != NULL)
+    {
+      if (ring->magic != SHM_MAGIC || ring->nslots != SHM_NSLOTS || ring->slotsize != SHM_SLOT_SIZE || os_atomic_ld32 (&ring->closed))
+      {
+        munmap (ring, SHM_MAPSIZE);
+        ring = NULL;
+      }
+    }
+    close (fd);
+  }
+
+  if (peer)
+  {
+    munmap (peer->ring, SHM_MAPSIZE);
+    if (ring == NULL)
+      *peer = ddsi_shm_config_g.peers[--ddsi_shm_config_g.npeers];
+  }
+  if (ring == NULL)
+  {
+    DDS_TRACE("ddsi_shm: segment %s not available\n", name);
+    return -1;
+  }
+  if (peer == NULL)
+  {
+    if (ddsi_shm_config_g.npeers == ddsi_shm_config_g.peers_size)
+    {
+      ddsi_shm_config_g.peers_size = ddsi_shm_config_g.peers_size ? 2 * ddsi_shm_config_g.peers_size : 8;
+      ddsi_shm_config_g.peers = os_realloc (ddsi_shm_config_g.peers, ddsi_shm_config_g.peers_size * sizeof (*ddsi_shm_config_g.peers));
+    }
+    peer = &ddsi_shm_config_g.peers[ddsi_shm_config_g.npeers++];
+    peer->port = port;
+    shm_doorbell_addr (&peer->addr, &peer->addrlen, port);
+  }
+  peer->ring = ring;
+  DDS_TRACE("ddsi_shm: mapped segment %s\n", name);
+  return 0;
+}
+
+static ssize_t ddsi_shm_conn_write_segs (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, size_t segsize)
+{
+  /* Enqueues the contents of iov as messages of segsize bytes (the last one
+     may be shorter) followed by at most one doorbell, returns the number of
+     bytes enqueued or -1 if none could be */
+  ddsi_shm_conn_t c = (ddsi_shm_conn_t) conn;
+  const struct shm_peer *peer;
+  size_t i, len, off;
+
+  for (i = 0, len = 0; i < niov; i++)
+    len += (size_t) iov[i].iov_len;
+  if (segsize > SHM_MAX_MSG)
+  {
+    DDS_ERROR("ddsi_shm_conn_write: message of %"PRIuSIZE" bytes too large\n", segsize);
+    return -1;
+  }
+
+  os_rwlockRead (&ddsi_shm_config_g.lock);
+  if ((peer = shm_peer_lookup (dst->port)) == NULL || os_atomic_ld32 (&peer->ring->closed))
+  {
+    int rc;
+    os_rwlockUnlock (&ddsi_shm_config_g.lock);
+    os_rwlockWrite (&ddsi_shm_config_g.lock);
+    rc = shm_peer_open (dst->port);
+    os_rwlockUnlock (&ddsi_shm_config_g.lock);
+    if (rc < 0)
+      return -1;
+    os_rwlockRead (&ddsi_shm_config_g.lock);
+    if ((peer = shm_peer_lookup (dst->port)) == NULL)
+    {
+      os_rwlockUnlock (&ddsi_shm_config_g.lock);
+      return -1;
+    }
+  }
+  for (off = 0; off < len; off += segsize)
+  {
+    const size_t n = (len - off < segsize) ? len - off : segsize;
+    if (shm_enqueue (peer->ring, c->m_base.m_base.m_port, niov, iov, off, n) < 0)
+    {
+      DDS_TRACE("ddsi_shm_conn_write: ring of port %u full\n", dst->port);
+      break;
+    }
+  }
+  if (off > 0)
+    shm_notify (c, peer);
+  os_rwlockUnlock (&ddsi_shm_config_g.lock);
+  return (off > 0) ? (ssize_t) (off < len ? off : len) : -1;
+}
+
+static ssize_t ddsi_shm_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags)
+{
+  size_t i, len;
+  (void) flags;
+  for (i = 0, len = 0; i < niov; i++)
+    len += (size_t) iov[i].iov_len;
+  return ddsi_shm_conn_write_segs (conn, dst, niov, iov, len);
+}
+
+static ssize_t ddsi_shm_conn_write_multi (ddsi_tran_conn_t conn, const nn_locator_t *dsts, size_t ndsts, size_t niov, const os_iovec_t *iov, uint32_t flags, size_t *ncalls)
+{
+  ssize_t nsent = 0;
+  size_t i;
+  for (i = 0; i < ndsts; i++)
+    if (ddsi_shm_conn_write (conn, &dsts[i], niov, iov, flags) > 0)
+      nsent++;
+  *ncalls = (size_t) nsent;
+  return (nsent > 0) ? nsent : -1;
+}
+
+static ssize_t ddsi_shm_conn_write_gso (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, size_t segsize, uint32_t flags)
+{
+  (void) flags;
+  return ddsi_shm_conn_write_segs (conn, dst, niov, iov, segsize);
+}
+
+static void shm_set_locator (nn_locator_t *loc, uint32_t port)
+{
+  loc->kind = NN_LOCATOR_KIND_SHM;
+  loc->port = port;
+  memset (loc->address, 0, sizeof (loc->address));
+  memcpy (loc->address, &ddsi_shm_config_g.hostid, sizeof (ddsi_shm_config_g.hostid));
+}
+
+static void shm_doorbell_drain (ddsi_shm_conn_t c)
+{
+  char buf[16];
+  while (recv (c->m_sock, buf, sizeof (buf), MSG_DONTWAIT) > 0)
+    ;
+}
+
+static ssize_t ddsi_shm_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, nn_locator_t *srcloc)
+{
+  ddsi_shm_conn_t c = (ddsi_shm_conn_t) conn;
+  struct shm_ring * const ring = c->m_ring;
+  struct shm_slot *slot = shm_slot (ring, c->m_head);
+  size_t n;
+  (void) allow_spurious;
+
+  if (os_atomic_ld32 (&slot->seq) != c->m_head + 1)
+  {
+    /* Out of messages: swallow the doorbell, then ask to be woken up.  A
+       writer may have added a message just before that without ringing,
+       in which case ring it ourselves. */
+    shm_doorbell_drain (c);
+    os_atomic_st32 (&ring->sleeping, 1);
+    os_atomic_fence ();
+    if (os_atomic_ld32 (&slot->seq) == c->m_head + 1 && os_atomic_cas32 (&ring->sleeping, 1, 0))
+      shm_doorbell_ring (c->m_sock, &c->m_addr, c->m_addrlen);
+    return 0;
+  }
+  os_atomic_fence_acq ();
+  n = slot->len;
+  if (n > len)
+  {
+    DDS_WARNING("shm/%u => %"PRIuSIZE" truncated to %"PRIuSIZE"\n", slot->srcport, n, len);
+    n = len;
+  }
+  memcpy (buf, slot + 1, n);
+  if (srcloc)
+    shm_set_locator (srcloc, slot->srcport);
+  os_atomic_fence_rel ();
+  os_atomic_st32 (&slot->seq, c->m_head + ring->nslots);
+  c->m_head++;
+  return (ssize_t) n;
+}
+
+static os_socket ddsi_shm_conn_handle (ddsi_tran_base_t base)
+{
+  return ((ddsi_shm_conn_t) base)->m_sock;
+}
+
+static bool ddsi_shm_supports (int32_t kind)
+{
+  return (kind == NN_LOCATOR_KIND_SHM);
+}
+
+static int ddsi_shm_conn_locator (ddsi_tran_base_t base, nn_locator_t *loc)
+{
+  shm_set_locator (loc, base->m_port);
+  return 0;
+}
+
+static struct shm_ring *shm_create_segment (const char *name)
+{
+  struct shm_ring *ring;
+  uint32_t i;
+  int fd;
+
+  /* A segment left behind by a process that used the port before us
+     may still be mapped by writers: mark it closed so they'll remap */
+  if ((fd = shm_open (name, O_RDWR, 0)) >= 0)
+  {
+    struct stat st;
+    if (fstat (fd, &st) == 0 && (size_t) st.st_size == SHM_MAPSIZE && (ring = shm_map (fd)) != NULL)
+    {
+      os_atomic_st32 (&ring->closed, 1);
+      munmap (ring, SHM_MAPSIZE);
+    }
+    close (fd);
+    shm_unlink (name);
+  }
+
+  if ((fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0)
+  {
+    DDS_ERROR("ddsi_shm_create_conn: shm_open %s failed ... errno = %d\n", name, os_getErrno ());
+    return NULL;
+  }
+  if (ftruncate (fd, (off_t) SHM_MAPSIZE) < 0 || (ring = shm_map (fd)) == NULL)
+  {
+    DDS_ERROR("ddsi_shm_create_conn: sizing or mapping %s failed ... errno = %d\n", name, os_getErrno ());
+    close (fd);
+    shm_unlink (name);
+    return NULL;
+  }
+  close (fd);
+  ring->nslots = SHM_NSLOTS;
+  ring->slotsize = SHM_SLOT_SIZE;
+  os_atomic_st32 (&ring->closed, 0);
+  os_atomic_st32 (&ring->sleeping, 1);
+  os_atomic_st32 (&ring->tail, 0);
+  for (i = 0; i < SHM_NSLOTS; i++)
+    os_atomic_st32 (&shm_slot (ring, i)->seq, i);
+  os_atomic_fence_rel ();
+  ring->magic = SHM_MAGIC;
+  return ring;
+}
+
+static ddsi_tran_conn_t ddsi_shm_create_conn (uint32_t port, ddsi_tran_qos_t qos)
+{
+  ddsi_shm_conn_t uc;
+  os_socket sock;
+  int flags;
+  (void) qos;
+
+  if (port == 0)
+  {
+    DDS_ERROR("ddsi_shm_create_conn: requires a port number\n");
+    return NULL;
+  }
+
+  uc = (ddsi_shm_conn_t) os_malloc (sizeof (*uc));
+  memset (uc, 0, sizeof (*uc));
+  shm_segment_name (uc->m_name, sizeof (uc->m_name), port);
+  shm_doorbell_addr (&uc->m_addr, &uc->m_addrlen, port);
+  if ((sock = socket (AF_UNIX, SOCK_DGRAM, 0)) == -1)
+  {
+    DDS_ERROR("ddsi_shm_create_conn: socket failed ... errno = %d\n", os_getErrno ());
+    goto fail;
+  }
+  if (bind (sock, (struct sockaddr *) &uc->m_addr, uc->m_addrlen) == -1)
+  {
+    DDS_ERROR("ddsi_shm_create_conn: bind port %u failed ... errno = %d\n", port, os_getErrno ());
+    goto fail_sock;
+  }
+  if ((flags = fcntl (sock, F_GETFL, 0)) == -1 || fcntl (sock, F_SETFL, flags | O_NONBLOCK) == -1)
+  {
+    DDS_ERROR("ddsi_shm_create_conn: can't make socket non-blocking ... errno = %d\n", os_getErrno ());
+    goto fail_sock;
+  }
+  if ((uc->m_ring = shm_create_segment (uc->m_name)) == NULL)
+    goto fail_sock;
+  uc->m_sock = sock;
+
+  ddsi_factory_conn_init (&ddsi_shm_factory_g, &uc->m_base);
+  uc->m_base.m_base.m_port = port;
+  uc->m_base.m_base.m_trantype = DDSI_TRAN_CONN;
+  uc->m_base.m_base.m_multicast = false;
+  uc->m_base.m_base.m_handle_fn = ddsi_shm_conn_handle;
+  uc->m_base.m_base.m_locator_fn = ddsi_shm_conn_locator;
+  uc->m_base.m_read_fn = ddsi_shm_conn_read;
+  uc->m_base.m_write_fn = ddsi_shm_conn_write;
+  uc->m_base.m_write_multi_fn = ddsi_shm_conn_write_multi;
+  uc->m_base.m_write_gso_fn = ddsi_shm_conn_write_gso;
+  uc->m_base.m_disable_multiplexing_fn = 0;
+
+  DDS_TRACE("ddsi_shm_create_conn socket %d port %u segment %s\n", uc->m_sock, port, uc->m_name);
+  return &uc->m_base;
+
+fail_sock:
+  close (sock);
+fail:
+  os_free (uc);
+  return NULL;
+}
+
+static void ddsi_shm_release_conn (ddsi_tran_conn_t conn)
+{
+  ddsi_shm_conn_t uc = (ddsi_shm_conn_t) conn;
+  DDS_TRACE("ddsi_shm_release_conn socket %d port %u\n", uc->m_sock, uc->m_base.m_base.m_port);
+  os_atomic_st32 (&uc->m_ring->closed, 1);
+  munmap (uc->m_ring, SHM_MAPSIZE);
+  shm_unlink (uc->m_name);
+  close (uc->m_sock);
+  os_free (conn);
+}
+
+static int ddsi_shm_join_mc (ddsi_tran_conn_t conn, const nn_locator_t *srcloc, const nn_locator_t *mcloc, const struct nn_interface *interf)
+{
+  (void) conn;
+  (void) srcloc;
+  (void) mcloc;
+  (void) interf;
+  return -1;
+}
+
+static int ddsi_shm_is_mcaddr (const ddsi_tran_factory_t tran, const nn_locator_t *loc)
+{
+  (void) tran;
+  (void) loc;
+  return 0;
+}
+
+static enum ddsi_nearby_address_result ddsi_shm_is_nearby_address (ddsi_tran_factory_t tran, const nn_locator_t *loc, size_t ninterf, const struct nn_interface interf[])
+{
+  (void) tran;
+  (void) ninterf;
+  (void) interf;
+  return (memcmp (loc->address, &ddsi_shm_config_g.hostid, sizeof (ddsi_shm_config_g.hostid)) == 0) ? DNAR_SAME : DNAR_DISTANT;
+}
+
+static enum ddsi_locator_from_string_result ddsi_shm_address_from_string (ddsi_tran_factory_t tran, nn_locator_t *loc, const char *str)
+{
+  uint64_t hostid;
+  int pos;
+  (void) tran;
+  OS_WARNING_MSVC_OFF(4996);
+  if (sscanf (str, "[%"SCNx64"]%n", &hostid, &pos) != 1 || str[pos] != 0)
+    return AFSR_INVALID;
+  OS_WARNING_MSVC_ON(4996);
+  loc->kind = NN_LOCATOR_KIND_SHM;
+  loc->port = NN_LOCATOR_PORT_INVALID;
+  memset (loc->address, 0, sizeof (loc->address));
+  memcpy (loc->address, &hostid, sizeof (hostid));
+  return AFSR_OK;
+}
+
+static char *ddsi_shm_to_string (ddsi_tran_factory_t tran, char *dst, size_t sizeof_dst, const nn_locator_t *loc, int with_port)
+{
+  uint64_t hostid;
+  (void) tran;
+  memcpy (&hostid, loc->address, sizeof (hostid));
+  if (with_port)
+    (void) snprintf (dst, sizeof_dst, "[%016"PRIx64"]:%u", hostid, loc->port);
+  else
+    (void) snprintf (dst, sizeof_dst, "[%016"PRIx64"]", hostid);
+  return dst;
+}
+
+static int ddsi_shm_enumerate_interfaces (ddsi_tran_factory_t factory, os_ifaddrs_t **interfs)
+{
+  (void) factory;
+  *interfs = NULL;
+  return 0;
+}
+
+static void ddsi_shm_deinit (void)
+{
+  if (os_atomic_dec32_nv (&init_g) == 0)
+  {
+    uint32_t i;
+    for (i = 0; i < ddsi_shm_config_g.npeers; i++)
+      munmap (ddsi_shm_config_g.peers[i].ring, SHM_MAPSIZE);
+    os_free (ddsi_shm_config_g.peers);
+    os_rwlockDestroy (&ddsi_shm_config_g.lock);
+    DDS_LOG(DDS_LC_CONFIG, "shm de-initialized\n");
+  }
+}
+
+int ddsi_shm_init (void)
+{
+  if (os_atomic_inc32_nv (&init_g) == 1)
+  {
+    memset (&ddsi_shm_config_g, 0, sizeof (ddsi_shm_config_g));
+    if (shm_host_id (&ddsi_shm_config_g.hostid) < 0)
+    {
+      os_atomic_dec32 (&init_g);
+      DDS_WARNING("shm: can't determine host id\n");
+      return -1;
+    }
+    os_rwlockInit (&ddsi_shm_config_g.lock);
+
+    memset (&ddsi_shm_factory_g, 0, sizeof (ddsi_shm_factory_g));
+    ddsi_shm_factory_g.m_free_fn = ddsi_shm_deinit;
+    ddsi_shm_factory_g.m_kind = NN_LOCATOR_KIND_SHM;
+    ddsi_shm_factory_g.m_typename = "shm";
+    ddsi_shm_factory_g.m_default_spdp_address = NULL;
+    ddsi_shm_factory_g.m_connless = 1;
+    ddsi_shm_factory_g.m_supports_fn = ddsi_shm_supports;
+    ddsi_shm_factory_g.m_create_conn_fn = ddsi_shm_create_conn;
+    ddsi_shm_factory_g.m_release_conn_fn = ddsi_shm_release_conn;
+    ddsi_shm_factory_g.m_join_mc_fn = ddsi_shm_join_mc;
+    ddsi_shm_factory_g.m_leave_mc_fn = ddsi_shm_join_mc;
+    ddsi_shm_factory_g.m_is_mcaddr_fn = ddsi_shm_is_mcaddr;
+    ddsi_shm_factory_g.m_is_ssm_mcaddr_fn = ddsi_shm_is_mcaddr;
+    ddsi_shm_factory_g.m_is_nearby_address_fn = ddsi_shm_is_nearby_address;
+    ddsi_shm_factory_g.m_locator_from_string_fn = ddsi_shm_address_from_string;
+    ddsi_shm_factory_g.m_locator_to_string_fn = ddsi_shm_to_string;
+    ddsi_shm_factory_g.m_enumerate_interfaces_fn = ddsi_shm_enumerate_interfaces;
+    ddsi_factory_add (&ddsi_shm_factory_g);
+
+    DDS_LOG(DDS_LC_CONFIG, "shm initialized, host id %016"PRIx64"\n", ddsi_shm_config_g.hostid);
+  }
+  return 0;
+}
+
+#else
+
+int ddsi_shm_init (void) { return -1; }
+
+#endif /* defined __linux */
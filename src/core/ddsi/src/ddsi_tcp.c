@@ -176,7 +176,7 @@ static void ddsi_tcp_sock_free (os_socket sock, const char * msg)
 
 static void ddsi_tcp_sock_new (os_socket * sock, unsigned short port)
 {
-  if (make_socket (sock, port, true, true) != 0)
+  if (make_socket (sock, port, true, true, false) != 0)
   {
     *sock = OS_INVALID_SOCKET;
   }
@@ -32,7 +32,15 @@ extern inline int ddsi_listener_locator (ddsi_tran_listener_t listener, nn_locat
 extern inline int ddsi_listener_listen (ddsi_tran_listener_t listener);
 extern inline ddsi_tran_conn_t ddsi_listener_accept (ddsi_tran_listener_t listener);
 extern inline ssize_t ddsi_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, nn_locator_t *srcloc);
+extern inline bool ddsi_conn_supports_read_batch (ddsi_tran_conn_t conn);
+extern inline ssize_t ddsi_conn_read_batch (ddsi_tran_conn_t conn, struct ddsi_tran_rxbuf *bufs, size_t nbufs);
 extern inline ssize_t ddsi_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags);
+extern inline bool ddsi_conn_supports_write_multi (ddsi_tran_conn_t conn);
+extern inline ssize_t ddsi_conn_write_multi (ddsi_tran_conn_t conn, const nn_locator_t *dsts, size_t ndsts, size_t niov, const os_iovec_t *iov, uint32_t flags, size_t *ncalls);
+extern inline bool ddsi_conn_supports_write_gso (ddsi_tran_conn_t conn);
+extern inline ssize_t ddsi_conn_write_gso (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, size_t segsize, uint32_t flags);
+extern inline bool ddsi_conn_supports_write_txtime (ddsi_tran_conn_t conn);
+extern inline ssize_t ddsi_conn_write_txtime (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags, int64_t txtime);
 
 void ddsi_factory_add (ddsi_tran_factory_t factory)
 {
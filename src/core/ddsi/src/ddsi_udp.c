@@ -9,6 +9,9 @@
  *
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
+#if defined __linux && !defined _GNU_SOURCE
+#define _GNU_SOURCE /* Required for recvmmsg/sendmmsg */
+#endif
 #include <assert.h>
 #include <string.h>
 #include "os/os.h"
@@ -22,6 +25,51 @@
 #include "ddsi/q_config.h"
 #include "ddsi/q_log.h"
 #include "ddsi/q_pcap.h"
+#include "ddsi/q_time.h"
+
+#if defined __linux && defined MSG_WAITFORONE
+#define DDSI_UDP_HAVE_RECVMMSG 1
+#define DDSI_UDP_HAVE_SENDMMSG 1
+#else
+#define DDSI_UDP_HAVE_RECVMMSG 0
+#define DDSI_UDP_HAVE_SENDMMSG 0
+#endif
+
+#if defined __linux
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 /* may be missing from older C libraries */
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#define DDSI_UDP_HAVE_GSO 1
+#else
+#define DDSI_UDP_HAVE_GSO 0
+#endif
+
+/* Departure times for paced sending (bandwidth limiting), handled by
+   the fq and etf queueing disciplines */
+#if defined __linux && defined DDSI_INCLUDE_BANDWIDTH_LIMITING
+#include <time.h>
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+#define SCM_TXTIME SO_TXTIME
+#endif
+struct ddsi_udp_sock_txtime { /* struct sock_txtime in linux/net_tstamp.h */
+  clockid_t clockid;
+  uint32_t flags;
+};
+#define DDSI_UDP_HAVE_TXTIME 1
+#else
+#define DDSI_UDP_HAVE_TXTIME 0
+#endif
+
+/* Coalesced packets are only returned by the batched read */
+#define DDSI_UDP_HAVE_GRO (DDSI_UDP_HAVE_GSO && DDSI_UDP_HAVE_RECVMMSG)
+
+/* Maximum number of destinations passed to a single sendmmsg call */
+#define DDSI_UDP_MAX_SENDMMSG 64
 
 extern void ddsi_factory_conn_init (ddsi_tran_factory_t factory, ddsi_tran_conn_t conn);
 
@@ -41,6 +89,12 @@ typedef struct ddsi_udp_conn
   WSAEVENT m_sockEvent;
 #endif
   int m_diffserv;
+#if DDSI_UDP_HAVE_GSO
+  os_atomic_uint32_t m_gso_ok;
+#endif
+#if DDSI_UDP_HAVE_GRO
+  bool m_gro;
+#endif
 }
 * ddsi_udp_conn_t;
 
@@ -104,13 +158,96 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, s
   return ret;
 }
 
+#if DDSI_UDP_HAVE_RECVMMSG
+static ssize_t ddsi_udp_conn_read_batch (ddsi_tran_conn_t conn, struct ddsi_tran_rxbuf *bufs, size_t nbufs)
+{
+  int err;
+  int ret;
+  size_t i;
+  struct mmsghdr msgs[MAX_RECV_BATCH_SIZE];
+  os_iovec_t msg_iovs[MAX_RECV_BATCH_SIZE];
+  os_sockaddr_storage srcs[MAX_RECV_BATCH_SIZE];
+#if DDSI_UDP_HAVE_GRO
+  union {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } controls[MAX_RECV_BATCH_SIZE];
+  const bool gro = ((ddsi_udp_conn_t) conn)->m_gro;
+#endif
+
+  if (nbufs > MAX_RECV_BATCH_SIZE)
+    nbufs = MAX_RECV_BATCH_SIZE;
+  memset (msgs, 0, nbufs * sizeof (*msgs));
+  for (i = 0; i < nbufs; i++)
+  {
+    msg_iovs[i].iov_base = (void *) bufs[i].buf;
+    msg_iovs[i].iov_len = bufs[i].len;
+    msgs[i].msg_hdr.msg_name = &srcs[i];
+    msgs[i].msg_hdr.msg_namelen = (socklen_t) sizeof (srcs[i]);
+    msgs[i].msg_hdr.msg_iov = &msg_iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+#if DDSI_UDP_HAVE_GRO
+    if (gro)
+    {
+      msgs[i].msg_hdr.msg_control = controls[i].buf;
+      msgs[i].msg_hdr.msg_controllen = sizeof (controls[i].buf);
+    }
+#endif
+  }
+
+  /* Block for the first packet, then take whatever else is available */
+  do {
+    ret = recvmmsg (((ddsi_udp_conn_t) conn)->m_sock, msgs, (unsigned) nbufs, MSG_WAITFORONE, NULL);
+    err = (ret == -1) ? os_getErrno() : 0;
+  } while (err == os_sockEINTR);
+
+  if (ret > 0)
+  {
+    for (i = 0; i < (size_t) ret; i++)
+    {
+      const os_sockaddr_storage *src = &srcs[i];
+      ddsi_ipaddr_to_loc(&bufs[i].srcloc, (os_sockaddr *)src, src->ss_family == AF_INET ? NN_LOCATOR_KIND_UDPv4 : NN_LOCATOR_KIND_UDPv6);
+      bufs[i].size = msgs[i].msg_len;
+      bufs[i].segsize = 0;
+#if DDSI_UDP_HAVE_GRO
+      if (gro)
+      {
+        struct cmsghdr *cmsg;
+        for (cmsg = CMSG_FIRSTHDR (&msgs[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR (&msgs[i].msg_hdr, cmsg))
+        {
+          if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+          {
+            int gso_size;
+            memcpy (&gso_size, CMSG_DATA (cmsg), sizeof (gso_size));
+            if (gso_size > 0 && (size_t) gso_size < bufs[i].size)
+              bufs[i].segsize = (size_t) gso_size;
+          }
+        }
+      }
+#endif
+      if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+      {
+        char addrbuf[DDSI_LOCSTRLEN];
+        ddsi_locator_to_string(addrbuf, sizeof(addrbuf), &bufs[i].srcloc);
+        DDS_WARNING("%s => packet truncated to %d\n", addrbuf, (int)bufs[i].len);
+      }
+    }
+  }
+  else if (err != os_sockENOTSOCK && err != os_sockECONNRESET)
+  {
+    DDS_ERROR("UDP recvmmsg sock %d: ret %d errno %d\n", (int) ((ddsi_udp_conn_t) conn)->m_sock, ret, err);
+  }
+  return ret;
+}
+#endif
+
 static void set_msghdr_iov (struct msghdr *mhdr, os_iovec_t *iov, size_t iovlen)
 {
   mhdr->msg_iov = iov;
   mhdr->msg_iovlen = (os_msg_iovlen_t)iovlen;
 }
 
-static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags)
+static ssize_t ddsi_udp_conn_sendmsg (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags, void *control, size_t controllen)
 {
   int err;
   ssize_t ret;
@@ -124,9 +261,11 @@ static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *d
   msg.msg_name = &dstaddr;
   msg.msg_namelen = (socklen_t) os_sockaddr_get_size((os_sockaddr *) &dstaddr);
 #if !defined(__sun) || defined(_XPG4_2)
-  msg.msg_control = NULL;
-  msg.msg_controllen = 0;
+  msg.msg_control = control;
+  msg.msg_controllen = (socklen_t) controllen;
 #else
+  assert (control == NULL);
+  OS_UNUSED_ARG(controllen);
   msg.msg_accrights = NULL;
   msg.msg_accrightslen = 0;
 #endif
@@ -178,6 +317,212 @@ static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *d
   return ret;
 }
 
+static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags)
+{
+  return ddsi_udp_conn_sendmsg (conn, dst, niov, iov, flags, NULL, 0);
+}
+
+#if DDSI_UDP_HAVE_TXTIME
+static ssize_t ddsi_udp_conn_write_txtime (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags, int64_t txtime)
+{
+  union {
+    char buf[CMSG_SPACE (sizeof (uint64_t))];
+    struct cmsghdr align;
+  } control;
+  struct cmsghdr *cmsg;
+  struct msghdr msg;
+  uint64_t t;
+
+  if (config.pacing_txtime == PTT_TAI)
+  {
+    /* etf requires TAI, departure times are monotonic */
+    struct timespec mono, tai;
+    (void) clock_gettime (CLOCK_MONOTONIC, &mono);
+    (void) clock_gettime (CLOCK_TAI, &tai);
+    txtime += (int64_t) (tai.tv_sec - mono.tv_sec) * 1000000000 + (tai.tv_nsec - mono.tv_nsec);
+  }
+  t = (uint64_t) txtime;
+  memset (&control, 0, sizeof (control));
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_TXTIME;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (t));
+  memcpy (CMSG_DATA (cmsg), &t, sizeof (t));
+  return ddsi_udp_conn_sendmsg (conn, dst, niov, iov, flags, control.buf, sizeof (control.buf));
+}
+
+static ssize_t ddsi_udp_conn_write_now (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags)
+{
+  /* etf drops packets without a departure time, so anything not paced
+     that goes out via a socket with SO_TXTIME is due immediately */
+  return ddsi_udp_conn_write_txtime (conn, dst, niov, iov, flags, now_mt ().v);
+}
+#endif
+
+#if DDSI_UDP_HAVE_SENDMMSG
+static ssize_t ddsi_udp_conn_write_multi (ddsi_tran_conn_t conn, const nn_locator_t *dsts, size_t ndsts, size_t niov, const os_iovec_t *iov, uint32_t flags, size_t *ncalls)
+{
+  ddsi_udp_conn_t uc = (ddsi_udp_conn_t) conn;
+  struct mmsghdr msgs[DDSI_UDP_MAX_SENDMMSG];
+  os_sockaddr_storage dstaddrs[DDSI_UDP_MAX_SENDMMSG];
+  size_t i, n, len, nsent = 0;
+  int sendflags = 0;
+  assert(niov <= INT_MAX);
+  (void) flags;
+#ifdef MSG_NOSIGNAL
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  for (i = 0, len = 0; i < niov; i++)
+    len += iov[i].iov_len;
+
+  while (ndsts > 0)
+  {
+    int ret, err;
+    n = (ndsts > DDSI_UDP_MAX_SENDMMSG) ? DDSI_UDP_MAX_SENDMMSG : ndsts;
+    memset (msgs, 0, n * sizeof (*msgs));
+    for (i = 0; i < n; i++)
+    {
+      ddsi_ipaddr_from_loc(&dstaddrs[i], &dsts[i]);
+      msgs[i].msg_hdr.msg_name = &dstaddrs[i];
+      msgs[i].msg_hdr.msg_namelen = (socklen_t) os_sockaddr_get_size((os_sockaddr *) &dstaddrs[i]);
+      set_msghdr_iov (&msgs[i].msg_hdr, (os_iovec_t *) iov, niov);
+    }
+    do {
+      ret = sendmmsg (uc->m_sock, msgs, (unsigned) n, sendflags);
+      err = (ret == -1) ? os_getErrno() : 0;
+    } while (err == os_sockEINTR);
+
+    if (ret > 0 && gv.pcap_fp)
+    {
+      os_sockaddr_storage sa;
+      socklen_t alen = sizeof (sa);
+      if (getsockname (uc->m_sock, (struct sockaddr *) &sa, &alen) == -1)
+        memset(&sa, 0, sizeof(sa));
+      for (i = 0; i < (size_t) ret; i++)
+        write_pcap_sent (gv.pcap_fp, now (), &sa, &msgs[i].msg_hdr, len);
+    }
+
+    /* sendmmsg stops at the first message that fails, leaving us none the
+       wiser as to the cause if it got at least one out.  Sending that one
+       with the regular write takes care of retrying on EWOULDBLOCK & EPERM,
+       as well as error reporting, and then we continue with the rest. */
+    if (ret > 0)
+      (*ncalls)++;
+    else
+      ret = 0;
+    nsent += (size_t) ret;
+    if ((size_t) ret < n)
+    {
+      if (ddsi_udp_conn_write (conn, &dsts[ret], niov, iov, flags) > 0)
+      {
+        nsent++;
+        (*ncalls)++;
+      }
+      ret++;
+    }
+    dsts += ret;
+    ndsts -= (size_t) ret;
+  }
+  return (nsent == 0) ? -1 : (ssize_t) nsent;
+}
+#endif
+
+#if DDSI_UDP_HAVE_GSO
+static ssize_t ddsi_udp_conn_write_segments (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, size_t segsize, uint32_t flags)
+{
+  /* Splits the message in iov in packets of segsize bytes and sends them
+     individually, for when segmentation offload can't be used */
+  os_iovec_t *segiov = os_malloc (niov * sizeof (*segiov));
+  size_t i = 0, off = 0;
+  ssize_t ret, total = 0;
+  while (i < niov)
+  {
+    size_t n = 0, seglen = 0;
+    while (i < niov && seglen < segsize)
+    {
+      const size_t avail = iov[i].iov_len - off;
+      const size_t take = (avail < segsize - seglen) ? avail : segsize - seglen;
+      if (take > 0)
+      {
+        segiov[n].iov_base = (char *) iov[i].iov_base + off;
+        segiov[n].iov_len = (os_iov_len_t) take;
+        n++;
+      }
+      seglen += take;
+      off += take;
+      if (off == iov[i].iov_len)
+      {
+        i++;
+        off = 0;
+      }
+    }
+    if (seglen == 0)
+      break;
+    if ((ret = ddsi_udp_conn_write (conn, dst, n, segiov, flags)) > 0)
+      total += ret;
+  }
+  os_free (segiov);
+  return (total > 0) ? total : -1;
+}
+
+static ssize_t ddsi_udp_conn_write_gso (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, size_t segsize, uint32_t flags)
+{
+  ddsi_udp_conn_t uc = (ddsi_udp_conn_t) conn;
+  union {
+    char buf[CMSG_SPACE (sizeof (uint16_t))];
+    struct cmsghdr align;
+  } control;
+  struct cmsghdr *cmsg;
+  struct msghdr msg;
+  os_sockaddr_storage dstaddr;
+  uint16_t gso_size;
+  int err, sendflags = 0;
+  ssize_t ret;
+
+  /* Packet capture works per packet, so don't bother with the offload
+     if the packets are to be captured */
+  if (!os_atomic_ld32 (&uc->m_gso_ok) || gv.pcap_fp || segsize > UINT16_MAX)
+    return ddsi_udp_conn_write_segments (conn, dst, niov, iov, segsize, flags);
+
+  assert(niov <= INT_MAX);
+  gso_size = (uint16_t) segsize;
+  ddsi_ipaddr_from_loc(&dstaddr, dst);
+  memset (&msg, 0, sizeof (msg));
+  set_msghdr_iov (&msg, (os_iovec_t *) iov, niov);
+  msg.msg_name = &dstaddr;
+  msg.msg_namelen = (socklen_t) os_sockaddr_get_size((os_sockaddr *) &dstaddr);
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (gso_size));
+  memcpy (CMSG_DATA (cmsg), &gso_size, sizeof (gso_size));
+#ifdef MSG_NOSIGNAL
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  do {
+    ret = sendmsg (uc->m_sock, &msg, sendflags);
+    err = (ret == -1) ? os_getErrno() : 0;
+  } while (err == os_sockEINTR);
+
+  if (ret == -1)
+  {
+    /* EINVAL if the segments don't fit in the MTU, EIO if the interface
+       can't do checksum offloading: neither is going to change */
+    if (err == os_sockEINVAL || err == EIO)
+    {
+      if (os_atomic_cas32 (&uc->m_gso_ok, 1, 0))
+        DDS_WARNING("UDP segmentation offload on sock %d failed with error code %d, disabled\n", (int) uc->m_sock, err);
+    }
+    ret = ddsi_udp_conn_write_segments (conn, dst, niov, iov, segsize, flags);
+  }
+  return ret;
+}
+#endif
+
 static void ddsi_udp_disable_multiplexing (ddsi_tran_conn_t base)
 {
 #if defined _WIN32 && !defined WINCE
@@ -240,6 +585,8 @@ static ddsi_tran_conn_t ddsi_udp_create_conn
   os_socket sock;
   ddsi_udp_conn_t uc = NULL;
   bool mcast = (bool) (qos ? qos->m_multicast : false);
+  bool reuseport = (bool) (qos ? qos->m_reuseport : false);
+  bool txtime = (bool) (qos ? qos->m_txtime : false);
 
   /* If port is zero, need to create dynamic port */
 
@@ -248,7 +595,8 @@ static ddsi_tran_conn_t ddsi_udp_create_conn
     &sock,
     (unsigned short) port,
     false,
-    mcast
+    mcast,
+    reuseport
   );
 
   if (ret == 0)
@@ -271,7 +619,63 @@ static ddsi_tran_conn_t ddsi_udp_create_conn
     uc->m_base.m_base.m_locator_fn = ddsi_udp_conn_locator;
 
     uc->m_base.m_read_fn = ddsi_udp_conn_read;
+#if DDSI_UDP_HAVE_RECVMMSG
+    uc->m_base.m_read_batch_fn = ddsi_udp_conn_read_batch;
+#endif
+#if DDSI_UDP_HAVE_SENDMMSG
+    uc->m_base.m_write_multi_fn = ddsi_udp_conn_write_multi;
+#endif
+#if DDSI_UDP_HAVE_GRO
+    /* Coalesced packets can be up to 64kB and must fit in a receive buffer */
+    if (config.recv_gro && config.rmsg_chunk_size >= 65536)
+    {
+      int one = 1;
+      if (setsockopt (sock, SOL_UDP, UDP_GRO, &one, (socklen_t) sizeof (one)) == 0)
+        uc->m_gro = true;
+      else
+        DDS_LOG(DDS_LC_CONFIG, "ddsi_udp_create_conn: UDP_GRO not supported on socket %d\n", (int) sock);
+    }
+#endif
+#if DDSI_UDP_HAVE_GSO
+    {
+      /* The socket option exists if the kernel supports segmentation offload */
+      int gso_size;
+      socklen_t optlen = (socklen_t) sizeof (gso_size);
+      if (getsockopt (sock, SOL_UDP, UDP_SEGMENT, &gso_size, &optlen) == 0)
+      {
+        os_atomic_st32 (&uc->m_gso_ok, 1);
+        uc->m_base.m_write_gso_fn = ddsi_udp_conn_write_gso;
+      }
+    }
+#endif
     uc->m_base.m_write_fn = ddsi_udp_conn_write;
+#if DDSI_UDP_HAVE_TXTIME
+    /* Only requested for the transmit connections of bandwidth-limited
+       channels: every packet sent via the socket must then carry a
+       departure time, which rules out sendmmsg and segmentation offload */
+    if (txtime && config.pacing_txtime != PTT_NONE)
+    {
+      struct ddsi_udp_sock_txtime so;
+      so.clockid = (config.pacing_txtime == PTT_TAI) ? CLOCK_TAI : CLOCK_MONOTONIC;
+      so.flags = 0;
+      if (setsockopt (sock, SOL_SOCKET, SO_TXTIME, &so, (socklen_t) sizeof (so)) == 0)
+      {
+        uc->m_base.m_write_fn = ddsi_udp_conn_write_now;
+        uc->m_base.m_write_txtime_fn = ddsi_udp_conn_write_txtime;
+        uc->m_base.m_write_multi_fn = 0;
+        uc->m_base.m_write_gso_fn = 0;
+#if DDSI_UDP_HAVE_GSO
+        os_atomic_st32 (&uc->m_gso_ok, 0);
+#endif
+      }
+      else
+      {
+        DDS_WARNING("ddsi_udp_create_conn: SO_TXTIME not supported on socket %d, pacing in a thread\n", (int) sock);
+      }
+    }
+#else
+    (void) txtime;
+#endif
     uc->m_base.m_disable_multiplexing_fn = ddsi_udp_disable_multiplexing;
 
     DDS_TRACE
@@ -0,0 +1,906 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#if defined __linux && !defined _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <assert.h>
+#include <string.h>
+#include "os/os.h"
+#include "os/os_atomics.h"
+#include "ddsi/ddsi_tran.h"
+#include "ddsi/ddsi_uring.h"
+#include "ddsi/ddsi_ipaddr.h"
+#include "ddsi/q_config.h"
+#include "ddsi/q_globals.h"
+#include "ddsi/q_log.h"
+
+#if defined __linux
+#include <sys/syscall.h>
+#if defined __NR_io_uring_setup
+#include <linux/io_uring.h>
+#endif
+#endif
+
+/* Multishot receives into a ring of provided buffers require Linux 6.0 */
+#if defined __NR_io_uring_setup && defined IORING_RECV_MULTISHOT
+#define DDSI_URING_SUPPORTED 1
+#else
+#define DDSI_URING_SUPPORTED 0
+#endif
+
+#if DDSI_URING_SUPPORTED
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <netinet/udp.h>
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+/* The io_uring transport is UDP with a different implementation of
+   reading and writing: it wraps the sockets of the UDP factory, and
+   inherits all address handling from it.
+
+   Receiving: each socket has its own ring with a multishot recvmsg
+   operation that remains posted, and a ring of provided buffers into
+   which the kernel writes the packets as they arrive.  Reading a
+   packet is then merely taking a completion from the completion queue
+   and copying the payload into the receive buffer; only when the
+   completion queue is empty does the receive thread enter the kernel
+   to wait.  The ring's file descriptor is readable whenever there are
+   completions, and so it is what the socket waitset waits for.
+   Packets coalesced by the kernel (Internal/ReceiveSegmentationOffload)
+   come with a control message giving the segment size, just like they
+   do for a plain UDP read.
+
+   The provided buffers can't be the receive buffers themselves: the
+   kernel may write into any buffer in the ring at any time, whereas
+   receive buffer memory remains in use for as long as the data in it
+   hasn't been delivered.
+
+   Transmitting: the data is copied into a transmit buffer and a
+   sendmsg operation is queued, the writer doesn't wait for its
+   completion.  Completions are reaped on subsequent writes, waiting
+   only when all transmit buffers are in use.  Packets that don't fit
+   in a transmit buffer (and all packets when writing a pcap file) are
+   sent synchronously using the UDP connection after all queued ones
+   have completed, preserving the order.  With Internal/SendIoUringPolling
+   a kernel thread picks up the queued operations, so that in steady
+   state writing involves no system calls at all. */
+
+#define DDSI_URING_RX_BUFFERS 32 /* must be a power of 2 */
+#define DDSI_URING_RX_BGID 0
+#define DDSI_URING_RX_CONTROLLEN CMSG_SPACE (sizeof (int)) /* UDP_GRO */
+#define DDSI_URING_TX_REQS 64
+#define DDSI_URING_SQPOLL_IDLE_MS 10
+
+#define DDSI_URING_UDATA_RECV 1
+#define DDSI_URING_UDATA_CANCEL 2
+
+struct ddsi_uring {
+  int fd;
+  unsigned sq_entries, sq_mask, cq_mask;
+  unsigned *sq_head, *sq_tail, *sq_flags, *sq_array;
+  unsigned *cq_head, *cq_tail;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_map, *cq_map;
+  size_t sq_map_sz, cq_map_sz, sqes_sz;
+  bool sqpoll;
+};
+
+struct ddsi_uring_txreq {
+  struct msghdr msg;
+  os_iovec_t iov;
+  os_sockaddr_storage dst;
+  uint32_t buf;
+};
+
+struct ddsi_uring_txbuf {
+  unsigned char *data;
+  uint32_t refc;
+};
+
+typedef struct ddsi_uring_conn
+{
+  struct ddsi_tran_conn m_base;
+  ddsi_tran_conn_t m_udp;
+  os_socket m_sock;
+
+  /* Receive side, used only by the thread reading from the socket */
+  bool m_rx_ok;
+  bool m_rx_armed;
+  struct ddsi_uring m_rx;
+  struct msghdr m_rx_msg;
+  struct io_uring_buf_ring *m_rx_br;
+  size_t m_rx_br_sz;
+  uint16_t m_rx_br_tail;
+  unsigned char *m_rx_bufs;
+  size_t m_rx_bufsz;
+
+  /* Transmit side, initialized on the first write */
+  os_mutex m_tx_lock;
+  int m_tx_state; /* 0: uninitialized, 1: ok, -1: failed */
+  struct ddsi_uring m_tx;
+  size_t m_tx_bufsz;
+  unsigned char *m_tx_mem;
+  struct ddsi_uring_txreq m_tx_reqs[DDSI_URING_TX_REQS];
+  struct ddsi_uring_txbuf m_tx_bufs[DDSI_URING_TX_REQS];
+  uint32_t m_tx_freereqs[DDSI_URING_TX_REQS];
+  uint32_t m_tx_freebufs[DDSI_URING_TX_REQS];
+  uint32_t m_tx_nfreereqs, m_tx_nfreebufs;
+  uint32_t m_tx_nfailed; /* failed sends not yet reported to a writer */
+}
+* ddsi_uring_conn_t;
+
+extern void ddsi_factory_conn_init (ddsi_tran_factory_t factory, ddsi_tran_conn_t conn);
+
+static struct ddsi_tran_factory ddsi_uring_factory_g;
+static ddsi_tran_factory_t ddsi_uring_udp_factory;
+static os_atomic_uint32_t ddsi_uring_init_g = OS_ATOMIC_UINT32_INIT(0);
+
+static int uring_setup (struct ddsi_uring *r, unsigned entries, unsigned cq_entries, bool sqpoll)
+{
+  struct io_uring_params p;
+  memset (r, 0, sizeof (*r));
+  memset (&p, 0, sizeof (p));
+  if (cq_entries > 0)
+  {
+    p.flags |= IORING_SETUP_CQSIZE;
+    p.cq_entries = cq_entries;
+  }
+  if (sqpoll)
+  {
+    p.flags |= IORING_SETUP_SQPOLL;
+    p.sq_thread_idle = DDSI_URING_SQPOLL_IDLE_MS;
+  }
+  if ((r->fd = (int) syscall (__NR_io_uring_setup, entries, &p)) < 0)
+    return -1;
+  r->sqpoll = sqpoll;
+  r->sq_map_sz = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+  r->cq_map_sz = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+  if ((p.features & IORING_FEAT_SINGLE_MMAP) && r->cq_map_sz > r->sq_map_sz)
+    r->sq_map_sz = r->cq_map_sz;
+  r->sq_map = mmap (NULL, r->sq_map_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+  if (r->sq_map == MAP_FAILED)
+    goto err_sq;
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    r->cq_map = r->sq_map;
+  else
+  {
+    r->cq_map = mmap (NULL, r->cq_map_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_map == MAP_FAILED)
+      goto err_cq;
+  }
+  r->sqes_sz = p.sq_entries * sizeof (struct io_uring_sqe);
+  r->sqes = mmap (NULL, r->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+  if (r->sqes == MAP_FAILED)
+    goto err_sqes;
+
+  r->sq_entries = p.sq_entries;
+  r->sq_head = (unsigned *) ((char *) r->sq_map + p.sq_off.head);
+  r->sq_tail = (unsigned *) ((char *) r->sq_map + p.sq_off.tail);
+  r->sq_mask = *(unsigned *) ((char *) r->sq_map + p.sq_off.ring_mask);
+  r->sq_flags = (unsigned *) ((char *) r->sq_map + p.sq_off.flags);
+  r->sq_array = (unsigned *) ((char *) r->sq_map + p.sq_off.array);
+  r->cq_head = (unsigned *) ((char *) r->cq_map + p.cq_off.head);
+  r->cq_tail = (unsigned *) ((char *) r->cq_map + p.cq_off.tail);
+  r->cq_mask = *(unsigned *) ((char *) r->cq_map + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe *) ((char *) r->cq_map + p.cq_off.cqes);
+  return 0;
+
+err_sqes:
+  if (r->cq_map != r->sq_map)
+    munmap (r->cq_map, r->cq_map_sz);
+err_cq:
+  munmap (r->sq_map, r->sq_map_sz);
+err_sq:
+  close (r->fd);
+  return -1;
+}
+
+static void uring_fini (struct ddsi_uring *r)
+{
+  munmap (r->sqes, r->sqes_sz);
+  if (r->cq_map != r->sq_map)
+    munmap (r->cq_map, r->cq_map_sz);
+  munmap (r->sq_map, r->sq_map_sz);
+  close (r->fd);
+}
+
+static int uring_enter (struct ddsi_uring *r, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+  int ret;
+  do {
+    ret = (int) syscall (__NR_io_uring_enter, r->fd, to_submit, min_complete, flags, NULL, 0);
+  } while (ret < 0 && errno == EINTR);
+  return ret;
+}
+
+static struct io_uring_sqe *uring_get_sqe (struct ddsi_uring *r)
+{
+  /* Single producer: the tail only changes here */
+  const unsigned tail = *r->sq_tail;
+  struct io_uring_sqe *sqe;
+  if (tail - __atomic_load_n (r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries)
+    return NULL;
+  r->sq_array[tail & r->sq_mask] = tail & r->sq_mask;
+  sqe = &r->sqes[tail & r->sq_mask];
+  memset (sqe, 0, sizeof (*sqe));
+  return sqe;
+}
+
+static void uring_commit_sqe (struct ddsi_uring *r)
+{
+  __atomic_store_n (r->sq_tail, *r->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+static int uring_submit (struct ddsi_uring *r)
+{
+  if (!r->sqpoll)
+  {
+    const unsigned pending = *r->sq_tail - __atomic_load_n (r->sq_head, __ATOMIC_ACQUIRE);
+    return (pending == 0) ? 0 : uring_enter (r, pending, 0, 0);
+  }
+  else
+  {
+    /* The polling thread goes to sleep when idle, it then needs a wakeup
+       call; the barrier orders the tail update and the check of the flag */
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (__atomic_load_n (r->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+      return uring_enter (r, 0, 0, IORING_ENTER_SQ_WAKEUP);
+    return 0;
+  }
+}
+
+static struct io_uring_cqe *uring_peek_cqe (struct ddsi_uring *r)
+{
+  const unsigned head = *r->cq_head;
+  if (head == __atomic_load_n (r->cq_tail, __ATOMIC_ACQUIRE))
+    return NULL;
+  return &r->cqes[head & r->cq_mask];
+}
+
+static void uring_cqe_seen (struct ddsi_uring *r)
+{
+  __atomic_store_n (r->cq_head, *r->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/* Receiving */
+
+static void ddsi_uring_rx_recycle (ddsi_uring_conn_t uc, unsigned bid, unsigned offset)
+{
+  struct io_uring_buf *b = &uc->m_rx_br->bufs[(uc->m_rx_br_tail + offset) & (DDSI_URING_RX_BUFFERS - 1)];
+  b->addr = (uint64_t) (uintptr_t) (uc->m_rx_bufs + bid * uc->m_rx_bufsz);
+  b->len = (uint32_t) uc->m_rx_bufsz;
+  b->bid = (uint16_t) bid;
+}
+
+static void ddsi_uring_rx_publish (ddsi_uring_conn_t uc, unsigned n)
+{
+  uc->m_rx_br_tail = (uint16_t) (uc->m_rx_br_tail + n);
+  __atomic_store_n (&uc->m_rx_br->tail, uc->m_rx_br_tail, __ATOMIC_RELEASE);
+}
+
+static int ddsi_uring_rx_arm (ddsi_uring_conn_t uc)
+{
+  struct io_uring_sqe *sqe;
+  if ((sqe = uring_get_sqe (&uc->m_rx)) == NULL)
+    return -1;
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = uc->m_sock;
+  sqe->addr = (uint64_t) (uintptr_t) &uc->m_rx_msg;
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = DDSI_URING_RX_BGID;
+  sqe->user_data = DDSI_URING_UDATA_RECV;
+  uring_commit_sqe (&uc->m_rx);
+  if (uring_submit (&uc->m_rx) < 0)
+  {
+    int err = os_getErrno ();
+    DDS_ERROR("ddsi_uring: arming receive on socket %"PRIsock" failed with error %d\n", uc->m_sock, err);
+    return -1;
+  }
+  uc->m_rx_armed = true;
+  return 0;
+}
+
+static void ddsi_uring_rx_unmap (ddsi_uring_conn_t uc)
+{
+  munmap (uc->m_rx_bufs, DDSI_URING_RX_BUFFERS * uc->m_rx_bufsz);
+  munmap (uc->m_rx_br, uc->m_rx_br_sz);
+  uring_fini (&uc->m_rx);
+}
+
+static void ddsi_uring_rx_fini (ddsi_uring_conn_t uc)
+{
+  struct io_uring_buf_reg reg;
+  struct io_uring_sqe *sqe;
+  if (uc->m_rx_armed && (sqe = uring_get_sqe (&uc->m_rx)) != NULL)
+  {
+    /* Cancel the receive and wait for its final completion, after which
+       the kernel no longer touches the buffers */
+    struct io_uring_cqe *cqe;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = DDSI_URING_UDATA_RECV;
+    sqe->user_data = DDSI_URING_UDATA_CANCEL;
+    uring_commit_sqe (&uc->m_rx);
+    if (uring_submit (&uc->m_rx) >= 0)
+    {
+      while (uc->m_rx_armed && uring_enter (&uc->m_rx, 0, 1, IORING_ENTER_GETEVENTS) >= 0)
+      {
+        while ((cqe = uring_peek_cqe (&uc->m_rx)) != NULL)
+        {
+          if (cqe->user_data == DDSI_URING_UDATA_RECV && !(cqe->flags & IORING_CQE_F_MORE))
+            uc->m_rx_armed = false;
+          uring_cqe_seen (&uc->m_rx);
+        }
+      }
+    }
+  }
+  memset (&reg, 0, sizeof (reg));
+  reg.bgid = DDSI_URING_RX_BGID;
+  (void) syscall (__NR_io_uring_register, uc->m_rx.fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+  ddsi_uring_rx_unmap (uc);
+}
+
+static int ddsi_uring_rx_init (ddsi_uring_conn_t uc)
+{
+  /* Same maximum packet size as the receive threads use */
+  const size_t maxsz = config.rmsg_chunk_size < 65536 ? config.rmsg_chunk_size : 65536;
+  struct io_uring_buf_reg reg;
+  struct io_uring_cqe *cqe;
+  unsigned i;
+
+  if (uring_setup (&uc->m_rx, 4, 2 * DDSI_URING_RX_BUFFERS, false) < 0)
+    return -1;
+  /* Each buffer holds a recvmsg_out header, the source address, the
+     control messages and the payload; the buffers are mapped lazily so
+     small packets only use the first page of each */
+  uc->m_rx_bufsz = (sizeof (struct io_uring_recvmsg_out) + sizeof (os_sockaddr_storage) + DDSI_URING_RX_CONTROLLEN + maxsz + 7) & ~(size_t) 7;
+  uc->m_rx_br_sz = DDSI_URING_RX_BUFFERS * sizeof (struct io_uring_buf);
+  uc->m_rx_br = mmap (NULL, uc->m_rx_br_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (uc->m_rx_br == MAP_FAILED)
+    goto err_br;
+  uc->m_rx_bufs = mmap (NULL, DDSI_URING_RX_BUFFERS * uc->m_rx_bufsz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (uc->m_rx_bufs == MAP_FAILED)
+    goto err_bufs;
+  memset (&reg, 0, sizeof (reg));
+  reg.ring_addr = (uint64_t) (uintptr_t) uc->m_rx_br;
+  reg.ring_entries = DDSI_URING_RX_BUFFERS;
+  reg.bgid = DDSI_URING_RX_BGID;
+  if (syscall (__NR_io_uring_register, uc->m_rx.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    goto err_register;
+  uc->m_rx_br_tail = 0;
+  for (i = 0; i < DDSI_URING_RX_BUFFERS; i++)
+    ddsi_uring_rx_recycle (uc, i, i);
+  ddsi_uring_rx_publish (uc, DDSI_URING_RX_BUFFERS);
+
+  memset (&uc->m_rx_msg, 0, sizeof (uc->m_rx_msg));
+  uc->m_rx_msg.msg_namelen = sizeof (os_sockaddr_storage);
+  uc->m_rx_msg.msg_controllen = DDSI_URING_RX_CONTROLLEN;
+  if (ddsi_uring_rx_arm (uc) < 0)
+    goto err_arm;
+  /* An unsupported operation fails immediately */
+  if ((cqe = uring_peek_cqe (&uc->m_rx)) != NULL && cqe->res < 0 && !(cqe->flags & IORING_CQE_F_MORE))
+  {
+    DDS_LOG(DDS_LC_CONFIG, "ddsi_uring: multishot receive not supported on socket %"PRIsock" (error %d)\n", uc->m_sock, -cqe->res);
+    uring_cqe_seen (&uc->m_rx);
+    uc->m_rx_armed = false;
+    goto err_arm;
+  }
+  return 0;
+
+err_arm:
+  ddsi_uring_rx_fini (uc);
+  return -1;
+err_register:
+  munmap (uc->m_rx_bufs, DDSI_URING_RX_BUFFERS * uc->m_rx_bufsz);
+err_bufs:
+  munmap (uc->m_rx_br, uc->m_rx_br_sz);
+err_br:
+  uring_fini (&uc->m_rx);
+  return -1;
+}
+
+static bool ddsi_uring_rx_copy (ddsi_uring_conn_t uc, struct ddsi_tran_rxbuf *rb, int res, unsigned bid)
+{
+  const unsigned char *buf = uc->m_rx_bufs + bid * uc->m_rx_bufsz;
+  const struct io_uring_recvmsg_out *out = (const struct io_uring_recvmsg_out *) buf;
+  const os_sockaddr_storage *src = (const os_sockaddr_storage *) (out + 1);
+  const unsigned char *payload = (const unsigned char *) (out + 1) + uc->m_rx_msg.msg_namelen + uc->m_rx_msg.msg_controllen;
+  size_t len;
+  if (res < (int) sizeof (*out) || out->namelen == 0)
+    return false;
+  ddsi_ipaddr_to_loc (&rb->srcloc, (const os_sockaddr *) src, src->ss_family == AF_INET ? NN_LOCATOR_KIND_UDPv4 : NN_LOCATOR_KIND_UDPv6);
+  len = out->payloadlen;
+  if (len > rb->len || (out->flags & MSG_TRUNC))
+  {
+    char addrbuf[DDSI_LOCSTRLEN];
+    ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &rb->srcloc);
+    DDS_WARNING("%s => %d truncated to %d\n", addrbuf, (int) len, (int) rb->len);
+    if (len > rb->len)
+      len = rb->len;
+  }
+  memcpy (rb->buf, payload, len);
+  rb->size = len;
+  rb->segsize = 0;
+  if (out->controllen > 0)
+  {
+    /* The control messages follow the source address, in the space
+       reserved for them in m_rx_msg */
+    struct msghdr mhdr;
+    struct cmsghdr *cmsg;
+    memset (&mhdr, 0, sizeof (mhdr));
+    mhdr.msg_control = (unsigned char *) (out + 1) + uc->m_rx_msg.msg_namelen;
+    mhdr.msg_controllen = out->controllen;
+    for (cmsg = CMSG_FIRSTHDR (&mhdr); cmsg; cmsg = CMSG_NXTHDR (&mhdr, cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+      {
+        int gso_size;
+        memcpy (&gso_size, CMSG_DATA (cmsg), sizeof (gso_size));
+        if (gso_size > 0 && (size_t) gso_size < rb->size)
+          rb->segsize = (size_t) gso_size;
+      }
+    }
+  }
+  return true;
+}
+
+static size_t ddsi_uring_rx_reap (ddsi_uring_conn_t uc, struct ddsi_tran_rxbuf *bufs, size_t nbufs)
+{
+  struct io_uring_cqe *cqe;
+  unsigned nrecycled = 0;
+  size_t n = 0;
+  while (n < nbufs && (cqe = uring_peek_cqe (&uc->m_rx)) != NULL)
+  {
+    if (cqe->user_data == DDSI_URING_UDATA_RECV)
+    {
+      if (!(cqe->flags & IORING_CQE_F_MORE))
+        uc->m_rx_armed = false;
+      if (cqe->flags & IORING_CQE_F_BUFFER)
+      {
+        const unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (ddsi_uring_rx_copy (uc, &bufs[n], cqe->res, bid))
+          n++;
+        ddsi_uring_rx_recycle (uc, bid, nrecycled++);
+      }
+      else if (cqe->res < 0 && cqe->res != -ENOBUFS)
+      {
+        /* Running out of buffers merely stops the multishot receive, the
+           packets remain queued in the socket until it is rearmed */
+        DDS_ERROR("ddsi_uring: recvmsg sock %"PRIsock": error %d\n", uc->m_sock, -cqe->res);
+      }
+    }
+    uring_cqe_seen (&uc->m_rx);
+  }
+  if (nrecycled > 0)
+    ddsi_uring_rx_publish (uc, nrecycled);
+  return n;
+}
+
+static ssize_t ddsi_uring_conn_read_batch (ddsi_tran_conn_t conn, struct ddsi_tran_rxbuf *bufs, size_t nbufs)
+{
+  ddsi_uring_conn_t uc = (ddsi_uring_conn_t) conn;
+  size_t n;
+  if (!uc->m_rx_ok)
+    return ddsi_conn_read_batch (uc->m_udp, bufs, nbufs);
+  while ((n = ddsi_uring_rx_reap (uc, bufs, nbufs)) == 0)
+  {
+    if (!uc->m_rx_armed && ddsi_uring_rx_arm (uc) < 0)
+      return -1;
+    if (uring_enter (&uc->m_rx, 0, 1, IORING_ENTER_GETEVENTS) < 0)
+    {
+      int err = os_getErrno ();
+      DDS_ERROR("ddsi_uring: waiting for packets on socket %"PRIsock" failed with error %d\n", uc->m_sock, err);
+      return -1;
+    }
+  }
+  if (!uc->m_rx_armed)
+    (void) ddsi_uring_rx_arm (uc);
+  return (ssize_t) n;
+}
+
+static ssize_t ddsi_uring_conn_read (ddsi_tran_conn_t conn, unsigned char *buf, size_t len, bool allow_spurious, nn_locator_t *srcloc)
+{
+  ddsi_uring_conn_t uc = (ddsi_uring_conn_t) conn;
+  struct ddsi_tran_rxbuf rb;
+  if (!uc->m_rx_ok)
+    return ddsi_conn_read (uc->m_udp, buf, len, allow_spurious, srcloc);
+  rb.buf = buf;
+  rb.len = len;
+  if (ddsi_uring_conn_read_batch (conn, &rb, 1) <= 0)
+    return -1;
+  if (srcloc)
+    *srcloc = rb.srcloc;
+  return (ssize_t) rb.size;
+}
+
+/* Transmitting */
+
+static bool ddsi_uring_tx_init_locked (ddsi_uring_conn_t uc)
+{
+  uint32_t i;
+  if (uc->m_tx_state != 0)
+    return (uc->m_tx_state > 0);
+  uc->m_tx_state = -1;
+  if (uring_setup (&uc->m_tx, DDSI_URING_TX_REQS, 0, config.uring_send_polling != 0) < 0)
+  {
+    int err = os_getErrno ();
+    if (!config.uring_send_polling || uring_setup (&uc->m_tx, DDSI_URING_TX_REQS, 0, false) < 0)
+    {
+      DDS_WARNING("ddsi_uring: transmit ring for socket %"PRIsock" failed with error %d, sending synchronously\n", uc->m_sock, err);
+      return false;
+    }
+    DDS_LOG(DDS_LC_CONFIG, "ddsi_uring: submission queue polling not available (error %d)\n", err);
+  }
+  /* MaxMessageSize is not a hard limit, leave some room for exceeding it
+     with small settings */
+  uc->m_tx_bufsz = (config.max_msg_size < 2048) ? 2048 : config.max_msg_size;
+  uc->m_tx_mem = os_malloc (DDSI_URING_TX_REQS * uc->m_tx_bufsz);
+  for (i = 0; i < DDSI_URING_TX_REQS; i++)
+  {
+    uc->m_tx_bufs[i].data = uc->m_tx_mem + i * uc->m_tx_bufsz;
+    uc->m_tx_bufs[i].refc = 0;
+    uc->m_tx_freereqs[i] = i;
+    uc->m_tx_freebufs[i] = i;
+  }
+  uc->m_tx_nfreereqs = uc->m_tx_nfreebufs = DDSI_URING_TX_REQS;
+  uc->m_tx_nfailed = 0;
+  uc->m_tx_state = 1;
+  return true;
+}
+
+static void ddsi_uring_tx_reap_locked (ddsi_uring_conn_t uc)
+{
+  struct io_uring_cqe *cqe;
+  while ((cqe = uring_peek_cqe (&uc->m_tx)) != NULL)
+  {
+    const uint32_t ireq = (uint32_t) cqe->user_data;
+    struct ddsi_uring_txreq * const req = &uc->m_tx_reqs[ireq];
+    if (cqe->res < 0)
+    {
+      uc->m_tx_nfailed++;
+      switch (-cqe->res)
+      {
+        case os_sockEPERM:
+        case os_sockECONNRESET:
+#ifdef os_sockENETUNREACH
+        case os_sockENETUNREACH:
+#endif
+#ifdef os_sockEHOSTUNREACH
+        case os_sockEHOSTUNREACH:
+#endif
+          break;
+        default:
+          DDS_ERROR("ddsi_uring_conn_write failed with error code %d\n", -cqe->res);
+      }
+    }
+    if (--uc->m_tx_bufs[req->buf].refc == 0)
+      uc->m_tx_freebufs[uc->m_tx_nfreebufs++] = req->buf;
+    uc->m_tx_freereqs[uc->m_tx_nfreereqs++] = ireq;
+    uring_cqe_seen (&uc->m_tx);
+  }
+}
+
+static bool ddsi_uring_tx_wait_locked (ddsi_uring_conn_t uc, uint32_t nreqs)
+{
+  ddsi_uring_tx_reap_locked (uc);
+  while (uc->m_tx_nfreereqs < nreqs)
+  {
+    if (uring_submit (&uc->m_tx) < 0 || uring_enter (&uc->m_tx, 0, 1, IORING_ENTER_GETEVENTS) < 0)
+    {
+      int err = os_getErrno ();
+      DDS_ERROR("ddsi_uring: waiting for transmit completions on socket %"PRIsock" failed with error %d\n", uc->m_sock, err);
+      return false;
+    }
+    ddsi_uring_tx_reap_locked (uc);
+  }
+  return true;
+}
+
+static ssize_t ddsi_uring_tx_report_locked (ddsi_uring_conn_t uc, size_t nsent)
+{
+  /* Sends complete asynchronously, so a failure is reported by whichever
+     write first sees its completion, much like a socket reports an
+     asynchronous error on the next send */
+  if (nsent == 0 || uc->m_tx_nfailed >= nsent)
+  {
+    uc->m_tx_nfailed -= (uint32_t) nsent;
+    return -1;
+  }
+  else
+  {
+    nsent -= uc->m_tx_nfailed;
+    uc->m_tx_nfailed = 0;
+    return (ssize_t) nsent;
+  }
+}
+
+static ssize_t ddsi_uring_conn_write_multi (ddsi_tran_conn_t conn, const nn_locator_t *dsts, size_t ndsts, size_t niov, const os_iovec_t *iov, uint32_t flags, size_t *ncalls)
+{
+  ddsi_uring_conn_t uc = (ddsi_uring_conn_t) conn;
+  size_t i, len;
+  ssize_t ret;
+
+  for (i = 0, len = 0; i < niov; i++)
+    len += iov[i].iov_len;
+
+  os_mutexLock (&uc->m_tx_lock);
+  if (!ddsi_uring_tx_init_locked (uc) || len > uc->m_tx_bufsz || gv.pcap_fp)
+  {
+    size_t nsent = 0;
+    if (uc->m_tx_state > 0)
+      (void) ddsi_uring_tx_wait_locked (uc, DDSI_URING_TX_REQS);
+    for (i = 0; i < ndsts; i++)
+      if (ddsi_conn_write (uc->m_udp, &dsts[i], niov, iov, flags) > 0)
+        nsent++;
+    *ncalls = nsent;
+    ret = ddsi_uring_tx_report_locked (uc, nsent);
+    os_mutexUnlock (&uc->m_tx_lock);
+    return ret;
+  }
+
+  ret = (ssize_t) ndsts;
+  while (ndsts > 0)
+  {
+    const uint32_t n = (ndsts > DDSI_URING_TX_REQS) ? DDSI_URING_TX_REQS : (uint32_t) ndsts;
+    struct ddsi_uring_txbuf *buf;
+    uint32_t ibuf, k;
+    unsigned char *p;
+    if (!ddsi_uring_tx_wait_locked (uc, n))
+    {
+      ret = -1;
+      break;
+    }
+    /* Every buffer in use is referenced by at least one request */
+    assert (uc->m_tx_nfreebufs >= uc->m_tx_nfreereqs);
+    ibuf = uc->m_tx_freebufs[--uc->m_tx_nfreebufs];
+    buf = &uc->m_tx_bufs[ibuf];
+    for (i = 0, p = buf->data; i < niov; i++)
+    {
+      memcpy (p, iov[i].iov_base, iov[i].iov_len);
+      p += iov[i].iov_len;
+    }
+    buf->refc = n;
+    for (k = 0; k < n; k++)
+    {
+      const uint32_t ireq = uc->m_tx_freereqs[--uc->m_tx_nfreereqs];
+      struct ddsi_uring_txreq * const req = &uc->m_tx_reqs[ireq];
+      struct io_uring_sqe *sqe = uring_get_sqe (&uc->m_tx);
+      /* Requests complete only after the kernel took them from the queue */
+      assert (sqe != NULL);
+      req->buf = ibuf;
+      req->iov.iov_base = (void *) buf->data;
+      req->iov.iov_len = (os_iov_len_t) len;
+      ddsi_ipaddr_from_loc (&req->dst, &dsts[k]);
+      memset (&req->msg, 0, sizeof (req->msg));
+      req->msg.msg_name = &req->dst;
+      req->msg.msg_namelen = (socklen_t) os_sockaddr_get_size ((os_sockaddr *) &req->dst);
+      req->msg.msg_iov = &req->iov;
+      req->msg.msg_iovlen = 1;
+      sqe->opcode = IORING_OP_SENDMSG;
+      sqe->fd = uc->m_sock;
+      sqe->addr = (uint64_t) (uintptr_t) &req->msg;
+      sqe->len = 1;
+      sqe->msg_flags = MSG_NOSIGNAL;
+      sqe->user_data = ireq;
+      uring_commit_sqe (&uc->m_tx);
+    }
+    if (uring_submit (&uc->m_tx) < 0)
+    {
+      /* The operations remain queued and are submitted with the next
+         write, at the latest when waiting for completions */
+      int err = os_getErrno ();
+      DDS_TRACE("ddsi_uring: submit on socket %"PRIsock" failed with error %d\n", uc->m_sock, err);
+    }
+    (*ncalls)++;
+    dsts += n;
+    ndsts -= n;
+  }
+  if (ret > 0)
+  {
+    ddsi_uring_tx_reap_locked (uc);
+    ret = ddsi_uring_tx_report_locked (uc, (size_t) ret);
+  }
+  os_mutexUnlock (&uc->m_tx_lock);
+  return ret;
+}
+
+static ssize_t ddsi_uring_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const os_iovec_t *iov, uint32_t flags)
+{
+  size_t i, len, ncalls;
+  for (i = 0, len = 0; i < niov; i++)
+    len += iov[i].iov_len;
+  return (ddsi_uring_conn_write_multi (conn, dst, 1, niov, iov, flags, &ncalls) < 0) ? -1 : (ssize_t) len;
+}
+
+static void ddsi_uring_tx_fini (ddsi_uring_conn_t uc)
+{
+  os_mutexLock (&uc->m_tx_lock);
+  if (uc->m_tx_state > 0)
+  {
+    (void) ddsi_uring_tx_wait_locked (uc, DDSI_URING_TX_REQS);
+    uring_fini (&uc->m_tx);
+    os_free (uc->m_tx_mem);
+  }
+  uc->m_tx_state = -1;
+  os_mutexUnlock (&uc->m_tx_lock);
+}
+
+/* Connections */
+
+static void ddsi_uring_disable_multiplexing (ddsi_tran_conn_t conn)
+{
+  ddsi_conn_disable_multiplexing (((ddsi_uring_conn_t) conn)->m_udp);
+}
+
+static os_socket ddsi_uring_conn_handle (ddsi_tran_base_t base)
+{
+  /* The ring is readable when packets have been received */
+  ddsi_uring_conn_t uc = (ddsi_uring_conn_t) base;
+  return uc->m_rx_ok ? uc->m_rx.fd : uc->m_sock;
+}
+
+static int ddsi_uring_conn_locator (ddsi_tran_base_t base, nn_locator_t *loc)
+{
+  return ddsi_conn_locator (((ddsi_uring_conn_t) base)->m_udp, loc);
+}
+
+static ddsi_tran_conn_t ddsi_uring_create_conn (uint32_t port, ddsi_tran_qos_t qos)
+{
+  ddsi_tran_conn_t udp;
+  ddsi_uring_conn_t uc;
+  struct ddsi_tran_qos udp_qos;
+
+  /* Sends submitted via the ring carry no departure time, so the
+     socket mustn't have SO_TXTIME set and paced xpacks wait in a
+     thread instead */
+  if (qos && qos->m_txtime)
+  {
+    udp_qos = *qos;
+    udp_qos.m_txtime = false;
+    qos = &udp_qos;
+  }
+  if ((udp = ddsi_factory_create_conn (ddsi_uring_udp_factory, port, qos)) == NULL)
+    return NULL;
+
+  uc = (ddsi_uring_conn_t) os_malloc (sizeof (*uc));
+  memset (uc, 0, sizeof (*uc));
+  uc->m_udp = udp;
+  uc->m_sock = ddsi_conn_handle (udp);
+  os_mutexInit (&uc->m_tx_lock);
+
+  ddsi_factory_conn_init (&ddsi_uring_factory_g, &uc->m_base);
+  uc->m_base.m_base.m_port = udp->m_base.m_port;
+  uc->m_base.m_base.m_trantype = DDSI_TRAN_CONN;
+  uc->m_base.m_base.m_multicast = udp->m_base.m_multicast;
+  uc->m_base.m_base.m_handle_fn = ddsi_uring_conn_handle;
+  uc->m_base.m_base.m_locator_fn = ddsi_uring_conn_locator;
+
+  uc->m_rx_ok = (ddsi_uring_rx_init (uc) == 0);
+  uc->m_base.m_read_fn = ddsi_uring_conn_read;
+  if (uc->m_rx_ok || ddsi_conn_supports_read_batch (udp))
+    uc->m_base.m_read_batch_fn = ddsi_uring_conn_read_batch;
+  uc->m_base.m_write_fn = ddsi_uring_conn_write;
+  uc->m_base.m_write_multi_fn = ddsi_uring_conn_write_multi;
+  uc->m_base.m_disable_multiplexing_fn = ddsi_uring_disable_multiplexing;
+
+  DDS_TRACE
+  (
+    "ddsi_uring_create_conn %s socket %"PRIsock" port %u ring %d\n",
+    uc->m_base.m_base.m_multicast ? "multicast" : "unicast",
+    uc->m_sock,
+    uc->m_base.m_base.m_port,
+    uc->m_rx_ok ? uc->m_rx.fd : -1
+  );
+  return &uc->m_base;
+}
+
+static void ddsi_uring_release_conn (ddsi_tran_conn_t conn)
+{
+  ddsi_uring_conn_t uc = (ddsi_uring_conn_t) conn;
+  DDS_TRACE
+  (
+    "ddsi_uring_release_conn %s socket %"PRIsock" port %u\n",
+    conn->m_base.m_multicast ? "multicast" : "unicast",
+    uc->m_sock,
+    uc->m_base.m_base.m_port
+  );
+  ddsi_uring_tx_fini (uc);
+  if (uc->m_rx_ok)
+    ddsi_uring_rx_fini (uc);
+  os_mutexDestroy (&uc->m_tx_lock);
+  (ddsi_uring_udp_factory->m_release_conn_fn) (uc->m_udp);
+  os_free (uc);
+}
+
+static int ddsi_uring_join_mc (ddsi_tran_conn_t conn, const nn_locator_t *srcloc, const nn_locator_t *mcloc, const struct nn_interface *interf)
+{
+  return ddsi_uring_udp_factory->m_join_mc_fn (((ddsi_uring_conn_t) conn)->m_udp, srcloc, mcloc, interf);
+}
+
+static int ddsi_uring_leave_mc (ddsi_tran_conn_t conn, const nn_locator_t *srcloc, const nn_locator_t *mcloc, const struct nn_interface *interf)
+{
+  return ddsi_uring_udp_factory->m_leave_mc_fn (((ddsi_uring_conn_t) conn)->m_udp, srcloc, mcloc, interf);
+}
+
+static bool ddsi_uring_probe (void)
+{
+  /* io_uring may be missing, disabled, or lack multishot receive: try the
+     receive side on a throw-away socket */
+  ddsi_uring_conn_t uc;
+  bool ok = false;
+  uc = os_malloc (sizeof (*uc));
+  memset (uc, 0, sizeof (*uc));
+  if ((uc->m_sock = os_sockNew (AF_INET, SOCK_DGRAM)) == OS_INVALID_SOCKET)
+    uc->m_sock = os_sockNew (AF_INET6, SOCK_DGRAM);
+  if (uc->m_sock != OS_INVALID_SOCKET)
+  {
+    if (ddsi_uring_rx_init (uc) == 0)
+    {
+      ddsi_uring_rx_fini (uc);
+      ok = true;
+    }
+    else
+    {
+      int err = os_getErrno ();
+      DDS_LOG(DDS_LC_CONFIG, "ddsi_uring: io_uring not available (error %d)\n", err);
+    }
+    os_sockFree (uc->m_sock);
+  }
+  os_free (uc);
+  return ok;
+}
+
+static void ddsi_uring_deinit (void)
+{
+  if (os_atomic_dec32_nv (&ddsi_uring_init_g) == 0)
+  {
+    memset (&ddsi_uring_factory_g, 0, sizeof (ddsi_uring_factory_g));
+    DDS_LOG(DDS_LC_CONFIG, "uring de-initialized\n");
+  }
+}
+
+int ddsi_uring_init (void)
+{
+  if (os_atomic_inc32_nv (&ddsi_uring_init_g) == 1)
+  {
+    /* Everything but reading and writing is inherited from UDP, including
+       the name, so that locators and addresses are indistinguishable */
+    ddsi_uring_udp_factory = ddsi_factory_find (config.transport_selector == TRANS_UDP6 ? "udp6" : "udp");
+    if (ddsi_uring_udp_factory == NULL || !ddsi_uring_probe ())
+    {
+      os_atomic_dec32 (&ddsi_uring_init_g);
+      return -1;
+    }
+    ddsi_uring_factory_g = *ddsi_uring_udp_factory;
+    ddsi_uring_factory_g.m_free_fn = ddsi_uring_deinit;
+    ddsi_uring_factory_g.m_create_conn_fn = ddsi_uring_create_conn;
+    ddsi_uring_factory_g.m_release_conn_fn = ddsi_uring_release_conn;
+    ddsi_uring_factory_g.m_join_mc_fn = ddsi_uring_join_mc;
+    ddsi_uring_factory_g.m_leave_mc_fn = ddsi_uring_leave_mc;
+    ddsi_factory_add (&ddsi_uring_factory_g);
+
+    DDS_LOG(DDS_LC_CONFIG, "uring initialized\n");
+  }
+  return 0;
+}
+
+#else
+
+int ddsi_uring_init (void) { return -1; }
+
+#endif /* DDSI_URING_SUPPORTED */
@@ -14,6 +14,16 @@
 extern inline int nn_bitset_isset (unsigned numbits, const unsigned *bits, unsigned idx);
 extern inline void nn_bitset_set (unsigned numbits, unsigned *bits, unsigned idx);
 extern inline void nn_bitset_clear (unsigned numbits, unsigned *bits, unsigned idx);
+#if !defined __GNUC__
+extern inline unsigned nn_bitset_clz_generic (unsigned x);
+extern inline unsigned nn_bitset_popcount_generic (unsigned x);
+#endif
+extern inline unsigned nn_bitset_skip_words (const unsigned *bits, unsigned w, unsigned nw, unsigned pattern);
+extern inline unsigned nn_bitset_find_set (unsigned numbits, const unsigned *bits, unsigned idx);
+extern inline unsigned nn_bitset_find_clear (unsigned numbits, const unsigned *bits, unsigned idx);
+extern inline unsigned nn_bitset_count_range (unsigned numbits, const unsigned *bits, unsigned lo, unsigned hi);
+extern inline unsigned nn_bitset_count (unsigned numbits, const unsigned *bits);
+extern inline void nn_bitset_set_range (unsigned numbits, unsigned *bits, unsigned lo, unsigned hi);
 extern inline void nn_bitset_zero (unsigned numbits, unsigned *bits);
 extern inline void nn_bitset_one (unsigned numbits, unsigned *bits);
 
@@ -138,6 +138,11 @@ DUPF(uint32);
 #endif
 DU(natint);
 DU(natint_255);
+DU(data_uc_recv_threads);
+DU(user_dqueues);
+DU(xevent_queues);
+DU(recv_batch_size);
+DU(sendq_threads);
 DUPF(participantIndex);
 DU(port);
 DU(dyn_port);
@@ -152,6 +157,9 @@ DUPF(besmode);
 DUPF(retransmit_merging);
 DUPF(sched_prio_class);
 DUPF(sched_class);
+DUPF(cpu_set);
+DUPF(numa_policy);
+DUPF(numa_nodes);
 DUPF(maybe_memsize);
 DUPF(maybe_int32);
 #ifdef DDSI_INCLUDE_ENCRYPTION
@@ -159,11 +167,13 @@ DUPF(cipher);
 #endif
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
 DUPF(bandwidth);
+DUPF(pacing_txtime);
 #endif
 DUPF(domainId);
 DUPF(durability_cdr);
 DUPF(transport_selector);
 DUPF(many_sockets_mode);
+DUPF(rbuf_backing);
 DU(deaf_mute);
 #ifdef DDSI_INCLUDE_SSL
 DUPF(min_tls_version);
@@ -248,7 +258,7 @@ static const struct cfgelem general_cfgelems[] = {
 { LEAF ("UseIPv6"), 1, "default", ABSOFF (compat_use_ipv6), 0, uf_boolean_default, 0, pf_nop,
 "<p>Deprecated (use Transport instead)</p>" },
 { LEAF ("Transport"), 1, "default", ABSOFF (transport_selector), 0, uf_transport_selector, 0, pf_transport_selector,
-"<p>This element allows selecting the transport to be used (udp, udp6, tcp, tcp6, raweth)</p>" },
+"<p>This element allows selecting the transport to be used (udp, udp6, tcp, tcp6, raweth, uring, uring6). The uring and uring6 transports are UDP using io_uring for receiving and transmitting on Linux, falling back to plain UDP if io_uring is not available.</p>" },
 { LEAF("EnableMulticastLoopback"), 1, "true", ABSOFF(enableMulticastLoopback), 0, uf_boolean, 0, pf_boolean,
 "<p>This element specifies whether DDSI2E allows IP multicast packets to be visible to all DDSI participants in the same node, including itself. It must be \"true\" for intra-node multicast communications, but if a node runs only a single DDSI2E service and does not host any other DDSI-capable programs, it should be set to \"false\" for improved performance.</p>" },
 { DEPRECATED_LEAF("EnableLoopback"), 1, "false", ABSOFF(enableLoopback), 0, uf_boolean, 0, pf_boolean,
@@ -356,9 +366,9 @@ static const struct cfgelem partitioning_cfgelems[] = {
 static const struct cfgelem channel_cfgelems[] = {
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
     { LEAF("DataBandwidthLimit"), 1, "inf", RELOFF(config_channel_listelem, data_bandwidth_limit), 0, uf_bandwidth, 0, pf_bandwidth,
-    "<p>This element specifies the maximum transmit rate of new samples and directly related data, for this channel. Bandwidth limiting uses a leaky bucket scheme. The default value \"inf\" means DDSI2E imposes no limitation, the underlying operating system and hardware will likely limit the maimum transmit rate.</p>" },
+    "<p>This element specifies the maximum transmit rate of new samples and directly related data, for this channel. Bandwidth limiting uses a token bucket scheme, see also Internal/PacingTxTime. The default value \"inf\" means DDSI2E imposes no limitation, the underlying operating system and hardware will likely limit the maimum transmit rate.</p>" },
     { LEAF("AuxiliaryBandwidthLimit"), 1, "inf", RELOFF(config_channel_listelem, auxiliary_bandwidth_limit), 0, uf_bandwidth, 0, pf_bandwidth,
-    "<p>This element specifies the maximum transmit rate of auxiliary traffic on this channel (e.g. retransmits, heartbeats, etc). Bandwidth limiting uses a leaky bucket scheme. The default value \"inf\" means DDSI2E imposes no limitation, the underlying operating system and hardware will likely limit the maimum transmit rate.</p>" },
+    "<p>This element specifies the maximum transmit rate of auxiliary traffic on this channel (e.g. retransmits, heartbeats, etc). Bandwidth limiting uses a token bucket scheme, see also Internal/PacingTxTime. The default value \"inf\" means DDSI2E imposes no limitation, the underlying operating system and hardware will likely limit the maimum transmit rate.</p>" },
 #endif
     { LEAF("DiffServField"), 1, "0", RELOFF(config_channel_listelem, diffserv_field), 0, uf_natint, 0, pf_int,
     "<p>This element describes the DiffServ setting the channel will apply to the networking messages. This parameter determines the value of the diffserv field of the IP version 4 packets sent on this channel which allows QoS setting to be applied to the network traffic send on this channel.<br/>\n\
@@ -395,11 +405,20 @@ static const struct cfgelem thread_properties_sched_cfgelems[] = {
     END_MARKER
 };
 
+static const struct cfgelem thread_properties_memory_cfgelems[] = {
+    { LEAF("Policy"), 1, "default", RELOFF(config_thread_properties_listelem, numa_policy), 0, uf_numa_policy, 0, pf_numa_policy,
+    "<p>This element specifies the NUMA memory allocation policy of the thread: <i>default</i> leaves it at the process default, <i>local</i> allocates memory on the node the thread is running on, <i>preferred</i> prefers the first of the nodes listed in Nodes, <i>bind</i> restricts allocations to the listed nodes and <i>interleave</i> interleaves allocations over the listed nodes. As the thread's buffers (such as the receive buffer pool of a receive thread) are touched first by the thread itself, combining <i>local</i> with an Affinity confined to a single node places them on that node. Currently only supported on Linux.</p>" },
+    { LEAF("Nodes"), 1, "", RELOFF(config_thread_properties_listelem, numa_nodes), 0, uf_numa_nodes, 0, pf_numa_nodes,
+    "<p>This element specifies the NUMA nodes used by the <i>preferred</i>, <i>bind</i> and <i>interleave</i> policies as a comma-separated list of node numbers and ranges, e.g., <i>0,2-3</i>. Node numbers must be less than 64.</p>" },
+    END_MARKER
+};
+
 static const struct cfgelem thread_properties_cfgattrs[] = {
     { ATTR("Name"), 1, NULL, RELOFF(config_thread_properties_listelem, name), 0, uf_string, ff_free, pf_string,
     "<p>The Name of the thread for which properties are being set. The following threads exist:</p>\n\
 <ul><li><i>gc</i>: garbage collector thread involved in deleting entities;</li>\n\
 <li><i>recv</i>: receive thread, taking data from the network and running the protocol state machine;</li>\n\
+<li><i>recvMC</i>, <i>recvUC</i>, <i>recvUC1</i>, ...: receive threads dedicated to the data multicast and data unicast sockets;</li>\n\
 <li><i>dq.builtins</i>: delivery thread for DDSI-builtin data, primarily for discovery;</li>\n\
 <li><i>lease</i>: DDSI liveliness monitoring;</li>\n\
 <li><i>tev</i>: general timed-event handling, retransmits and discovery;</li>\n\
@@ -414,6 +433,10 @@ static const struct cfgelem thread_properties_cfgelems[] = {
     "<p>This element configures the scheduling properties of the thread.</p>" },
     { LEAF("StackSize"), 1, "default", RELOFF(config_thread_properties_listelem, stack_size), 0, uf_maybe_memsize, 0, pf_maybe_memsize,
     "<p>This element configures the stack size for this thread. The default value <i>default</i> leaves the stack size at the operating system default.</p>" },
+    { LEAF("Affinity"), 1, "", RELOFF(config_thread_properties_listelem, cpu_set), 0, uf_cpu_set, 0, pf_cpu_set,
+    "<p>This element specifies the CPUs the thread may run on as a comma-separated list of CPU numbers and ranges, e.g., <i>0,2-3</i>. The default (empty) does not restrict the thread. Supported on Linux and, for the first 64 CPUs, on Windows.</p>" },
+    { GROUP("Memory", thread_properties_memory_cfgelems),
+    "<p>This element configures the NUMA memory allocation policy of the thread.</p>" },
     END_MARKER
 };
 
@@ -518,6 +541,10 @@ static const struct cfgelem unsupp_cfgelems[] = {
     { MOVED("FragmentSize", "General/FragmentSize") },
     { LEAF("DeliveryQueueMaxSamples"), 1, "256", ABSOFF(delivery_queue_maxsamples), 0, uf_uint, 0, pf_uint,
     "<p>This element controls the Maximum size of a delivery queue, expressed in samples. Once a delivery queue is full, incoming samples destined for that queue are dropped until space becomes available again.</p>" },
+    { LEAF("DeliveryQueues"), 1, "1", ABSOFF(user_dqueues), 0, uf_user_dqueues, 0, pf_int,
+    "<p>This element sets the number of delivery queues (and delivery threads) for application data. Each remote writer is assigned to one of them based on its GUID, so the samples of a writer are always delivered in order, while samples from different writers may be delivered to the readers in parallel. It is ignored when network channels are used, each channel has its own delivery queue. The maximum is 16.</p>" },
+    { LEAF("EventQueues"), 1, "1", ABSOFF(xevent_queues), 0, uf_xevent_queues, 0, pf_int,
+    "<p>This element sets the number of queues (and threads) for timed events and retransmits. The heartbeats and retransmits of each writer and the acknowledgements for each remote writer are handled by one of them, chosen based on its GUID, so that a writer that retransmits a lot does not delay the heartbeats and acknowledgements of others. Discovery and the built-in endpoints always use the first one, and writers mapped to a network channel with its own event thread use that of the channel. The maximum is 16.</p>" },
     { LEAF("PrimaryReorderMaxSamples"), 1, "64", ABSOFF(primary_reorder_maxsamples), 0, uf_uint, 0, pf_uint,
     "<p>This element sets the maximum size in samples of a primary re-order administration. Each proxy writer has one primary re-order administration to buffer the packet flow in case some packets arrive out of order. Old samples are forwarded to secondary re-order administrations associated with readers in need of historical data.</p>" },
     { LEAF("SecondaryReorderMaxSamples"), 1, "16", ABSOFF(secondary_reorder_maxsamples), 0, uf_uint, 0, pf_uint,
@@ -548,6 +575,8 @@ static const struct cfgelem unsupp_cfgelems[] = {
 "<p>This element controls whether samples sent by a writer with QoS settings latency_budget <= SynchronousDeliveryLatencyBound and transport_priority greater than or equal to this element's value will be delivered synchronously from the \"recv\" thread, all others will be delivered asynchronously through delivery queues. This reduces latency at the expense of aggregate bandwidth.</p>" },
 { LEAF("SynchronousDeliveryLatencyBound"), 1, "inf", ABSOFF(synchronous_delivery_latency_bound), 0, uf_duration_inf, 0, pf_duration,
 "<p>This element controls whether samples sent by a writer with QoS settings transport_priority >= SynchronousDeliveryPriorityThreshold and a latency_budget at most this element's value will be delivered synchronously from the \"recv\" thread, all others will be delivered asynchronously through delivery queues. This reduces latency at the expense of aggregate bandwidth.</p>" },
+{ LEAF("SynchronousDeliveryAdaptive"), 1, "false", ABSOFF(synchronous_delivery_adaptive), 0, uf_boolean, 0, pf_boolean,
+"<p>This element controls whether samples from writers that qualify for synchronous delivery are only delivered from the \"recv\" thread while none of that writer's samples are waiting in its delivery queue and no reader history cache recently blocked delivery. Otherwise they are delivered asynchronously through the delivery queue until it has caught up, trading some latency for throughput under load.</p>" },
 { LEAF("MaxParticipants"), 1, "0", ABSOFF(max_participants), 0, uf_natint, 0, pf_int,
 "<p>This elements configures the maximum number of DCPS domain participants this DDSI2E instance is willing to service. 0 is unlimited.</p>" },
 { LEAF("AccelerateRexmitBlockSize"), 1, "0", ABSOFF(accelerate_rexmit_block_size), 0, uf_uint, 0, pf_uint,
@@ -586,7 +615,9 @@ static const struct cfgelem unsupp_cfgelems[] = {
 "<p>This setting allows the timing of scheduled events to be rounded up so that more events can be handled in a single cycle of the event queue. The default is 0 and causes no rounding at all, i.e. are scheduled exactly, whereas a value of 10ms would mean that events are rounded up to the nearest 10 milliseconds.</p>" },
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
 { LEAF("AuxiliaryBandwidthLimit"), 1, "inf", ABSOFF(auxiliary_bandwidth_limit), 0, uf_bandwidth, 0, pf_bandwidth,
-"<p>This element specifies the maximum transmit rate of auxiliary traffic not bound to a specific channel, such as discovery traffic, as well as auxiliary traffic related to a certain channel if that channel has elected to share this global AuxiliaryBandwidthLimit. Bandwidth limiting uses a leaky bucket scheme. The default value \"inf\" means DDSI2E imposes no limitation, the underlying operating system and hardware will likely limit the maimum transmit rate.</p>" },
+"<p>This element specifies the maximum transmit rate of auxiliary traffic not bound to a specific channel, such as discovery traffic, as well as auxiliary traffic related to a certain channel if that channel has elected to share this global AuxiliaryBandwidthLimit. Bandwidth limiting uses a token bucket scheme, see also Internal/PacingTxTime. The default value \"inf\" means DDSI2E imposes no limitation, the underlying operating system and hardware will likely limit the maimum transmit rate.</p>" },
+{ LEAF("PacingTxTime"), 1, "false", ABSOFF(pacing_txtime), 0, uf_pacing_txtime, 0, pf_pacing_txtime,
+"<p>This element controls how packets subject to a bandwidth limit are paced. Each limit is a token bucket that assigns every packet a departure time. By default (<i>false</i>), packets that may not leave yet are handed to a sending thread dedicated to that limit, which waits until their departure time, so neither the writing threads nor other traffic stall. Setting it to <i>monotonic</i> or <i>tai</i> passes the departure time to the kernel instead (SO_TXTIME, Linux only), which only has an effect if the network interface uses a queueing discipline that honours it: <i>monotonic</i> for fq, <i>tai</i> for etf. This applies to bandwidth-limited channels only, each of which then gets its own transmit socket on which every packet carries a departure time; the global AuxiliaryBandwidthLimit and sockets that do not support it use the sending thread.</p>" },
 #endif
 { LEAF("DDSI2DirectMaxThreads"), 1, "1", ABSOFF(ddsi2direct_max_threads), 0, uf_uint, 0, pf_uint,
 "<p>This element sets the maximum number of extra threads for an experimental, undocumented and unsupported direct mode.</p>" },
@@ -620,10 +651,28 @@ static const struct cfgelem unsupp_cfgelems[] = {
 "<p>Do not use.</p>" },
 { LEAF("SendAsync"), 1, "false", ABSOFF(xpack_send_async), 0, uf_boolean, 0, pf_boolean,
 "<p>This element controls whether the actual sending of packets occurs on the same thread that prepares them, or is done asynchronously by another thread.</p>" },
+{ LEAF("SendAsyncThreads"), 1, "1", ABSOFF(xpack_send_async_threads), 0, uf_sendq_threads, 0, pf_int,
+"<p>This element specifies the number of threads sending packets when SendAsync is enabled. Packets are assigned to a thread based on their destination, so the order of packets sent to any one destination is retained. The maximum is 16.</p>" },
+{ LEAF("SendIoUringPolling"), 1, "false", ABSOFF(uring_send_polling), 0, uf_boolean, 0, pf_boolean,
+"<p>This element controls whether packets sent using the uring and uring6 transports are picked up by a kernel thread polling the submission queue, instead of being submitted with a system call per packet. This saves the system call at the cost of a kernel thread that keeps a CPU busy for a short while after sending.</p>" },
+{ LEAF("SendSegmentationOffload"), 1, "false", ABSOFF(xpack_send_gso), 0, uf_boolean, 0, pf_boolean,
+"<p>This element controls whether consecutive packets of equal size to the same destinations, such as those carrying the fragments of a large sample, are handed to the kernel in a single system call, to be split into individual datagrams by the kernel or the network interface (UDP generic segmentation offload). Packets are only collected while a write or event is being processed, so none is held back beyond the end of the write that produced it, even when writes are batched. It is only used for transports that support it (currently UDP on Linux) and is not used in combination with SendAsync. It only has an effect if the packets fit in the MTU of the network interface, i.e., General/MaxMessageSize must be set below the MTU.</p>" },
 { LEAF_W_ATTRS("RediscoveryBlacklistDuration", rediscovery_blacklist_duration_attrs), 1, "10s", ABSOFF(prune_deleted_ppant.delay), 0, uf_duration_inf, 0, pf_duration,
 "<p>This element controls for how long a remote participant that was previously deleted will remain on a blacklist to prevent rediscovery, giving the software on a node time to perform any cleanup actions it needs to do. To some extent this delay is required internally by DDSI2E, but in the default configuration with the 'enforce' attribute set to false, DDSI2E will reallow rediscovery as soon as it has cleared its internal administration. Setting it to too small a value may result in the entry being pruned from the blacklist before DDSI2E is ready, it is therefore recommended to set it to at least several seconds.</p>" },
   { LEAF_W_ATTRS("MultipleReceiveThreads", multiple_recv_threads_attrs), 1, "true", ABSOFF(multiple_recv_threads), 0, uf_boolean, 0, pf_boolean,
          "<p>This element controls whether all traffic is handled by a single receive thread or whether multiple receive threads may be used to improve latency. Currently multiple receive threads are only used for connectionless transport (e.g., UDP) and ManySocketsMode not set to single (the default).</p>" },
+{ LEAF("DataUnicastReceiveThreads"), 1, "1", ABSOFF(data_uc_recv_threads), 0, uf_data_uc_recv_threads, 0, pf_int,
+"<p>This element sets the number of sockets bound to the data unicast port, each served by its own receive thread. The kernel distributes incoming packets over these sockets based on their source address and port, so all traffic from a single remote writer is handled by the same thread, preserving its ordering. It only has an effect if MultipleReceiveThreads is enabled and ManySocketsMode is single, and requires SO_REUSEPORT load balancing (currently Linux only). The maximum is 16.</p>" },
+{ LEAF("ReceiveBatchSize"), 1, "1", ABSOFF(recv_batch_size), 0, uf_recv_batch_size, 0, pf_int,
+"<p>This element sets the maximum number of packets a receive thread reads from a socket in a single system call, reducing the per-packet overhead at high packet rates. It is only used for transports that support it (currently UDP on Linux, using recvmmsg), the default of 1 reads packets one at a time. The achieved batch sizes are included in the trace. The maximum is 64.</p>" },
+{ LEAF("ReceiveSegmentationOffload"), 1, "false", ABSOFF(recv_gro), 0, uf_boolean, 0, pf_boolean,
+"<p>This element controls whether the kernel may coalesce consecutive packets from the same source into a single large buffer (UDP generic receive offload), which are then split into the individual messages by the receive thread without copying. This reduces the per-packet overhead when receiving large, fragmented samples. It is only used for transports that support it (currently UDP and io_uring on Linux) and requires Internal/ReceiveBufferChunkSize to be at least 64kB.</p>" },
+{ LEAF("RawEthernetPacketRing"), 1, "false", ABSOFF(raweth_packet_ring), 0, uf_boolean, 0, pf_boolean,
+"<p>This element controls whether the raw Ethernet transport receives frames through a memory-mapped packet ring (PACKET_MMAP with TPACKET_V3) shared with the kernel, instead of using a system call per frame. The kernel hands over the ring in blocks of frames, a block is handed back once all its frames have been read. A block that is not full is handed over after at most a millisecond, which bounds the additional latency.</p>" },
+{ LEAF("SharedMemoryTransport"), 1, "false", ABSOFF(shm_transport), 0, uf_boolean, 0, pf_boolean,
+"<p>This element controls whether unicast traffic between participants on the same host (and in the same network namespace, for the same user) is exchanged through shared memory instead of UDP. Each process then also advertises a shared-memory locator, peers that do not recognise it ignore it. Messages are copied into a ring of slots in a segment owned by the receiving process and a receiver that has run out of messages is woken up through a local socket. It is only supported on Linux, with the UDP transport and ManySocketsMode set to single.</p>" },
+{ LEAF("ZeroCopyReceiveThreshold"), 1, "0 B", ABSOFF(zerocopy_recv_threshold), 0, uf_memsize, 0, pf_memsize,
+"<p>This element sets the minimum serialised size of received samples of which the payload is referenced in the receive buffers instead of being copied out of them, deferring the copy until a reader actually deserialises the sample. A sample kept in a reader history then keeps the receive buffer it was received in allocated, which can substantially increase memory usage. Samples of topics with a key that arrive in fragments are always copied. The default of 0 disables it.</p>" },
 { MGROUP("ControlTopic", control_topic_cfgelems, control_topic_cfgattrs), 1, 0, 0, 0, 0, 0, 0, 0,
 "<p>The ControlTopic element allows configured whether DDSI2E provides a special control interface via a predefined topic or not.<p>" },
 { GROUP("Test", unsupp_test_cfgelems),
@@ -639,6 +688,14 @@ static const struct cfgelem sizing_cfgelems[] =
     "<p>This element sets the size of a single receive buffer. Many receive buffers may be needed. Their size must be greater than ReceiveBufferChunkSize by a modest amount.</p>" },
     { LEAF("ReceiveBufferChunkSize"), 1, "128 KiB", ABSOFF(rmsg_chunk_size), 0, uf_memsize, 0, pf_memsize,
     "<p>This element specifies the size of one allocation unit in the receive buffer. Must be greater than the maximum packet size by a modest amount (too large packets are dropped). Each allocation is shrunk immediately after processing a message, or freed straightaway.</p>" },
+    { LEAF("ReceiveBufferBacking"), 1, "heap", ABSOFF(rbuf_backing), 0, uf_rbuf_backing, 0, pf_rbuf_backing,
+    "<p>This element specifies how the memory for the receive buffers is obtained:</p>\n\
+<ul><li><i>heap</i>: allocated on the heap, the pages get mapped in by the receive thread when it first touches them;</li>\n\
+<li><i>populate</i>: mapped and populated by the kernel when the buffer is allocated, avoiding page faults while processing received data;</li>\n\
+<li><i>hugepages</i>: like populate, but using 2MB huge pages to also reduce TLB misses, in which case the size of a receive buffer is rounded up to a multiple of 2MB. This requires huge pages to have been reserved in the operating system, if none are available it falls back to populate.</li></ul>\n\
+<p>The latter two are only supported on Linux.</p>" },
+    { LEAF("ReceiveBufferSpares"), 1, "0", ABSOFF(rbuf_spares), 0, uf_uint, 0, pf_uint,
+    "<p>This element sets the number of empty receive buffers each receive thread keeps ready, so that it can switch to a new one when the current one is full without having to allocate it (and touch its pages for the first time) while processing incoming data. Buffers that become empty are recycled to replenish these. Each time a receive thread does have to allocate a new buffer is counted as an allocation stall, visible through the debug monitor.</p>" },
     END_MARKER
 };
 
@@ -1791,6 +1848,113 @@ static void pf_sched_class(struct cfgst *cfgst, void *parent, struct cfgelem con
     cfg_log(cfgst, "%s%s", str, is_default ? " [def]" : "");
 }
 
+static int uf_numa_policy(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG(int first), const char *value)
+{
+    static const char *vs[] = { "default", "local", "preferred", "bind", "interleave", NULL };
+    static const os_numaPolicy ms[] = { OS_NUMA_DEFAULT, OS_NUMA_LOCAL, OS_NUMA_PREFERRED, OS_NUMA_BIND, OS_NUMA_INTERLEAVE, 0 };
+    int idx = list_index(vs, value);
+    os_numaPolicy *elem = cfg_address(cfgst, parent, cfgelem);
+    assert(sizeof(vs) / sizeof(*vs) == sizeof(ms) / sizeof(*ms));
+    if ( idx < 0 )
+        return cfg_error(cfgst, "'%s': undefined value", value);
+    *elem = ms[idx];
+    return 1;
+}
+
+static void pf_numa_policy(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int is_default)
+{
+    os_numaPolicy *p = cfg_address(cfgst, parent, cfgelem);
+    const char *str = "INVALID";
+    switch ( *p ) {
+        case OS_NUMA_DEFAULT: str = "default"; break;
+        case OS_NUMA_LOCAL: str = "local"; break;
+        case OS_NUMA_PREFERRED: str = "preferred"; break;
+        case OS_NUMA_BIND: str = "bind"; break;
+        case OS_NUMA_INTERLEAVE: str = "interleave"; break;
+    }
+    cfg_log(cfgst, "%s%s", str, is_default ? " [def]" : "");
+}
+
+OS_WARNING_MSVC_OFF(4996);
+static int parse_index_list(struct cfgst *cfgst, const char *value, uint32_t max, uint64_t *bits)
+{
+    /* comma-separated list of numbers and ranges, setting bits[i/64] bit i%64 for each */
+    char *copy = os_strdup(value), *cursor = copy, *tok;
+    memset(bits, 0, (max / 64) * sizeof(*bits));
+    while ( (tok = os_strsep(&cursor, ",")) != NULL ) {
+        unsigned lo, hi;
+        int pos;
+        if ( *tok == 0 )
+            continue;
+        if ( sscanf(tok, "%u-%u%n", &lo, &hi, &pos) == 2 && tok[pos] == 0 )
+            ;
+        else if ( sscanf(tok, "%u%n", &lo, &pos) == 1 && tok[pos] == 0 )
+            hi = lo;
+        else {
+            int ret = cfg_error(cfgst, "'%s' in '%s' invalid", tok, value);
+            os_free(copy);
+            return ret;
+        }
+        if ( lo > hi || hi >= max ) {
+            int ret = cfg_error(cfgst, "'%s' in '%s' out of range", tok, value);
+            os_free(copy);
+            return ret;
+        }
+        for ( ; lo <= hi; lo++ )
+            bits[lo / 64] |= (uint64_t) 1 << (lo % 64);
+    }
+    os_free(copy);
+    return 1;
+}
+OS_WARNING_MSVC_ON(4996);
+
+static void pf_index_list(struct cfgst *cfgst, uint32_t max, const uint64_t *bits, int is_default)
+{
+    char str[1024];
+    size_t pos = 0;
+    uint32_t i = 0;
+    str[0] = 0;
+    while ( i < max && pos < sizeof(str) ) {
+        uint32_t j;
+        if ( !(bits[i / 64] & ((uint64_t) 1 << (i % 64))) ) {
+            i++;
+            continue;
+        }
+        for ( j = i; j + 1 < max && (bits[(j + 1) / 64] & ((uint64_t) 1 << ((j + 1) % 64))); j++ )
+            ;
+        if ( j == i )
+            pos += (size_t) snprintf(str + pos, sizeof(str) - pos, "%s%u", pos ? "," : "", i);
+        else
+            pos += (size_t) snprintf(str + pos, sizeof(str) - pos, "%s%u-%u", pos ? "," : "", i, j);
+        i = j + 1;
+    }
+    cfg_log(cfgst, "%s%s", str, is_default ? " [def]" : "");
+}
+
+static int uf_cpu_set(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG(int first), const char *value)
+{
+    os_cpuSet *elem = cfg_address(cfgst, parent, cfgelem);
+    return parse_index_list(cfgst, value, OS_CPUSET_SIZE, elem->bits);
+}
+
+static void pf_cpu_set(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int is_default)
+{
+    os_cpuSet *p = cfg_address(cfgst, parent, cfgelem);
+    pf_index_list(cfgst, OS_CPUSET_SIZE, p->bits, is_default);
+}
+
+static int uf_numa_nodes(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG(int first), const char *value)
+{
+    uint64_t *elem = cfg_address(cfgst, parent, cfgelem);
+    return parse_index_list(cfgst, value, 64, elem);
+}
+
+static void pf_numa_nodes(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int is_default)
+{
+    uint64_t *p = cfg_address(cfgst, parent, cfgelem);
+    pf_index_list(cfgst, 64, p, is_default);
+}
+
 OS_WARNING_MSVC_OFF(4996);
 static int uf_maybe_int32(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG(int first), const char *value)
 {
@@ -1986,11 +2150,36 @@ static int uf_natint_255(struct cfgst *cfgst, void *parent, struct cfgelem const
     return uf_int_min_max(cfgst, parent, cfgelem, first, value, 0, 255);
 }
 
+static int uf_data_uc_recv_threads(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+    return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, MAX_DATA_UC_RECV_THREADS);
+}
+
+static int uf_user_dqueues(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+    return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, MAX_USER_DQUEUES);
+}
+
+static int uf_xevent_queues(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+    return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, MAX_XEVENT_QUEUES);
+}
+
+static int uf_sendq_threads(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+    return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, MAX_SENDQ_THREADS);
+}
+
+static int uf_recv_batch_size(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+    return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, MAX_RECV_BATCH_SIZE);
+}
+
 static int uf_transport_selector (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG (int first), const char *value)
 {
-  static const char *vs[] = { "default", "udp", "udp6", "tcp", "tcp6", "raweth", NULL };
+  static const char *vs[] = { "default", "udp", "udp6", "tcp", "tcp6", "raweth", "uring", "uring6", NULL };
   static const enum transport_selector ms[] = {
-    TRANS_DEFAULT, TRANS_UDP, TRANS_UDP6, TRANS_TCP, TRANS_TCP6, TRANS_RAWETH, 0,
+    TRANS_DEFAULT, TRANS_UDP, TRANS_UDP6, TRANS_TCP, TRANS_TCP6, TRANS_RAWETH, TRANS_URING, TRANS_URING6, 0,
   };
   enum transport_selector *elem = cfg_address (cfgst, parent, cfgelem);
   int idx = list_index (vs, value);
@@ -2013,6 +2202,8 @@ static void pf_transport_selector (struct cfgst *cfgst, void *parent, struct cfg
     case TRANS_TCP: str = "tcp"; break;
     case TRANS_TCP6: str = "tcp6"; break;
     case TRANS_RAWETH: str = "raweth"; break;
+    case TRANS_URING: str = "uring"; break;
+    case TRANS_URING6: str = "uring6"; break;
   }
   cfg_log (cfgst, "%s%s", str, is_default ? " [def]" : "");
 }
@@ -2045,6 +2236,64 @@ static void pf_many_sockets_mode (struct cfgst *cfgst, void *parent, struct cfge
   cfg_log (cfgst, "%s%s", str, is_default ? " [def]" : "");
 }
 
+static int uf_rbuf_backing (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG (int first), const char *value)
+{
+  static const char *vs[] = { "heap", "populate", "hugepages", NULL };
+  static const enum rbuf_backing ms[] = {
+    RBB_HEAP, RBB_POPULATE, RBB_HUGEPAGES, 0,
+  };
+  enum rbuf_backing *elem = cfg_address (cfgst, parent, cfgelem);
+  int idx = list_index (vs, value);
+  assert (sizeof (vs) / sizeof (*vs) == sizeof (ms) / sizeof (*ms));
+  if (idx < 0)
+    return cfg_error (cfgst, "'%s': undefined value", value);
+  *elem = ms[idx];
+  return 1;
+}
+
+static void pf_rbuf_backing (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int is_default)
+{
+  enum rbuf_backing *p = cfg_address (cfgst, parent, cfgelem);
+  const char *str = "INVALID";
+  switch (*p)
+  {
+    case RBB_HEAP: str = "heap"; break;
+    case RBB_POPULATE: str = "populate"; break;
+    case RBB_HUGEPAGES: str = "hugepages"; break;
+  }
+  cfg_log (cfgst, "%s%s", str, is_default ? " [def]" : "");
+}
+
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+static int uf_pacing_txtime (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG (int first), const char *value)
+{
+  static const char *vs[] = { "false", "monotonic", "tai", NULL };
+  static const enum pacing_txtime ms[] = {
+    PTT_NONE, PTT_MONOTONIC, PTT_TAI, 0,
+  };
+  enum pacing_txtime *elem = cfg_address (cfgst, parent, cfgelem);
+  int idx = list_index (vs, value);
+  assert (sizeof (vs) / sizeof (*vs) == sizeof (ms) / sizeof (*ms));
+  if (idx < 0)
+    return cfg_error (cfgst, "'%s': undefined value", value);
+  *elem = ms[idx];
+  return 1;
+}
+
+static void pf_pacing_txtime (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int is_default)
+{
+  enum pacing_txtime *p = cfg_address (cfgst, parent, cfgelem);
+  const char *str = "INVALID";
+  switch (*p)
+  {
+    case PTT_NONE: str = "false"; break;
+    case PTT_MONOTONIC: str = "monotonic"; break;
+    case PTT_TAI: str = "tai"; break;
+  }
+  cfg_log (cfgst, "%s%s", str, is_default ? " [def]" : "");
+}
+#endif
+
 static int uf_deaf_mute (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
 {
   return uf_boolean (cfgst, parent, cfgelem, first, value);
@@ -2827,6 +3076,12 @@ struct cfgst * config_init
      the poor framework */
   {
     int ok1 = 1;
+    /* io_uring is an implementation of UDP, not a different protocol */
+    if (cfgst->cfg->transport_selector == TRANS_URING || cfgst->cfg->transport_selector == TRANS_URING6)
+    {
+      cfgst->cfg->transport_selector = (cfgst->cfg->transport_selector == TRANS_URING) ? TRANS_UDP : TRANS_UDP6;
+      cfgst->cfg->transport_uring = 1;
+    }
     switch (cfgst->cfg->transport_selector)
     {
       case TRANS_DEFAULT:
@@ -2850,6 +3105,10 @@ struct cfgst * config_init
       case TRANS_RAWETH:
         ok1 = !(cfgst->cfg->compat_tcp_enable == BOOLDEF_TRUE || cfgst->cfg->compat_use_ipv6 == BOOLDEF_TRUE);
         break;
+      case TRANS_URING:
+      case TRANS_URING6:
+        assert (0);
+        break;
     }
     if (!ok1)
       DDS_ERROR("config: invalid combination of Transport, IPv6, TCP\n");
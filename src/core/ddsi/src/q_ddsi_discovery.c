@@ -62,6 +62,20 @@ static int get_locator (nn_locator_t *loc, const nn_locators_t *locs, int uc_sam
     }
   }
 
+  /* A shared-memory locator beats anything else if it is on this host
+     and we can use it ourselves */
+  if (gv.data_conn_shm)
+  {
+    for (l = locs->first; l != NULL; l = l->next)
+    {
+      if (l->loc.kind == NN_LOCATOR_KIND_SHM && ddsi_is_nearby_address (&l->loc, (size_t)gv.n_interfaces, gv.interfaces) == DNAR_SAME)
+      {
+        *loc = l->loc;
+        return 1;
+      }
+    }
+  }
+
   /* Preferably an (the first) address that matches a network we are
      on; if none does, pick the first. No multicast locator ever will
      match, so the first one will be used. */
@@ -182,6 +196,7 @@ int spdp_write (struct participant *pp)
 {
   struct nn_xmsg *mpayload;
   struct nn_locators_one def_uni_loc_one, def_multi_loc_one, meta_uni_loc_one, meta_multi_loc_one;
+  struct nn_locators_one def_shm_loc_one, meta_shm_loc_one;
   nn_plist_t ps;
   struct writer *wr;
   size_t size;
@@ -243,6 +258,21 @@ int spdp_write (struct participant *pp)
     meta_uni_loc_one.loc = gv.loc_meta_uc;
   }
 
+  if (gv.data_conn_shm)
+  {
+    /* in addition to the UDP ones: same-host peers with shared memory enabled prefer these */
+    def_shm_loc_one.loc = gv.loc_default_shm;
+    meta_shm_loc_one.loc = gv.loc_meta_shm;
+    def_shm_loc_one.next = NULL;
+    meta_shm_loc_one.next = NULL;
+    def_uni_loc_one.next = &def_shm_loc_one;
+    meta_uni_loc_one.next = &meta_shm_loc_one;
+    ps.default_unicast_locators.last = &def_shm_loc_one;
+    ps.metatraffic_unicast_locators.last = &meta_shm_loc_one;
+    ps.default_unicast_locators.n = 2;
+    ps.metatraffic_unicast_locators.n = 2;
+  }
+
   if (config.publish_uc_locators)
   {
     ps.present |= PP_DEFAULT_UNICAST_LOCATOR | PP_METATRAFFIC_UNICAST_LOCATOR;
@@ -1095,6 +1125,15 @@ static struct proxy_participant *implicitly_create_proxypp (const nn_guid_t *ppg
   return ephash_lookup_proxy_participant_guid (ppguid);
 }
 
+#ifndef DDSI_INCLUDE_NETWORK_CHANNELS
+static struct nn_dqueue *user_dqueue_for_guid (const nn_guid_t *guid)
+{
+  /* All samples of a proxy writer must go through the same queue to
+     preserve their order, beyond that any spreading will do */
+  return gv.user_dqueues[guid_shard (guid, gv.n_user_dqueues)];
+}
+#endif
+
 static void handle_SEDP_alive (const struct receiver_state *rst, nn_plist_t *datap /* note: potentially modifies datap */, const nn_guid_prefix_t *src_guid_prefix, nn_vendorid_t vendorid, nn_wctime_t timestamp)
 {
 #define E(msg, lbl) do { DDS_LOG(DDS_LC_DISCOVERY, msg); goto lbl; } while (0)
@@ -1266,10 +1305,10 @@ static void handle_SEDP_alive (const struct receiver_state *rst, nn_plist_t *dat
 #ifdef DDSI_INCLUDE_NETWORK_CHANNELS
         {
           struct config_channel_listelem *channel = find_channel (xqos->transport_priority);
-          new_proxy_writer (&ppguid, &datap->endpoint_guid, as, datap, channel->dqueue, channel->evq ? channel->evq : gv.xevents, timestamp);
+          new_proxy_writer (&ppguid, &datap->endpoint_guid, as, datap, channel->dqueue, channel->evq ? channel->evq : xeventq_for_guid (&datap->endpoint_guid), timestamp);
         }
 #else
-        new_proxy_writer (&ppguid, &datap->endpoint_guid, as, datap, gv.user_dqueue, gv.xevents, timestamp);
+        new_proxy_writer (&ppguid, &datap->endpoint_guid, as, datap, user_dqueue_for_guid (&datap->endpoint_guid), xeventq_for_guid (&datap->endpoint_guid), timestamp);
 #endif
       }
     }
@@ -27,6 +27,7 @@
 #include "ddsi/q_globals.h"
 #include "ddsi/q_addrset.h"
 #include "ddsi/q_radmin.h"
+#include "ddsi/q_xevent.h"
 #include "ddsi/q_ddsi_discovery.h"
 #include "ddsi/q_protocol.h" /* NN_ENTITYID_... */
 #include "ddsi/q_unused.h"
@@ -139,6 +140,12 @@ static int print_proxy_endpoint_common (ddsi_tran_conn_t conn, const char *label
 }
 
 
+static int print_rx_drops (ddsi_tran_conn_t conn, const char *prefix, const struct nn_rx_drop_stats *d)
+{
+  return cpf (conn, "%sdrops queue-full %"PRIu64" too-old %"PRIu64" reorder-full %"PRIu64" duplicate %"PRIu64" defrag-full %"PRIu64"\n",
+              prefix, d->queue_full, d->too_old, d->reorder_full, d->duplicate, d->defrag_full);
+}
+
 static int print_participants (struct thread_state1 *self, ddsi_tran_conn_t conn)
 {
   struct ephash_enum_participant e;
@@ -266,15 +273,30 @@ static int print_proxy_participants (struct thread_state1 *self, ddsi_tran_conn_
       {
         ut_avlIter_t rdit;
         struct pwr_rd_match *m;
+        struct nn_radmin_stats dfst, rost;
+        struct nn_dqueue_stats dqst;
         if (w->c.proxypp != p)
           continue;
         os_mutexLock (&w->e.lock);
         print_proxy_endpoint_common (conn, "pwr", &w->e, &w->c);
-        x += cpf (conn, "    last_seq %lld last_fragnum %u\n", w->last_seq, w->last_fragnum);
+        x += cpf (conn, "    last_seq %lld last_fragnum %u dqueue %s\n", w->last_seq, w->last_fragnum, nn_dqueue_name (w->dqueue));
+        x += cpf (conn, "    delivery %s sync %"PRIu64" async %"PRIu64" stalls %"PRIu32" dqueued %"PRIu32"\n",
+                  w->deliver_adaptively ? "adaptive" : w->deliver_synchronously ? "sync" : "async",
+                  w->n_delivered_sync, w->n_delivered_async, w->n_sync_stalls, os_atomic_ld32 (&w->n_dqueued));
+        nn_defrag_stats (w->defrag, &dfst);
+        nn_reorder_stats (w->reorder, &rost);
+        nn_dqueue_stats (w->dqueue, &dqst);
+        x += cpf (conn, "    defrag %"PRIu32"/%"PRIu32" reorder %"PRIu32"/%"PRIu32" dqueue %"PRIu32"/%"PRIu32" high-water %"PRIu32"\n",
+                  dfst.n_samples, dfst.max_samples, rost.n_samples, rost.max_samples,
+                  dqst.n_samples, dqst.max_samples, dqst.high_water);
+        nn_rx_drop_stats_add (&rost.drops, &dfst.drops);
+        x += print_rx_drops (conn, "    ", &rost.drops);
         for (m = ut_avlIterFirst (&wr_readers_treedef, &w->readers, &rdit); m; m = ut_avlIterNext (&rdit))
         {
           x += cpf (conn, "    rd %x:%x:%x:%x (nack %lld %lld)\n",
                     PGUID (m->rd_guid), m->seq_last_nack, m->t_last_nack);
+          nn_reorder_stats (m->u.not_in_sync.reorder, &rost);
+          x += print_rx_drops (conn, "      ", &rost.drops);
           switch (m->in_sync)
           {
             case PRMSS_SYNC:
@@ -297,6 +319,57 @@ static int print_proxy_participants (struct thread_state1 *self, ddsi_tran_conn_
   return x;
 }
 
+static int print_recv_threads (ddsi_tran_conn_t conn)
+{
+  int x = 0;
+  for (unsigned i = 0; i < gv.n_recv_threads; i++)
+  {
+    if (gv.recv_threads[i].arg.rbpool)
+    {
+      struct nn_rbufpool_stats st;
+      nn_rbufpool_stats (gv.recv_threads[i].arg.rbpool, &st);
+      x += cpf (conn, "thread %s rbufs %"PRIu32" spare %"PRIu32" size %"PRIu32" rbuf-alloc-stalls %"PRIu32" batch-drops %"PRIu32"\n",
+                gv.recv_threads[i].name, st.n_rbufs, st.n_spares, st.rbuf_size, st.alloc_stalls, st.batch_drops);
+    }
+  }
+  return x;
+}
+
+static int print_xevent_queue (ddsi_tran_conn_t conn, const char *name, struct xeventq *evq)
+{
+  struct xeventq_stats st;
+  xeventq_stats (evq, &st);
+  return cpf (conn, "thread %s timed %"PRIu64" lag avg %"PRId64"us max %"PRId64"us non-timed %"PRIu64" rexmit-queued %"PRIuSIZE" msgs %"PRIuSIZE" bytes\n",
+              name, st.n_timed, (st.n_timed == 0) ? 0 : st.lag_sum / (int64_t) st.n_timed / 1000, st.lag_max / 1000,
+              st.n_nontimed, st.queued_rexmit_msgs, st.queued_rexmit_bytes);
+}
+
+static int print_xevent_queues (ddsi_tran_conn_t conn)
+{
+  int x = 0;
+  for (unsigned i = 0; i < gv.n_xevent_shards; i++)
+  {
+    char name[16];
+    if (i == 0)
+      (void) snprintf (name, sizeof (name), "tev");
+    else
+      (void) snprintf (name, sizeof (name), "tev.%u", i);
+    x += print_xevent_queue (conn, name, gv.xevent_shards[i]);
+  }
+#ifdef DDSI_INCLUDE_NETWORK_CHANNELS
+  for (struct config_channel_listelem *chptr = config.channels; chptr; chptr = chptr->next)
+  {
+    if (chptr->evq)
+    {
+      char name[64];
+      (void) snprintf (name, sizeof (name), "tev.%s", chptr->name);
+      x += print_xevent_queue (conn, name, chptr->evq);
+    }
+  }
+#endif
+  return x;
+}
+
 static uint32_t debmon_main (void *vdm)
 {
   struct debug_monitor *dm = vdm;
@@ -312,6 +385,10 @@ static uint32_t debmon_main (void *vdm)
       r += print_participants (dm->servts, conn);
       if (r == 0)
         r += print_proxy_participants (dm->servts, conn);
+      if (r == 0)
+        r += print_recv_threads (conn);
+      if (r == 0)
+        r += print_xevent_queues (conn);
 
       /* Note: can only add plugins (at the tail) */
       os_mutexLock (&dm->lock);
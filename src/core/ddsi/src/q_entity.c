@@ -2718,20 +2718,21 @@ static void new_writer_guid_common_init (struct writer *wr, const struct ddsi_se
   }
 #endif
 
-  /* for non-builtin writers, select the eventqueue based on the channel it is mapped to */
+  /* for non-builtin writers, select the eventqueue based on the channel it is mapped to,
+     or failing that, on its GUID */
 
 #ifdef DDSI_INCLUDE_NETWORK_CHANNELS
-  if (!is_builtin_entityid (wr->e.guid.entityid, ownvendorid))
+  if (!is_builtin_entityid (wr->e.guid.entityid, NN_VENDORID_ECLIPSE))
   {
     struct config_channel_listelem *channel = find_channel (wr->xqos->transport_priority);
     DDS_LOG(DDS_LC_DISCOVERY, "writer %x:%x:%x:%x: transport priority %d => channel '%s' priority %d\n",
             PGUID (wr->e.guid), wr->xqos->transport_priority.value, channel->name, channel->priority);
-    wr->evq = channel->evq ? channel->evq : gv.xevents;
+    wr->evq = channel->evq ? channel->evq : xeventq_for_guid (&wr->e.guid);
   }
   else
 #endif
   {
-    wr->evq = gv.xevents;
+    wr->evq = is_builtin_entityid (wr->e.guid.entityid, NN_VENDORID_ECLIPSE) ? gv.xevents : xeventq_for_guid (&wr->e.guid);
   }
 
   /* heartbeat event will be deleted when the handler can't find a
@@ -4107,6 +4108,13 @@ int new_proxy_writer (const struct nn_guid *ppguid, const struct nn_guid *guid,
   } else {
     pwr->deliver_synchronously = 0;
   }
+  /* Adaptive delivery only ever falls back from synchronous delivery */
+  pwr->deliver_adaptively = pwr->deliver_synchronously && config.synchronous_delivery_adaptive;
+  pwr->sync_delivery_stalled = 0;
+  os_atomic_st32 (&pwr->n_dqueued, 0);
+  pwr->n_delivered_sync = 0;
+  pwr->n_delivered_async = 0;
+  pwr->n_sync_stalls = 0;
   pwr->have_seen_heartbeat = 0;
   pwr->local_matching_inprogress = 1;
 #ifdef DDSI_INCLUDE_SSM
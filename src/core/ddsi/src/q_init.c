@@ -51,12 +51,15 @@
 #include "ddsi/ddsi_udp.h"
 #include "ddsi/ddsi_tcp.h"
 #include "ddsi/ddsi_raweth.h"
+#include "ddsi/ddsi_uring.h"
+#include "ddsi/ddsi_shm.h"
 #include "ddsi/ddsi_mcgroup.h"
 #include "ddsi/ddsi_serdata_default.h"
 
 #include "ddsi/ddsi_tkmap.h"
 #include "dds__whc.h"
 #include "ddsi/ddsi_iid.h"
+#include "ddsi/ddsi_pacer.h"
 
 static void add_peer_addresses (struct addrset *as, const struct config_peer_listelem *list)
 {
@@ -67,6 +70,71 @@ static void add_peer_addresses (struct addrset *as, const struct config_peer_lis
   }
 }
 
+static void make_data_uc_shards (uint32_t port)
+{
+  /* Additional sockets on the data unicast port, the first one (data_conn_uc)
+     was already created with SO_REUSEPORT set.  Failing to create these is
+     not fatal: it merely means fewer receive threads handle the data. */
+  ddsi_tran_qos_t qos = ddsi_tran_create_qos ();
+  unsigned n = (unsigned) config.data_uc_recv_threads - 1;
+  qos->m_reuseport = true;
+  while (gv.n_data_conn_uc_shards < n)
+  {
+    ddsi_tran_conn_t conn;
+    if ((conn = ddsi_factory_create_conn (gv.m_factory, port, qos)) == NULL)
+    {
+      DDS_WARNING("make_uc_sockets: only %u of %d data unicast sockets created\n", gv.n_data_conn_uc_shards + 1, config.data_uc_recv_threads);
+      break;
+    }
+    gv.data_conn_uc_shards[gv.n_data_conn_uc_shards++] = conn;
+  }
+  ddsi_tran_free_qos (qos);
+}
+
+static void free_data_uc_shards (void)
+{
+  while (gv.n_data_conn_uc_shards > 0)
+    ddsi_conn_free (gv.data_conn_uc_shards[--gv.n_data_conn_uc_shards]);
+}
+
+static void make_shm_conns (void)
+{
+  /* Shared-memory connections on the unicast ports, so that peers on the
+     same host can reach us through them.  Failing to create them is not
+     fatal: all traffic then simply goes over UDP. */
+  ddsi_tran_factory_t factory;
+  if (!(gv.m_factory->m_connless && config.many_sockets_mode == MSM_SINGLE_UNICAST))
+  {
+    DDS_WARNING("shared-memory transport requires UDP and ManySocketsMode single: disabled\n");
+    return;
+  }
+  if (ddsi_shm_init () < 0 || (factory = ddsi_factory_find ("shm")) == NULL)
+  {
+    DDS_WARNING("shared-memory transport not available\n");
+    return;
+  }
+  if ((gv.disc_conn_shm = ddsi_factory_create_conn (factory, ddsi_conn_port (gv.disc_conn_uc), NULL)) == NULL)
+    return;
+  if (gv.data_conn_uc == gv.disc_conn_uc)
+    gv.data_conn_shm = gv.disc_conn_shm;
+  else if ((gv.data_conn_shm = ddsi_factory_create_conn (factory, ddsi_conn_port (gv.data_conn_uc), NULL)) == NULL)
+  {
+    ddsi_conn_free (gv.disc_conn_shm);
+    gv.disc_conn_shm = NULL;
+    return;
+  }
+  ddsi_conn_locator (gv.disc_conn_shm, &gv.loc_meta_shm);
+  ddsi_conn_locator (gv.data_conn_shm, &gv.loc_default_shm);
+}
+
+static void free_shm_conns (void)
+{
+  if (gv.data_conn_shm != gv.disc_conn_shm)
+    ddsi_conn_free (gv.data_conn_shm);
+  ddsi_conn_free (gv.disc_conn_shm);
+  gv.data_conn_shm = gv.disc_conn_shm = NULL;
+}
+
 static int make_uc_sockets (uint32_t * pdisc, uint32_t * pdata, int ppid)
 {
   if (config.many_sockets_mode == MSM_NO_UNICAST)
@@ -105,7 +173,23 @@ static int make_uc_sockets (uint32_t * pdisc, uint32_t * pdata, int ppid)
 
     if (*pdata != 0 && (*pdata != *pdisc))
     {
-      gv.data_conn_uc = ddsi_factory_create_conn (gv.m_factory, *pdata, NULL);
+      /* Spreading the data over multiple sockets only works for a
+         dedicated data port: the discovery port is also used by the
+         participant index selection to detect it is in use */
+      const bool shard =
+        (gv.m_factory->m_connless && config.multiple_recv_threads &&
+         config.many_sockets_mode == MSM_SINGLE_UNICAST && config.data_uc_recv_threads > 1);
+      ddsi_tran_qos_t qos = NULL;
+      if (shard)
+      {
+        qos = ddsi_tran_create_qos ();
+        qos->m_reuseport = true;
+      }
+      gv.data_conn_uc = ddsi_factory_create_conn (gv.m_factory, *pdata, qos);
+      if (qos)
+        ddsi_tran_free_qos (qos);
+      if (shard && gv.data_conn_uc)
+        make_data_uc_shards (*pdata);
     }
     else
     {
@@ -590,9 +674,9 @@ int rtps_config_prep (struct cfgst *cfgst)
 #define USER_MAX_THREADS 50
 
 #ifdef DDSI_INCLUDE_NETWORK_CHANNELS
-    const unsigned max_threads = 9 + USER_MAX_THREADS + num_channel_threads + config.ddsi2direct_max_threads;
+    const unsigned max_threads = 9 + (unsigned) config.xevent_queues + USER_MAX_THREADS + num_channel_threads + config.ddsi2direct_max_threads;
 #else
-    const unsigned max_threads = 11 + USER_MAX_THREADS + config.ddsi2direct_max_threads;
+    const unsigned max_threads = 10 + (unsigned) config.user_dqueues + (unsigned) config.xevent_queues + USER_MAX_THREADS + config.ddsi2direct_max_threads;
 #endif
     thread_states_init (max_threads);
   }
@@ -784,8 +868,10 @@ static int setup_and_start_recv_threads (void)
     gv.recv_threads[i].ts = NULL;
     gv.recv_threads[i].arg.mode = RTM_SINGLE;
     gv.recv_threads[i].arg.rbpool = NULL;
+    gv.recv_threads[i].arg.populated = 0;
     gv.recv_threads[i].arg.u.single.loc = NULL;
     gv.recv_threads[i].arg.u.single.conn = NULL;
+    gv.recv_threads[i].arg.u.single.ws = NULL;
   }
 
   /* First thread always uses a waitset and gobbles up all sockets not handled by dedicated threads - FIXME: MSM_NO_UNICAST mode with UDP probably doesn't even need this one to use a waitset */
@@ -813,16 +899,33 @@ static int setup_and_start_recv_threads (void)
       gv.recv_threads[gv.n_recv_threads].arg.u.single.loc = &gv.loc_default_uc;
       ddsi_conn_disable_multiplexing (gv.data_conn_uc);
       gv.n_recv_threads++;
+      for (i = 0; i < gv.n_data_conn_uc_shards; i++)
+      {
+        /* Sockets sharing the data port: these can't be woken up by sending a packet to the port */
+        static const char *names[MAX_DATA_UC_RECV_THREADS - 1] = {
+          "recvUC1", "recvUC2", "recvUC3", "recvUC4", "recvUC5", "recvUC6", "recvUC7", "recvUC8",
+          "recvUC9", "recvUC10", "recvUC11", "recvUC12", "recvUC13", "recvUC14", "recvUC15"
+        };
+        gv.recv_threads[gv.n_recv_threads].name = names[i];
+        gv.recv_threads[gv.n_recv_threads].arg.mode = RTM_SINGLE;
+        gv.recv_threads[gv.n_recv_threads].arg.u.single.conn = gv.data_conn_uc_shards[i];
+        gv.recv_threads[gv.n_recv_threads].arg.u.single.loc = &gv.loc_default_uc;
+        ddsi_conn_disable_multiplexing (gv.data_conn_uc_shards[i]);
+        gv.n_recv_threads++;
+      }
     }
   }
   assert (gv.n_recv_threads <= MAX_RECV_THREADS);
 
   /* For each thread, create rbufpool and waitset if needed, then start it */
+  os_condInit (&gv.recv_threads_cond, &gv.lock);
   for (i = 0; i < gv.n_recv_threads; i++)
   {
     /* We create the rbufpool for the receive thread, and so we'll
        become the initial owner thread. The receive thread will change
-       it before it does anything with it. */
+       it and then allocate the receive buffers itself, so that their
+       memory follows its affinity and memory policy; it tells us
+       whether that succeeded. */
     if ((gv.recv_threads[i].arg.rbpool = nn_rbufpool_new (config.rbuf_size, config.rmsg_chunk_size)) == NULL)
     {
       DDS_ERROR("rtps_init: can't allocate receive buffer pool for thread %s\n", gv.recv_threads[i].name);
@@ -836,15 +939,36 @@ static int setup_and_start_recv_threads (void)
         goto fail;
       }
     }
+    else if (gv.n_data_conn_uc_shards > 0 && gv.recv_threads[i].arg.u.single.loc == &gv.loc_default_uc)
+    {
+      /* Threads sharing the data unicast port wait on a waitset of their own so they can be triggered */
+      if ((gv.recv_threads[i].arg.u.single.ws = os_sockWaitsetNew ()) == NULL)
+      {
+        DDS_ERROR("rtps_init: can't allocate sock waitset for thread %s\n", gv.recv_threads[i].name);
+        goto fail;
+      }
+      os_sockWaitsetAdd (gv.recv_threads[i].arg.u.single.ws, gv.recv_threads[i].arg.u.single.conn);
+    }
     if ((gv.recv_threads[i].ts = create_thread (gv.recv_threads[i].name, recv_thread, &gv.recv_threads[i].arg)) == NULL)
     {
       DDS_ERROR("rtps_init: failed to start thread %s\n", gv.recv_threads[i].name);
       goto fail;
     }
+    os_mutexLock (&gv.lock);
+    while (gv.recv_threads[i].arg.populated == 0)
+      os_condWait (&gv.recv_threads_cond, &gv.lock);
+    os_mutexUnlock (&gv.lock);
+    if (gv.recv_threads[i].arg.populated < 0)
+    {
+      DDS_ERROR("rtps_init: can't allocate receive buffers for thread %s\n", gv.recv_threads[i].name);
+      goto fail;
+    }
   }
+  os_condDestroy (&gv.recv_threads_cond);
   return 0;
 
 fail:
+  os_condDestroy (&gv.recv_threads_cond);
   /* to trigger any threads we already started to stop - xevent thread has already been started */
   rtps_term_prep ();
   wait_for_receive_threads ();
@@ -852,6 +976,8 @@ fail:
   {
     if (gv.recv_threads[i].arg.mode == RTM_MANY && gv.recv_threads[i].arg.u.many.ws)
       os_sockWaitsetFree (gv.recv_threads[i].arg.u.many.ws);
+    else if (gv.recv_threads[i].arg.mode == RTM_SINGLE && gv.recv_threads[i].arg.u.single.ws)
+      os_sockWaitsetFree (gv.recv_threads[i].arg.u.single.ws);
     if (gv.recv_threads[i].arg.rbpool)
       nn_rbufpool_free (gv.recv_threads[i].arg.rbpool);
   }
@@ -863,6 +989,8 @@ int rtps_init (void)
   uint32_t port_disc_uc = 0;
   uint32_t port_data_uc = 0;
   bool mc_available = true;
+  /* bandwidth-limited channels use the send threads for pacing */
+  bool need_sendq = (config.xpack_send_async != 0);
 
   /* Initialize implementation (Lite or OSPL) */
 
@@ -873,6 +1001,9 @@ int rtps_init (void)
 
   gv.disc_conn_uc = NULL;
   gv.data_conn_uc = NULL;
+  gv.n_data_conn_uc_shards = 0;
+  gv.disc_conn_shm = NULL;
+  gv.data_conn_shm = NULL;
   gv.disc_conn_mc = NULL;
   gv.data_conn_mc = NULL;
   gv.tev_conn = NULL;
@@ -905,6 +1036,8 @@ int rtps_init (void)
   switch (config.transport_selector)
   {
     case TRANS_DEFAULT:
+    case TRANS_URING:
+    case TRANS_URING6:
       assert(0);
     case TRANS_UDP:
     case TRANS_UDP6:
@@ -912,6 +1045,9 @@ int rtps_init (void)
       config.enable_uc_locators = 1;
       if (ddsi_udp_init () < 0)
         goto err_udp_tcp_init;
+      /* The io_uring factory overrides the plain UDP one if it is available */
+      if (config.transport_uring && ddsi_uring_init () < 0)
+        DDS_WARNING("io_uring not available, using plain UDP\n");
       gv.m_factory = ddsi_factory_find (config.transport_selector == TRANS_UDP ? "udp" : "udp6");
       break;
     case TRANS_TCP:
@@ -1096,6 +1232,8 @@ int rtps_init (void)
       assert(0);
     }
     DDS_LOG(DDS_LC_CONFIG, "rtps_init: uc ports: disc %u data %u\n", port_disc_uc, port_data_uc);
+    if (config.shm_transport)
+      make_shm_conns ();
   }
   DDS_LOG(DDS_LC_CONFIG, "rtps_init: domainid %d participantid %d\n", config.domainId.value, config.participantIndex);
 
@@ -1180,14 +1318,30 @@ int rtps_init (void)
     {
       size_t slen = strlen (chptr->name) + 5;
       char * tname = os_malloc (slen);
+      bool txtime = false;
       (void) snprintf (tname, slen, "tev.%s", chptr->name);
 
-      /* Only actually create new connection if diffserv set */
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+      /* One token bucket per limit, shared by all writers resp. the
+         event queue of the channel */
+      chptr->data_pacer = chptr->data_bandwidth_limit ? ddsi_pacer_new (chptr->name, chptr->data_bandwidth_limit) : NULL;
+      chptr->auxiliary_pacer = chptr->auxiliary_bandwidth_limit ? ddsi_pacer_new (tname, chptr->auxiliary_bandwidth_limit) : NULL;
+      if (chptr->data_pacer || chptr->auxiliary_pacer)
+        need_sendq = true;
+      /* Departure times require SO_TXTIME, which makes the kernel drop
+         anything sent without one, so a bandwidth-limited channel then
+         gets a connection of its own */
+      txtime = (config.pacing_txtime != PTT_NONE && (chptr->data_pacer || chptr->auxiliary_pacer));
+#endif
 
-      if (chptr->diffserv_field)
+      /* Only actually create new connection if diffserv set (or
+         departure times are needed) */
+
+      if (chptr->diffserv_field || txtime)
       {
         ddsi_tran_qos_t qos = ddsi_tran_create_qos ();
         qos->m_diffserv = chptr->diffserv_field;
+        qos->m_txtime = txtime;
         chptr->transmit_conn = ddsi_factory_create_conn (gv.m_factory, 0, qos);
         ddsi_tran_free_qos (qos);
         if (chptr->transmit_conn == NULL)
@@ -1199,7 +1353,7 @@ int rtps_init (void)
       {
         chptr->transmit_conn = gv.data_conn_uc;
       }
-      DDS_TRACE("channel %s: transmit port %d\n", chptr->name, (int) ddsi_tran_port (chptr->transmit_conn));
+      DDS_TRACE("channel %s: transmit port %d\n", chptr->name, (int) ddsi_conn_port (chptr->transmit_conn));
 
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
       if (chptr->auxiliary_bandwidth_limit > 0 || lookup_thread_properties (tname))
@@ -1209,7 +1363,7 @@ int rtps_init (void)
           chptr->transmit_conn,
           config.max_queued_rexmit_bytes,
           config.max_queued_rexmit_msgs,
-          chptr->auxiliary_bandwidth_limit
+          chptr->auxiliary_pacer
         );
       }
 #else
@@ -1220,7 +1374,7 @@ int rtps_init (void)
           chptr->transmit_conn,
           config.max_queued_rexmit_bytes,
           config.max_queued_rexmit_msgs,
-          0
+          NULL
         );
       }
 #endif
@@ -1232,17 +1386,39 @@ int rtps_init (void)
 
   /* Create event queues */
 
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  gv.auxiliary_pacer = config.auxiliary_bandwidth_limit ? ddsi_pacer_new ("tev", config.auxiliary_bandwidth_limit) : NULL;
+  if (gv.auxiliary_pacer)
+    need_sendq = true;
+#endif
   gv.xevents = xeventq_new
   (
     gv.tev_conn,
     config.max_queued_rexmit_bytes,
     config.max_queued_rexmit_msgs,
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
-    config.auxiliary_bandwidth_limit
+    gv.auxiliary_pacer
 #else
-    0
+    NULL
 #endif
   );
+  /* The other event queues share the global auxiliary bandwidth limit */
+  gv.n_xevent_shards = (unsigned) config.xevent_queues;
+  gv.xevent_shards[0] = gv.xevents;
+  for (unsigned i = 1; i < gv.n_xevent_shards; i++)
+  {
+    gv.xevent_shards[i] = xeventq_new
+    (
+      gv.tev_conn,
+      config.max_queued_rexmit_bytes,
+      config.max_queued_rexmit_msgs,
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+      gv.auxiliary_pacer
+#else
+      NULL
+#endif
+    );
+  }
 
   gv.as_disc = new_addrset ();
   add_to_addrset (gv.as_disc, &gv.loc_spdp_mc);
@@ -1277,6 +1453,14 @@ int rtps_init (void)
   gv.rtps_keepgoing = 1;
   os_rwlockInit (&gv.qoslock);
 
+  /* Send threads must exist before anything creates an asynchronous
+     xpack, which includes the event threads */
+  if (need_sendq)
+  {
+    nn_xpack_sendq_init();
+    nn_xpack_sendq_start();
+  }
+
   {
     int r;
     gv.builtins_dqueue = nn_dqueue_new ("builtins", config.delivery_queue_maxsamples, builtins_dqueue_handler, NULL);
@@ -1284,12 +1468,13 @@ int rtps_init (void)
     {
       DDS_FATAL("failed to start global event processing thread (%d)\n", r);
     }
-  }
-
-  if (config.xpack_send_async)
-  {
-    nn_xpack_sendq_init();
-    nn_xpack_sendq_start();
+    for (unsigned i = 1; i < gv.n_xevent_shards; i++)
+    {
+      char name[16];
+      (void) snprintf (name, sizeof (name), "%u", i);
+      if ((r = xeventq_start (gv.xevent_shards[i], name)) < 0)
+        DDS_FATAL("failed to start event processing thread %u (%d)\n", i, r);
+    }
   }
 
 #ifdef DDSI_INCLUDE_NETWORK_CHANNELS
@@ -1309,7 +1494,16 @@ int rtps_init (void)
     }
   }
 #else
-  gv.user_dqueue = nn_dqueue_new ("user", config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
+  gv.n_user_dqueues = (unsigned) config.user_dqueues;
+  for (unsigned i = 0; i < gv.n_user_dqueues; i++)
+  {
+    char name[16];
+    if (gv.n_user_dqueues == 1)
+      (void) snprintf (name, sizeof (name), "user");
+    else
+      (void) snprintf (name, sizeof (name), "user.%u", i);
+    gv.user_dqueues[i] = nn_dqueue_new (name, config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
+  }
 #endif
 
   if (setup_and_start_recv_threads () < 0)
@@ -1345,6 +1539,8 @@ err_mc_conn:
     ddsi_conn_free (gv.disc_conn_uc);
   if (gv.data_conn_uc != gv.disc_conn_uc)
     ddsi_conn_free (gv.data_conn_uc);
+  free_data_uc_shards ();
+  free_shm_conns ();
   free_group_membership(gv.mship);
 err_unicast_sockets:
   ddsi_tkmap_free (gv.m_tkmap);
@@ -1444,6 +1640,8 @@ void rtps_stop (void)
   }
 
   xeventq_stop (gv.xevents);
+  for (unsigned i = 1; i < gv.n_xevent_shards; i++)
+    xeventq_stop (gv.xevent_shards[i]);
 #ifdef DDSI_INCLUDE_NETWORK_CHANNELS
   for (chptr = config.channels; chptr; chptr = chptr->next)
   {
@@ -1557,6 +1755,10 @@ void rtps_stop (void)
 
 void rtps_fini (void)
 {
+#ifdef DDSI_INCLUDE_NETWORK_CHANNELS
+  struct config_channel_listelem *chptr;
+#endif
+
   /* Shut down the GC system -- no new requests will be added */
   gcreq_queue_free (gv.gcreq_queue);
 
@@ -1573,16 +1775,23 @@ void rtps_fini (void)
     chptr = chptr->next;
   }
 #else
-  nn_dqueue_free (gv.user_dqueue);
+  for (unsigned i = 0; i < gv.n_user_dqueues; i++)
+    nn_dqueue_free (gv.user_dqueues[i]);
 #endif
 
   xeventq_free (gv.xevents);
+  for (unsigned i = 1; i < gv.n_xevent_shards; i++)
+    xeventq_free (gv.xevent_shards[i]);
 
-  if (config.xpack_send_async)
+  if (gv.n_sendqs > 0)
   {
     nn_xpack_sendq_stop();
     nn_xpack_sendq_fini();
   }
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  if (gv.auxiliary_pacer)
+    ddsi_pacer_free (gv.auxiliary_pacer);
+#endif
 
 #ifdef DDSI_INCLUDE_NETWORK_CHANNELS
   chptr = config.channels;
@@ -1592,6 +1801,12 @@ void rtps_fini (void)
     {
       xeventq_free (chptr->evq);
     }
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+    if (chptr->data_pacer)
+      ddsi_pacer_free (chptr->data_pacer);
+    if (chptr->auxiliary_pacer)
+      ddsi_pacer_free (chptr->auxiliary_pacer);
+#endif
     if (chptr->transmit_conn != gv.data_conn_uc)
     {
       ddsi_conn_free (chptr->transmit_conn);
@@ -1611,6 +1826,8 @@ void rtps_fini (void)
     ddsi_conn_free (gv.disc_conn_uc);
   if (gv.data_conn_uc != gv.disc_conn_uc)
     ddsi_conn_free (gv.data_conn_uc);
+  free_data_uc_shards ();
+  free_shm_conns ();
 
   /* Not freeing gv.tev_conn: it aliases data_conn_uc */
 
@@ -1640,6 +1857,8 @@ void rtps_fini (void)
     {
       if (gv.recv_threads[i].arg.mode == RTM_MANY)
         os_sockWaitsetFree (gv.recv_threads[i].arg.u.many.ws);
+      else if (gv.recv_threads[i].arg.u.single.ws)
+        os_sockWaitsetFree (gv.recv_threads[i].arg.u.single.ws);
       nn_rbufpool_free (gv.recv_threads[i].arg.rbpool);
     }
   }
@@ -10,6 +10,7 @@
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
 #include <string.h>
+#include <assert.h>
 
 #include "ddsi/q_misc.h"
 #include "ddsi/q_bswap.h"
@@ -151,3 +152,12 @@ uint32_t crc32_calc (const void *buf, size_t length)
   }
   return reg;
 }
+
+uint32_t guid_shard (const nn_guid_t *guid, uint32_t n)
+{
+  const uint64_t a = ((uint64_t) guid->prefix.u[0] << 32) | guid->prefix.u[1];
+  const uint64_t b = ((uint64_t) guid->prefix.u[2] << 32) | guid->entityid.u;
+  const uint64_t h = a * UINT64_C (16292676669999574021) ^ b * UINT64_C (10242350189706880077);
+  assert (n > 0);
+  return (uint32_t) (h >> 32) % n;
+}
@@ -197,6 +197,27 @@ static int set_reuse_options (os_socket socket)
   return 0;
 }
 
+static int set_reuseport_option (os_socket socket)
+{
+  /* Allow multiple sockets to be bound to the same unicast port, with
+     the kernel distributing incoming datagrams over them based on a
+     hash of the source address */
+#if defined SO_REUSEPORT && defined __linux
+  int one = 1;
+
+  if (os_sockSetsockopt (socket, SOL_SOCKET, SO_REUSEPORT, (char *) &one, sizeof (one)) != os_resultSuccess)
+  {
+    print_sockerror ("SO_REUSEPORT");
+    return -2;
+  }
+  return 0;
+#else
+  (void) socket;
+  DDS_WARNING("SO_REUSEPORT load balancing not supported on this platform\n");
+  return -2;
+#endif
+}
+
 static int bind_socket (os_socket socket, unsigned short port)
 {
   os_result rc;
@@ -333,7 +354,8 @@ int make_socket
   os_socket * sock,
   unsigned short port,
   bool stream,
-  bool reuse
+  bool reuse,
+  bool reuseport
 )
 {
   int rc = -2;
@@ -365,6 +387,11 @@ int make_socket
     goto fail;
   }
 
+  if (port && reuseport && ((rc = set_reuseport_option (*sock)) < 0))
+  {
+    goto fail;
+  }
+
   if
   (
     (rc = set_rcvbuf (*sock) < 0) ||
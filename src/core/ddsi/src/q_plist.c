@@ -1546,6 +1546,15 @@ static int do_locator
       }
       break;
     }
+    case NN_LOCATOR_KIND_SHM:
+      if (gv.data_conn_shm == NULL)
+        return 0;
+      if (loc.port <= 0 || loc.port > 65535)
+      {
+        DDS_TRACE("plist/do_locator[kind=SHM]: invalid port (%d)\n", (int) loc.port);
+        return ERR_INVALID;
+      }
+      break;
     case NN_LOCATOR_KIND_INVALID:
       if (!locator_address_zero (&loc))
       {
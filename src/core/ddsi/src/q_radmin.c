@@ -24,6 +24,10 @@
 
 #include "os/os.h"
 
+#if defined __linux
+#include <sys/mman.h>
+#endif
+
 #include "util/ut_avl.h"
 #include "ddsi/q_protocol.h"
 #include "ddsi/q_rtps.h"
@@ -35,6 +39,7 @@
 #include "ddsi/q_plist.h"
 #include "ddsi/q_unused.h"
 #include "ddsi/q_radmin.h"
+#include "ddsi/probes-constants.h"
 #include "ddsi/q_bitset.h"
 #include "ddsi/q_thread.h"
 #include "ddsi/q_globals.h" /* for mattr, cattr */
@@ -263,6 +268,9 @@
 
 /* RBUFPOOL ------------------------------------------------------------ */
 
+#define RSTCACHE_SIZE_LG2 4
+#define RSTCACHE_SIZE (1u << RSTCACHE_SIZE_LG2)
+
 struct nn_rbufpool {
   /* An rbuf pool is owned by a receive thread, and that thread is the
      only allocating rmsgs from the rbufs in the pool. Any thread may
@@ -270,16 +278,42 @@ struct nn_rbufpool {
 
      Currently, we only have maintain a current rbuf, which gets
      replaced when allocating a new one from it fails. Any rbufs that
-     are released are freed completely if different from the current
-     one.
-
-     Could trivially be done lockless, except that it requires
-     compare-and-swap, and we don't have that. But it hardly ever
-     happens anyway. */
+     are released are recycled as spares as long as there are fewer
+     than max_spares of those, and freed completely otherwise.
+     Replacing the current rbuf takes a spare if there is one, having
+     to allocate a new one instead counts as an allocation stall.
+
+     The lock protects the spares list and the current pointer. It is
+     taken twice by the owner when it replaces the current rbuf (once
+     to pop a spare and once to swap), and once by whichever thread
+     releases the last reference to an rbuf and recycles it. That is
+     a handful of lock operations per rbuf worth of data, against
+     which the contention is negligible.
+
+     The pool also caches the receiver states of recent messages (see
+     nn_rmsg_receiver_state), only the owner touches that. */
   os_mutex lock;
   struct nn_rbuf *current;
+  struct nn_rbuf *spares;
+  uint32_t nspares;
+  uint32_t max_spares;
   uint32_t rbuf_size;
   uint32_t max_rmsg_size;
+  enum rbuf_backing backing;
+  os_atomic_uint32_t alloc_stalls;
+  os_atomic_uint32_t batch_drops;
+  os_atomic_uint32_t n_rbufs;
+
+  /* Receive buffers reserved for a batched receive (only touched by
+     the owner, batch_rbuf is NULL if no batch is outstanding) */
+  struct nn_rbuf *batch_rbuf;
+  unsigned char *batch_base;
+  uint32_t batch_n;
+  uint32_t batch_slotsize;
+
+  /* Direct-mapped cache of receiver states, each slot holds a
+     reference */
+  struct nn_rst_shared *rstcache[RSTCACHE_SIZE];
 #ifndef NDEBUG
   /* Thread that owns this pool, so we can check that no other thread
      is calling functions only the owner may use. */
@@ -288,7 +322,11 @@ struct nn_rbufpool {
 };
 
 static struct nn_rbuf *nn_rbuf_alloc_new (struct nn_rbufpool *rbufpool);
+static void nn_rst_shared_unref (struct nn_rst_shared *rs);
 static void nn_rbuf_release (struct nn_rbuf *rbuf);
+static void nn_rbuf_free (struct nn_rbuf *rbuf);
+static void nn_rbuf_push_spare (struct nn_rbufpool *rbp, struct nn_rbuf *rbuf);
+static struct nn_rbuf *nn_rbuf_pop_spare (struct nn_rbufpool *rbp);
 
 static uint32_t align8uint32 (uint32_t x)
 {
@@ -338,25 +376,51 @@ struct nn_rbufpool *nn_rbufpool_new (uint32_t rbuf_size, uint32_t max_rmsg_size)
 
   rbp->rbuf_size = rbuf_size;
   rbp->max_rmsg_size = max_rmsg_size;
+  rbp->backing = config.rbuf_backing;
+  rbp->spares = NULL;
+  rbp->nspares = 0;
+  rbp->max_spares = config.rbuf_spares;
+  os_atomic_st32 (&rbp->alloc_stalls, 0);
+  os_atomic_st32 (&rbp->batch_drops, 0);
+  os_atomic_st32 (&rbp->n_rbufs, 0);
+  rbp->batch_rbuf = NULL;
+  rbp->batch_base = NULL;
+  rbp->batch_n = 0;
+  rbp->batch_slotsize = 0;
+  memset (rbp->rstcache, 0, sizeof (rbp->rstcache));
+  rbp->current = NULL;
 
 #if USE_VALGRIND
   VALGRIND_CREATE_MEMPOOL (rbp, 0, 0);
 #endif
-
-  if ((rbp->current = nn_rbuf_alloc_new (rbp)) == NULL)
-    goto fail_rbuf;
   return rbp;
 
- fail_rbuf:
-#if USE_VALGRIND
-  VALGRIND_DESTROY_MEMPOOL (rbp);
-#endif
-  os_mutexDestroy (&rbp->lock);
-  os_free (rbp);
  fail_rbp:
   return NULL;
 }
 
+int nn_rbufpool_populate (struct nn_rbufpool *rbp)
+{
+  /* Allocates the first rbuf and the spares. This is done by the owner
+     rather than in nn_rbufpool_new, so that the memory gets faulted in
+     by the receive thread once its CPU affinity and NUMA memory policy
+     are in effect. */
+  ASSERT_RBUFPOOL_OWNER (rbp);
+  assert (rbp->current == NULL);
+  if ((rbp->current = nn_rbuf_alloc_new (rbp)) == NULL)
+    return -1;
+  while (rbp->nspares < rbp->max_spares)
+  {
+    struct nn_rbuf *rb;
+    if ((rb = nn_rbuf_alloc_new (rbp)) == NULL)
+      break;
+    os_mutexLock (&rbp->lock);
+    nn_rbuf_push_spare (rbp, rb);
+    os_mutexUnlock (&rbp->lock);
+  }
+  return 0;
+}
+
 void nn_rbufpool_setowner (UNUSED_ARG_NDEBUG (struct nn_rbufpool *rbp), UNUSED_ARG_NDEBUG (os_threadId tid))
 {
 #ifndef NDEBUG
@@ -373,7 +437,17 @@ void nn_rbufpool_free (struct nn_rbufpool *rbp)
      reference counts are all 0, as they should be. */
   ASSERT_RBUFPOOL_OWNER (rbp);
 #endif
-  nn_rbuf_release (rbp->current);
+  assert (rbp->batch_rbuf == NULL);
+  for (uint32_t i = 0; i < RSTCACHE_SIZE; i++)
+    if (rbp->rstcache[i])
+      nn_rst_shared_unref (rbp->rstcache[i]);
+  if (rbp->current)
+    nn_rbuf_release (rbp->current);
+  {
+    struct nn_rbuf *rb;
+    while ((rb = nn_rbuf_pop_spare (rbp)) != NULL)
+      nn_rbuf_free (rb);
+  }
 #if USE_VALGRIND
   VALGRIND_DESTROY_MEMPOOL (rbp);
 #endif
@@ -381,13 +455,31 @@ void nn_rbufpool_free (struct nn_rbufpool *rbp)
   os_free (rbp);
 }
 
+uint32_t nn_rbufpool_alloc_stalls (struct nn_rbufpool *rbp)
+{
+  return os_atomic_ld32 (&rbp->alloc_stalls);
+}
+
+void nn_rbufpool_stats (struct nn_rbufpool *rbp, struct nn_rbufpool_stats *st)
+{
+  st->rbuf_size = rbp->rbuf_size;
+  st->n_rbufs = os_atomic_ld32 (&rbp->n_rbufs);
+  st->alloc_stalls = os_atomic_ld32 (&rbp->alloc_stalls);
+  st->batch_drops = os_atomic_ld32 (&rbp->batch_drops);
+  os_mutexLock (&rbp->lock);
+  st->n_spares = rbp->nspares;
+  os_mutexUnlock (&rbp->lock);
+}
+
 /* RBUF ---------------------------------------------------------------- */
 
 struct nn_rbuf {
   os_atomic_uint32_t n_live_rmsg_chunks;
   uint32_t size;
   uint32_t max_rmsg_size;
+  uint32_t mapsize; /* 0 if allocated on the heap */
   struct nn_rbufpool *rbufpool;
+  struct nn_rbuf *next_spare;
 
   /* Allocating sequentially, releasing in random order, not bothering
      to reuse memory as soon as it becomes available again. I think
@@ -406,38 +498,134 @@ struct nn_rbuf {
   } u;
 };
 
+static struct nn_rbuf *nn_rbuf_map (struct nn_rbufpool *rbufpool)
+{
+  /* Maps memory for an rbuf with the kernel populating the page
+     tables, with huge pages if so configured (using all of the
+     mapping, as the size is rounded up to a whole number of huge
+     pages).  If no huge pages are available, the pool falls back to
+     normal pages; the warning is given only once per process, as every
+     receive thread has a pool of its own and they all run into it. */
+#if defined __linux
+  static os_atomic_uint32_t hugepage_warned = OS_ATOMIC_UINT32_INIT (0);
+  const size_t hugepagesize = 2 * 1048576;
+  size_t mapsize = offsetof (struct nn_rbuf, u.raw) + rbufpool->rbuf_size;
+  void *p = MAP_FAILED;
+  struct nn_rbuf *rb;
+  if (rbufpool->backing == RBB_HUGEPAGES)
+  {
+    const size_t hpmapsize = (mapsize + hugepagesize - 1) & ~(hugepagesize - 1);
+    if (hpmapsize <= UINT32_MAX &&
+        (p = mmap (NULL, hpmapsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_HUGETLB, -1, 0)) != MAP_FAILED)
+      mapsize = hpmapsize;
+    else
+    {
+      const int err = os_getErrno ();
+      if (os_atomic_cas32 (&hugepage_warned, 0, 1))
+        DDS_WARNING("receive buffers: no huge pages available (errno %d), using normal pages instead\n", err);
+      rbufpool->backing = RBB_POPULATE;
+    }
+  }
+  if (p == MAP_FAILED && (p = mmap (NULL, mapsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0)) == MAP_FAILED)
+    return NULL;
+  rb = p;
+  rb->mapsize = (uint32_t) mapsize;
+  rb->size = (uint32_t) (mapsize - offsetof (struct nn_rbuf, u.raw));
+  return rb;
+#else
+  (void) rbufpool;
+  return NULL;
+#endif
+}
+
 static struct nn_rbuf *nn_rbuf_alloc_new (struct nn_rbufpool *rbufpool)
 {
   struct nn_rbuf *rb;
   ASSERT_RBUFPOOL_OWNER (rbufpool);
 
-  if ((rb = os_malloc (offsetof (struct nn_rbuf, u.raw) + rbufpool->rbuf_size)) == NULL)
+  if (rbufpool->backing != RBB_HEAP && (rb = nn_rbuf_map (rbufpool)) != NULL)
+    ;
+  else if ((rb = os_malloc (offsetof (struct nn_rbuf, u.raw) + rbufpool->rbuf_size)) == NULL)
     return NULL;
+  else
+  {
+    rb->mapsize = 0;
+    rb->size = rbufpool->rbuf_size;
+    if (rbufpool->max_spares > 0)
+    {
+      /* touch all pages now, so they won't fault in while receiving */
+      memset (rb->u.raw, 0, rb->size);
+    }
+  }
 #if USE_VALGRIND
-  VALGRIND_MAKE_MEM_NOACCESS (rb->u.raw, rbufpool->rbuf_size);
+  VALGRIND_MAKE_MEM_NOACCESS (rb->u.raw, rb->size);
 #endif
 
   rb->rbufpool = rbufpool;
+  rb->next_spare = NULL;
   os_atomic_st32 (&rb->n_live_rmsg_chunks, 1);
-  rb->size = rbufpool->rbuf_size;
   rb->max_rmsg_size = rbufpool->max_rmsg_size;
   rb->freeptr = rb->u.raw;
+  os_atomic_inc32 (&rbufpool->n_rbufs);
   DDS_LOG(DDS_LC_RADMIN, "rbuf_alloc_new(%p) = %p\n", (void *) rbufpool, (void *) rb);
   return rb;
 }
 
+static void nn_rbuf_free (struct nn_rbuf *rbuf)
+{
+  os_atomic_dec32 (&rbuf->rbufpool->n_rbufs);
+#if defined __linux
+  if (rbuf->mapsize > 0)
+  {
+    munmap (rbuf, rbuf->mapsize);
+    return;
+  }
+#endif
+  os_free (rbuf);
+}
+
+static void nn_rbuf_push_spare (struct nn_rbufpool *rbp, struct nn_rbuf *rbuf)
+{
+  /* caller must hold rbp->lock unless rbp is private to it */
+  assert (os_atomic_ld32 (&rbuf->n_live_rmsg_chunks) == 1);
+  assert (rbuf->freeptr == rbuf->u.raw);
+  rbuf->next_spare = rbp->spares;
+  rbp->spares = rbuf;
+  rbp->nspares++;
+}
+
+static struct nn_rbuf *nn_rbuf_pop_spare (struct nn_rbufpool *rbp)
+{
+  /* caller must hold rbp->lock unless rbp is private to it */
+  struct nn_rbuf *rbuf;
+  if ((rbuf = rbp->spares) != NULL)
+  {
+    rbp->spares = rbuf->next_spare;
+    rbp->nspares--;
+  }
+  return rbuf;
+}
+
 static struct nn_rbuf *nn_rbuf_new (struct nn_rbufpool *rbufpool)
 {
-  struct nn_rbuf *rb;
+  struct nn_rbuf *rb, *old;
   assert (rbufpool->current);
   ASSERT_RBUFPOOL_OWNER (rbufpool);
-  if ((rb = nn_rbuf_alloc_new (rbufpool)) != NULL)
-  {
-    os_mutexLock (&rbufpool->lock);
-    nn_rbuf_release (rbufpool->current);
-    rbufpool->current = rb;
-    os_mutexUnlock (&rbufpool->lock);
+  os_mutexLock (&rbufpool->lock);
+  rb = nn_rbuf_pop_spare (rbufpool);
+  os_mutexUnlock (&rbufpool->lock);
+  if (rb == NULL)
+  {
+    os_atomic_inc32 (&rbufpool->alloc_stalls);
+    DDS_LOG(DDS_LC_RADMIN, "rbuf_new(%p): no spare\n", (void *) rbufpool);
+    if ((rb = nn_rbuf_alloc_new (rbufpool)) == NULL)
+      return NULL;
   }
+  os_mutexLock (&rbufpool->lock);
+  old = rbufpool->current;
+  rbufpool->current = rb;
+  os_mutexUnlock (&rbufpool->lock);
+  nn_rbuf_release (old);
   return rb;
 }
 
@@ -447,8 +635,19 @@ static void nn_rbuf_release (struct nn_rbuf *rbuf)
   DDS_LOG(DDS_LC_RADMIN, "rbuf_release(%p) pool %p current %p\n", (void *) rbuf, (void *) rbp, (void *) rbp->current);
   if (os_atomic_dec32_ov (&rbuf->n_live_rmsg_chunks) == 1)
   {
-    DDS_LOG(DDS_LC_RADMIN, "rbuf_release(%p) free\n", (void *) rbuf);
-    os_free (rbuf);
+    int recycled = 0;
+    os_mutexLock (&rbp->lock);
+    if (rbp->nspares < rbp->max_spares)
+    {
+      os_atomic_st32 (&rbuf->n_live_rmsg_chunks, 1);
+      rbuf->freeptr = rbuf->u.raw;
+      nn_rbuf_push_spare (rbp, rbuf);
+      recycled = 1;
+    }
+    os_mutexUnlock (&rbp->lock);
+    DDS_LOG(DDS_LC_RADMIN, "rbuf_release(%p) %s\n", (void *) rbuf, recycled ? "spare" : "free");
+    if (!recycled)
+      nn_rbuf_free (rbuf);
   }
 }
 
@@ -481,6 +680,12 @@ static void *nn_rbuf_alloc (struct nn_rbufpool *rbufpool)
   assert (rb->freeptr >= rb->u.raw);
   assert (rb->freeptr <= rb->u.raw + rb->size);
 
+  /* Never hand out memory still holding packets of an outstanding
+     batch: the only way to get here while one is being processed is
+     when an rmsg in it needs an additional chunk */
+  if (rb == rbufpool->batch_rbuf && rb->freeptr < rbufpool->batch_base + rbufpool->batch_n * rbufpool->batch_slotsize)
+    rb->freeptr = rbufpool->batch_base + rbufpool->batch_n * rbufpool->batch_slotsize;
+
   if ((uint32_t) (rb->u.raw + rb->size - rb->freeptr) < asize)
   {
     /* not enough space left for new rmsg */
@@ -503,6 +708,7 @@ static void init_rmsg_chunk (struct nn_rmsg_chunk *chunk, struct nn_rbuf *rbuf)
   chunk->rbuf = rbuf;
   chunk->next = NULL;
   chunk->size = 0;
+  chunk->capacity = rbuf->max_rmsg_size;
   os_atomic_inc32 (&rbuf->n_live_rmsg_chunks);
 }
 
@@ -521,6 +727,7 @@ struct nn_rmsg *nn_rmsg_new (struct nn_rbufpool *rbufpool)
   /* Initial chunk */
   init_rmsg_chunk (&rmsg->chunk, rbufpool->current);
   rmsg->lastchunk = &rmsg->chunk;
+  rmsg->rst_shared = NULL;
   /* Incrementing freeptr happens in commit(), so that discarding the
      message is really simple. */
   DDS_LOG(DDS_LC_RADMIN, "rmsg_new(%p) = %p\n", (void *) rbufpool, (void *) rmsg);
@@ -535,7 +742,7 @@ void nn_rmsg_setsize (struct nn_rmsg *rmsg, uint32_t size)
   ASSERT_RMSG_UNCOMMITTED (rmsg);
   assert (os_atomic_ld32 (&rmsg->refcount) == RMSG_REFCOUNT_UNCOMMITTED_BIAS);
   assert (rmsg->chunk.size == 0);
-  assert (size8 <= rmsg->chunk.rbuf->max_rmsg_size);
+  assert (size8 <= rmsg->chunk.capacity);
   assert (rmsg->lastchunk == &rmsg->chunk);
   rmsg->chunk.size = size8;
 #if USE_VALGRIND
@@ -555,6 +762,8 @@ void nn_rmsg_free (struct nn_rmsg *rmsg)
   struct nn_rmsg_chunk *c;
   DDS_LOG(DDS_LC_RADMIN, "rmsg_free(%p)\n", (void *) rmsg);
   assert (os_atomic_ld32 (&rmsg->refcount) == 0);
+  if (rmsg->rst_shared)
+    nn_rst_shared_unref (rmsg->rst_shared);
   c = &rmsg->chunk;
   while (c)
   {
@@ -595,7 +804,7 @@ void nn_rmsg_commit (struct nn_rmsg *rmsg)
                  (void *) rmsg, rmsg->refcount.v, chunk->size);
   ASSERT_RBUFPOOL_OWNER (chunk->rbuf->rbufpool);
   ASSERT_RMSG_UNCOMMITTED (rmsg);
-  assert (chunk->size <= chunk->rbuf->max_rmsg_size);
+  assert (chunk->size <= chunk->capacity);
   assert ((chunk->size % 8) == 0);
   assert (os_atomic_ld32 (&rmsg->refcount) >= RMSG_REFCOUNT_UNCOMMITTED_BIAS);
   assert (os_atomic_ld32 (&rmsg->chunk.rbuf->n_live_rmsg_chunks) > 0);
@@ -671,7 +880,7 @@ void *nn_rmsg_alloc (struct nn_rmsg *rmsg, uint32_t size)
   assert ((chunk->size % 8) == 0);
   assert (size8 <= rbuf->max_rmsg_size);
 
-  if (chunk->size + size8 > rbuf->max_rmsg_size)
+  if (chunk->size + size8 > chunk->capacity)
   {
     struct nn_rbufpool *rbufpool = rbuf->rbufpool;
     struct nn_rmsg_chunk *newchunk;
@@ -701,6 +910,214 @@ void *nn_rmsg_alloc (struct nn_rmsg *rmsg, uint32_t size)
   return ptr;
 }
 
+/* RECEIVER STATE CACHE ------------------------ */
+
+/* Every Data(Frag) references the receiver state in effect for it,
+   which therefore must live as long as the sample, and the default is
+   to allocate one in each rmsg that contains a sample (and another
+   one for every INFO_SRC or INFO_DST following one).  Most messages
+   share the state with many of those received before, so instead, the
+   rbuf pool keeps a few refcounted, immutable receiver states that
+   messages may reference, at most one per rmsg to keep it to a single
+   pointer.  If a message needs more than one, the others are copied
+   into the message like they always used to be. */
+
+struct nn_rst_shared {
+  os_atomic_uint32_t refc;
+  struct receiver_state rst;
+};
+
+static void nn_rst_shared_unref (struct nn_rst_shared *rs)
+{
+  /* Note: any thread may release the last reference */
+  if (os_atomic_dec32_ov (&rs->refc) == 1)
+    os_free (rs);
+}
+
+static uint32_t rst_hash (const struct receiver_state *rst)
+{
+  /* Packets from one peer but from different source addresses or
+     arriving on different connections differ in reply address and
+     connection only, so those must be part of the hash, too, lest they
+     keep evicting each other from the same slot */
+  const uintptr_t conn = (uintptr_t) rst->conn;
+  uint32_t addr[4], h;
+  memcpy (addr, rst->srcloc.address, sizeof (addr));
+  h = rst->src_guid_prefix.u[0] ^ rst->src_guid_prefix.u[1] ^ rst->src_guid_prefix.u[2];
+  h ^= (rst->dst_guid_prefix.u[0] ^ rst->dst_guid_prefix.u[1] ^ rst->dst_guid_prefix.u[2]) * 0x9e3779b1u;
+  h ^= ((uint32_t) conn ^ (uint32_t) ((uint64_t) conn >> 32)) * 0xc2b2ae35u;
+  h ^= (addr[0] ^ addr[1] ^ addr[2] ^ addr[3] ^ rst->srcloc.port) * 0x27d4eb2fu;
+  return (h * 0x85ebca6bu) >> (32 - RSTCACHE_SIZE_LG2);
+}
+
+static int rst_equal (const struct receiver_state *a, const struct receiver_state *b)
+{
+  return (memcmp (&a->src_guid_prefix, &b->src_guid_prefix, sizeof (a->src_guid_prefix)) == 0 &&
+          memcmp (&a->dst_guid_prefix, &b->dst_guid_prefix, sizeof (a->dst_guid_prefix)) == 0 &&
+          a->reply_locators == b->reply_locators &&
+          a->forme == b->forme &&
+          a->vendor.id[0] == b->vendor.id[0] && a->vendor.id[1] == b->vendor.id[1] &&
+          a->protocol_version.major == b->protocol_version.major &&
+          a->protocol_version.minor == b->protocol_version.minor &&
+          a->conn == b->conn &&
+          memcmp (&a->srcloc, &b->srcloc, sizeof (a->srcloc)) == 0);
+}
+
+struct receiver_state *nn_rmsg_receiver_state (struct nn_rmsg *rmsg, const struct receiver_state *rst)
+{
+  /* Returns a receiver state equal to *rst that lives as long as rmsg */
+  struct nn_rbufpool * const rbp = rmsg->chunk.rbuf->rbufpool;
+  struct nn_rst_shared **slot, *rs;
+  struct receiver_state *nrst;
+  ASSERT_RBUFPOOL_OWNER (rbp);
+  ASSERT_RMSG_UNCOMMITTED (rmsg);
+
+  slot = &rbp->rstcache[rst_hash (rst)];
+  if ((rs = *slot) == NULL || !rst_equal (&rs->rst, rst))
+  {
+    DDS_LOG(DDS_LC_RADMIN, "rmsg_receiver_state(%p) miss\n", (void *) rmsg);
+    rs = os_malloc (sizeof (*rs));
+    os_atomic_st32 (&rs->refc, 1);
+    rs->rst = *rst;
+    if (*slot)
+      nn_rst_shared_unref (*slot);
+    *slot = rs;
+  }
+  if (rmsg->rst_shared == rs)
+    return &rs->rst;
+  else if (rmsg->rst_shared == NULL)
+  {
+    os_atomic_inc32 (&rs->refc);
+    rmsg->rst_shared = rs;
+    return &rs->rst;
+  }
+  else if ((nrst = nn_rmsg_alloc (rmsg, sizeof (*nrst))) != NULL)
+  {
+    *nrst = *rst;
+  }
+  return nrst;
+}
+
+/* RMSG BATCHES -------------------------------- */
+
+/* Batched receiving (e.g., recvmmsg) needs buffers for multiple
+   packets before any of them is known, which doesn't fit with the
+   one-uncommitted-rmsg-at-a-time allocation scheme.  So instead, a
+   batch of consecutive slots, each large enough for a full rmsg
+   header plus a packet, is reserved at the free pointer of the
+   current rbuf without moving the free pointer.
+
+   Packets are then turned into rmsgs in order by
+   nn_rmsg_new_from_batch, which slides each packet down so that it
+   immediately follows whatever the previous one left committed.  This
+   keeps the rbuf as densely packed as in the unbatched case, and the
+   copy is free for the first packet and cheap for small ones, which is
+   what batching is for anyway.  An rmsg constructed in this way may
+   grow up to the start of the next slot; should it need more, it gets
+   an additional chunk beyond the reserved area (see nn_rbuf_alloc),
+   from where on the remaining packets in the batch are moved there as
+   well.
+
+   The batch holds a reference to the rbuf so that the packets remain
+   valid even if the pool switches to a new rbuf halfway through. */
+
+uint32_t nn_rbufpool_batch_reserve (struct nn_rbufpool *rbp, uint32_t n, uint32_t bufsz, unsigned char **bufs)
+{
+  const uint32_t slotsize = align8uint32 ((uint32_t) offsetof (struct nn_rmsg, chunk.u.payload) + bufsz);
+  struct nn_rbuf *rb;
+  uint32_t i, avail;
+  ASSERT_RBUFPOOL_OWNER (rbp);
+  assert (rbp->batch_rbuf == NULL);
+  assert (n > 0);
+  assert (bufsz <= rbp->max_rmsg_size);
+
+  rb = rbp->current;
+  if ((avail = (uint32_t) (rb->u.raw + rb->size - rb->freeptr) / slotsize) == 0)
+  {
+    if ((rb = nn_rbuf_new (rbp)) == NULL)
+      return 0;
+    avail = (uint32_t) (rb->u.raw + rb->size - rb->freeptr) / slotsize;
+    assert (avail > 0);
+  }
+  if (n > avail)
+    n = avail;
+
+  os_atomic_inc32 (&rb->n_live_rmsg_chunks);
+  rbp->batch_rbuf = rb;
+  rbp->batch_base = rb->freeptr;
+  rbp->batch_n = n;
+  rbp->batch_slotsize = slotsize;
+#if USE_VALGRIND
+  VALGRIND_MAKE_MEM_UNDEFINED (rbp->batch_base, n * slotsize);
+#endif
+  for (i = 0; i < n; i++)
+    bufs[i] = NN_RMSG_PAYLOAD ((struct nn_rmsg *) (rbp->batch_base + i * slotsize));
+  DDS_LOG(DDS_LC_RADMIN, "rbufpool_batch_reserve(%p, %u) = %u @ %p\n", (void *) rbp, bufsz, n, (void *) rbp->batch_base);
+  return n;
+}
+
+struct nn_rmsg *nn_rmsg_new_from_batch (struct nn_rbufpool *rbp, uint32_t idx, uint32_t size)
+{
+  /* Note: only one thread calls nn_rmsg_new on a pool */
+  struct nn_rmsg * const src = (struct nn_rmsg *) (rbp->batch_base + idx * rbp->batch_slotsize);
+  unsigned char * const slot_end = (unsigned char *) src + rbp->batch_slotsize;
+  struct nn_rbuf *rb = rbp->current;
+  struct nn_rmsg *rmsg;
+  uint32_t capacity;
+  ASSERT_RBUFPOOL_OWNER (rbp);
+  assert (rbp->batch_rbuf != NULL);
+  assert (idx < rbp->batch_n);
+  assert (NN_RMSG_PAYLOAD (src) + size <= slot_end);
+
+  if (rb == rbp->batch_rbuf && rb->freeptr <= (unsigned char *) src)
+  {
+    /* Still within the reserved area: everything up to the next slot is available */
+    rmsg = (struct nn_rmsg *) rb->freeptr;
+#if USE_VALGRIND
+    VALGRIND_MEMPOOL_ALLOC (rbp, rmsg, (size_t) (slot_end - rb->freeptr));
+#endif
+    capacity = (uint32_t) (slot_end - NN_RMSG_PAYLOAD (rmsg));
+    if (capacity > rb->max_rmsg_size)
+      capacity = rb->max_rmsg_size;
+  }
+  else
+  {
+    /* An earlier rmsg overflowed the reserved area */
+    if ((rmsg = nn_rbuf_alloc (rbp)) == NULL)
+    {
+      /* The packet stays in its slot until the batch is released, but
+         is lost as far as the protocol is concerned */
+      os_atomic_inc32 (&rbp->batch_drops);
+      return NULL;
+    }
+    rb = rbp->current;
+    capacity = rb->max_rmsg_size;
+  }
+  if (rmsg != src)
+    memmove (NN_RMSG_PAYLOAD (rmsg), NN_RMSG_PAYLOAD (src), size);
+
+  os_atomic_st32 (&rmsg->refcount, RMSG_REFCOUNT_UNCOMMITTED_BIAS);
+  init_rmsg_chunk (&rmsg->chunk, rb);
+  rmsg->chunk.capacity = capacity;
+  rmsg->lastchunk = &rmsg->chunk;
+  rmsg->rst_shared = NULL;
+  DDS_LOG(DDS_LC_RADMIN, "rmsg_new_from_batch(%p, %u) = %p\n", (void *) rbp, idx, (void *) rmsg);
+  nn_rmsg_setsize (rmsg, size);
+  return rmsg;
+}
+
+void nn_rbufpool_batch_release (struct nn_rbufpool *rbp)
+{
+  struct nn_rbuf *rb = rbp->batch_rbuf;
+  ASSERT_RBUFPOOL_OWNER (rbp);
+  assert (rb != NULL);
+  DDS_LOG(DDS_LC_RADMIN, "rbufpool_batch_release(%p)\n", (void *) rbp);
+  rbp->batch_rbuf = NULL;
+  rbp->batch_base = NULL;
+  rbp->batch_n = 0;
+  nn_rbuf_release (rb);
+}
+
 /* RDATA --------------------------------------- */
 
 struct nn_rdata *nn_rdata_new (struct nn_rmsg *rmsg, uint32_t start, uint32_t endp1, uint32_t submsg_offset, uint32_t payload_offset)
@@ -752,12 +1169,44 @@ static void nn_rdata_rmbias_anythread (struct nn_rdata *rdata)
   nn_rmsg_rmbias_anythread (rdata->rmsg);
 }
 
+static void nn_rdata_ref (struct nn_rdata *rdata)
+{
+  /* For holding on to the payload after delivery; may be done by any
+     thread that already has a reference to the rmsg. */
+  DDS_LOG(DDS_LC_RADMIN, "rdata_ref(%p)\n", (void *) rdata);
+  assert (os_atomic_ld32 (&rdata->rmsg->refcount) > 0);
+  os_atomic_inc32 (&rdata->rmsg->refcount);
+}
+
 static void nn_rdata_unref (struct nn_rdata *rdata)
 {
   DDS_LOG(DDS_LC_RADMIN, "rdata_rdata_unref(%p)\n", (void *) rdata);
   nn_rmsg_unref (rdata->rmsg);
 }
 
+/* RX DROP STATS ------------------------------------------------------ */
+
+void nn_rx_drop_stats_add (struct nn_rx_drop_stats *a, const struct nn_rx_drop_stats *b)
+{
+  a->queue_full += b->queue_full;
+  a->too_old += b->too_old;
+  a->reorder_full += b->reorder_full;
+  a->duplicate += b->duplicate;
+  a->defrag_full += b->defrag_full;
+}
+
+static void rx_drop_count (struct nn_rx_drop_stats *st, int reason, uint32_t n)
+{
+  switch (reason)
+  {
+    case DROP_QUEUE_FULL: st->queue_full += n; break;
+    case DROP_TOO_OLD: st->too_old += n; break;
+    case DROP_REORDER_FULL: st->reorder_full += n; break;
+    case DROP_DUPLICATE: st->duplicate += n; break;
+    case DROP_DEFRAG_FULL: st->defrag_full += n; break;
+  }
+}
+
 /* DEFRAG --------------------------------------------------------------
 
    Defragmentation happens separately from reordering, the reason
@@ -814,6 +1263,18 @@ static void nn_rdata_unref (struct nn_rdata *rdata)
    fragmented message will have at least one interval allocated to it
    and thus have sufficient space for the chain node.
 
+   Samples consisting of many fragments (DEFRAG_BITMAP_MIN_FRAGS or
+   more) are tracked using a bitmap with a bit per fragment instead,
+   plus an array of pointers to the rdata that first provided each
+   fragment.  With random loss, the interval tree of a sample of
+   thousands of fragments sees a great many inserts and merges, while
+   setting a bit is trivial and both the completeness check and the
+   construction of a NACK_FRAG bitmap can then be done a word at a
+   time.  The fragment chain is built when the sample is complete.
+   A fragment in the bitmap only counts as received if the rdata
+   covers it completely, which it normally does: the spec requires
+   all fragments of a sample to be of the same size.
+
    FIXME: These AVL trees are overkill.  Either switch to parent-less
    red-black trees (they have better performance anyway and only need
    a single bit of state) or to splay trees (must have a parent
@@ -821,6 +1282,8 @@ static void nn_rdata_unref (struct nn_rdata *rdata)
    of intervals in the tree is limited, which probably is a good idea
    anyway). */
 
+#define DEFRAG_BITMAP_MIN_FRAGS 256
+
 struct nn_defrag_iv {
   ut_avlNode_t avlnode; /* for nn_rsample.defrag::fragtree */
   uint32_t min, maxp1;
@@ -828,12 +1291,22 @@ struct nn_defrag_iv {
   struct nn_rdata *last;
 };
 
+struct nn_defrag_bitmap {
+  uint32_t nfrags;
+  uint32_t nmissing;
+  uint32_t fragsize;
+  struct nn_rsample_chain_elem *sce; /* for rsample_convert_defrag_to_reorder */
+  struct nn_rdata **frags;           /* rdata stored for a fragment, NULL if it started earlier */
+  uint32_t bits[];                   /* MSB first, as in a fragment number set */
+};
+
 struct nn_rsample {
   union {
     struct nn_rsample_defrag {
       ut_avlNode_t avlnode; /* for nn_defrag::sampletree */
       ut_avlTree_t fragtree;
       struct nn_defrag_iv *lastfrag;
+      struct nn_defrag_bitmap *bitmap; /* NULL: fragtree in use */
       struct nn_rsample_info *sampleinfo;
       seqno_t seq;
     } defrag;
@@ -852,6 +1325,7 @@ struct nn_defrag {
   uint32_t n_samples;
   uint32_t max_samples;
   enum nn_defrag_drop_mode drop_mode;
+  struct nn_rx_drop_stats drops;
 };
 
 static int compare_uint32 (const void *va, const void *vb);
@@ -885,6 +1359,7 @@ struct nn_defrag *nn_defrag_new (enum nn_defrag_drop_mode drop_mode, uint32_t ma
   d->max_samples = max_samples;
   d->n_samples = 0;
   d->max_sample = NULL;
+  memset (&d->drops, 0, sizeof (d->drops));
   return d;
 }
 
@@ -912,6 +1387,87 @@ static void nn_fragchain_rmbias_anythread (struct nn_rdata *frag, UNUSED_ARG (in
   }
 }
 
+static uint32_t defrag_nfrags (const struct nn_rsample_info *sampleinfo)
+{
+  return (sampleinfo->fragsize == 0) ? 0 : (sampleinfo->size + sampleinfo->fragsize - 1) / sampleinfo->fragsize;
+}
+
+static struct nn_defrag_bitmap *defrag_bitmap_new (uint32_t nfrags, uint32_t fragsize)
+{
+  const uint32_t nwords = (nfrags + 31) / 32;
+  struct nn_defrag_bitmap *bm;
+  bm = os_malloc (offsetof (struct nn_defrag_bitmap, bits) + nwords * sizeof (bm->bits[0]));
+  bm->frags = os_malloc (nfrags * sizeof (*bm->frags));
+  bm->nfrags = bm->nmissing = nfrags;
+  bm->fragsize = fragsize;
+  bm->sce = NULL;
+  memset (bm->bits, 0, nwords * sizeof (bm->bits[0]));
+  memset (bm->frags, 0, nfrags * sizeof (*bm->frags));
+  return bm;
+}
+
+static void defrag_bitmap_free (struct nn_defrag_bitmap *bm)
+{
+  os_free (bm->frags);
+  os_free (bm);
+}
+
+static uint32_t defrag_bitmap_word (const struct nn_defrag_bitmap *bm, uint32_t idx)
+{
+  /* 32 bits starting at fragment idx, fragments beyond the end count as received */
+  const uint32_t w = idx / 32, s = idx % 32, nwords = (bm->nfrags + 31) / 32;
+  uint32_t x = (w < nwords) ? bm->bits[w] << s : 0;
+  if (s > 0 && w + 1 < nwords)
+    x |= bm->bits[w + 1] >> (32 - s);
+  if (idx + 32 > bm->nfrags)
+    x |= (idx >= bm->nfrags) ? ~0u : ~0u >> (bm->nfrags - idx);
+  return x;
+}
+
+static uint32_t defrag_bitmap_first_missing (const struct nn_defrag_bitmap *bm, uint32_t idx, uint32_t lim)
+{
+  /* Lowest missing fragment in [idx,lim), or lim */
+  while (idx < lim)
+  {
+    uint32_t x = defrag_bitmap_word (bm, idx);
+    if (x != ~0u)
+    {
+      while (x & 0x80000000u)
+      {
+        x <<= 1;
+        idx++;
+      }
+      return (idx < lim) ? idx : lim;
+    }
+    idx += 32;
+  }
+  return lim;
+}
+
+static uint32_t defrag_bitmap_last_missing (const struct nn_defrag_bitmap *bm, uint32_t lim)
+{
+  /* Highest missing fragment below lim, or UINT32_MAX */
+  while (lim > 0)
+  {
+    const uint32_t idx = (lim >= 32) ? lim - 32 : 0;
+    uint32_t x = defrag_bitmap_word (bm, idx);
+    if (lim - idx < 32)
+      x |= ~0u >> (lim - idx);
+    if (x != ~0u)
+    {
+      uint32_t i = idx + 31;
+      while (x & 1u)
+      {
+        x >>= 1;
+        i--;
+      }
+      return i;
+    }
+    lim = idx;
+  }
+  return UINT32_MAX;
+}
+
 static void defrag_rsample_drop (struct nn_defrag *defrag, struct nn_rsample *rsample, void (*fragchain_free) (struct nn_rdata *frag, int adjust))
 {
   /* Can't reference rsample after the first fragchain_free, because
@@ -923,10 +1479,20 @@ static void defrag_rsample_drop (struct nn_defrag *defrag, struct nn_rsample *rs
      inorder treewalk does provide. */
   ut_avlIter_t iter;
   struct nn_defrag_iv *iv;
+  struct nn_defrag_bitmap * const bm = rsample->u.defrag.bitmap;
   DDS_LOG(DDS_LC_RADMIN, "  defrag_rsample_drop (%p, %p)\n", (void *) defrag, (void *) rsample);
   ut_avlDelete (&defrag_sampletree_treedef, &defrag->sampletree, rsample);
   assert (defrag->n_samples > 0);
   defrag->n_samples--;
+  if (bm != NULL)
+  {
+    /* the bitmap is not in an rmsg, so it remains valid */
+    for (uint32_t i = 0; i < bm->nfrags; i++)
+      if (bm->frags[i])
+        fragchain_free (bm->frags[i], 0);
+    defrag_bitmap_free (bm);
+    return;
+  }
   for (iv = ut_avlIterFirst (&rsample_defrag_fragtree_treedef, &rsample->u.defrag.fragtree, &iter); iv; iv = ut_avlIterNext (&iter))
     fragchain_free (iv->first, 0);
 }
@@ -1024,6 +1590,38 @@ static void rsample_init_common (UNUSED_ARG (struct nn_rsample *rsample), UNUSED
 {
 }
 
+static struct nn_rsample *defrag_add_fragment_bitmap (struct nn_rsample *sample, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
+{
+  struct nn_rsample_defrag *dfsample = &sample->u.defrag;
+  struct nn_defrag_bitmap *bm = dfsample->bitmap;
+  /* fragments completely covered by rdata */
+  const uint32_t lo = (rdata->min + bm->fragsize - 1) / bm->fragsize;
+  const uint32_t hi = (rdata->maxp1 >= dfsample->sampleinfo->size) ? bm->nfrags : rdata->maxp1 / bm->fragsize;
+  uint32_t slot;
+
+  /* rdata goes in the slot of the first fragment it adds */
+  if (lo >= hi || (slot = nn_bitset_find_clear (bm->nfrags, bm->bits, lo)) >= hi)
+  {
+    DDS_LOG(DDS_LC_RADMIN, "  new contained in bitmap\n");
+    return NULL;
+  }
+  bm->nmissing -= (hi - lo) - nn_bitset_count_range (bm->nfrags, bm->bits, lo, hi);
+  nn_bitset_set_range (bm->nfrags, bm->bits, lo, hi);
+
+  /* Every fragment before the slot of rdata is available (so rdata->min can
+     be before the start of the fragment without creating a gap in the chain) */
+  DDS_LOG(DDS_LC_RADMIN, "  bitmap: fragment %u (%u..%u), %u missing\n", slot, lo, hi, bm->nmissing);
+  nn_rdata_addbias (rdata);
+  rdata->nextfrag = NULL;
+  bm->frags[slot] = rdata;
+  if (slot == 0)
+  {
+    /* use the sample info contributed by the first fragment */
+    *dfsample->sampleinfo = *sampleinfo;
+  }
+  return (bm->nmissing == 0) ? sample : NULL;
+}
+
 static struct nn_rsample *defrag_rsample_new (struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
 {
   struct nn_rsample *rsample;
@@ -1035,6 +1633,7 @@ static struct nn_rsample *defrag_rsample_new (struct nn_rdata *rdata, const stru
   rsample_init_common (rsample, rdata, sampleinfo);
   dfsample = &rsample->u.defrag;
   dfsample->lastfrag = NULL;
+  dfsample->bitmap = NULL;
   dfsample->seq = sampleinfo->seq;
   if ((dfsample->sampleinfo = nn_rmsg_alloc (rdata->rmsg, sizeof (*dfsample->sampleinfo))) == NULL)
     return NULL;
@@ -1042,6 +1641,28 @@ static struct nn_rsample *defrag_rsample_new (struct nn_rdata *rdata, const stru
 
   ut_avlInit (&rsample_defrag_fragtree_treedef, &dfsample->fragtree);
 
+  if (defrag_nfrags (sampleinfo) >= DEFRAG_BITMAP_MIN_FRAGS)
+  {
+    /* the chain element must come from the same rmsg as the rsample,
+       the one providing the first rdata stored */
+    struct nn_rsample_chain_elem *sce;
+    if ((sce = nn_rmsg_alloc (rdata->rmsg, sizeof (*sce))) == NULL)
+      return NULL;
+    dfsample->bitmap = defrag_bitmap_new (defrag_nfrags (sampleinfo), sampleinfo->fragsize);
+    dfsample->bitmap->sce = sce;
+    /* can't be complete after one rdata, or it wouldn't be a fragment */
+    if (defrag_add_fragment_bitmap (rsample, rdata, sampleinfo) != NULL)
+      assert (0);
+    if (dfsample->bitmap->nmissing == dfsample->bitmap->nfrags)
+    {
+      /* rdata doesn't cover a single fragment completely, so it didn't
+         get stored and there is no point in creating the sample */
+      defrag_bitmap_free (dfsample->bitmap);
+      return NULL;
+    }
+    return rsample;
+  }
+
   /* add sentinel if rdata is not the first fragment of the message */
   if (rdata->min > 0)
   {
@@ -1129,14 +1750,39 @@ static void rsample_convert_defrag_to_reorder (struct nn_rsample *sample)
      self-respecting compiler will optimise them away, and any
      self-respecting CPU would need to copy them via registers anyway
      because it uses a load-store architecture. */
-  struct nn_defrag_iv *iv = ut_avlRootNonEmpty (&rsample_defrag_fragtree_treedef, &sample->u.defrag.fragtree);
-  struct nn_rdata *fragchain = iv->first;
+  struct nn_defrag_bitmap *bm = sample->u.defrag.bitmap;
+  struct nn_rdata *fragchain;
   struct nn_rsample_info *sampleinfo = sample->u.defrag.sampleinfo;
   struct nn_rsample_chain_elem *sce;
   seqno_t seq = sample->u.defrag.seq;
 
-  /* re-use memory fragment interval node for sample chain */
-  sce = (struct nn_rsample_chain_elem *) ut_avlRootNonEmpty (&rsample_defrag_fragtree_treedef, &sample->u.defrag.fragtree);
+  if (bm == NULL)
+  {
+    struct nn_defrag_iv *iv = ut_avlRootNonEmpty (&rsample_defrag_fragtree_treedef, &sample->u.defrag.fragtree);
+    fragchain = iv->first;
+    /* re-use memory fragment interval node for sample chain */
+    sce = (struct nn_rsample_chain_elem *) iv;
+  }
+  else
+  {
+    /* chain the fragments in order of their slots */
+    struct nn_rdata *last = NULL;
+    assert (bm->nmissing == 0);
+    fragchain = NULL;
+    for (uint32_t i = 0; i < bm->nfrags; i++)
+    {
+      if (bm->frags[i] == NULL)
+        continue;
+      if (last)
+        last->nextfrag = bm->frags[i];
+      else
+        fragchain = bm->frags[i];
+      last = bm->frags[i];
+    }
+    sce = bm->sce;
+    defrag_bitmap_free (bm);
+  }
+  assert (fragchain != NULL && fragchain->min == 0);
   sce->fragchain = fragchain;
   sce->next = NULL;
   sce->sampleinfo = sampleinfo;
@@ -1154,6 +1800,9 @@ static struct nn_rsample *defrag_add_fragment (struct nn_rsample *sample, struct
   const uint32_t min = rdata->min;
   const uint32_t maxp1 = rdata->maxp1;
 
+  if (dfsample->bitmap)
+    return defrag_add_fragment_bitmap (sample, rdata, sampleinfo);
+
   /* min, max are byte offsets; contents has max-min+1 bytes; it all
      concerns the message pointer to by sample */
   assert (min < maxp1);
@@ -1286,6 +1935,7 @@ static int defrag_limit_samples (struct nn_defrag *defrag, seqno_t seq, seqno_t
       if (seq > defrag->max_sample->u.defrag.seq)
       {
         DDS_LOG(DDS_LC_RADMIN, "  new sample is new latest => discarding it\n");
+        rx_drop_count (&defrag->drops, DROP_DEFRAG_FULL, 1);
         return 0;
       }
       sample_to_drop = defrag->max_sample;
@@ -1297,11 +1947,13 @@ static int defrag_limit_samples (struct nn_defrag *defrag, seqno_t seq, seqno_t
       if (seq < sample_to_drop->u.defrag.seq)
       {
         DDS_LOG(DDS_LC_RADMIN, "  new sample is new oldest => discarding it\n");
+        rx_drop_count (&defrag->drops, DROP_DEFRAG_FULL, 1);
         return 0;
       }
       break;
   }
   assert (sample_to_drop != NULL);
+  rx_drop_count (&defrag->drops, DROP_DEFRAG_FULL, 1);
   defrag_rsample_drop (defrag, sample_to_drop, nn_fragchain_adjust_refcount);
   if (sample_to_drop == defrag->max_sample)
   {
@@ -1440,6 +2092,24 @@ void nn_defrag_notegap (struct nn_defrag *defrag, seqno_t min, seqno_t maxp1)
   defrag->max_sample = ut_avlFindMax (&defrag_sampletree_treedef, &defrag->sampletree);
 }
 
+static int defrag_nackmap_bitmap (const struct nn_defrag_bitmap *bm, uint32_t maxfragnum, struct nn_fragment_number_set *map, uint32_t maxsz)
+{
+  /* Request everything missing from the first missing fragment up to
+     and including the last missing one not beyond maxfragnum */
+  const uint32_t first = defrag_bitmap_first_missing (bm, 0, maxfragnum + 1);
+  const uint32_t last = defrag_bitmap_last_missing (bm, maxfragnum + 1);
+  uint32_t w;
+  map->bitmap_base = first;
+  map->numbits = (first > maxfragnum) ? 0 : last - first + 1;
+  if (map->numbits > maxsz)
+    map->numbits = maxsz;
+  for (w = 0; w < (map->numbits + 31) / 32; w++)
+    map->bits[w] = ~defrag_bitmap_word (bm, first + 32 * w);
+  if (map->numbits % 32)
+    map->bits[map->numbits / 32] &= ~(~0u >> (map->numbits % 32));
+  return (int) map->numbits;
+}
+
 int nn_defrag_nackmap (struct nn_defrag *defrag, seqno_t seq, uint32_t maxfragnum, struct nn_fragment_number_set *map, uint32_t maxsz)
 {
   struct nn_rsample *s;
@@ -1477,6 +2147,9 @@ int nn_defrag_nackmap (struct nn_defrag *defrag, seqno_t seq, uint32_t maxfragnu
   if (maxfragnum >= nfrags)
     maxfragnum = nfrags - 1;
 
+  if (s->u.defrag.bitmap)
+    return defrag_nackmap_bitmap (s->u.defrag.bitmap, maxfragnum, map, maxsz);
+
   /* Determine bitmap start & size */
   {
     /* We always have an interval starting at 0, which is empty if we
@@ -1524,10 +2197,10 @@ int nn_defrag_nackmap (struct nn_defrag *defrag, seqno_t seq, uint32_t maxfragnu
          extra to cover everything up to iv->min. */
       ++bound;
     }
-    for (; i < map->bitmap_base + map->numbits && i < bound; i++)
+    if (i < bound)
     {
-      unsigned x = (unsigned) (i - map->bitmap_base);
-      nn_bitset_set (map->numbits, map->bits, x);
+      const uint32_t end = (bound < map->bitmap_base + map->numbits) ? bound : map->bitmap_base + map->numbits;
+      nn_bitset_set_range (map->numbits, map->bits, i - map->bitmap_base, end - map->bitmap_base);
     }
     /* next sequence of fragments to request retranmsission of starts
        at fragment containing maxp1 (because we don't have that byte
@@ -1536,14 +2209,18 @@ int nn_defrag_nackmap (struct nn_defrag *defrag, seqno_t seq, uint32_t maxfragnu
     iv = ut_avlFindSucc (&rsample_defrag_fragtree_treedef, &s->u.defrag.fragtree, iv);
   }
   /* and set bits for missing fragments beyond the highest interval */
-  for (; i < map->bitmap_base + map->numbits; i++)
-  {
-    unsigned x = (unsigned) (i - map->bitmap_base);
-    nn_bitset_set (map->numbits, map->bits, x);
-  }
+  if (i < map->bitmap_base + map->numbits)
+    nn_bitset_set_range (map->numbits, map->bits, i - map->bitmap_base, map->numbits);
   return (int) map->numbits;
 }
 
+void nn_defrag_stats (const struct nn_defrag *defrag, struct nn_radmin_stats *st)
+{
+  st->n_samples = defrag->n_samples;
+  st->max_samples = defrag->max_samples;
+  st->drops = defrag->drops;
+}
+
 /* REORDER -------------------------------------------------------------
 
    The reorder index tracks out-of-order messages as non-overlapping,
@@ -1618,15 +2295,44 @@ int nn_defrag_nackmap (struct nn_defrag *defrag, seqno_t seq, uint32_t maxfragnu
    admins that accepted it, less BIAS for the initial reference.  We
    can't use the original sample because of [CASE I], so we adjust
    based on the fragment chain instead of the sample.  Example code is
-   in the overview comment at the top of this file. */
+   in the overview comment at the top of this file.
+
+   On a healthy network nearly every sample is the next one expected,
+   and the out-of-order ones are usually only a little bit ahead.  To
+   avoid tree lookups for those, the reorder admin also indexes the
+   part of the interval tree that falls within [next_seq, next_seq +
+   REORDER_WINDOW) in a ring indexed by sequence number: a bit per
+   sequence number that is covered by an interval, and for each
+   interval in the window a pointer to it in the slots of its first
+   and last sequence numbers.  Intervals never overlap, so a slot
+   never needs to refer to two intervals; and if a slot refers to an
+   interval while one of its neighbours isn't covered, it must be the
+   end of the interval facing that neighbour.  That turns the
+   lookups of the
+   neighbouring intervals, duplicate detection and generating a NACK
+   bitmap into O(1) operations on the ring; the tree remains the
+   authoritative store and covers everything outside the window.
+
+   The window is allocated the first time something gets stored, so
+   admins that only ever see in-order data don't pay for it, and if
+   that allocation fails everything simply goes through the tree. */
+
+#define REORDER_WINDOW 512 /* power of 2, >= maximum NACK bitmap length */
+
+struct nn_reorder_window {
+  struct nn_rsample *bound[REORDER_WINDOW]; /* interval with min = seq or maxp1-1 = seq */
+  uint32_t covered[REORDER_WINDOW / 32];
+};
 
 struct nn_reorder {
   ut_avlTree_t sampleivtree;
   struct nn_rsample *max_sampleiv; /* = max(sampleivtree) */
+  struct nn_reorder_window *win; /* index of [next_seq, next_seq + REORDER_WINDOW), may be NULL */
   seqno_t next_seq;
   enum nn_reorder_mode mode;
   uint32_t max_samples;
   uint32_t n_samples;
+  struct nn_rx_drop_stats drops;
 };
 
 static const ut_avlTreedef_t reorder_sampleivtree_treedef =
@@ -1639,13 +2345,27 @@ struct nn_reorder *nn_reorder_new (enum nn_reorder_mode mode, uint32_t max_sampl
     return NULL;
   ut_avlInit (&reorder_sampleivtree_treedef, &r->sampleivtree);
   r->max_sampleiv = NULL;
+  r->win = NULL;
   r->next_seq = 1;
   r->mode = mode;
   r->max_samples = max_samples;
   r->n_samples = 0;
+  memset (&r->drops, 0, sizeof (r->drops));
   return r;
 }
 
+void nn_fragchain_ref (struct nn_rdata *frag)
+{
+  /* Adds a reference to each fragment, to be released using
+     nn_fragchain_unref(); unlike nn_fragchain_adjust_refcount it is
+     not tied to the receive thread's bias accounting. */
+  while (frag)
+  {
+    nn_rdata_ref (frag);
+    frag = frag->nextfrag;
+  }
+}
+
 void nn_fragchain_unref (struct nn_rdata *frag)
 {
   struct nn_rdata *frag1;
@@ -1675,15 +2395,147 @@ void nn_reorder_free (struct nn_reorder *r)
     }
     iv = ut_avlFindMin (&reorder_sampleivtree_treedef, &r->sampleivtree);
   }
+  os_free (r->win);
   os_free (r);
 }
 
+static int reorder_win_contains (const struct nn_reorder *reorder, seqno_t seq)
+{
+  return reorder->win != NULL && seq >= reorder->next_seq && seq - reorder->next_seq < REORDER_WINDOW;
+}
+
+static uint32_t reorder_win_slot (seqno_t seq)
+{
+  return (uint32_t) seq & (REORDER_WINDOW - 1);
+}
+
+static int reorder_win_covered (const struct nn_reorder *reorder, seqno_t seq)
+{
+  const uint32_t idx = reorder_win_slot (seq);
+  assert (reorder_win_contains (reorder, seq));
+  return (reorder->win->covered[idx / 32] & (1u << (idx % 32))) != 0;
+}
+
+static void reorder_win_mark (struct nn_reorder *reorder, seqno_t min, seqno_t maxp1, int covered)
+{
+  /* Sets/clears the covered bits for [min,maxp1) clipped to the
+     window, a word at a time; words align with the ring so wrapping
+     around needs no special care. */
+  if (reorder->win == NULL)
+    return;
+  if (min < reorder->next_seq)
+    min = reorder->next_seq;
+  if (maxp1 > reorder->next_seq + REORDER_WINDOW)
+    maxp1 = reorder->next_seq + REORDER_WINDOW;
+  while (min < maxp1)
+  {
+    const uint32_t idx = reorder_win_slot (min);
+    const uint32_t n = (maxp1 - min < 32 - idx % 32) ? (uint32_t) (maxp1 - min) : 32 - idx % 32;
+    const uint32_t m = (n == 32) ? ~0u : ((1u << n) - 1) << (idx % 32);
+    if (covered)
+      reorder->win->covered[idx / 32] |= m;
+    else
+      reorder->win->covered[idx / 32] &= ~m;
+    min += n;
+  }
+}
+
+static void reorder_win_index (struct nn_reorder *reorder, struct nn_rsample *iv, seqno_t min, seqno_t maxp1)
+{
+  /* Records iv as the interval starting & ending at its bounds and
+     [min,maxp1) as newly covered by it */
+  if (reorder->win == NULL)
+    return;
+  reorder_win_mark (reorder, min, maxp1, 1);
+  if (reorder_win_contains (reorder, iv->u.reorder.min))
+    reorder->win->bound[reorder_win_slot (iv->u.reorder.min)] = iv;
+  if (reorder_win_contains (reorder, iv->u.reorder.maxp1 - 1))
+    reorder->win->bound[reorder_win_slot (iv->u.reorder.maxp1 - 1)] = iv;
+}
+
+static void reorder_win_unindex_bounds (struct nn_reorder *reorder, const struct nn_rsample *iv)
+{
+  /* Forgets the bounds of iv, but leaves the covered bits alone: to
+     be used before changing the bounds of iv or merging it into
+     another interval */
+  if (reorder->win == NULL)
+    return;
+  if (reorder_win_contains (reorder, iv->u.reorder.min))
+    reorder->win->bound[reorder_win_slot (iv->u.reorder.min)] = NULL;
+  if (reorder_win_contains (reorder, iv->u.reorder.maxp1 - 1))
+    reorder->win->bound[reorder_win_slot (iv->u.reorder.maxp1 - 1)] = NULL;
+}
+
+static void reorder_win_load (struct nn_reorder *reorder, seqno_t min, seqno_t maxp1)
+{
+  /* Indexes the parts of the intervals in the tree that overlap with
+     [min,maxp1), which must be within the window and not indexed yet */
+  struct nn_rsample *iv;
+  iv = ut_avlLookupPredEq (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &min);
+  if (iv == NULL || iv->u.reorder.maxp1 <= min)
+    iv = ut_avlFindSucc (&reorder_sampleivtree_treedef, &reorder->sampleivtree, iv);
+  while (iv && iv->u.reorder.min < maxp1)
+  {
+    const seqno_t a = (iv->u.reorder.min > min) ? iv->u.reorder.min : min;
+    const seqno_t b = (iv->u.reorder.maxp1 < maxp1) ? iv->u.reorder.maxp1 : maxp1;
+    reorder_win_mark (reorder, a, b, 1);
+    if (iv->u.reorder.min >= min)
+      reorder->win->bound[reorder_win_slot (iv->u.reorder.min)] = iv;
+    if (iv->u.reorder.maxp1 <= maxp1)
+      reorder->win->bound[reorder_win_slot (iv->u.reorder.maxp1 - 1)] = iv;
+    iv = ut_avlFindSucc (&reorder_sampleivtree_treedef, &reorder->sampleivtree, iv);
+  }
+}
+
+static void reorder_win_ensure (struct nn_reorder *reorder)
+{
+  if (reorder->win != NULL)
+    return;
+  if ((reorder->win = os_malloc_s (sizeof (*reorder->win))) == NULL)
+    return;
+  memset (reorder->win, 0, sizeof (*reorder->win));
+  reorder_win_load (reorder, reorder->next_seq, reorder->next_seq + REORDER_WINDOW);
+}
+
+static void reorder_set_next_seq (struct nn_reorder *reorder, seqno_t next_seq)
+{
+  /* Slides the window along with next_seq: the slots of [old,
+     next_seq) are exactly those of [old + W, next_seq + W), so they
+     must be cleared and then loaded from whatever the tree has beyond
+     the old window.  Everything below next_seq must have been removed
+     from the tree already.  If the tree is empty, so is the window,
+     and the caller may as well update next_seq directly. */
+  const seqno_t old = reorder->next_seq;
+  reorder->next_seq = next_seq;
+  if (reorder->win == NULL || next_seq <= old)
+    return;
+  if (next_seq - old >= REORDER_WINDOW)
+  {
+    memset (reorder->win, 0, sizeof (*reorder->win));
+    if (reorder->max_sampleiv)
+      reorder_win_load (reorder, next_seq, next_seq + REORDER_WINDOW);
+  }
+  else
+  {
+    for (seqno_t seq = old; seq < next_seq; seq++)
+    {
+      const uint32_t idx = reorder_win_slot (seq);
+      reorder->win->bound[idx] = NULL;
+    }
+    reorder_win_mark (reorder, old + REORDER_WINDOW, next_seq + REORDER_WINDOW, 0);
+    if (reorder->max_sampleiv && reorder->max_sampleiv->u.reorder.maxp1 > old + REORDER_WINDOW)
+      reorder_win_load (reorder, old + REORDER_WINDOW, next_seq + REORDER_WINDOW);
+  }
+}
+
 static void reorder_add_rsampleiv (struct nn_reorder *reorder, struct nn_rsample *rsample)
 {
   ut_avlIPath_t path;
+  reorder_win_ensure (reorder);
   if (ut_avlLookupIPath (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &rsample->u.reorder.min, &path) != NULL)
     assert (0);
   ut_avlInsertIPath (&reorder_sampleivtree_treedef, &reorder->sampleivtree, rsample, &path);
+  reorder_win_index (reorder, rsample, rsample->u.reorder.min, rsample->u.reorder.maxp1);
 }
 
 #ifndef NDEBUG
@@ -1731,6 +2583,7 @@ static int reorder_try_append_and_discard (struct nn_reorder *reorder, struct nn
             appendto->u.reorder.min, appendto->u.reorder.maxp1, (void *) appendto,
             todiscard->u.reorder.min, todiscard->u.reorder.maxp1, (void *) todiscard);
     assert (todiscard->u.reorder.min == appendto->u.reorder.maxp1);
+    reorder_win_unindex_bounds (reorder, todiscard);
     ut_avlDelete (&reorder_sampleivtree_treedef, &reorder->sampleivtree, todiscard);
     append_rsample_interval (appendto, todiscard);
     DDS_LOG(DDS_LC_RADMIN, "  try_append_and_discard: max_sampleiv needs update? %s\n",
@@ -1811,6 +2664,8 @@ static void delete_last_sample (struct nn_reorder *reorder)
        recalc max_sampleiv. */
     DDS_LOG(DDS_LC_RADMIN, "  delete_last_sample: in singleton interval\n");
     fragchain = last->sc.first->fragchain;
+    reorder_win_unindex_bounds (reorder, reorder->max_sampleiv);
+    reorder_win_mark (reorder, last->min, last->maxp1, 0);
     ut_avlDelete (&reorder_sampleivtree_treedef, &reorder->sampleivtree, reorder->max_sampleiv);
     reorder->max_sampleiv = ut_avlFindMax (&reorder_sampleivtree_treedef, &reorder->sampleivtree);
     /* No harm done if it the sampleivtree is empty, except that we
@@ -1837,9 +2692,12 @@ static void delete_last_sample (struct nn_reorder *reorder)
     fragchain = e->fragchain;
     pe->next = NULL;
     assert (pe->sampleinfo->seq + 1 < last->maxp1);
+    reorder_win_unindex_bounds (reorder, reorder->max_sampleiv);
+    reorder_win_mark (reorder, last->maxp1 - 1, last->maxp1, 0);
     last->sc.last = pe;
     last->maxp1--;
     last->n_samples--;
+    reorder_win_index (reorder, reorder->max_sampleiv, last->maxp1, last->maxp1);
   }
 
   nn_fragchain_unref (fragchain);
@@ -1892,6 +2750,7 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     if (delivery_queue_full_p)
     {
       DDS_LOG(DDS_LC_RADMIN, "  discarding deliverable sample: delivery queue is full\n");
+      rx_drop_count (&reorder->drops, DROP_QUEUE_FULL, 1);
       return NN_REORDER_REJECT;
     }
 
@@ -1905,8 +2764,13 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
       DDS_LOG(DDS_LC_RADMIN, "  try append_and_discard\n");
       if (reorder_try_append_and_discard (reorder, rsampleiv, min))
         reorder->max_sampleiv = NULL;
+      reorder_set_next_seq (reorder, s->maxp1);
+    }
+    else
+    {
+      /* nothing stored means nothing in the window either */
+      reorder->next_seq = s->maxp1;
     }
-    reorder->next_seq = s->maxp1;
     *sc = rsampleiv->u.reorder.sc;
     (*refcount_adjust)++;
     DDS_LOG(DDS_LC_RADMIN, "  return [%"PRId64",%"PRId64")\n", s->min, s->maxp1);
@@ -1924,6 +2788,7 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     /* we've moved beyond this one: discard it; no need to adjust
        n_samples */
     DDS_LOG(DDS_LC_RADMIN, "  discard: too old\n");
+    rx_drop_count (&reorder->drops, DROP_TOO_OLD, 1);
     return NN_REORDER_TOO_OLD; /* don't want refcount increment */
   }
   else if (ut_avlIsEmpty (&reorder->sampleivtree))
@@ -1936,6 +2801,7 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     if (reorder->max_samples == 0)
     {
       DDS_LOG(DDS_LC_RADMIN, "  NOT - max_samples hit\n");
+      rx_drop_count (&reorder->drops, DROP_REORDER_FULL, 1);
       return NN_REORDER_REJECT;
     }
     else
@@ -1952,6 +2818,7 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     {
       /* growing last inteval will not be accepted when this flag is set */
       DDS_LOG(DDS_LC_RADMIN, "  discarding sample: only accepting delayed samples due to backlog in delivery queue\n");
+      rx_drop_count (&reorder->drops, DROP_QUEUE_FULL, 1);
       return NN_REORDER_REJECT;
     }
 
@@ -1959,12 +2826,15 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     DDS_LOG(DDS_LC_RADMIN, "  growing last interval\n");
     if (reorder->n_samples < reorder->max_samples)
     {
+      reorder_win_unindex_bounds (reorder, reorder->max_sampleiv);
       append_rsample_interval (reorder->max_sampleiv, rsampleiv);
+      reorder_win_index (reorder, reorder->max_sampleiv, s->min, s->maxp1);
       reorder->n_samples++;
     }
     else
     {
        DDS_LOG(DDS_LC_RADMIN, "  discarding sample: max_samples reached and sample at end\n");
+      rx_drop_count (&reorder->drops, DROP_REORDER_FULL, 1);
       return NN_REORDER_REJECT;
     }
   }
@@ -1974,6 +2844,7 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     {
       /* new interval at the end will not be accepted when this flag is set */
       DDS_LOG(DDS_LC_RADMIN, "  discarding sample: only accepting delayed samples due to backlog in delivery queue\n");
+      rx_drop_count (&reorder->drops, DROP_QUEUE_FULL, 1);
       return NN_REORDER_REJECT;
     }
     if (reorder->n_samples < reorder->max_samples)
@@ -1986,6 +2857,7 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     else
     {
       DDS_LOG(DDS_LC_RADMIN, "  discarding sample: max_samples reached and sample at end\n");
+      rx_drop_count (&reorder->drops, DROP_REORDER_FULL, 1);
       return NN_REORDER_REJECT;
     }
   }
@@ -1997,30 +2869,59 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
        - if m <= s->min < n we discard it (duplicate)
        - if n=s->min we can append s to predeq
        - if immsucc exists we can prepend s to immsucc
-       - and possibly join predeq, s, and immsucc */
+       - and possibly join predeq, s, and immsucc
+
+       within the window, the only predeq of interest is the one
+       ending at s->min, and both that and immsucc can be found in the
+       ring */
+    const seqno_t smin = s->min, smaxp1 = s->maxp1;
     struct nn_rsample *predeq, *immsucc;
     DDS_LOG(DDS_LC_RADMIN, "  hard case ...\n");
 
     if (config.late_ack_mode && delivery_queue_full_p)
     {
       DDS_LOG(DDS_LC_RADMIN, "  discarding sample: delivery queue full\n");
+      rx_drop_count (&reorder->drops, DROP_QUEUE_FULL, 1);
       return NN_REORDER_REJECT;
     }
 
-    predeq = ut_avlLookupPredEq (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &s->min);
-    if (predeq)
-      DDS_LOG(DDS_LC_RADMIN, "  predeq = [%"PRId64",%"PRId64") @ %p\n",
-              predeq->u.reorder.min, predeq->u.reorder.maxp1, (void *) predeq);
+    if (reorder_win_contains (reorder, smin))
+    {
+      assert (smin > reorder->next_seq);
+      if (reorder_win_covered (reorder, smin))
+      {
+        DDS_LOG(DDS_LC_RADMIN, "  discard: covered in window\n");
+        rx_drop_count (&reorder->drops, DROP_DUPLICATE, 1);
+        return NN_REORDER_REJECT;
+      }
+      predeq = reorder->win->bound[reorder_win_slot (smin - 1)];
+      if (predeq)
+        DDS_LOG(DDS_LC_RADMIN, "  predeq = [%"PRId64",%"PRId64") @ %p\n",
+                predeq->u.reorder.min, predeq->u.reorder.maxp1, (void *) predeq);
+      else
+        DDS_LOG(DDS_LC_RADMIN, "  predeq = null\n");
+      if (reorder_win_contains (reorder, smaxp1))
+        immsucc = reorder->win->bound[reorder_win_slot (smaxp1)];
+      else
+        immsucc = ut_avlLookup (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &smaxp1);
+    }
     else
-      DDS_LOG(DDS_LC_RADMIN, "  predeq = null\n");
-    if (predeq && s->min >= predeq->u.reorder.min && s->min < predeq->u.reorder.maxp1)
     {
-      /* contained in predeq */
-      DDS_LOG(DDS_LC_RADMIN, "  discard: contained in predeq\n");
-      return NN_REORDER_REJECT;
+      predeq = ut_avlLookupPredEq (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &s->min);
+      if (predeq)
+        DDS_LOG(DDS_LC_RADMIN, "  predeq = [%"PRId64",%"PRId64") @ %p\n",
+                predeq->u.reorder.min, predeq->u.reorder.maxp1, (void *) predeq);
+      else
+        DDS_LOG(DDS_LC_RADMIN, "  predeq = null\n");
+      if (predeq && s->min >= predeq->u.reorder.min && s->min < predeq->u.reorder.maxp1)
+      {
+        /* contained in predeq */
+        DDS_LOG(DDS_LC_RADMIN, "  discard: contained in predeq\n");
+        rx_drop_count (&reorder->drops, DROP_DUPLICATE, 1);
+        return NN_REORDER_REJECT;
+      }
+      immsucc = ut_avlLookup (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &s->maxp1);
     }
-
-    immsucc = ut_avlLookup (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &s->maxp1);
     if (immsucc)
       DDS_LOG(DDS_LC_RADMIN, "  immsucc = [%"PRId64",%"PRId64") @ %p\n",
               immsucc->u.reorder.min, immsucc->u.reorder.maxp1, (void *) immsucc);
@@ -2030,9 +2931,11 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     {
       /* grow predeq at end, and maybe append immsucc as well */
       DDS_LOG(DDS_LC_RADMIN, "  growing predeq at end ...\n");
+      reorder_win_unindex_bounds (reorder, predeq);
       append_rsample_interval (predeq, rsampleiv);
       if (reorder_try_append_and_discard (reorder, predeq, immsucc))
         reorder->max_sampleiv = predeq;
+      reorder_win_index (reorder, predeq, smin, smaxp1);
     }
     else if (immsucc)
     {
@@ -2040,6 +2943,7 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
          key of the node in the tree, but _doesn't_ change the tree's
          structure. */
       DDS_LOG(DDS_LC_RADMIN, "  growing immsucc at head\n");
+      reorder_win_unindex_bounds (reorder, immsucc);
       s->sc.last->next = immsucc->u.reorder.sc.first;
       immsucc->u.reorder.sc.first = s->sc.first;
       immsucc->u.reorder.min = s->min;
@@ -2061,6 +2965,7 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
       ut_avlSwapNode (&reorder_sampleivtree_treedef, &reorder->sampleivtree, immsucc, rsampleiv);
       if (immsucc == reorder->max_sampleiv)
         reorder->max_sampleiv = rsampleiv;
+      reorder_win_index (reorder, rsampleiv, smin, smaxp1);
     }
     else
     {
@@ -2077,6 +2982,7 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
       reorder->n_samples++;
     else
     {
+      rx_drop_count (&reorder->drops, DROP_REORDER_FULL, 1);
       delete_last_sample (reorder);
     }
   }
@@ -2110,8 +3016,10 @@ static struct nn_rsample *coalesce_intervals_touching_range (struct nn_reorder *
   }
   /* Append successors [m',n') s.t. m' <= maxp1 to s */
   assert (s->u.reorder.min + s->u.reorder.n_samples <= s->u.reorder.maxp1);
+  reorder_win_unindex_bounds (reorder, s);
   while ((t = ut_avlFindSucc (&reorder_sampleivtree_treedef, &reorder->sampleivtree, s)) != NULL && t->u.reorder.min <= maxp1)
   {
+    reorder_win_unindex_bounds (reorder, t);
     ut_avlDelete (&reorder_sampleivtree_treedef, &reorder->sampleivtree, t);
     assert (t->u.reorder.min + t->u.reorder.n_samples <= t->u.reorder.maxp1);
     append_rsample_interval (s, t);
@@ -2128,6 +3036,7 @@ static struct nn_rsample *coalesce_intervals_touching_range (struct nn_reorder *
     *valuable = 1;
     s->u.reorder.maxp1 = maxp1;
   }
+  reorder_win_index (reorder, s, s->u.reorder.min, s->u.reorder.maxp1);
   return s;
 }
 
@@ -2145,6 +3054,7 @@ static int reorder_insert_gap (struct nn_reorder *reorder, struct nn_rdata *rdat
   struct nn_rsample_chain_elem *sce;
   struct nn_rsample *s;
   ut_avlIPath_t path;
+  reorder_win_ensure (reorder);
   if (ut_avlLookupIPath (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &min, &path) != NULL)
     assert (0);
   if ((sce = nn_rmsg_alloc (rdata->rmsg, sizeof (*sce))) == NULL)
@@ -2159,6 +3069,7 @@ static int reorder_insert_gap (struct nn_reorder *reorder, struct nn_rdata *rdat
   s->u.reorder.maxp1 = maxp1;
   s->u.reorder.n_samples = 1;
   ut_avlInsertIPath (&reorder_sampleivtree_treedef, &reorder->sampleivtree, s, &path);
+  reorder_win_index (reorder, s, min, maxp1);
   return 1;
 }
 
@@ -2215,7 +3126,7 @@ nn_reorder_result_t nn_reorder_gap (struct nn_rsample_chain *sc, struct nn_reord
     if (min <= reorder->next_seq)
     {
       DDS_LOG(DDS_LC_RADMIN, "  next expected: %"PRId64"\n", maxp1);
-      reorder->next_seq = maxp1;
+      reorder_set_next_seq (reorder, maxp1);
       res = NN_REORDER_ACCEPT;
     }
     else if (reorder->n_samples == reorder->max_samples &&
@@ -2254,8 +3165,8 @@ nn_reorder_result_t nn_reorder_gap (struct nn_rsample_chain *sc, struct nn_reord
     ut_avlDelete (&reorder_sampleivtree_treedef, &reorder->sampleivtree, coalesced);
     if (coalesced->u.reorder.min <= reorder->next_seq)
       assert (min <= reorder->next_seq);
-    reorder->next_seq = coalesced->u.reorder.maxp1;
     reorder->max_sampleiv = ut_avlFindMax (&reorder_sampleivtree_treedef, &reorder->sampleivtree);
+    reorder_set_next_seq (reorder, coalesced->u.reorder.maxp1);
     DDS_LOG(DDS_LC_RADMIN, "  next expected: %"PRId64"\n", reorder->next_seq);
     *sc = coalesced->u.reorder.sc;
 
@@ -2280,6 +3191,8 @@ int nn_reorder_wantsample (struct nn_reorder *reorder, seqno_t seq)
   if (seq < reorder->next_seq)
     /* trivially not interesting */
     return 0;
+  if (reorder_win_contains (reorder, seq))
+    return !reorder_win_covered (reorder, seq);
   /* Find interval that contains seq, if we know seq.  We are
      interested if seq is outside this interval (if any). */
   s = ut_avlLookupPredEq (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &seq);
@@ -2325,29 +3238,67 @@ unsigned nn_reorder_nackmap (struct nn_reorder *reorder, seqno_t base, seqno_t m
     map->numbits = (uint32_t) (maxseq + 1 - base);
   nn_bitset_zero (map->numbits, map->bits);
 
+  if (reorder->win != NULL && base + map->numbits <= reorder->next_seq + REORDER_WINDOW)
+  {
+    /* Everything of interest is in the window (or precedes it, and
+       then it is missing, too) */
+    uint32_t x, tail = 0;
+    i = (reorder->next_seq < base + map->numbits) ? reorder->next_seq : base + map->numbits;
+    if (i > base)
+      nn_bitset_set_range (map->numbits, map->bits, 0, (unsigned) (i - base));
+    /* then the window, in chunks that don't cross a word in the ring,
+       only looking at individual bits if they're mixed */
+    x = (uint32_t) (i - base);
+    while (x < map->numbits)
+    {
+      const uint32_t idx = reorder_win_slot (base + x);
+      const uint32_t n = (map->numbits - x < 32 - idx % 32) ? map->numbits - x : 32 - idx % 32;
+      const uint32_t mask = (n == 32) ? ~0u : (1u << n) - 1;
+      const uint32_t covered = (reorder->win->covered[idx / 32] >> (idx % 32)) & mask;
+      if (covered == 0)
+        nn_bitset_set_range (map->numbits, map->bits, x, x + n);
+      else if (covered != mask)
+      {
+        for (uint32_t k = 0; k < n; k++)
+          if (!(covered & (1u << k)))
+            nn_bitset_set (map->numbits, map->bits, x + k);
+      }
+      if (covered)
+        tail = x + n;
+      x += n;
+    }
+    /* no need to nack the tail following the last covered sequence
+       number if notail is set; tail is the end of the chunk containing
+       it, or 0 if nothing is covered, so walk it back -- unless there
+       is data beyond the end of the map, in which case everything
+       missing in the map precedes a known sample, just like in the
+       interval tree case below */
+    if (notail && !(reorder->max_sampleiv && reorder->max_sampleiv->u.reorder.maxp1 > base + map->numbits))
+    {
+      while (tail > 0 && nn_bitset_isset (map->numbits, map->bits, tail - 1))
+        nn_bitset_clear (map->numbits, map->bits, --tail);
+      map->numbits = tail;
+    }
+    return map->numbits;
+  }
+
   if ((iv = ut_avlFindMin (&reorder_sampleivtree_treedef, &reorder->sampleivtree)) != NULL)
     assert (iv->u.reorder.min > base);
   i = base;
   while (iv && i < base + map->numbits)
   {
-    for (; i < base + map->numbits && i < iv->u.reorder.min; i++)
+    if (i < iv->u.reorder.min)
     {
-      unsigned x = (unsigned) (i - base);
-      nn_bitset_set (map->numbits, map->bits, x);
+      const seqno_t end = (iv->u.reorder.min < base + map->numbits) ? iv->u.reorder.min : base + map->numbits;
+      nn_bitset_set_range (map->numbits, map->bits, (unsigned) (i - base), (unsigned) (end - base));
     }
     i = iv->u.reorder.maxp1;
     iv = ut_avlFindSucc (&reorder_sampleivtree_treedef, &reorder->sampleivtree, iv);
   }
   if (notail && i < base + map->numbits)
     map->numbits = (unsigned) (i - base);
-  else
-  {
-    for (; i < base + map->numbits; i++)
-    {
-      unsigned x = (unsigned) (i - base);
-      nn_bitset_set (map->numbits, map->bits, x);
-    }
-  }
+  else if (i < base + map->numbits)
+    nn_bitset_set_range (map->numbits, map->bits, (unsigned) (i - base), map->numbits);
   return map->numbits;
 }
 
@@ -2356,20 +3307,37 @@ seqno_t nn_reorder_next_seq (const struct nn_reorder *reorder)
   return reorder->next_seq;
 }
 
+void nn_reorder_stats (const struct nn_reorder *reorder, struct nn_radmin_stats *st)
+{
+  st->n_samples = reorder->n_samples;
+  st->max_samples = reorder->max_samples;
+  st->drops = reorder->drops;
+}
+
 /* DQUEUE -------------------------------------------------------------- */
 
+/* The queue itself is a lock-free LIFO of enqueue operations: each
+   enqueued chain is reversed and pushed onto "head" in a single CAS,
+   and the delivery thread takes the whole list in one go and reverses
+   it, restoring FIFO order. The lock and condition variable are only
+   used when the delivery thread is parked waiting for work or another
+   thread is waiting for the queue to drain. */
+
 struct nn_dqueue {
+  os_atomic_voidp_t head;
+  os_atomic_uint32_t parked;
+  os_atomic_uint32_t nwaiters;
+
   os_mutex lock;
   os_cond cond;
   nn_dqueue_handler_t handler;
   void *handler_arg;
 
-  struct nn_rsample_chain sc;
-
   struct thread_state1 *ts;
   char *name;
   uint32_t max_samples;
   os_atomic_uint32_t nof_samples;
+  os_atomic_uint32_t high_water;
 };
 
 enum dqueue_elem_kind {
@@ -2413,6 +3381,36 @@ static enum dqueue_elem_kind dqueue_elem_kind (const struct nn_rsample_chain_ele
     return DQEK_BUBBLE;
 }
 
+static struct nn_rsample_chain_elem *dqueue_reverse (struct nn_rsample_chain_elem *e)
+{
+  struct nn_rsample_chain_elem *first = NULL;
+  while (e)
+  {
+    struct nn_rsample_chain_elem *next = e->next;
+    e->next = first;
+    first = e;
+    e = next;
+  }
+  return first;
+}
+
+static struct nn_rsample_chain_elem *dqueue_take_all (struct nn_dqueue *q)
+{
+  void *head;
+  do {
+    if ((head = os_atomic_ldvoidp (&q->head)) == NULL)
+      return NULL;
+  } while (!os_atomic_casvoidp (&q->head, head, NULL));
+  return dqueue_reverse (head);
+}
+
+static void dqueue_wakeup (struct nn_dqueue *q)
+{
+  os_mutexLock (&q->lock);
+  os_condBroadcast (&q->cond);
+  os_mutexUnlock (&q->lock);
+}
+
 static uint32_t dqueue_thread (struct nn_dqueue *q)
 {
   struct thread_state1 *self = lookup_thread_state ();
@@ -2421,26 +3419,33 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
   nn_guid_t rdguid, *prdguid = NULL;
   uint32_t rdguid_count = 0;
 
-  os_mutexLock (&q->lock);
   while (keepgoing)
   {
-    struct nn_rsample_chain sc;
+    struct nn_rsample_chain_elem *first;
 
     LOG_THREAD_CPUTIME (next_thread_cputime);
 
-    if (q->sc.first == NULL)
-      os_condWait (&q->cond, &q->lock);
-    sc = q->sc;
-    q->sc.first = q->sc.last = NULL;
-    os_mutexUnlock (&q->lock);
+    if ((first = dqueue_take_all (q)) == NULL)
+    {
+      /* Producers only signal if they see "parked" set after making the
+         queue non-empty, so it must be set before the final check */
+      os_mutexLock (&q->lock);
+      os_atomic_st32 (&q->parked, 1);
+      os_atomic_fence ();
+      while (os_atomic_ldvoidp (&q->head) == NULL)
+        os_condWait (&q->cond, &q->lock);
+      os_atomic_st32 (&q->parked, 0);
+      os_mutexUnlock (&q->lock);
+      continue;
+    }
 
-    while (sc.first)
+    while (first)
     {
-      struct nn_rsample_chain_elem *e = sc.first;
+      struct nn_rsample_chain_elem *e = first;
       int ret;
-      sc.first = e->next;
-      if (os_atomic_dec32_ov (&q->nof_samples) == 1) {
-        os_condBroadcast (&q->cond);
+      first = e->next;
+      if (os_atomic_dec32_ov (&q->nof_samples) == 1 && os_atomic_ld32 (&q->nwaiters) > 0) {
+        dqueue_wakeup (q);
       }
       thread_state_awake (self);
       switch (dqueue_elem_kind (e))
@@ -2467,7 +3472,7 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
               /* Stuff enqueued behind the bubble will still be
                  processed, we do want to drain the queue.  Nothing
                  may be queued anymore once we queue the stop bubble,
-                 so q->sc.first should be empty.  If it isn't
+                 so q->head should be empty.  If it isn't
                  ... dqueue_free fail an assertion.  STOP bubble
                  doesn't get malloced, and hence not freed. */
               keepgoing = 0;
@@ -2494,10 +3499,7 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
       }
       thread_state_asleep (self);
     }
-
-    os_mutexLock (&q->lock);
   }
-  os_mutexUnlock (&q->lock);
   return 0;
 }
 
@@ -2513,9 +3515,12 @@ struct nn_dqueue *nn_dqueue_new (const char *name, uint32_t max_samples, nn_dque
     goto fail_name;
   q->max_samples = max_samples;
   os_atomic_st32 (&q->nof_samples, 0);
+  os_atomic_st32 (&q->high_water, 0);
   q->handler = handler;
   q->handler_arg = arg;
-  q->sc.first = q->sc.last = NULL;
+  os_atomic_stvoidp (&q->head, NULL);
+  os_atomic_st32 (&q->parked, 0);
+  os_atomic_st32 (&q->nwaiters, 0);
 
   os_mutexInit (&q->lock);
   os_condInit (&q->cond, &q->lock);
@@ -2541,21 +3546,26 @@ struct nn_dqueue *nn_dqueue_new (const char *name, uint32_t max_samples, nn_dque
   return NULL;
 }
 
-static int nn_dqueue_enqueue_locked (struct nn_dqueue *q, struct nn_rsample_chain *sc)
+static void dqueue_add_samples (struct nn_dqueue *q, uint32_t n)
 {
-  int must_signal;
-  if (q->sc.first == NULL)
-  {
-    must_signal = 1;
-    q->sc = *sc;
-  }
-  else
-  {
-    must_signal = 0;
-    q->sc.last->next = sc->first;
-    q->sc.last = sc->last;
-  }
-  return must_signal;
+  const uint32_t nof_samples = os_atomic_add32_nv (&q->nof_samples, n);
+  uint32_t hw;
+  while (nof_samples > (hw = os_atomic_ld32 (&q->high_water)) && !os_atomic_cas32 (&q->high_water, hw, nof_samples))
+    ;
+}
+
+static int nn_dqueue_push (struct nn_dqueue *q, struct nn_rsample_chain *sc)
+{
+  /* Returns whether the delivery thread needs waking up; the full
+     barrier of the CAS orders the push before reading "parked" */
+  struct nn_rsample_chain_elem * const last = sc->first;
+  struct nn_rsample_chain_elem * const first = dqueue_reverse (sc->first);
+  void *head;
+  do {
+    head = os_atomic_ldvoidp (&q->head);
+    last->next = head;
+  } while (!os_atomic_casvoidp (&q->head, head, first));
+  return head == NULL && os_atomic_ld32 (&q->parked);
 }
 
 void nn_dqueue_enqueue (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reorder_result_t rres)
@@ -2563,30 +3573,26 @@ void nn_dqueue_enqueue (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reo
   assert (rres > 0);
   assert (sc->first);
   assert (sc->last->next == NULL);
-  os_mutexLock (&q->lock);
-  os_atomic_add32 (&q->nof_samples, (uint32_t) rres);
-  if (nn_dqueue_enqueue_locked (q, sc))
-    os_condBroadcast (&q->cond);
-  os_mutexUnlock (&q->lock);
+  dqueue_add_samples (q, (uint32_t) rres);
+  if (nn_dqueue_push (q, sc))
+    dqueue_wakeup (q);
 }
 
-static int nn_dqueue_enqueue_bubble_locked (struct nn_dqueue *q, struct nn_dqueue_bubble *b)
+static void nn_dqueue_init_bubble (struct nn_dqueue_bubble *b)
 {
-  struct nn_rsample_chain sc;
   b->sce.next = NULL;
   b->sce.fragchain = NULL;
   b->sce.sampleinfo = (struct nn_rsample_info *) b;
-  sc.first = sc.last = &b->sce;
-  return nn_dqueue_enqueue_locked (q, &sc);
 }
 
 static void nn_dqueue_enqueue_bubble (struct nn_dqueue *q, struct nn_dqueue_bubble *b)
 {
-  os_mutexLock (&q->lock);
-  os_atomic_inc32 (&q->nof_samples);
-  if (nn_dqueue_enqueue_bubble_locked (q, b))
-    os_condBroadcast (&q->cond);
-  os_mutexUnlock (&q->lock);
+  struct nn_rsample_chain sc;
+  nn_dqueue_init_bubble (b);
+  sc.first = sc.last = &b->sce;
+  dqueue_add_samples (q, 1);
+  if (nn_dqueue_push (q, &sc))
+    dqueue_wakeup (q);
 }
 
 void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, void *arg)
@@ -2602,6 +3608,7 @@ void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, v
 void nn_dqueue_enqueue1 (struct nn_dqueue *q, const nn_guid_t *rdguid, struct nn_rsample_chain *sc, nn_reorder_result_t rres)
 {
   struct nn_dqueue_bubble *b;
+  struct nn_rsample_chain sc1;
 
   b = os_malloc (sizeof (*b));
   b->kind = NN_DQBK_RDGUID;
@@ -2612,12 +3619,20 @@ void nn_dqueue_enqueue1 (struct nn_dqueue *q, const nn_guid_t *rdguid, struct nn
   assert (rdguid != NULL);
   assert (sc->first);
   assert (sc->last->next == NULL);
-  os_mutexLock (&q->lock);
-  os_atomic_add32 (&q->nof_samples, 1 + (uint32_t) rres);
-  if (nn_dqueue_enqueue_bubble_locked (q, b))
-    os_condBroadcast (&q->cond);
-  nn_dqueue_enqueue_locked (q, sc);
-  os_mutexUnlock (&q->lock);
+  /* bubble and samples must be pushed in one go, the count in the
+     bubble applies to the samples immediately following it */
+  nn_dqueue_init_bubble (b);
+  b->sce.next = sc->first;
+  sc1.first = &b->sce;
+  sc1.last = sc->last;
+  dqueue_add_samples (q, 1 + (uint32_t) rres);
+  if (nn_dqueue_push (q, &sc1))
+    dqueue_wakeup (q);
+}
+
+const char *nn_dqueue_name (const struct nn_dqueue *q)
+{
+  return q->name;
 }
 
 int nn_dqueue_is_full (struct nn_dqueue *q)
@@ -2639,12 +3654,21 @@ void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q)
   if (count >= q->max_samples)
   {
     os_mutexLock (&q->lock);
+    os_atomic_inc32 (&q->nwaiters);
     while (os_atomic_ld32 (&q->nof_samples) > 0)
       os_condWait (&q->cond, &q->lock);
+    os_atomic_dec32 (&q->nwaiters);
     os_mutexUnlock (&q->lock);
   }
 }
 
+void nn_dqueue_stats (struct nn_dqueue *q, struct nn_dqueue_stats *st)
+{
+  st->n_samples = os_atomic_ld32 (&q->nof_samples);
+  st->max_samples = q->max_samples;
+  st->high_water = os_atomic_ld32 (&q->high_water);
+}
+
 void nn_dqueue_free (struct nn_dqueue *q)
 {
   /* There must not be any thread enqueueing things anymore at this
@@ -2657,7 +3681,7 @@ void nn_dqueue_free (struct nn_dqueue *q)
   nn_dqueue_enqueue_bubble (q, &b);
 
   join_thread (q->ts);
-  assert (q->sc.first == NULL);
+  assert (os_atomic_ldvoidp (&q->head) == NULL);
   os_condDestroy (&q->cond);
   os_mutexDestroy (&q->lock);
   os_free (q->name);
@@ -66,11 +66,15 @@ Notes:
   which is needed if IN-ORDER synchronous delivery is desired when
   there are also multiple receive threads
 
+- deliver_or_enqueue_user_data must be called with pwr->e.lock held,
+  adaptive delivery relies on it for switching between synchronous
+  and asynchronous delivery without reordering samples
+
 - deliver_user_data gets passed in whether pwr->e.lock is held on entry
 
 */
 
-static void deliver_user_data_synchronously (struct nn_rsample_chain *sc);
+static void deliver_or_enqueue_user_data (struct proxy_writer *pwr, struct nn_rsample_chain *sc, nn_reorder_result_t rres);
 
 static void maybe_set_reader_in_sync (struct proxy_writer *pwr, struct pwr_rd_match *wn, seqno_t last_deliv_seq)
 {
@@ -650,20 +654,19 @@ static seqno_t grow_gap_to_next_seq (const struct writer *wr, seqno_t seq)
 
 static int acknack_is_nack (const AckNack_t *msg)
 {
-  unsigned x = 0, mask;
-  int i;
-  if (msg->readerSNState.numbits == 0)
-    /* Disallowed by the spec, but RTI appears to require them (and so
-       even we generate them) */
-    return 0;
-  for (i = 0; i < (int) NN_SEQUENCE_NUMBER_SET_BITS_SIZE (msg->readerSNState.numbits) / 4 - 1; i++)
-    x |= msg->readerSNState.bits[i];
-  if ((msg->readerSNState.numbits % 32) == 0)
-    mask = ~0u;
-  else
-    mask = ~(~0u >> (msg->readerSNState.numbits % 32));
-  x |= msg->readerSNState.bits[i] & mask;
-  return x != 0;
+  /* A numbits of 0 is disallowed by the spec, but RTI appears to
+     require them (and so even we generate them) */
+  return nn_bitset_find_set (msg->readerSNState.numbits, msg->readerSNState.bits, 0) < msg->readerSNState.numbits;
+}
+
+static unsigned acknack_next_nacked (const AckNack_t *msg, unsigned i)
+{
+  /* Index of the first sequence number >= seqbase+i that is nack'd,
+     anything beyond the set counts as nack'd for the accelerated
+     schedule */
+  if (i >= msg->readerSNState.numbits)
+    return i;
+  return nn_bitset_find_set (msg->readerSNState.numbits, msg->readerSNState.bits, i);
 }
 
 static int accept_ack_or_hb_w_timeout (nn_count_t new_count, nn_count_t *exp_count, nn_etime_t tnow, nn_etime_t *t_last_accepted, int force_accept)
@@ -925,77 +928,74 @@ static int handle_AckNack (struct receiver_state *rst, nn_etime_t tnow, const Ac
      a future request'll fix it. */
   enqueued = 1;
   seq_xmit = READ_SEQ_XMIT(wr);
-  for (i = 0; i < numbits && seqbase + i <= seq_xmit && enqueued; i++)
+  for (i = acknack_next_nacked (msg, 0); i < numbits && seqbase + i <= seq_xmit && enqueued; i = acknack_next_nacked (msg, i + 1))
   {
     /* Accelerated schedule may run ahead of sequence number set
        contained in the acknack, and assumes all messages beyond the
        set are NACK'd -- don't feel like tracking where exactly we
        left off ... */
-    if (i >= msg->readerSNState.numbits || nn_bitset_isset (numbits, msg->readerSNState.bits, i))
+    seqno_t seq = seqbase + i;
+    struct whc_borrowed_sample sample;
+    if (whc_borrow_sample (wr->whc, seq, &sample))
     {
-      seqno_t seq = seqbase + i;
-      struct whc_borrowed_sample sample;
-      if (whc_borrow_sample (wr->whc, seq, &sample))
-      {
-        if (!wr->retransmitting && sample.unacked)
-          writer_set_retransmitting (wr);
+      if (!wr->retransmitting && sample.unacked)
+        writer_set_retransmitting (wr);
 
-        if (config.retransmit_merging != REXMIT_MERGE_NEVER && rn->assumed_in_sync)
-        {
-          /* send retransmit to all receivers, but skip if recently done */
-          nn_mtime_t tstamp = now_mt ();
-          if (tstamp.v > sample.last_rexmit_ts.v + config.retransmit_merging_period)
-          {
-            DDS_TRACE(" RX%"PRId64, seqbase + i);
-            enqueued = (enqueue_sample_wrlock_held (wr, seq, sample.plist, sample.serdata, NULL, 0) >= 0);
-            if (enqueued)
-            {
-              max_seq_in_reply = seqbase + i;
-              msgs_sent++;
-              sample.last_rexmit_ts = tstamp;
-            }
-          }
-          else
-          {
-            DDS_TRACE(" RX%"PRId64" (merged)", seqbase + i);
-          }
-        }
-        else
+      if (config.retransmit_merging != REXMIT_MERGE_NEVER && rn->assumed_in_sync)
+      {
+        /* send retransmit to all receivers, but skip if recently done */
+        nn_mtime_t tstamp = now_mt ();
+        if (tstamp.v > sample.last_rexmit_ts.v + config.retransmit_merging_period)
         {
-          /* no merging, send directed retransmit */
-          DDS_TRACE(" RX%"PRId64"", seqbase + i);
-          enqueued = (enqueue_sample_wrlock_held (wr, seq, sample.plist, sample.serdata, prd, 0) >= 0);
+          DDS_TRACE(" RX%"PRId64, seqbase + i);
+          enqueued = (enqueue_sample_wrlock_held (wr, seq, sample.plist, sample.serdata, NULL, 0) >= 0);
           if (enqueued)
           {
             max_seq_in_reply = seqbase + i;
             msgs_sent++;
-            sample.rexmit_count++;
+            sample.last_rexmit_ts = tstamp;
           }
         }
-
-        whc_return_sample(wr->whc, &sample, true);
-      }
-      else if (gapstart == -1)
-      {
-        DDS_TRACE(" M%"PRId64, seqbase + i);
-        gapstart = seqbase + i;
-        gapend = gapstart + 1;
-        msgs_lost++;
-      }
-      else if (seqbase + i == gapend)
-      {
-        DDS_TRACE(" M%"PRId64, seqbase + i);
-        gapend = seqbase + i + 1;
-        msgs_lost++;
+        else
+        {
+          DDS_TRACE(" RX%"PRId64" (merged)", seqbase + i);
+        }
       }
-      else if (seqbase + i - gapend < 256)
+      else
       {
-        unsigned idx = (unsigned) (seqbase + i - gapend);
-        DDS_TRACE(" M%"PRId64, seqbase + i);
-        gapnumbits = idx + 1;
-        nn_bitset_set (gapnumbits, gapbits, idx);
-        msgs_lost++;
+        /* no merging, send directed retransmit */
+        DDS_TRACE(" RX%"PRId64"", seqbase + i);
+        enqueued = (enqueue_sample_wrlock_held (wr, seq, sample.plist, sample.serdata, prd, 0) >= 0);
+        if (enqueued)
+        {
+          max_seq_in_reply = seqbase + i;
+          msgs_sent++;
+          sample.rexmit_count++;
+        }
       }
+
+      whc_return_sample(wr->whc, &sample, true);
+    }
+    else if (gapstart == -1)
+    {
+      DDS_TRACE(" M%"PRId64, seqbase + i);
+      gapstart = seqbase + i;
+      gapend = gapstart + 1;
+      msgs_lost++;
+    }
+    else if (seqbase + i == gapend)
+    {
+      DDS_TRACE(" M%"PRId64, seqbase + i);
+      gapend = seqbase + i + 1;
+      msgs_lost++;
+    }
+    else if (seqbase + i - gapend < 256)
+    {
+      unsigned idx = (unsigned) (seqbase + i - gapend);
+      DDS_TRACE(" M%"PRId64, seqbase + i);
+      gapnumbits = idx + 1;
+      nn_bitset_set (gapnumbits, gapbits, idx);
+      msgs_lost++;
     }
   }
   if (!enqueued)
@@ -1243,10 +1243,7 @@ static int handle_Heartbeat (struct receiver_state *rst, nn_etime_t tnow, struct
     gap = nn_rdata_newgap (rmsg);
     if ((res = nn_reorder_gap (&sc, pwr->reorder, gap, 1, lastseq + 1, &refc_adjust)) > 0)
     {
-      if (pwr->deliver_synchronously)
-        deliver_user_data_synchronously (&sc);
-      else
-        nn_dqueue_enqueue (pwr->dqueue, &sc, res);
+      deliver_or_enqueue_user_data (pwr, &sc, res);
     }
     nn_fragchain_adjust_refcount (gap, refc_adjust);
     pwr->have_seen_heartbeat = 1;
@@ -1280,10 +1277,7 @@ static int handle_Heartbeat (struct receiver_state *rst, nn_etime_t tnow, struct
     gap = nn_rdata_newgap (rmsg);
     if ((res = nn_reorder_gap (&sc, pwr->reorder, gap, 1, firstseq, &refc_adjust)) > 0)
     {
-      if (pwr->deliver_synchronously)
-        deliver_user_data_synchronously (&sc);
-      else
-        nn_dqueue_enqueue (pwr->dqueue, &sc, res);
+      deliver_or_enqueue_user_data (pwr, &sc, res);
     }
     for (wn = ut_avlFindMin (&pwr_readers_treedef, &pwr->readers); wn; wn = ut_avlFindSucc (&pwr_readers_treedef, &pwr->readers, wn))
       if (wn->in_sync != PRMSS_SYNC)
@@ -1513,16 +1507,14 @@ static int handle_NackFrag (struct receiver_state *rst, nn_etime_t tnow, const N
     const unsigned base = msg->fragmentNumberState.bitmap_base - 1;
     int enqueued = 1;
     DDS_TRACE(" scheduling requested frags ...\n");
-    for (i = 0; i < msg->fragmentNumberState.numbits && enqueued; i++)
+    const unsigned numbits = msg->fragmentNumberState.numbits;
+    for (i = nn_bitset_find_set (numbits, msg->fragmentNumberState.bits, 0); i < numbits && enqueued; i = nn_bitset_find_set (numbits, msg->fragmentNumberState.bits, i + 1))
     {
-      if (nn_bitset_isset (msg->fragmentNumberState.numbits, msg->fragmentNumberState.bits, i))
-      {
-        struct nn_xmsg *reply;
-        if (create_fragment_message (wr, seq, sample.plist, sample.serdata, base + i, prd, &reply, 0) < 0)
-          enqueued = 0;
-        else
-          enqueued = qxev_msg_rexmit_wrlock_held (wr->evq, reply, 0);
-      }
+      struct nn_xmsg *reply;
+      if (create_fragment_message (wr, seq, sample.plist, sample.serdata, base + i, prd, &reply, 0) < 0)
+        enqueued = 0;
+      else
+        enqueued = qxev_msg_rexmit_wrlock_held (wr->evq, reply, 0);
     }
     whc_return_sample (wr->whc, &sample, false);
   }
@@ -1628,10 +1620,7 @@ static int handle_one_gap (struct proxy_writer *pwr, struct pwr_rd_match *wn, se
      deliverable. */
   if ((res = nn_reorder_gap (&sc, pwr->reorder, gap, a, b, refc_adjust)) > 0)
   {
-    if (pwr->deliver_synchronously)
-      deliver_user_data_synchronously (&sc);
-    else
-      nn_dqueue_enqueue (pwr->dqueue, &sc, res);
+    deliver_or_enqueue_user_data (pwr, &sc, res);
   }
 
   /* If the result was REJECT or TOO_OLD, then this gap didn't add
@@ -1711,9 +1700,7 @@ static int handle_Gap (struct receiver_state *rst, nn_etime_t tnow, struct nn_rm
   /* There is no _good_ reason for a writer to start the bitmap with a
      1 bit, but check for it just in case, to reduce the number of
      sequence number gaps to be processed. */
-  for (listidx = 0; listidx < msg->gapList.numbits; listidx++)
-    if (!nn_bitset_isset (msg->gapList.numbits, msg->gapList.bits, listidx))
-      break;
+  listidx = nn_bitset_find_clear (msg->gapList.numbits, msg->gapList.bits, 0);
   last_included_rel = (int)listidx - 1;
 
   if (!rst->forme)
@@ -1755,24 +1742,16 @@ static int handle_Gap (struct receiver_state *rst, nn_etime_t tnow, struct nn_rm
          intervals */
       (void) handle_one_gap (pwr, wn, gapstart, listbase + listidx, gap, &refc_adjust);
     }
-    while (listidx < msg->gapList.numbits)
+    while ((listidx = nn_bitset_find_set (msg->gapList.numbits, msg->gapList.bits, listidx)) < msg->gapList.numbits)
     {
-      if (!nn_bitset_isset (msg->gapList.numbits, msg->gapList.bits, listidx))
-        listidx++;
-      else
-      {
-        unsigned j;
-        for (j = listidx+1; j < msg->gapList.numbits; j++)
-          if (!nn_bitset_isset (msg->gapList.numbits, msg->gapList.bits, j))
-            break;
-        /* spec says gapList (2) identifies an additional list of sequence numbers that
-           are invalid (8.3.7.4.2), so by that rule an insane start would simply mean the
-           initial interval is to be ignored and the bitmap to be applied */
-        (void) handle_one_gap (pwr, wn, listbase + listidx, listbase + j, gap, &refc_adjust);
-        assert(j >= 1);
-        last_included_rel = j - 1;
-        listidx = j;
-      }
+      const unsigned j = nn_bitset_find_clear (msg->gapList.numbits, msg->gapList.bits, listidx + 1);
+      /* spec says gapList (2) identifies an additional list of sequence numbers that
+         are invalid (8.3.7.4.2), so by that rule an insane start would simply mean the
+         initial interval is to be ignored and the bitmap to be applied */
+      (void) handle_one_gap (pwr, wn, listbase + listidx, listbase + j, gap, &refc_adjust);
+      assert(j >= 1);
+      last_included_rel = (int) j - 1;
+      listidx = j;
     }
     nn_fragchain_adjust_refcount (gap, refc_adjust);
   }
@@ -2039,6 +2018,13 @@ retry:
             DDS_TRACE("reader %x:%x:%x:%x\n", PGUID (rdary[i]->e.guid));
             if (! (ddsi_plugin.rhc_plugin.rhc_store_fn) (rdary[i]->rhc, &pwr_info, payload, tk))
             {
+              if (pwr_locked)
+              {
+                /* pwr_locked implies synchronous delivery: let the
+                   delivery queue absorb the next samples */
+                pwr->sync_delivery_stalled = 1;
+                pwr->n_sync_stalls++;
+              }
               if (pwr_locked) os_mutexUnlock (&pwr->e.lock);
               os_mutexUnlock (&pwr->rdary.rdary_lock);
               dds_sleepfor (DDS_MSECS (10));
@@ -2100,6 +2086,8 @@ int user_dqueue_handler (const struct nn_rsample_info *sampleinfo, const struct
 {
   int res;
   res = deliver_user_data (sampleinfo, fragchain, rdguid, 0);
+  if (rdguid == NULL && sampleinfo->pwr->deliver_adaptively)
+    os_atomic_dec32 (&sampleinfo->pwr->n_dqueued);
   return res;
 }
 
@@ -2121,6 +2109,41 @@ static void deliver_user_data_synchronously (struct nn_rsample_chain *sc)
   }
 }
 
+static void deliver_or_enqueue_user_data (struct proxy_writer *pwr, struct nn_rsample_chain *sc, nn_reorder_result_t rres)
+{
+  /* Adaptive delivery: deliver from the receive thread only while
+     none of this proxy writer's samples are still waiting in the
+     delivery queue (or else they'd be overtaken) and the last
+     synchronous delivery didn't have to wait for a reader.  Otherwise
+     the delivery queue takes over until it has caught up.  The count
+     of queued samples only goes down outside pwr->e.lock, so a stale
+     value merely means going through the queue once more. */
+  int sync = pwr->deliver_synchronously;
+  ASSERT_MUTEX_HELD (&pwr->e.lock);
+  if (pwr->deliver_adaptively)
+  {
+    if (os_atomic_ld32 (&pwr->n_dqueued) > 0)
+      sync = 0;
+    else if (pwr->sync_delivery_stalled)
+    {
+      pwr->sync_delivery_stalled = 0;
+      sync = 0;
+    }
+  }
+  if (sync)
+  {
+    pwr->n_delivered_sync += (uint64_t) rres;
+    deliver_user_data_synchronously (sc);
+  }
+  else
+  {
+    pwr->n_delivered_async += (uint64_t) rres;
+    if (pwr->deliver_adaptively)
+      os_atomic_add32 (&pwr->n_dqueued, (uint32_t) rres);
+    nn_dqueue_enqueue (pwr->dqueue, sc, rres);
+  }
+}
+
 static void clean_defrag (struct proxy_writer *pwr)
 {
   seqno_t seq = nn_reorder_next_seq (pwr->reorder);
@@ -2221,10 +2244,7 @@ static void handle_regular (struct receiver_state *rst, nn_etime_t tnow, struct
          receive thread's data gets interleaved -- arguably delivery
          needn't be exactly in-order, which would allow us to do this
          without pwr->e.lock held. */
-      if (!pwr->deliver_synchronously)
-        nn_dqueue_enqueue (pwr->dqueue, &sc, rres);
-      else
-        deliver_user_data_synchronously (&sc);
+      deliver_or_enqueue_user_data (pwr, &sc, rres);
       if (pwr->n_readers_out_of_sync > 0)
       {
         /* Those readers catching up with TL but in sync with the proxy
@@ -2615,16 +2635,26 @@ static void malformed_packet_received
   DDS_WARNING ("%s\n", tmp);
 }
 
-static struct receiver_state *rst_cow_if_needed (int *rst_live, struct nn_rmsg *rmsg, struct receiver_state *rst)
+static struct receiver_state *rst_cow_if_needed (int *rst_live, struct receiver_state *rst_tmp, struct receiver_state *rst)
 {
   if (! *rst_live)
     return rst;
   else
   {
-    struct receiver_state *nrst = nn_rmsg_alloc (rmsg, sizeof (*nrst));
-    *nrst = *rst;
+    *rst_tmp = *rst;
     *rst_live = 0;
-    return nrst;
+    return rst_tmp;
+  }
+}
+
+static struct receiver_state *rst_make_live (int *rst_live, struct nn_rmsg *rmsg, struct receiver_state *rst)
+{
+  if (*rst_live)
+    return rst;
+  else
+  {
+    *rst_live = 1;
+    return nn_rmsg_receiver_state (rmsg, rst);
   }
 }
 
@@ -2646,17 +2676,19 @@ static int handle_submsg_sequence
   const char *state;
   SubmessageKind_t state_smkind;
   Header_t * hdr = (Header_t *) msg;
-  struct receiver_state *rst;
+  struct receiver_state rst_tmp, *rst;
   int rst_live, ts_for_latmeas;
   nn_ddsi_time_t timestamp;
   size_t submsg_size = 0;
   unsigned char * end = msg + len;
 
-  /* Receiver state is dynamically allocated with lifetime bound to
-     the message.  Updates cause a new copy to be created if the
-     current one is "live", i.e., possibly referenced by a
-     submessage (for now, only Data(Frag)). */
-  rst = nn_rmsg_alloc (rmsg, sizeof (*rst));
+  /* Receiver state is built on the stack and only gets a lifetime
+     bound to the message once it becomes "live", i.e., possibly
+     referenced by a submessage (for now, only Data(Frag)), in which
+     case it is usually shared with other messages from the same
+     source.  Updates of a live one are done on a new copy on the
+     stack. */
+  rst = &rst_tmp;
   memset (rst, 0, sizeof (*rst));
   rst->conn = conn;
   rst->src_guid_prefix = *src_prefix;
@@ -2763,7 +2795,7 @@ static int handle_submsg_sequence
         state = "parse:info_src";
         if (!valid_InfoSRC (&sm->infosrc, submsg_size, byteswap))
           goto malformed;
-        rst = rst_cow_if_needed (&rst_live, rmsg, rst);
+        rst = rst_cow_if_needed (&rst_live, &rst_tmp, rst);
         handle_InfoSRC (rst, &sm->infosrc);
         /* no effect on ts_for_latmeas */
         break;
@@ -2778,7 +2810,7 @@ static int handle_submsg_sequence
         state = "parse:info_dst";
         if (!valid_InfoDST (&sm->infodst, submsg_size, byteswap))
           goto malformed;
-        rst = rst_cow_if_needed (&rst_live, rmsg, rst);
+        rst = rst_cow_if_needed (&rst_live, &rst_tmp, rst);
         handle_InfoDST (rst, &sm->infodst, dst_prefix);
         /* no effect on ts_for_latmeas */
         break;
@@ -2809,12 +2841,12 @@ static int handle_submsg_sequence
           struct nn_rsample_info sampleinfo;
           unsigned char *datap;
           /* valid_DataFrag does not validate the payload */
+          rst = rst_make_live (&rst_live, rmsg, rst);
           if (!valid_DataFrag (rst, rmsg, &sm->datafrag, submsg_size, byteswap, &sampleinfo, &datap))
             goto malformed;
           sampleinfo.timestamp = timestamp;
           sampleinfo.reception_timestamp = tnowWC;
           handle_DataFrag (rst, tnowE, rmsg, &sm->datafrag, submsg_size, &sampleinfo, datap);
-          rst_live = 1;
           ts_for_latmeas = 0;
         }
         break;
@@ -2824,6 +2856,7 @@ static int handle_submsg_sequence
           struct nn_rsample_info sampleinfo;
           unsigned char *datap;
           /* valid_Data does not validate the payload */
+          rst = rst_make_live (&rst_live, rmsg, rst);
           if (!valid_Data (rst, rmsg, &sm->data, submsg_size, byteswap, &sampleinfo, &datap))
           {
             goto malformed;
@@ -2831,7 +2864,6 @@ static int handle_submsg_sequence
           sampleinfo.timestamp = timestamp;
           sampleinfo.reception_timestamp = tnowWC;
           handle_Data (rst, tnowE, rmsg, &sm->data, submsg_size, &sampleinfo, datap);
-          rst_live = 1;
           ts_for_latmeas = 0;
         }
         break;
@@ -2932,6 +2964,120 @@ malformed:
   return -1;
 }
 
+static void handle_rtps_message
+(
+  struct thread_state1 * const self,
+  ddsi_tran_conn_t conn,
+  const nn_guid_prefix_t * guidprefix,
+  struct nn_rmsg * rmsg,
+  size_t sz,
+  unsigned char * buff,
+  const nn_locator_t * srcloc
+)
+{
+  Header_t * hdr = (Header_t *) buff;
+  assert (vtime_asleep_p (self->vtime));
+
+  if (sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)buff != NN_PROTOCOLID_AS_UINT32)
+  {
+    /* discard packets that are really too small or don't have magic cookie */
+  }
+  else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+  {
+    if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+      DDS_TRACE("HDR(%x:%x:%x vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
+                PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
+    if (NN_PEDANTIC_P)
+      malformed_packet_received_nosubmsg (buff, (ssize_t) sz, "header", hdr->vendorid);
+  }
+  else
+  {
+    hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
+
+    if (dds_get_log_mask() & DDS_LC_TRACE)
+    {
+      char addrstr[DDSI_LOCSTRLEN];
+      ddsi_locator_to_string(addrstr, sizeof(addrstr), srcloc);
+      DDS_TRACE("HDR(%x:%x:%x vendor %d.%d) len %lu from %s\n",
+                PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
+    }
+
+    handle_submsg_sequence (conn, srcloc, self, now (), now_et (), &hdr->guid_prefix, guidprefix, buff, sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg);
+  }
+  thread_state_asleep (self);
+}
+
+static bool do_packet_batch
+(
+  struct thread_state1 *self,
+  ddsi_tran_conn_t conn,
+  const nn_guid_prefix_t * guidprefix,
+  struct nn_rbufpool *rbpool
+)
+{
+  /* Connectionless transports that can read multiple packets in one
+     call get a batch of receive buffers reserved in the rbufpool, those
+     that arrived are then turned into rmsgs one by one. This is also the
+     path for receiving packets coalesced by the kernel. */
+
+  const size_t maxsz = config.rmsg_chunk_size < 65536 ? config.rmsg_chunk_size : 65536;
+  struct ddsi_tran_rxbuf bufs[MAX_RECV_BATCH_SIZE];
+  unsigned char *ptrs[MAX_RECV_BATCH_SIZE];
+  uint32_t i, n;
+  ssize_t nrecv;
+
+  assert (!conn->m_stream);
+  assert (config.recv_batch_size <= MAX_RECV_BATCH_SIZE);
+  if ((n = nn_rbufpool_batch_reserve (rbpool, (uint32_t) config.recv_batch_size, (uint32_t) maxsz, ptrs)) == 0)
+  {
+    return false;
+  }
+  for (i = 0; i < n; i++)
+  {
+    bufs[i].buf = ptrs[i];
+    bufs[i].len = maxsz;
+  }
+
+  nrecv = ddsi_conn_read_batch (conn, bufs, n);
+  if (nrecv > 0 && !gv.deaf)
+  {
+    DDS_TRACE("recvbatch %d/%u\n", (int) nrecv, n);
+    for (i = 0; i < (uint32_t) nrecv; i++)
+    {
+      struct nn_rmsg *rmsg;
+      if (bufs[i].size == 0)
+        continue;
+      if ((rmsg = nn_rmsg_new_from_batch (rbpool, i, (uint32_t) bufs[i].size)) == NULL)
+      {
+        /* Out of memory: drop this one (it is counted in the pool) but
+           keep trying the rest, rbufs may have been freed in the
+           meantime; all slots are released with the batch */
+        DDS_TRACE("recvbatch: packet %u of %d dropped, no memory\n", i, (int) nrecv);
+        continue;
+      }
+      if (bufs[i].segsize == 0)
+        handle_rtps_message (self, conn, guidprefix, rmsg, bufs[i].size, NN_RMSG_PAYLOAD (rmsg), &bufs[i].srcloc);
+      else
+      {
+        /* Packets coalesced by the kernel: all offsets into the payload are
+           relative to the start of the rmsg, so the individual messages can
+           simply be processed in place, sharing the rmsg */
+        unsigned char * const buff = (unsigned char *) NN_RMSG_PAYLOAD (rmsg);
+        size_t off;
+        DDS_TRACE("recvgro %"PRIuSIZE"x%"PRIuSIZE"\n", (bufs[i].size + bufs[i].segsize - 1) / bufs[i].segsize, bufs[i].segsize);
+        for (off = 0; off < bufs[i].size; off += bufs[i].segsize)
+        {
+          const size_t sz = (bufs[i].size - off < bufs[i].segsize) ? bufs[i].size - off : bufs[i].segsize;
+          handle_rtps_message (self, conn, guidprefix, rmsg, sz, buff + off, &bufs[i].srcloc);
+        }
+      }
+      nn_rmsg_commit (rmsg);
+    }
+  }
+  nn_rbufpool_batch_release (rbpool);
+  return (nrecv > 0);
+}
+
 static bool do_packet
 (
   struct thread_state1 *self,
@@ -2946,12 +3092,16 @@ static bool do_packet
   const size_t ddsi_msg_len_size = 8;
   const size_t stream_hdr_size = RTPS_MESSAGE_HEADER_SIZE + ddsi_msg_len_size;
   ssize_t sz;
-  struct nn_rmsg * rmsg = nn_rmsg_new (rbpool);
+  struct nn_rmsg * rmsg;
   unsigned char * buff;
   size_t buff_len = maxsz;
   Header_t * hdr;
   nn_locator_t srcloc;
 
+  if ((config.recv_batch_size > 1 || config.recv_gro) && ddsi_conn_supports_read_batch (conn))
+    return do_packet_batch (self, conn, guidprefix, rbpool);
+
+  rmsg = nn_rmsg_new (rbpool);
   if (rmsg == NULL)
   {
     return false;
@@ -3022,35 +3172,7 @@ static bool do_packet
   if (sz > 0 && !gv.deaf)
   {
     nn_rmsg_setsize (rmsg, (uint32_t) sz);
-    assert (vtime_asleep_p (self->vtime));
-
-    if ((size_t)sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)buff != NN_PROTOCOLID_AS_UINT32)
-    {
-      /* discard packets that are really too small or don't have magic cookie */
-    }
-    else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
-    {
-      if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
-        DDS_TRACE("HDR(%x:%x:%x vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
-                  PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
-      if (NN_PEDANTIC_P)
-        malformed_packet_received_nosubmsg (buff, sz, "header", hdr->vendorid);
-    }
-    else
-    {
-      hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
-
-      if (dds_get_log_mask() & DDS_LC_TRACE)
-      {
-        char addrstr[DDSI_LOCSTRLEN];
-        ddsi_locator_to_string(addrstr, sizeof(addrstr), &srcloc);
-        DDS_TRACE("HDR(%x:%x:%x vendor %d.%d) len %lu from %s\n",
-                  PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
-      }
-
-      handle_submsg_sequence (conn, &srcloc, self, now (), now_et (), &hdr->guid_prefix, guidprefix, buff, (size_t) sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg);
-    }
-    thread_state_asleep (self);
+    handle_rtps_message (self, conn, guidprefix, rmsg, (size_t) sz, buff, &srcloc);
   }
   nn_rmsg_commit (rmsg);
   return (sz > 0);
@@ -3311,6 +3433,13 @@ void trigger_recv_threads (void)
     {
       case RTM_SINGLE: {
         char buf[DDSI_LOCSTRLEN];
+        if (gv.recv_threads[i].arg.u.single.ws)
+        {
+          /* shares its port with other sockets: a packet sent to it might end up elsewhere */
+          DDS_TRACE("trigger_recv_threads: %d single %p\n", i, (void *) gv.recv_threads[i].arg.u.single.ws);
+          os_sockWaitsetTrigger (gv.recv_threads[i].arg.u.single.ws);
+          break;
+        }
         char dummy = 0;
         const nn_locator_t *dst = gv.recv_threads[i].arg.u.single.loc;
         os_iovec_t iov;
@@ -3338,7 +3467,33 @@ uint32_t recv_thread (void *vrecv_thread_arg)
   nn_mtime_t next_thread_cputime = { 0 };
 
   nn_rbufpool_setowner (rbpool, os_threadIdSelf ());
-  if (waitset == NULL)
+  {
+    /* rtps_init waits for the outcome, and fails if there are no
+       buffers to receive into */
+    const int populated = (nn_rbufpool_populate (rbpool) < 0) ? -1 : 1;
+    os_mutexLock (&gv.lock);
+    recv_thread_arg->populated = populated;
+    os_condBroadcast (&gv.recv_threads_cond);
+    os_mutexUnlock (&gv.lock);
+    if (populated < 0)
+      return 0;
+  }
+  if (waitset == NULL && recv_thread_arg->u.single.ws != NULL)
+  {
+    /* one of several sockets bound to the same port, waitset only contains the socket itself */
+    while (gv.rtps_keepgoing)
+    {
+      os_sockWaitsetCtx ctx;
+      LOG_THREAD_CPUTIME (next_thread_cputime);
+      if ((ctx = os_sockWaitsetWait (recv_thread_arg->u.single.ws)) != NULL)
+      {
+        ddsi_tran_conn_t conn;
+        while (os_sockWaitsetNextEvent (ctx, &conn) >= 0)
+          (void) do_packet (self, conn, NULL, rbpool);
+      }
+    }
+  }
+  else if (waitset == NULL)
   {
     while (gv.rtps_keepgoing)
     {
@@ -3365,6 +3520,12 @@ uint32_t recv_thread (void *vrecv_thread_arg)
       if ((rc = recv_thread_waitset_add_conn (waitset, gv.data_conn_uc)) < 0)
         DDS_FATAL("recv_thread: failed to add data_conn_uc to waitset\n");
       num_fixed_uc += (unsigned)rc;
+      if ((rc = recv_thread_waitset_add_conn (waitset, gv.disc_conn_shm)) < 0)
+        DDS_FATAL("recv_thread: failed to add disc_conn_shm to waitset\n");
+      num_fixed_uc += (unsigned)rc;
+      if ((rc = recv_thread_waitset_add_conn (waitset, gv.data_conn_shm)) < 0)
+        DDS_FATAL("recv_thread: failed to add data_conn_shm to waitset\n");
+      num_fixed_uc += (unsigned)rc;
       num_fixed += num_fixed_uc;
       if ((rc = recv_thread_waitset_add_conn (waitset, gv.disc_conn_mc)) < 0)
         DDS_FATAL("recv_thread: failed to add disc_conn_mc to waitset\n");
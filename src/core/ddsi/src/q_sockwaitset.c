@@ -25,14 +25,20 @@
 #define MODE_KQUEUE 1
 #define MODE_SELECT 2
 #define MODE_WFMEVS 3
+#define MODE_EPOLL 4
 
+/* MODE_SEL may be defined on the command line to override the default */
+#ifndef MODE_SEL
 #if defined __APPLE__
 #define MODE_SEL MODE_KQUEUE
 #elif defined WINCE
 #define MODE_SEL MODE_WFMEVS
+#elif defined __linux
+#define MODE_SEL MODE_EPOLL
 #else
 #define MODE_SEL MODE_SELECT
 #endif
+#endif
 
 #if MODE_SEL == MODE_KQUEUE
 
@@ -280,6 +286,306 @@ int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
   return -1;
 }
 
+#elif MODE_SEL == MODE_EPOLL
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/* Connections live in slots that don't move, so that the epoll data can
+   refer to them. A slot is identified by its index and a generation
+   number, so that events for a slot that has been freed (and possibly
+   reused) while the thread was on its way out of epoll_wait can be
+   recognized and ignored.
+
+   The index returned by os_sockWaitsetNextEvent is the position in the
+   order in which the connections were added, with removal moving the
+   last one into the vacated position, exactly as in the select-based
+   implementation. */
+
+#define EPOLL_TRIGGER_DATA UINT64_MAX
+
+struct os_sockWaitsetCtx
+{
+  struct epoll_event *evs;
+  ddsi_tran_conn_t *conns;   /* connections for evs[0 .. nevs-1] */
+  int *poss;                 /* positions for evs[0 .. nevs-1] */
+  uint32_t nevs;
+  uint32_t evs_sz;
+  uint32_t index;            /* cursor for enumerating */
+};
+
+struct slot {
+  ddsi_tran_conn_t conn;     /* NULL if free */
+  int fd;
+  uint32_t gen;
+  uint32_t pos;              /* index in order */
+};
+
+struct os_sockWaitset
+{
+  int epfd;
+  int evfd;                      /* eventfd used for triggering */
+  os_mutex lock;                 /* for add/delete */
+  uint32_t nslots;
+  struct slot *slots;
+  uint32_t n;                    /* number of connections */
+  uint32_t *order;               /* slot index for each position, order[0 .. n-1] */
+  struct os_sockWaitsetCtx ctx;  /* set of descriptors being handled  */
+};
+
+static uint64_t slot_data (const os_sockWaitset ws, uint32_t idx)
+{
+  return ((uint64_t) ws->slots[idx].gen << 32) | idx;
+}
+
+os_sockWaitset os_sockWaitsetNew (void)
+{
+  struct epoll_event ev;
+  os_sockWaitset ws;
+  uint32_t i;
+
+  ws = os_malloc (sizeof (*ws));
+  ws->nslots = WAITSET_DELTA;
+  ws->slots = os_malloc (ws->nslots * sizeof (*ws->slots));
+  ws->order = os_malloc (ws->nslots * sizeof (*ws->order));
+  for (i = 0; i < ws->nslots; i++)
+  {
+    ws->slots[i].conn = NULL;
+    ws->slots[i].gen = 0;
+  }
+  ws->n = 0;
+  ws->ctx.nevs = 0;
+  ws->ctx.index = 0;
+  ws->ctx.evs_sz = ws->nslots + 1;
+  ws->ctx.evs = os_malloc (ws->ctx.evs_sz * sizeof (*ws->ctx.evs));
+  ws->ctx.conns = os_malloc (ws->ctx.evs_sz * sizeof (*ws->ctx.conns));
+  ws->ctx.poss = os_malloc (ws->ctx.evs_sz * sizeof (*ws->ctx.poss));
+  if ((ws->epfd = epoll_create1 (EPOLL_CLOEXEC)) == -1)
+    goto fail_epoll;
+  if ((ws->evfd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1)
+    goto fail_eventfd;
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ev.data.u64 = EPOLL_TRIGGER_DATA;
+  if (epoll_ctl (ws->epfd, EPOLL_CTL_ADD, ws->evfd, &ev) == -1)
+    goto fail_add_trigger;
+  os_mutexInit (&ws->lock);
+  return ws;
+
+fail_add_trigger:
+  close (ws->evfd);
+fail_eventfd:
+  close (ws->epfd);
+fail_epoll:
+  DDS_ERROR("os_sockWaitsetNew: failed to create epoll set, errno = %d\n", os_getErrno ());
+  os_free (ws->ctx.poss);
+  os_free (ws->ctx.conns);
+  os_free (ws->ctx.evs);
+  os_free (ws->order);
+  os_free (ws->slots);
+  os_free (ws);
+  return NULL;
+}
+
+void os_sockWaitsetFree (os_sockWaitset ws)
+{
+  os_mutexDestroy (&ws->lock);
+  close (ws->evfd);
+  close (ws->epfd);
+  os_free (ws->ctx.poss);
+  os_free (ws->ctx.conns);
+  os_free (ws->ctx.evs);
+  os_free (ws->order);
+  os_free (ws->slots);
+  os_free (ws);
+}
+
+void os_sockWaitsetTrigger (os_sockWaitset ws)
+{
+  const uint64_t one = 1;
+  if (write (ws->evfd, &one, sizeof (one)) != (ssize_t) sizeof (one))
+  {
+    const int err = os_getErrno ();
+    if (err != EAGAIN) /* counter saturated: it is triggered anyway */
+      DDS_WARNING("os_sockWaitsetTrigger: write failed on trigger eventfd, errno = %d\n", err);
+  }
+}
+
+int os_sockWaitsetAdd (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  const int fd = ddsi_conn_handle (conn);
+  struct epoll_event ev;
+  uint32_t i, idx;
+  int ret;
+
+  assert (fd >= 0);
+  os_mutexLock (&ws->lock);
+  for (i = 0; i < ws->n; i++)
+  {
+    if (ws->slots[ws->order[i]].conn == conn)
+      break;
+  }
+  if (i < ws->n)
+    ret = 0;
+  else
+  {
+    if (ws->n == ws->nslots)
+    {
+      const uint32_t newsz = ws->nslots + WAITSET_DELTA;
+      ws->slots = os_realloc (ws->slots, newsz * sizeof (*ws->slots));
+      ws->order = os_realloc (ws->order, newsz * sizeof (*ws->order));
+      for (i = ws->nslots; i < newsz; i++)
+      {
+        ws->slots[i].conn = NULL;
+        ws->slots[i].gen = 0;
+      }
+      ws->nslots = newsz;
+    }
+    for (idx = 0; ws->slots[idx].conn != NULL; idx++)
+      assert (idx + 1 < ws->nslots);
+    ws->slots[idx].gen++;
+    memset (&ev, 0, sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = slot_data (ws, idx);
+    if (epoll_ctl (ws->epfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+      DDS_WARNING("os_sockWaitsetAdd: epoll_ctl failed for socket %d, errno = %d\n", fd, os_getErrno ());
+      ret = -1;
+    }
+    else
+    {
+      ws->slots[idx].conn = conn;
+      ws->slots[idx].fd = fd;
+      ws->slots[idx].pos = ws->n;
+      ws->order[ws->n++] = idx;
+      ret = 1;
+    }
+  }
+  os_mutexUnlock (&ws->lock);
+  return ret;
+}
+
+static void remove_slot_locked (os_sockWaitset ws, uint32_t idx)
+{
+  /* The socket may have been closed already, in which case the kernel has
+     removed it from the epoll set and the file descriptor may even have
+     been reused for another socket in this set */
+  struct slot * const s = &ws->slots[idx];
+  uint32_t i;
+  for (i = 0; i < ws->n; i++)
+  {
+    if (ws->order[i] != idx && ws->slots[ws->order[i]].fd == s->fd)
+      break;
+  }
+  if (i == ws->n)
+    (void) epoll_ctl (ws->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+  s->conn = NULL;
+  s->gen++;
+}
+
+void os_sockWaitsetPurge (os_sockWaitset ws, unsigned index)
+{
+  os_mutexLock (&ws->lock);
+  while (ws->n > index)
+  {
+    const uint32_t idx = ws->order[ws->n - 1];
+    remove_slot_locked (ws, idx);
+    ws->n--;
+  }
+  os_mutexUnlock (&ws->lock);
+}
+
+void os_sockWaitsetRemove (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  uint32_t i;
+  os_mutexLock (&ws->lock);
+  for (i = 0; i < ws->n; i++)
+  {
+    if (ws->slots[ws->order[i]].conn == conn)
+      break;
+  }
+  if (i < ws->n)
+  {
+    remove_slot_locked (ws, ws->order[i]);
+    if (i != --ws->n)
+    {
+      ws->order[i] = ws->order[ws->n];
+      ws->slots[ws->order[i]].pos = i;
+    }
+  }
+  os_mutexUnlock (&ws->lock);
+}
+
+os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
+{
+  /* if the array of events is smaller than the number of file descriptors in the
+     epoll set, things will still work fine, as the kernel will just return what
+     can be stored, and the set will be grown on the next call */
+  os_sockWaitsetCtx ctx = &ws->ctx;
+  uint32_t i, n;
+  int nevs;
+
+  os_mutexLock (&ws->lock);
+  if (ctx->evs_sz < ws->nslots + 1)
+  {
+    ctx->evs_sz = ws->nslots + 1;
+    ctx->evs = os_realloc (ctx->evs, ctx->evs_sz * sizeof (*ctx->evs));
+    ctx->conns = os_realloc (ctx->conns, ctx->evs_sz * sizeof (*ctx->conns));
+    ctx->poss = os_realloc (ctx->poss, ctx->evs_sz * sizeof (*ctx->poss));
+  }
+  os_mutexUnlock (&ws->lock);
+
+  do {
+    nevs = epoll_wait (ws->epfd, ctx->evs, (int) ctx->evs_sz, -1);
+  } while (nevs == -1 && os_getErrno () == EINTR);
+  if (nevs <= 0)
+  {
+    if (nevs < 0)
+      DDS_WARNING("os_sockWaitsetWait: epoll_wait failed, errno = %d\n", os_getErrno ());
+    return NULL;
+  }
+
+  /* Map the events to connections & their current positions, dropping those
+     for connections that have been removed in the meantime */
+  os_mutexLock (&ws->lock);
+  for (i = 0, n = 0; i < (uint32_t) nevs; i++)
+  {
+    const uint64_t data = ctx->evs[i].data.u64;
+    if (data == EPOLL_TRIGGER_DATA)
+    {
+      uint64_t cnt;
+      if (read (ws->evfd, &cnt, sizeof (cnt)) != (ssize_t) sizeof (cnt) && os_getErrno () != EAGAIN)
+        DDS_WARNING("os_sockWaitsetWait: read failed on trigger eventfd, errno = %d\n", os_getErrno ());
+    }
+    else
+    {
+      const uint32_t idx = (uint32_t) data;
+      if (idx < ws->nslots && ws->slots[idx].conn != NULL && slot_data (ws, idx) == data)
+      {
+        ctx->conns[n] = ws->slots[idx].conn;
+        ctx->poss[n] = (int) ws->slots[idx].pos;
+        n++;
+      }
+    }
+  }
+  os_mutexUnlock (&ws->lock);
+  ctx->nevs = n;
+  ctx->index = 0;
+  return ctx;
+}
+
+int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
+{
+  if (ctx->index < ctx->nevs)
+  {
+    const uint32_t idx = ctx->index++;
+    *conn = ctx->conns[idx];
+    return ctx->poss[idx];
+  }
+  return -1;
+}
+
 #elif MODE_SEL == MODE_WFMEVS
 
 struct os_sockWaitsetCtx
@@ -266,8 +266,11 @@ struct thread_state1 *create_thread (_In_z_ const char *name, _In_ uint32_t (*f)
     tattr.schedClass = tprops->sched_class; /* explicit default value in the enum */
     if (!tprops->stack_size.isdefault)
       tattr.stackSize = tprops->stack_size.value;
+    tattr.cpuSet = tprops->cpu_set;
+    tattr.numaPolicy = tprops->numa_policy;
+    tattr.numaNodes = tprops->numa_nodes;
   }
-  DDS_TRACE("create_thread: %s: class %d priority %d stack %u\n", name, (int) tattr.schedClass, tattr.schedPriority, tattr.stackSize);
+  DDS_TRACE("create_thread: %s: class %d priority %d stack %u affinity %s numa %d nodes %"PRIx64"\n", name, (int) tattr.schedClass, tattr.schedPriority, tattr.stackSize, os_cpuSetIsEmpty (&tattr.cpuSet) ? "any" : "set", (int) tattr.numaPolicy, tattr.numaNodes);
 
   if (os_threadCreate (&tid, name, &tattr, (os_threadRoutine)&create_thread_wrapper, ctxt) != os_resultSuccess)
   {
@@ -11,11 +11,12 @@
  */
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "os/os.h"
 
 #include "util/ut_avl.h"
-#include "util/ut_fibheap.h"
+#include "util/ut_twheel.h"
 
 #include "ddsi/q_time.h"
 #include "ddsi/q_log.h"
@@ -68,7 +69,7 @@ enum xeventkind
 
 struct xevent
 {
-  ut_fibheapNode_t heapnode;
+  ut_twheelNode_t wheelnode;
   struct xeventq *evq;
   nn_mtime_t tsched;
   enum xeventkind kind;
@@ -141,7 +142,7 @@ struct xevent_nt
 };
 
 struct xeventq {
-  ut_fibheap_t xevents;
+  ut_twheel_t xevents;
   ut_avlTree_t msg_xevents;
   struct xevent_nt *non_timed_xmit_list_oldest;
   struct xevent_nt *non_timed_xmit_list_newest; /* undefined if ..._oldest == NULL */
@@ -154,24 +155,22 @@ struct xeventq {
   os_mutex lock;
   os_cond cond;
   ddsi_tran_conn_t tev_conn;
-  uint32_t auxiliary_bandwidth_limit;
+  struct ddsi_pacer *auxiliary_pacer;
+  struct xeventq_stats stats; /* protected by lock */
 };
 
 static uint32_t xevent_thread (struct xeventq *xevq);
 static nn_mtime_t earliest_in_xeventq (struct xeventq *evq);
 static int msg_xevents_cmp (const void *a, const void *b);
-static int compare_xevent_tsched (const void *va, const void *vb);
 
 static const ut_avlTreedef_t msg_xevents_treedef = UT_AVL_TREEDEF_INITIALIZER_INDKEY (offsetof (struct xevent_nt, u.msg_rexmit.msg_avlnode), offsetof (struct xevent_nt, u.msg_rexmit.msg), msg_xevents_cmp, 0);
 
-static const ut_fibheapDef_t evq_xevents_fhdef = UT_FIBHEAPDEF_INITIALIZER(offsetof (struct xevent, heapnode), compare_xevent_tsched);
-
-static int compare_xevent_tsched (const void *va, const void *vb)
-{
-  const struct xevent *a = va;
-  const struct xevent *b = vb;
-  return (a->tsched.v == b->tsched.v) ? 0 : (a->tsched.v < b->tsched.v) ? -1 : 1;
-}
+/* Timed events are kept in a timing wheel, because heartbeats and
+   acknacks get rescheduled all the time and that is O(1) in a wheel.
+   The minimum is exact regardless of the tick, but the events within
+   a tick need to be scanned to find it; 2^10ns keeps that to a few
+   even with 100k events (see xtests/twheel_bench). */
+static const ut_twheelDef_t evq_xevents_twdef = UT_TWHEELDEF_INITIALIZER(offsetof (struct xevent, wheelnode), offsetof (struct xevent, tsched.v), 10);
 
 static void update_rexmit_counts (struct xeventq *evq, struct xevent_nt *ev)
 {
@@ -349,12 +348,12 @@ void delete_xevent (struct xevent *ev)
   if (ev->tsched.v != T_NEVER)
   {
     ev->tsched.v = TSCHED_DELETE;
-    ut_fibheapDecreaseKey (&evq_xevents_fhdef, &evq->xevents, ev);
+    ut_twheelUpdateKey (&evq_xevents_twdef, &evq->xevents, ev);
   }
   else
   {
     ev->tsched.v = TSCHED_DELETE;
-    ut_fibheapInsert (&evq_xevents_fhdef, &evq->xevents, ev);
+    ut_twheelInsert (&evq_xevents_twdef, &evq->xevents, ev);
   }
   /* TSCHED_DELETE is absolute minimum time, so chances are we need to
      wake up the thread.  The superfluous signal is harmless. */
@@ -382,12 +381,12 @@ int resched_xevent_if_earlier (struct xevent *ev, nn_mtime_t tsched)
     if (ev->tsched.v != T_NEVER)
     {
       ev->tsched = tsched;
-      ut_fibheapDecreaseKey (&evq_xevents_fhdef, &evq->xevents, ev);
+      ut_twheelUpdateKey (&evq_xevents_twdef, &evq->xevents, ev);
     }
     else
     {
       ev->tsched = tsched;
-      ut_fibheapInsert (&evq_xevents_fhdef, &evq->xevents, ev);
+      ut_twheelInsert (&evq_xevents_twdef, &evq->xevents, ev);
     }
     is_resched = 1;
     if (tsched.v < tbefore.v)
@@ -433,7 +432,7 @@ static nn_mtime_t earliest_in_xeventq (struct xeventq *evq)
 {
   struct xevent *min;
   ASSERT_MUTEX_HELD (&evq->lock);
-  if ((min = ut_fibheapMin (&evq_xevents_fhdef, &evq->xevents)) != NULL)
+  if ((min = ut_twheelMin (&evq_xevents_twdef, &evq->xevents)) != NULL)
     return min->tsched;
   else
   {
@@ -451,7 +450,7 @@ static void qxev_insert (struct xevent *ev)
   if (ev->tsched.v != T_NEVER)
   {
     nn_mtime_t tbefore = earliest_in_xeventq (evq);
-    ut_fibheapInsert (&evq_xevents_fhdef, &evq->xevents, ev);
+    ut_twheelInsert (&evq_xevents_twdef, &evq->xevents, ev);
     if (ev->tsched.v < tbefore.v)
       os_condSignal (&evq->cond);
   }
@@ -476,14 +475,14 @@ struct xeventq * xeventq_new
   ddsi_tran_conn_t conn,
   size_t max_queued_rexmit_bytes,
   size_t max_queued_rexmit_msgs,
-  uint32_t auxiliary_bandwidth_limit
+  struct ddsi_pacer *auxiliary_pacer
 )
 {
   struct xeventq *evq = os_malloc (sizeof (*evq));
   /* limit to 2GB to prevent overflow (4GB - 64kB should be ok, too) */
   if (max_queued_rexmit_bytes > 2147483648u)
     max_queued_rexmit_bytes = 2147483648u;
-  ut_fibheapInit (&evq_xevents_fhdef, &evq->xevents);
+  ut_twheelInit (&evq_xevents_twdef, &evq->xevents);
   ut_avlInit (&msg_xevents_treedef, &evq->msg_xevents);
   evq->non_timed_xmit_list_oldest = NULL;
   evq->non_timed_xmit_list_newest = NULL;
@@ -491,10 +490,11 @@ struct xeventq * xeventq_new
   evq->ts = NULL;
   evq->max_queued_rexmit_bytes = max_queued_rexmit_bytes;
   evq->max_queued_rexmit_msgs = max_queued_rexmit_msgs;
-  evq->auxiliary_bandwidth_limit = auxiliary_bandwidth_limit;
+  evq->auxiliary_pacer = auxiliary_pacer;
   evq->queued_rexmit_bytes = 0;
   evq->queued_rexmit_msgs = 0;
   evq->tev_conn = conn;
+  memset (&evq->stats, 0, sizeof (evq->stats));
   os_mutexInit (&evq->lock);
   os_condInit (&evq->cond, &evq->lock);
   return evq;
@@ -533,11 +533,27 @@ void xeventq_stop (struct xeventq *evq)
   evq->ts = NULL;
 }
 
+struct xeventq *xeventq_for_guid (const nn_guid_t *guid)
+{
+  /* All events of a (proxy) writer must go through the same queue to
+     keep the retransmits in order, beyond that any spreading will do */
+  return gv.xevent_shards[guid_shard (guid, gv.n_xevent_shards)];
+}
+
+void xeventq_stats (struct xeventq *evq, struct xeventq_stats *st)
+{
+  os_mutexLock (&evq->lock);
+  *st = evq->stats;
+  st->queued_rexmit_bytes = evq->queued_rexmit_bytes;
+  st->queued_rexmit_msgs = evq->queued_rexmit_msgs;
+  os_mutexUnlock (&evq->lock);
+}
+
 void xeventq_free (struct xeventq *evq)
 {
   struct xevent *ev;
   assert (evq->ts == NULL);
-  while ((ev = ut_fibheapExtractMin (&evq_xevents_fhdef, &evq->xevents)) != NULL)
+  while ((ev = ut_twheelExtractMin (&evq_xevents_twdef, &evq->xevents)) != NULL)
   {
     if (ev->tsched.v == TSCHED_DELETE || ev->kind != XEVK_CALLBACK)
       free_xevent (evq, ev);
@@ -760,23 +776,21 @@ static void add_AckNack (struct nn_xmsg *msg, struct proxy_writer *pwr, struct p
      that the defragmenter knows about. Then note the sequence number
      & add a NACKFRAG for that sample */
   nackfrag_numbits = -1;
-  for (i = 0; i < numbits && nackfrag_numbits < 0; i++)
+  for (i = nn_bitset_find_set (numbits, an->readerSNState.bits, 0); i < numbits; i = nn_bitset_find_set (numbits, an->readerSNState.bits, i + 1))
   {
     uint32_t fragnum;
     nackfrag_seq = base + i;
-    if (!nn_bitset_isset (numbits, an->readerSNState.bits, i))
-      continue;
     if (nackfrag_seq == pwr->last_seq)
       fragnum = pwr->last_fragnum;
     else
       fragnum = UINT32_MAX;
-    nackfrag_numbits = nn_defrag_nackmap (pwr->defrag, nackfrag_seq, fragnum, &nackfrag.set, max_numbits);
+    if ((nackfrag_numbits = nn_defrag_nackmap (pwr->defrag, nackfrag_seq, fragnum, &nackfrag.set, max_numbits)) >= 0)
+      break;
   }
   if (nackfrag_numbits >= 0) {
     /* Cut the NACK short, NACKFRAG will be added after the NACK's is
        properly formatted */
-    assert (i > 0);
-    an->readerSNState.numbits = numbits = i - 1;
+    an->readerSNState.numbits = numbits = i;
   }
 
   /* Let caller know whether it is a nack, and, in steady state, set
@@ -1320,13 +1334,19 @@ static void handle_xevents (struct thread_state1 *self, struct xeventq *xevq, st
   {
     while (earliest_in_xeventq(xevq).v <= tnow.v)
     {
-      struct xevent *xev = ut_fibheapExtractMin (&evq_xevents_fhdef, &xevq->xevents);
+      struct xevent *xev = ut_twheelExtractMin (&evq_xevents_twdef, &xevq->xevents);
       if (xev->tsched.v == TSCHED_DELETE)
       {
         free_xevent (xevq, xev);
       }
       else
       {
+        /* time 0 means as soon as possible, that's not being late */
+        const int64_t lag = (xev->tsched.v > 0) ? tnow.v - xev->tsched.v : 0;
+        xevq->stats.n_timed++;
+        xevq->stats.lag_sum += lag;
+        if (lag > xevq->stats.lag_max)
+          xevq->stats.lag_max = lag;
         /* event rescheduling functions look at xev->tsched to
            determine whether it is currently on the heap or not (i.e.,
            scheduled or not), so set to TSCHED_NEVER to indicate it
@@ -1343,6 +1363,7 @@ static void handle_xevents (struct thread_state1 *self, struct xeventq *xevq, st
     if (!non_timed_xmit_list_is_empty (xevq))
     {
       struct xevent_nt *xev = getnext_from_non_timed_xmit_list (xevq);
+      xevq->stats.n_nontimed++;
       handle_nontimed_xevent (self, xev, xp);
       tnow = now_mt ();
     }
@@ -1361,7 +1382,7 @@ static uint32_t xevent_thread (struct xeventq * xevq)
   struct nn_xpack *xp;
   nn_mtime_t next_thread_cputime = { 0 };
 
-  xp = nn_xpack_new (xevq->tev_conn, xevq->auxiliary_bandwidth_limit, config.xpack_send_async);
+  xp = nn_xpack_new (xevq->tev_conn, xevq->auxiliary_pacer, config.xpack_send_async);
 
   os_mutexLock (&xevq->lock);
   while (!xevq->terminate)
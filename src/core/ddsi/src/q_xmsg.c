@@ -40,6 +40,7 @@
 #include "ddsi/q_ephash.h"
 #include "ddsi/q_freelist.h"
 #include "ddsi/ddsi_serdata_default.h"
+#include "ddsi/ddsi_pacer.h"
 
 #define NN_XMSG_MAX_ALIGN 8
 #define NN_XMSG_CHUNK_SIZE 128
@@ -129,16 +130,6 @@ struct nn_xmsg_chain {
   struct nn_xmsg_chain_elem *latest;
 };
 
-#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
-#define NN_BW_UNLIMITED (0)
-
-struct nn_bw_limiter {
-    uint32_t       bandwidth;   /*Config in bytes/s   (0 = UNLIMITED)*/
-    int64_t        balance;
-    nn_mtime_t      last_update;
-};
-#endif
-
 ///////////////////////////
 typedef struct os_sem {
   os_mutex mtx;
@@ -180,6 +171,32 @@ static os_result os_sem_wait (os_sem_t *sem)
 }
 ///////////////////////////
 
+#define NN_XPACK_GSO_MAX_SEGMENTS 64
+#define NN_XPACK_GSO_MAX_BYTES 65507 /* max UDP payload over IPv4 */
+#define NN_XPACK_GSO_MAX_IOVECS 1024
+
+/* Run of packets for segmentation offload, see nn_xpack_gso_mayadd */
+struct nn_xpack_gso {
+  size_t nseg;
+  size_t segsize;
+  size_t bytes;
+  uint32_t call_flags;
+  Header_t hdr;
+  enum nn_xmsg_dstmode dstmode;
+  union
+  {
+    nn_locator_t loc;
+    struct
+    {
+      struct addrset *as;
+      struct addrset *as_group;
+    } all;
+  } dstaddr;
+  struct nn_xmsg_chain msgs;
+  size_t niov;
+  os_iovec_t iov[NN_XPACK_GSO_MAX_IOVECS];
+};
+
 struct nn_xpack
 {
   struct nn_xpack *sendq_next;
@@ -192,7 +209,9 @@ struct nn_xpack
   unsigned packetid;
   os_atomic_uint32_t calls;
   uint32_t call_flags;
+  uint64_t syscalls_saved; /* by sending to multiple destinations/packets at once */
   ddsi_tran_conn_t conn;
+  struct nn_xpack_gso *gso; /* non-NULL iff using segmentation offload */
   os_sem_t sem;
   size_t niov;
   os_iovec_t iov[NN_XMSG_MAX_MESSAGE_IOVECS];
@@ -211,7 +230,8 @@ struct nn_xpack
   struct nn_xmsg_chain included_msgs;
 
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
-  struct nn_bw_limiter limiter;
+  struct ddsi_pacer *pacer; /* shared token bucket, NULL if unlimited */
+  struct nn_xpack_sendq *paced_sendq; /* if the thread has to wait, else NULL */
 #endif
 
 #ifdef DDSI_INCLUDE_NETWORK_PARTITIONS
@@ -1149,72 +1169,18 @@ static void nn_xmsg_chain_add (struct nn_xmsg_chain *chain, struct nn_xmsg *m)
   chain->latest = &m->link;
 }
 
-#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
-/* BW_LIMITER ----------------------------------------------------------
-
-   Helper for XPACKS, that contain the configuration and state to handle Bandwidth limitation.*/
-
-/* To be called after Xpack sends out a packet.
- * Keeps a balance of real data vs. allowed data according to the bandwidth limit.
- * If data is send too fast, a sleep is inserted to get the used bandwidth at the configured rate.
- */
-
-#define NN_BW_LIMIT_MAX_BUFFER (-30 * T_MILLISECOND)
-#define NN_BW_LIMIT_MIN_SLEEP (2 * T_MILLISECOND)
-static void nn_bw_limit_sleep_if_needed(struct nn_bw_limiter* this, ssize_t size)
-{
-  if ( this->bandwidth > 0 ) {
-    nn_mtime_t tnow = now_mt();
-    int64_t actual_interval;
-    int64_t target_interval;
-
-    /* calculate intervals */
-    actual_interval = tnow.v - this->last_update.v;
-    this->last_update = tnow;
-
-    target_interval = T_SECOND*size/this->bandwidth;
-
-    this->balance += (target_interval - actual_interval);
-
-
-    DDS_TRACE(" <limiter(us):%"PRId64"",(target_interval - actual_interval)/1000);
-
-    if ( this->balance < NN_BW_LIMIT_MAX_BUFFER )
-    {
-      /* We're below the bandwidth limit, do not further accumulate  */
-      this->balance = NN_BW_LIMIT_MAX_BUFFER;
-      DDS_TRACE(":%"PRId64":max",this->balance/1000);
-    }
-    else if ( this->balance > NN_BW_LIMIT_MIN_SLEEP )
-    {
-      /* We're over the bandwidth limit far enough, to warrent a sleep. */
-      os_time delay;
-      DDS_TRACE(":%"PRId64":sleep",this->balance/1000);
-      delay.tv_sec = (int32_t) (this->balance / T_SECOND);
-      delay.tv_nsec = (int32_t) (this->balance % T_SECOND);
-      thread_state_blocked (lookup_thread_state ());
-      os_nanoSleep (delay);
-      thread_state_unblocked (lookup_thread_state ());
-    }
-    else
-    {
-      DDS_TRACE(":%"PRId64"",this->balance/1000);
-    }
-    DDS_TRACE(">");
-  }
-}
-
-
-static void nn_bw_limit_init (struct nn_bw_limiter *limiter, uint32_t bandwidth_limit)
+static void nn_xmsg_chain_move (struct nn_xmsg_chain *dst, struct nn_xmsg_chain *src)
 {
-  limiter->bandwidth = bandwidth_limit;
-  limiter->balance = 0;
-  if (bandwidth_limit)
-    limiter->last_update = now_mt ();
-  else
-    limiter->last_update.v = 0;
+  /* Prepends all of src to dst, leaving src empty */
+  struct nn_xmsg_chain_elem *ce;
+  if (src->latest == NULL)
+    return;
+  for (ce = src->latest; ce->older; ce = ce->older)
+    ;
+  ce->older = dst->latest;
+  dst->latest = src->latest;
+  src->latest = NULL;
 }
-#endif /* DDSI_INCLUDE_BANDWIDTH_LIMITING */
 
 /* XPACK ---------------------------------------------------------------
 
@@ -1222,6 +1188,16 @@ static void nn_bw_limit_init (struct nn_bw_limiter *limiter, uint32_t bandwidth_
    The xpack is sent to the union of all address sets provided in the
    message added to the xpack.  */
 
+static bool nn_xpack_is_paced (const struct nn_xpack *xp)
+{
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  return xp->pacer != NULL;
+#else
+  (void) xp;
+  return false;
+#endif
+}
+
 static void nn_xpack_reinit (struct nn_xpack *xp)
 {
   xp->dstmode = NN_XMSG_DST_UNSET;
@@ -1236,17 +1212,41 @@ static void nn_xpack_reinit (struct nn_xpack *xp)
   xp->packetid++;
 }
 
-struct nn_xpack * nn_xpack_new (ddsi_tran_conn_t conn, uint32_t bw_limit, bool async_mode)
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+static struct nn_xpack_sendq *nn_xpack_sendq_for_pacer (const struct ddsi_pacer *pacer);
+#endif
+
+struct nn_xpack * nn_xpack_new (ddsi_tran_conn_t conn, struct ddsi_pacer *pacer, bool async_mode)
 {
   struct nn_xpack *xp;
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  struct nn_xpack_sendq *paced_sendq = NULL;
+
+  /* Without departure times in the kernel, paced packets have to wait
+     for their turn, and that is better done by the send thread of the
+     token bucket than by the writer, the event thread or a send thread
+     shared with other traffic */
+  if (pacer && !ddsi_conn_supports_write_txtime (conn))
+  {
+    paced_sendq = nn_xpack_sendq_for_pacer (pacer);
+    assert (paced_sendq != NULL);
+    async_mode = true;
+  }
+#else
+  (void) pacer;
+#endif
 
-  /* Disallow setting async_mode if not configured to enable async mode: this way we
-     can avoid starting the async send thread altogether */
-  assert (!async_mode || config.xpack_send_async);
+  /* Disallow setting async_mode if the send threads haven't been
+     started: this way we can avoid starting them altogether */
+  assert (!async_mode || gv.n_sendqs > 0);
 
   xp = os_malloc (sizeof (*xp));
   memset (xp, 0, sizeof (*xp));
   xp->async_mode = async_mode;
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  xp->pacer = pacer;
+  xp->paced_sendq = paced_sendq;
+#endif
 
   /* Fixed header fields, initialized just once */
   xp->hdr.protocol.id[0] = 'R';
@@ -1266,6 +1266,14 @@ struct nn_xpack * nn_xpack_new (ddsi_tran_conn_t conn, uint32_t bw_limit, bool a
   xp->conn = conn;
   nn_xpack_reinit (xp);
 
+  if (config.xpack_send_gso && !async_mode && !nn_xpack_is_paced (xp) && !conn->m_stream && ddsi_conn_supports_write_gso (conn))
+  {
+    xp->gso = os_malloc (sizeof (*xp->gso));
+    xp->gso->nseg = 0;
+    xp->gso->niov = 0;
+    xp->gso->msgs.latest = NULL;
+  }
+
   if (gv.thread_pool)
     os_sem_init (&xp->sem, 0);
 
@@ -1278,11 +1286,6 @@ struct nn_xpack * nn_xpack_new (ddsi_tran_conn_t conn, uint32_t bw_limit, bool a
     xp->SecurityHeader.smhdr.octetsToNextHeader = 4;
     xp->SecurityHeader.id = PTINFO_ID_ENCRYPT;
   }
-#endif
-#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
-  nn_bw_limit_init (&xp->limiter, bw_limit);
-#else
-  (void) bw_limit;
 #endif
   return xp;
 }
@@ -1291,6 +1294,11 @@ void nn_xpack_free (struct nn_xpack *xp)
 {
   assert (xp->niov == 0);
   assert (xp->included_msgs.latest == NULL);
+  if (xp->gso)
+  {
+    assert (xp->gso->nseg == 0);
+    os_free (xp->gso);
+  }
 #ifdef DDSI_INCLUDE_ENCRYPTION
   if (q_security_plugin.free_encoder)
   {
@@ -1302,6 +1310,45 @@ void nn_xpack_free (struct nn_xpack *xp)
   os_free (xp);
 }
 
+static ddsi_tran_conn_t nn_xpack_conn (const struct nn_xpack *xp, const nn_locator_t *loc)
+{
+  /* Shared-memory locators are in the address sets alongside those of the
+     xpack's own transport, they need to go out through their own one */
+  return (loc->kind == NN_LOCATOR_KIND_SHM && gv.data_conn_shm) ? gv.data_conn_shm : xp->conn;
+}
+
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+/* Bandwidth limiting: every packet going out over the network takes
+   its size from the token bucket of the xpack and gets a departure
+   time in return. If the transport can pass that to the kernel (UDP
+   with SO_TXTIME and an fq or etf qdisc), the packet is written
+   immediately, otherwise the sender sleeps until it is due, which is
+   the send thread dedicated to the token bucket because nn_xpack_new
+   forces paced xpacks into asynchronous mode in that case. */
+static ssize_t nn_xpack_write_paced (struct nn_xpack *xp, ddsi_tran_conn_t conn, const nn_locator_t *loc)
+{
+  const nn_mtime_t tnow = now_mt ();
+  nn_mtime_t tdepart;
+  if (conn != xp->conn)
+    return ddsi_conn_write (conn, loc, xp->niov, xp->iov, xp->call_flags);
+  tdepart = ddsi_pacer_schedule (xp->pacer, tnow, xp->msg_len.length);
+  if (ddsi_conn_supports_write_txtime (conn))
+    return ddsi_conn_write_txtime (conn, loc, xp->niov, xp->iov, xp->call_flags, tdepart.v);
+  if (tdepart.v > tnow.v)
+  {
+    const int64_t delay = tdepart.v - tnow.v;
+    os_time d;
+    DDS_TRACE(" <paced %"PRId64"us>", delay / 1000);
+    d.tv_sec = (os_timeSec) (delay / T_SECOND);
+    d.tv_nsec = (int32_t) (delay % T_SECOND);
+    thread_state_blocked (lookup_thread_state ());
+    os_nanoSleep (d);
+    thread_state_unblocked (lookup_thread_state ());
+  }
+  return ddsi_conn_write (conn, loc, xp->niov, xp->iov, xp->call_flags);
+}
+#endif
+
 static ssize_t nn_xpack_send1 (const nn_locator_t *loc, void * varg)
 {
   struct nn_xpack * xp = varg;
@@ -1330,14 +1377,19 @@ static ssize_t nn_xpack_send1 (const nn_locator_t *loc, void * varg)
   {
     struct iovec iov[NN_XMSG_MAX_MESSAGE_IOVECS];
     memcpy (iov, xp->iov, sizeof (iov));
-    nbytes = (q_security_plugin.send_encoded) (xp->conn, loc, xp->niov, iov, &xp->codec, xp->encoderId, xp->call_flags);
+    nbytes = (q_security_plugin.send_encoded) (nn_xpack_conn (xp, loc), loc, xp->niov, iov, &xp->codec, xp->encoderId, xp->call_flags);
   }
   else
 #endif
   {
     if (!gv.mute)
     {
-      nbytes = ddsi_conn_write (xp->conn, loc, xp->niov, xp->iov, xp->call_flags);
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+      if (xp->pacer)
+        nbytes = nn_xpack_write_paced (xp, nn_xpack_conn (xp, loc), loc);
+      else
+#endif
+      nbytes = ddsi_conn_write (nn_xpack_conn (xp, loc), loc, xp->niov, xp->iov, xp->call_flags);
 #ifndef NDEBUG
       {
         size_t i, len;
@@ -1358,20 +1410,87 @@ static ssize_t nn_xpack_send1 (const nn_locator_t *loc, void * varg)
   /* Clear call flags, as used on a per call basis */
 
   xp->call_flags = 0;
+  return nbytes;
+}
 
-#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
-  if (nbytes > 0)
+static void nn_xpack_send1v (const nn_locator_t *loc, void * varg)
+{
+  (void) nn_xpack_send1 (loc, varg);
+}
+
+/* Sending to many destinations in a single call: the locators are
+   collected while walking the address set and written out using the
+   connection's write_multi operation whenever the buffer fills up or
+   the walk completes. Only used for plain xpacks. */
+
+#define NN_XPACK_MAX_MULTI_DSTS 64
+
+struct nn_xpack_send_multi_arg {
+  struct nn_xpack *xp;
+  size_t n;
+  nn_locator_t dsts[NN_XPACK_MAX_MULTI_DSTS];
+};
+
+static bool nn_xpack_is_plain (const struct nn_xpack *xp)
+{
+  /* True if nn_xpack_send1 would simply pass the xpack to ddsi_conn_write */
+  if (gv.mute || config.xmit_lossiness > 0)
+    return false;
+#ifdef DDSI_INCLUDE_ENCRYPTION
+  if (q_security_plugin.send_encoded && xp->encoderId != 0 && (q_security_plugin.encoder_type) (xp->codec, xp->encoderId) != Q_CIPHER_NONE)
+    return false;
+#else
+  (void) xp;
+#endif
+  return true;
+}
+
+static bool nn_xpack_may_send_multi (const struct nn_xpack *xp)
+{
+  /* paced packets each need their own departure time */
+  return ddsi_conn_supports_write_multi (xp->conn) && nn_xpack_is_plain (xp) && !nn_xpack_is_paced (xp);
+}
+
+static void nn_xpack_send_multi_flush (struct nn_xpack_send_multi_arg *arg)
+{
+  struct nn_xpack *xp = arg->xp;
+  ssize_t nsent;
+  size_t ncalls;
+
+  if (arg->n == 0)
+    return;
+  else if (arg->n == 1)
   {
-    nn_bw_limit_sleep_if_needed (&xp->limiter, nbytes);
+    (void) nn_xpack_send1 (&arg->dsts[0], xp);
+    arg->n = 0;
+    return;
   }
-#endif
 
-  return nbytes;
+  nsent = ddsi_conn_write_multi (xp->conn, arg->dsts, arg->n, xp->niov, xp->iov, xp->call_flags, &ncalls);
+  xp->call_flags = 0;
+  /* a partial send is completed with individual writes, which save nothing */
+  if (nsent > 0 && (size_t) nsent > ncalls)
+    xp->syscalls_saved += (size_t) nsent - ncalls;
+  arg->n = 0;
 }
 
-static void nn_xpack_send1v (const nn_locator_t *loc, void * varg)
+static void nn_xpack_send_multi1 (const nn_locator_t *loc, void * varg)
 {
-  (void) nn_xpack_send1 (loc, varg);
+  struct nn_xpack_send_multi_arg *arg = varg;
+  if (dds_get_log_mask() & DDS_LC_TRACE)
+  {
+    char buf[DDSI_LOCSTRLEN];
+    DDS_TRACE(" %s", ddsi_locator_to_string (buf, sizeof(buf), loc));
+  }
+  if (nn_xpack_conn (arg->xp, loc) != arg->xp->conn)
+  {
+    /* different transport: send it right away, leaving the call flags for the others */
+    (void) ddsi_conn_write (nn_xpack_conn (arg->xp, loc), loc, arg->xp->niov, arg->xp->iov, arg->xp->call_flags);
+    return;
+  }
+  arg->dsts[arg->n++] = *loc;
+  if (arg->n == NN_XPACK_MAX_MULTI_DSTS)
+    nn_xpack_send_multi_flush (arg);
 }
 
 typedef struct nn_xpack_send1_thread_arg {
@@ -1399,12 +1518,172 @@ static void nn_xpack_send1_threaded (const nn_locator_t *loc, void * varg)
   ut_thread_pool_submit (gv.thread_pool, nn_xpack_send1_thread, arg);
 }
 
+/* Segmentation offload: runs of equally sized packets for the same
+   destinations -- typically the fragments of a large sample -- are
+   collected and then passed to the transport in a single call, leaving
+   it to the kernel to cut the run into packets again.
+
+   Only packets that are sent because the next message no longer fits
+   in the xpack are added to a run, and any other call to send the
+   xpack also sends out the run, so this never delays anything. The
+   run keeps the xmsgs alive until it has been sent and has its own
+   copy of the RTPS header because that of the xpack gets reused. */
+
+static int guid_prefix_eq (const nn_guid_prefix_t *a, const nn_guid_prefix_t *b)
+{
+  return a->u[0] == b->u[0] && a->u[1] == b->u[1] && a->u[2] == b->u[2];
+}
+
+static bool nn_xpack_gso_mayadd (const struct nn_xpack *xp)
+{
+  const struct nn_xpack_gso *gso = xp->gso;
+  const size_t len = xp->msg_len.length;
+
+  if (!nn_xpack_is_plain (xp) || xp->dstmode == NN_XMSG_DST_UNSET)
+    return false;
+  if (gso->nseg == 0)
+    return true;
+
+  /* All but the last segment must be segsize bytes */
+  if (gso->nseg == NN_XPACK_GSO_MAX_SEGMENTS || gso->bytes != gso->nseg * gso->segsize || len > gso->segsize)
+    return false;
+  if (gso->bytes + len > NN_XPACK_GSO_MAX_BYTES || gso->niov + xp->niov > NN_XPACK_GSO_MAX_IOVECS)
+    return false;
+  if (gso->call_flags != xp->call_flags || !guid_prefix_eq (&gso->hdr.guid_prefix, &xp->hdr.guid_prefix))
+    return false;
+  if (gso->dstmode != xp->dstmode)
+    return false;
+  switch (xp->dstmode)
+  {
+    case NN_XMSG_DST_UNSET:
+      break;
+    case NN_XMSG_DST_ONE:
+      return memcmp (&gso->dstaddr.loc, &xp->dstaddr.loc, sizeof (gso->dstaddr.loc)) == 0;
+    case NN_XMSG_DST_ALL:
+      return gso->dstaddr.all.as == xp->dstaddr.all.as && gso->dstaddr.all.as_group == xp->dstaddr.all.as_group;
+  }
+  return false;
+}
+
+static void nn_xpack_gso_add (struct nn_xpack *xp)
+{
+  struct nn_xpack_gso *gso = xp->gso;
+  size_t i;
+
+  assert (nn_xpack_gso_mayadd (xp));
+  assert (xp->iov[0].iov_base == (void *) &xp->hdr && xp->iov[0].iov_len == sizeof (xp->hdr));
+  DDS_TRACE("nn_xpack_gso_add %u: segment %"PRIuSIZE"\n", xp->msg_len.length, gso->nseg);
+
+  if (gso->nseg == 0)
+  {
+    /* Run takes over the references to the address sets */
+    gso->segsize = xp->msg_len.length;
+    gso->bytes = 0;
+    gso->call_flags = xp->call_flags;
+    gso->hdr = xp->hdr;
+    gso->dstmode = xp->dstmode;
+    if (xp->dstmode == NN_XMSG_DST_ONE)
+      gso->dstaddr.loc = xp->dstaddr.loc;
+    else
+    {
+      gso->dstaddr.all.as = xp->dstaddr.all.as;
+      gso->dstaddr.all.as_group = xp->dstaddr.all.as_group;
+    }
+  }
+  else if (xp->dstmode == NN_XMSG_DST_ALL)
+  {
+    unref_addrset (xp->dstaddr.all.as);
+    unref_addrset (xp->dstaddr.all.as_group);
+  }
+
+  gso->iov[gso->niov].iov_base = (void *) &gso->hdr;
+  gso->iov[gso->niov].iov_len = sizeof (gso->hdr);
+  for (i = 1; i < xp->niov; i++)
+    gso->iov[gso->niov + i] = xp->iov[i];
+  gso->niov += xp->niov;
+  gso->bytes += xp->msg_len.length;
+  gso->nseg++;
+  nn_xmsg_chain_move (&gso->msgs, &xp->included_msgs);
+  nn_xpack_reinit (xp);
+}
+
+static ssize_t nn_xpack_gso_send1 (const nn_locator_t *loc, void * varg)
+{
+  struct nn_xpack *xp = varg;
+  struct nn_xpack_gso *gso = xp->gso;
+  ssize_t nbytes;
+
+  if (dds_get_log_mask() & DDS_LC_TRACE)
+  {
+    char buf[DDSI_LOCSTRLEN];
+    DDS_TRACE(" %s", ddsi_locator_to_string (buf, sizeof(buf), loc));
+  }
+  nbytes = ddsi_conn_write_gso (nn_xpack_conn (xp, loc), loc, gso->niov, gso->iov, gso->segsize, gso->call_flags);
+  return nbytes;
+}
+
+static void nn_xpack_gso_send1v (const nn_locator_t *loc, void * varg)
+{
+  (void) nn_xpack_gso_send1 (loc, varg);
+}
+
+static void nn_xpack_gso_flush (struct nn_xpack *xp)
+{
+  struct nn_xpack_gso *gso = xp->gso;
+  size_t calls = 0;
+
+  if (gso->nseg == 0)
+    return;
+
+  DDS_TRACE("nn_xpack_send_gso %"PRIuSIZE"x%"PRIuSIZE" %"PRIuSIZE": [", gso->nseg, gso->segsize, gso->bytes);
+  if (gso->dstmode == NN_XMSG_DST_ONE)
+  {
+    calls = 1;
+    (void) nn_xpack_gso_send1 (&gso->dstaddr.loc, xp);
+  }
+  else
+  {
+    if (gso->dstaddr.all.as)
+    {
+      calls = addrset_forall_count (gso->dstaddr.all.as, nn_xpack_gso_send1v, xp);
+      unref_addrset (gso->dstaddr.all.as);
+    }
+    if (gso->dstaddr.all.as_group)
+    {
+      if (addrset_forone (gso->dstaddr.all.as_group, nn_xpack_gso_send1, xp) == 0)
+        calls++;
+      unref_addrset (gso->dstaddr.all.as_group);
+    }
+  }
+  if (calls > 0 && gso->nseg > 1)
+  {
+    xp->syscalls_saved += calls * (gso->nseg - 1);
+    DDS_TRACE(" (syscalls saved %"PRIuSIZE" total %"PRIu64")", calls * (gso->nseg - 1), xp->syscalls_saved);
+  }
+  DDS_TRACE(" ]\n");
+  if (calls)
+  {
+    DDS_LOG(DDS_LC_TRAFFIC, "traffic-xmit (%lu) %lu\n", (unsigned long) calls, (unsigned long) gso->bytes);
+  }
+  nn_xmsg_chain_release (&gso->msgs);
+  gso->nseg = 0;
+  gso->niov = 0;
+}
+
 static void nn_xpack_send_real (struct nn_xpack * xp)
 {
   size_t calls;
 
   assert (xp->niov <= NN_XMSG_MAX_MESSAGE_IOVECS);
 
+  if (xp->gso && xp->gso->nseg > 0)
+  {
+    /* Complete the run if possible, but in any case send it before xp */
+    if (xp->niov > 0 && nn_xpack_gso_mayadd (xp))
+      nn_xpack_gso_add (xp);
+    nn_xpack_gso_flush (xp);
+  }
+
   if (xp->niov == 0)
   {
     return;
@@ -1436,7 +1715,18 @@ static void nn_xpack_send_real (struct nn_xpack * xp)
     calls = 0;
     if (xp->dstaddr.all.as)
     {
-      if (gv.thread_pool == NULL)
+      if (gv.thread_pool == NULL && nn_xpack_may_send_multi (xp))
+      {
+        struct nn_xpack_send_multi_arg arg;
+        const uint64_t saved0 = xp->syscalls_saved;
+        arg.xp = xp;
+        arg.n = 0;
+        calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send_multi1, &arg);
+        nn_xpack_send_multi_flush (&arg);
+        if (xp->syscalls_saved != saved0)
+          DDS_TRACE(" (syscalls saved %"PRIu64" total %"PRIu64")", xp->syscalls_saved - saved0, xp->syscalls_saved);
+      }
+      else if (gv.thread_pool == NULL)
       {
         calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send1v, xp);
       }
@@ -1474,65 +1764,371 @@ static void nn_xpack_send_real (struct nn_xpack * xp)
   nn_xpack_reinit (xp);
 }
 
+/* SENDQ ---------------------------------------------------------------
+
+   Asynchronously sent xpacks are copied into an xpack taken from a
+   pool and handed to one of the send threads, the one selected by
+   hashing the destination so that all packets to a destination go
+   through the same queue and retain their order.
+
+   Each send queue is lock-free for the producers: an xpack is pushed
+   onto "head" with a CAS and the send thread takes the whole list in
+   one go and reverses it, restoring FIFO order. The send thread only
+   blocks on the condition variable when the queue is empty, or for at
+   most SENDQ_LINGER when fewer than SENDQ_HW xpacks are queued, none
+   of which needs to go out immediately, so that it handles them in
+   batches. Producers block once SENDQ_MAX xpacks are queued until
+   the send thread has reduced it to SENDQ_LW. */
+
 #define SENDQ_MAX 200
 #define SENDQ_HW 10
 #define SENDQ_LW 0
+#define SENDQ_LINGER 1000000 /* ns */
+
+struct nn_xpack_sendq {
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  const struct ddsi_pacer *pacer; /* NULL for the shared ones */
+  struct nn_xpack_sendq *next; /* in gv.paced_sendqs */
+#endif
+  os_atomic_voidp_t head;
+  os_atomic_uint32_t length;
+  os_atomic_uint32_t immediately;
+  os_atomic_uint32_t parked;
+  os_atomic_uint32_t nwaiters;
+  os_atomic_uint32_t stop;
+  os_mutex lock;
+  os_cond cond;
+  struct thread_state1 *ts;
+};
+
+static struct nn_xpack *nn_xpack_pool_get (void)
+{
+  struct nn_xpack *xp;
+  if ((xp = nn_freelist_pop (gv.xpack_pool)) == NULL)
+  {
+    xp = os_malloc (sizeof (*xp));
+    memset (xp, 0, sizeof (*xp));
+    if (gv.thread_pool)
+      os_sem_init (&xp->sem, 0);
+  }
+  return xp;
+}
+
+static void nn_xpack_pool_realfree (void *vxp)
+{
+  struct nn_xpack *xp = vxp;
+  if (gv.thread_pool)
+    os_sem_destroy (&xp->sem);
+  os_free (xp);
+}
+
+static void nn_xpack_pool_put (struct nn_xpack *xp)
+{
+  if (!nn_freelist_push (gv.xpack_pool, xp))
+    nn_xpack_pool_realfree (xp);
+}
+
+static void nn_xpack_move_to_pooled (struct nn_xpack *dst, struct nn_xpack *src)
+{
+  /* Takes over the contents of src, the iovecs referencing the fixed
+     headers in src must be made to reference the copies in dst */
+  const char *src_lo = (const char *) src, *src_hi = (const char *) (src + 1);
+  size_t i;
+  assert (src->gso == NULL);
+  dst->async_mode = false;
+  dst->hdr = src->hdr;
+  dst->msg_len = src->msg_len;
+  dst->maxdelay = src->maxdelay;
+  dst->packetid = src->packetid;
+  dst->call_flags = src->call_flags;
+  dst->syscalls_saved = 0;
+  dst->conn = src->conn;
+  dst->gso = NULL;
+  dst->dstmode = src->dstmode;
+  dst->dstaddr = src->dstaddr;
+  dst->included_msgs = src->included_msgs;
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  dst->pacer = src->pacer;
+  dst->paced_sendq = src->paced_sendq;
+#endif
+#ifdef DDSI_INCLUDE_NETWORK_PARTITIONS
+  dst->encoderId = src->encoderId;
+#endif
+#ifdef DDSI_INCLUDE_ENCRYPTION
+  dst->codec = src->codec;
+  dst->SecurityHeader = src->SecurityHeader;
+#endif
+  dst->niov = src->niov;
+  for (i = 0; i < src->niov; i++)
+  {
+    const char *base = src->iov[i].iov_base;
+    dst->iov[i].iov_len = src->iov[i].iov_len;
+    if (base >= src_lo && base < src_hi)
+      dst->iov[i].iov_base = (void *) ((char *) dst + (base - src_lo));
+    else
+      dst->iov[i].iov_base = (void *) base;
+  }
+  dst->last_src = NULL;
+  dst->last_dst = NULL;
+  /* src no longer owns the messages nor the address sets */
+  nn_xpack_reinit (src);
+}
+
+static void nn_xpack_sendq_wakeup (struct nn_xpack_sendq *q)
+{
+  os_mutexLock (&q->lock);
+  os_condBroadcast (&q->cond);
+  os_mutexUnlock (&q->lock);
+}
+
+static struct nn_xpack *nn_xpack_sendq_take_all (struct nn_xpack_sendq *q)
+{
+  struct nn_xpack *xp, *first = NULL;
+  void *head;
+  do {
+    if ((head = os_atomic_ldvoidp (&q->head)) == NULL)
+      return NULL;
+  } while (!os_atomic_casvoidp (&q->head, head, NULL));
+  xp = head;
+  while (xp)
+  {
+    struct nn_xpack *next = xp->sendq_next;
+    xp->sendq_next = first;
+    first = xp;
+    xp = next;
+  }
+  return first;
+}
 
-static uint32_t nn_xpack_sendq_thread (UNUSED_ARG (void *arg))
+static uint32_t nn_xpack_sendq_thread (void *varg)
 {
-  os_mutexLock (&gv.sendq_lock);
-  while (!(gv.sendq_stop && gv.sendq_head == NULL))
+  struct nn_xpack_sendq * const q = varg;
+  int lingered = 0;
+  while (1)
   {
     struct nn_xpack *xp;
-    if ((xp = gv.sendq_head) == NULL)
+    if (os_atomic_ldvoidp (&q->head) == NULL)
     {
-      os_time to = { 0, 1000000 };
-      os_condTimedWait (&gv.sendq_cond, &gv.sendq_lock, &to);
+      /* Producers only signal if they see "parked" set after making the
+         queue non-empty, so it must be set before the final check */
+      if (os_atomic_ld32 (&q->stop))
+        break;
+      os_mutexLock (&q->lock);
+      os_atomic_st32 (&q->parked, 1);
+      os_atomic_fence ();
+      while (os_atomic_ldvoidp (&q->head) == NULL && !os_atomic_ld32 (&q->stop))
+        os_condWait (&q->cond, &q->lock);
+      os_atomic_st32 (&q->parked, 0);
+      os_mutexUnlock (&q->lock);
+      continue;
     }
-    else
+    if (!lingered && os_atomic_ld32 (&q->length) < SENDQ_HW && !os_atomic_ld32 (&q->immediately) && !os_atomic_ld32 (&q->stop))
+    {
+      /* Give a few more packets the opportunity to arrive before waking
+         up for every single one, producers wake us early when it hits
+         SENDQ_HW or a packet needs to go out immediately */
+      const os_time to = { 0, SENDQ_LINGER };
+      os_mutexLock (&q->lock);
+      os_atomic_st32 (&q->parked, 1);
+      os_atomic_fence ();
+      if (os_atomic_ld32 (&q->length) < SENDQ_HW && !os_atomic_ld32 (&q->immediately))
+        (void) os_condTimedWait (&q->cond, &q->lock, &to);
+      os_atomic_st32 (&q->parked, 0);
+      os_mutexUnlock (&q->lock);
+      lingered = 1;
+      continue;
+    }
+    lingered = 0;
+    os_atomic_st32 (&q->immediately, 0);
+    xp = nn_xpack_sendq_take_all (q);
+    while (xp)
     {
-      gv.sendq_head = xp->sendq_next;
-      if (--gv.sendq_length == SENDQ_LW)
-        os_condBroadcast (&gv.sendq_cond);
-      os_mutexUnlock (&gv.sendq_lock);
+      struct nn_xpack *next = xp->sendq_next;
       nn_xpack_send_real (xp);
-      nn_xpack_free (xp);
-      os_mutexLock (&gv.sendq_lock);
+      nn_xpack_pool_put (xp);
+      if (os_atomic_dec32_nv (&q->length) == SENDQ_LW && os_atomic_ld32 (&q->nwaiters) > 0)
+        nn_xpack_sendq_wakeup (q);
+      xp = next;
     }
   }
-  os_mutexUnlock (&gv.sendq_lock);
   return 0;
 }
 
+static struct nn_xpack_sendq *nn_xpack_sendq_for (const struct nn_xpack *xp)
+{
+  uint64_t h;
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  if (xp->paced_sendq)
+    return xp->paced_sendq;
+#endif
+  if (gv.n_sendqs == 1)
+    return gv.sendqs[0];
+  switch (xp->dstmode)
+  {
+    case NN_XMSG_DST_ONE: {
+      const unsigned char *a = xp->dstaddr.loc.address;
+      uint64_t a0, a1;
+      memcpy (&a0, a, sizeof (a0));
+      memcpy (&a1, a + 8, sizeof (a1));
+      h = (a0 ^ (a1 * UINT64_C (0x9e3779b97f4a7c15))) + xp->dstaddr.loc.port;
+      break;
+    }
+    default:
+      h = (uint64_t) (uintptr_t) xp->dstaddr.all.as ^ ((uint64_t) (uintptr_t) xp->dstaddr.all.as_group << 1);
+      break;
+  }
+  h *= UINT64_C (0x9e3779b97f4a7c15);
+  return gv.sendqs[(uint32_t) (h >> 32) % gv.n_sendqs];
+}
+
+static void nn_xpack_sendq_enqueue (struct nn_xpack_sendq *q, struct nn_xpack *xp, bool immediately)
+{
+  uint32_t length;
+  void *head;
+
+  if (os_atomic_ld32 (&q->length) >= SENDQ_MAX)
+  {
+    os_mutexLock (&q->lock);
+    os_atomic_inc32 (&q->nwaiters);
+    while (os_atomic_ld32 (&q->length) > SENDQ_LW)
+      os_condWait (&q->cond, &q->lock);
+    os_atomic_dec32 (&q->nwaiters);
+    os_mutexUnlock (&q->lock);
+  }
+
+  length = os_atomic_inc32_nv (&q->length);
+  if (immediately)
+    os_atomic_st32 (&q->immediately, 1);
+  do {
+    head = os_atomic_ldvoidp (&q->head);
+    xp->sendq_next = head;
+  } while (!os_atomic_casvoidp (&q->head, head, xp));
+  /* the full barrier of the CAS orders the push before reading "parked" */
+  if (os_atomic_ld32 (&q->parked) && (head == NULL || immediately || length == SENDQ_HW))
+    nn_xpack_sendq_wakeup (q);
+}
+
+static struct nn_xpack_sendq *nn_xpack_sendq_new (void)
+{
+  struct nn_xpack_sendq *q = os_malloc (sizeof (*q));
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  q->pacer = NULL;
+  q->next = NULL;
+#endif
+  os_atomic_stvoidp (&q->head, NULL);
+  os_atomic_st32 (&q->length, 0);
+  os_atomic_st32 (&q->immediately, 0);
+  os_atomic_st32 (&q->parked, 0);
+  os_atomic_st32 (&q->nwaiters, 0);
+  os_atomic_st32 (&q->stop, 0);
+  os_mutexInit (&q->lock);
+  os_condInit (&q->cond, &q->lock);
+  q->ts = NULL;
+  return q;
+}
+
+static void nn_xpack_sendq_stop1 (struct nn_xpack_sendq *q)
+{
+  os_atomic_st32 (&q->stop, 1);
+  nn_xpack_sendq_wakeup (q);
+}
+
+static void nn_xpack_sendq_free (struct nn_xpack_sendq *q)
+{
+  if (q->ts)
+    join_thread (q->ts);
+  assert (os_atomic_ldvoidp (&q->head) == NULL);
+  os_condDestroy (&q->cond);
+  os_mutexDestroy (&q->lock);
+  os_free (q);
+}
+
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+static void nn_xpack_sendq_add_paced (const struct ddsi_pacer *pacer, ddsi_tran_conn_t conn)
+{
+  struct nn_xpack_sendq *q;
+  if (pacer == NULL || ddsi_conn_supports_write_txtime (conn))
+    return;
+  q = nn_xpack_sendq_new ();
+  q->pacer = pacer;
+  q->next = gv.paced_sendqs;
+  gv.paced_sendqs = q;
+}
+
+static struct nn_xpack_sendq *nn_xpack_sendq_for_pacer (const struct ddsi_pacer *pacer)
+{
+  struct nn_xpack_sendq *q;
+  for (q = gv.paced_sendqs; q; q = q->next)
+    if (q->pacer == pacer)
+      return q;
+  return NULL;
+}
+#endif
+
 void nn_xpack_sendq_init (void)
 {
-  gv.sendq_stop = 0;
-  gv.sendq_head = NULL;
-  gv.sendq_tail = NULL;
-  gv.sendq_length = 0;
-  os_mutexInit (&gv.sendq_lock);
-  os_condInit (&gv.sendq_cond, &gv.sendq_lock);
+  gv.xpack_pool = os_malloc (sizeof (*gv.xpack_pool));
+  nn_freelist_init (gv.xpack_pool, UINT32_MAX, offsetof (struct nn_xpack, sendq_next));
+  gv.n_sendqs = (unsigned) config.xpack_send_async_threads;
+  for (unsigned i = 0; i < gv.n_sendqs; i++)
+    gv.sendqs[i] = nn_xpack_sendq_new ();
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  gv.paced_sendqs = NULL;
+  nn_xpack_sendq_add_paced (gv.auxiliary_pacer, gv.tev_conn);
+  for (struct config_channel_listelem *chptr = config.channels; chptr; chptr = chptr->next)
+  {
+    nn_xpack_sendq_add_paced (chptr->data_pacer, chptr->transmit_conn);
+    nn_xpack_sendq_add_paced (chptr->auxiliary_pacer, chptr->transmit_conn);
+  }
+#endif
 }
 
 void nn_xpack_sendq_start (void)
 {
-  gv.sendq_ts = create_thread("sendq", nn_xpack_sendq_thread, NULL);
+  for (unsigned i = 0; i < gv.n_sendqs; i++)
+  {
+    char name[16];
+    if (gv.n_sendqs == 1)
+      snprintf (name, sizeof (name), "sendq");
+    else
+      snprintf (name, sizeof (name), "sendq%u", i);
+    gv.sendqs[i]->ts = create_thread (name, nn_xpack_sendq_thread, gv.sendqs[i]);
+  }
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  for (struct nn_xpack_sendq *q = gv.paced_sendqs; q; q = q->next)
+  {
+    char name[64];
+    snprintf (name, sizeof (name), "sendq.%s", ddsi_pacer_name (q->pacer));
+    q->ts = create_thread (name, nn_xpack_sendq_thread, q);
+  }
+#endif
 }
 
 void nn_xpack_sendq_stop (void)
 {
-  os_mutexLock (&gv.sendq_lock);
-  gv.sendq_stop = 1;
-  os_condBroadcast (&gv.sendq_cond);
-  os_mutexUnlock (&gv.sendq_lock);
+  for (unsigned i = 0; i < gv.n_sendqs; i++)
+    nn_xpack_sendq_stop1 (gv.sendqs[i]);
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  for (struct nn_xpack_sendq *q = gv.paced_sendqs; q; q = q->next)
+    nn_xpack_sendq_stop1 (q);
+#endif
 }
 
 void nn_xpack_sendq_fini (void)
 {
-  assert (gv.sendq_head == NULL);
-  join_thread(gv.sendq_ts);
-  os_condDestroy(&gv.sendq_cond);
-  os_mutexDestroy(&gv.sendq_lock);
+  for (unsigned i = 0; i < gv.n_sendqs; i++)
+    nn_xpack_sendq_free (gv.sendqs[i]);
+  gv.n_sendqs = 0;
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  while (gv.paced_sendqs)
+  {
+    struct nn_xpack_sendq *q = gv.paced_sendqs;
+    gv.paced_sendqs = q->next;
+    nn_xpack_sendq_free (q);
+  }
+#endif
+  nn_freelist_fini (gv.xpack_pool, nn_xpack_pool_realfree);
+  os_free (gv.xpack_pool);
 }
 
 void nn_xpack_send (struct nn_xpack *xp, bool immediately)
@@ -1541,29 +2137,37 @@ void nn_xpack_send (struct nn_xpack *xp, bool immediately)
   {
     nn_xpack_send_real (xp);
   }
+  else if (xp->niov > 0)
+  {
+    struct nn_xpack *xp1 = nn_xpack_pool_get ();
+    nn_xpack_move_to_pooled (xp1, xp);
+    nn_xpack_sendq_enqueue (nn_xpack_sendq_for (xp1), xp1, immediately);
+  }
+}
+
+void nn_xpack_send_completed (struct nn_xpack *xp)
+{
+  /* For callers that hold on to a partially filled xpack: packets that
+     were completed while adding messages to it may be waiting in the run
+     for segmentation offload, but nothing more is coming for now */
+  if (xp->gso && xp->gso->nseg > 0)
+    nn_xpack_gso_flush (xp);
+}
+
+static void nn_xpack_send_full (struct nn_xpack *xp)
+{
+  /* Called when xp must be sent to make room for the next message, so
+     more is likely to follow and xp may be added to a run for the
+     segmentation offload instead */
+  if (xp->gso == NULL || !nn_xpack_is_plain (xp))
+    nn_xpack_send (xp, false);
   else
   {
-    struct nn_xpack *xp1 = os_malloc (sizeof (*xp));
-    memcpy (xp1, xp, sizeof (*xp1));
-    nn_xpack_reinit (xp);
-    xp1->sendq_next = NULL;
-    os_mutexLock (&gv.sendq_lock);
-    if (immediately || gv.sendq_length == SENDQ_HW)
-      os_condBroadcast (&gv.sendq_cond);
-    if (gv.sendq_length >= SENDQ_MAX)
-    {
-      while (gv.sendq_length > SENDQ_LW)
-        os_condWait (&gv.sendq_cond, &gv.sendq_lock);
-    }
-    if (gv.sendq_head)
-      gv.sendq_tail->sendq_next = xp1;
-    else
-    {
-      gv.sendq_head = xp1;
-    }
-    gv.sendq_tail = xp1;
-    gv.sendq_length++;
-    os_mutexUnlock (&gv.sendq_lock);
+    if (!nn_xpack_gso_mayadd (xp))
+      nn_xpack_gso_flush (xp);
+    nn_xpack_gso_add (xp);
+    if (xp->gso->bytes != xp->gso->nseg * xp->gso->segsize)
+      nn_xpack_gso_flush (xp);
   }
 }
 
@@ -1649,11 +2253,6 @@ static int nn_xpack_mayaddmsg (const struct nn_xpack *xp, const struct nn_xmsg *
   return addressing_info_eq_onesidederr (xp, m);
 }
 
-static int guid_prefix_eq (const nn_guid_prefix_t *a, const nn_guid_prefix_t *b)
-{
-  return a->u[0] == b->u[0] && a->u[1] == b->u[1] && a->u[2] == b->u[2];
-}
-
 int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flags)
 {
   /* Returns > 0 if pack got sent out before adding m */
@@ -1684,7 +2283,7 @@ int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flag
   if (!nn_xpack_mayaddmsg (xp, m, flags))
   {
     assert (xp->niov > 0);
-    nn_xpack_send (xp, false);
+    nn_xpack_send_full (xp);
     assert (nn_xpack_mayaddmsg (xp, m, flags));
     result = 1;
   }
@@ -1844,7 +2443,7 @@ int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flag
     DDS_TRACE(" => now niov %d sz %"PRIuSIZE" > max_msg_size %u, nn_xpack_send niov %d sz %u now\n", (int) niov, sz, config.max_msg_size, (int) xpo_niov, xpo_sz);
     xp->msg_len.length = xpo_sz;
     xp->niov = xpo_niov;
-    nn_xpack_send (xp, false);
+    nn_xpack_send_full (xp);
     result = nn_xpack_addmsg (xp, m, flags); /* Retry on emptied xp */
   }
   else
@@ -1866,3 +2465,8 @@ unsigned nn_xpack_packetid (const struct nn_xpack *xp)
 {
   return xp->packetid;
 }
+
+size_t nn_xpack_size (const struct nn_xpack *xp)
+{
+  return xp->msg_len.length;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "CUnit/Test.h"
+#include "ddsi/q_bitset.h"
+
+/* Sizes around word and vector boundaries, the 256-bit maximum of
+   sequence number sets and something like a fragment bitmap of a
+   large sample */
+static const unsigned sizes[] = { 1, 2, 31, 32, 33, 63, 64, 65, 127, 128, 129, 255, 256, 257, 1000, 4096 };
+#define MAXWORDS (4096 / 32 + 1)
+
+static int ref_isset (const unsigned *bits, unsigned idx)
+{
+  return (bits[idx / 32] & (1u << (31 - (idx % 32)))) != 0;
+}
+
+static void fill (unsigned numbits, unsigned *bits, int density)
+{
+  /* density in percent, 0 and 100 give sets without any clear resp.
+     set bits, words get garbage beyond numbits */
+  for (unsigned i = 0; i < (numbits + 31) / 32; i++)
+    bits[i] = 0;
+  for (unsigned i = 0; i < (numbits + 31) / 32 * 32; i++)
+    if (i >= numbits ? (rand () & 1) : (rand () % 100) < density)
+      bits[i / 32] |= 1u << (31 - (i % 32));
+}
+
+CU_Test(ddsi_bitset, find_set)
+{
+  static const int densities[] = { 0, 1, 50, 99, 100 };
+  unsigned bits[MAXWORDS];
+  srand (1);
+  for (size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++)
+  {
+    const unsigned numbits = sizes[s];
+    for (size_t d = 0; d < sizeof (densities) / sizeof (densities[0]); d++)
+    {
+      fill (numbits, bits, densities[d]);
+      for (unsigned idx = 0; idx <= numbits; idx++)
+      {
+        unsigned exp = idx;
+        while (exp < numbits && !ref_isset (bits, exp))
+          exp++;
+        CU_ASSERT_EQUAL_FATAL (nn_bitset_find_set (numbits, bits, idx), exp);
+      }
+    }
+  }
+}
+
+CU_Test(ddsi_bitset, find_clear)
+{
+  static const int densities[] = { 0, 1, 50, 99, 100 };
+  unsigned bits[MAXWORDS];
+  srand (2);
+  for (size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++)
+  {
+    const unsigned numbits = sizes[s];
+    for (size_t d = 0; d < sizeof (densities) / sizeof (densities[0]); d++)
+    {
+      fill (numbits, bits, densities[d]);
+      for (unsigned idx = 0; idx <= numbits; idx++)
+      {
+        unsigned exp = idx;
+        while (exp < numbits && ref_isset (bits, exp))
+          exp++;
+        CU_ASSERT_EQUAL_FATAL (nn_bitset_find_clear (numbits, bits, idx), exp);
+      }
+    }
+  }
+}
+
+CU_Test(ddsi_bitset, count_range)
+{
+  unsigned bits[MAXWORDS];
+  srand (3);
+  for (size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++)
+  {
+    const unsigned numbits = sizes[s];
+    unsigned total = 0;
+    fill (numbits, bits, 30);
+    for (unsigned i = 0; i < numbits; i++)
+      total += (unsigned) ref_isset (bits, i);
+    CU_ASSERT_EQUAL_FATAL (nn_bitset_count (numbits, bits), total);
+    for (int k = 0; k < 1000; k++)
+    {
+      unsigned lo = (unsigned) rand () % (numbits + 1), hi = (unsigned) rand () % (numbits + 1), exp = 0;
+      if (lo > hi)
+      {
+        unsigned t = lo; lo = hi; hi = t;
+      }
+      for (unsigned i = lo; i < hi; i++)
+        exp += (unsigned) ref_isset (bits, i);
+      CU_ASSERT_EQUAL_FATAL (nn_bitset_count_range (numbits, bits, lo, hi), exp);
+    }
+  }
+}
+
+CU_Test(ddsi_bitset, set_range)
+{
+  unsigned bits[MAXWORDS + 1], ref[MAXWORDS + 1];
+  srand (4);
+  for (size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++)
+  {
+    const unsigned numbits = sizes[s], nw = (numbits + 31) / 32;
+    for (int k = 0; k < 1000; k++)
+    {
+      unsigned lo = (unsigned) rand () % (numbits + 1), hi = (unsigned) rand () % (numbits + 1);
+      if (lo > hi)
+      {
+        unsigned t = lo; lo = hi; hi = t;
+      }
+      fill (numbits, bits, 10);
+      bits[nw] = 0x5a5a5a5a;
+      memcpy (ref, bits, sizeof (bits));
+      for (unsigned i = lo; i < hi; i++)
+        ref[i / 32] |= 1u << (31 - (i % 32));
+      nn_bitset_set_range (numbits, bits, lo, hi);
+      CU_ASSERT_FATAL (memcmp (bits, ref, (nw + 1) * sizeof (bits[0])) == 0);
+    }
+  }
+}
+
+CU_Test(ddsi_bitset, one)
+{
+  unsigned bits[MAXWORDS + 1];
+  for (size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++)
+  {
+    const unsigned numbits = sizes[s], nw = (numbits + 31) / 32;
+    memset (bits, 0x5a, sizeof (bits));
+    nn_bitset_one (numbits, bits);
+    for (unsigned i = 0; i < nw * 32; i++)
+      CU_ASSERT_EQUAL_FATAL (ref_isset (bits, i), i < numbits);
+    /* must not touch the word following the set */
+    CU_ASSERT_EQUAL_FATAL (bits[nw], 0x5a5a5a5a);
+    CU_ASSERT_EQUAL_FATAL (nn_bitset_find_clear (numbits, bits, 0), numbits);
+    CU_ASSERT_EQUAL_FATAL (nn_bitset_count (numbits, bits), numbits);
+  }
+}
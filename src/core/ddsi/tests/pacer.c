@@ -0,0 +1,117 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdlib.h>
+
+#include "CUnit/Test.h"
+#include "ddsi/ddsi_pacer.h"
+#include "ddsi/q_config.h"
+#include "ddsi/q_time.h"
+
+/* All tests use 1 byte/us and start at an arbitrary, non-zero time */
+#define RATE 1000000u
+#define T0 (17 * T_SECOND)
+
+static nn_mtime_t mt (int64_t t)
+{
+  nn_mtime_t x;
+  x.v = t;
+  return x;
+}
+
+static struct ddsi_pacer *new_pacer (uint32_t max_msg_size)
+{
+  /* the depth of the bucket derives from the maximum message size */
+  config.max_msg_size = max_msg_size;
+  return ddsi_pacer_new ("test", RATE);
+}
+
+CU_Test(ddsi_pacer, depth)
+{
+  /* 4000 bytes is 4ms at this rate, so a burst of 4ms worth of data
+     plus one more packet can go immediately, then it is one packet per
+     millisecond */
+  struct ddsi_pacer *pacer = new_pacer (4000);
+  for (int k = 0; k < 10; k++)
+  {
+    const nn_mtime_t td = ddsi_pacer_schedule (pacer, mt (T0), 1000);
+    CU_ASSERT_EQUAL_FATAL (td.v, (k <= 4) ? T0 : T0 + (k - 4) * T_MILLISECOND);
+  }
+  ddsi_pacer_free (pacer);
+}
+
+CU_Test(ddsi_pacer, min_depth)
+{
+  /* small messages at a high rate: the burst is 1ms, not 100us */
+  struct ddsi_pacer *pacer = new_pacer (100);
+  for (int k = 0; k < 20; k++)
+  {
+    const nn_mtime_t td = ddsi_pacer_schedule (pacer, mt (T0), 100);
+    CU_ASSERT_EQUAL_FATAL (td.v, (k <= 10) ? T0 : T0 + (k - 10) * 100 * T_MICROSECOND);
+  }
+  ddsi_pacer_free (pacer);
+}
+
+CU_Test(ddsi_pacer, refill)
+{
+  struct ddsi_pacer *pacer = new_pacer (4000);
+  nn_mtime_t td;
+  /* 10 packets of 1ms each: it will not have drained until T0+10ms */
+  for (int k = 0; k < 10; k++)
+    (void) ddsi_pacer_schedule (pacer, mt (T0), 1000);
+
+  /* at T0+8ms, 2ms worth of data is still in it: as with the initial
+     burst, a packet may go as long as the bucket isn't over its depth
+     before adding it, so three can go immediately, and then it is back
+     to one per millisecond */
+  td = ddsi_pacer_schedule (pacer, mt (T0 + 8 * T_MILLISECOND), 1000);
+  CU_ASSERT_EQUAL (td.v, T0 + 8 * T_MILLISECOND);
+  td = ddsi_pacer_schedule (pacer, mt (T0 + 8 * T_MILLISECOND), 1000);
+  CU_ASSERT_EQUAL (td.v, T0 + 8 * T_MILLISECOND);
+  td = ddsi_pacer_schedule (pacer, mt (T0 + 8 * T_MILLISECOND), 1000);
+  CU_ASSERT_EQUAL (td.v, T0 + 8 * T_MILLISECOND);
+  td = ddsi_pacer_schedule (pacer, mt (T0 + 8 * T_MILLISECOND), 1000);
+  CU_ASSERT_EQUAL (td.v, T0 + 9 * T_MILLISECOND);
+
+  /* long after it has been emptied, it is full again but no fuller:
+     idle time doesn't accumulate credit beyond the depth */
+  for (int k = 0; k < 10; k++)
+  {
+    td = ddsi_pacer_schedule (pacer, mt (T0 + T_SECOND), 1000);
+    CU_ASSERT_EQUAL_FATAL (td.v, (k <= 4) ? T0 + T_SECOND : T0 + T_SECOND + (k - 4) * T_MILLISECOND);
+  }
+  ddsi_pacer_free (pacer);
+}
+
+CU_Test(ddsi_pacer, tdepart)
+{
+  /* random sizes and arrival times: departure times are never before
+     the arrival, never decrease, and never exceed the rate beyond the
+     depth of the bucket */
+  struct ddsi_pacer *pacer = new_pacer (1500);
+  const int64_t depth = 1500 * T_MICROSECOND;
+  int64_t tnow = T0, tprev = 0, bytes = 0;
+  srand (1);
+  for (int k = 0; k < 10000; k++)
+  {
+    const size_t size = 1 + (size_t) (rand () % 1500);
+    nn_mtime_t td;
+    tnow += (rand () % 4 == 0) ? rand () % (2 * T_MILLISECOND) : 0;
+    td = ddsi_pacer_schedule (pacer, mt (tnow), size);
+    CU_ASSERT_FATAL (td.v >= tnow);
+    CU_ASSERT_FATAL (td.v >= tprev);
+    tprev = td.v;
+    bytes += (int64_t) size;
+    /* total sent by td can't exceed what the rate allows plus a full bucket */
+    CU_ASSERT_FATAL (bytes * T_MICROSECOND <= (td.v - T0) + depth + (int64_t) size * T_MICROSECOND);
+  }
+  ddsi_pacer_free (pacer);
+}
@@ -0,0 +1,581 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "CUnit/Test.h"
+#include "os/os.h"
+#include "ddsi/q_bitset.h"
+#include "ddsi/q_misc.h"
+#include "ddsi/q_protocol.h"
+#include "ddsi/q_radmin.h"
+
+/* REORDER_WINDOW in q_radmin.c: sequence numbers in [next_seq, next_seq
+   + WINDOW) are indexed in a ring, anything beyond that only in the
+   interval tree, so the interesting cases are around that edge */
+#define WINDOW 512
+#define MAXSEQ 4000
+
+static struct nn_rbufpool *rbp;
+static struct nn_defrag *defrag;
+static struct nn_reorder *reorder;
+static seqno_t delivered[MAXSEQ];
+static uint32_t ndelivered;
+
+static void setup (uint32_t max_samples)
+{
+  rbp = nn_rbufpool_new (1048576, 65536);
+  CU_ASSERT_FATAL (rbp != NULL);
+  CU_ASSERT_FATAL (nn_rbufpool_populate (rbp) == 0);
+  defrag = nn_defrag_new (NN_DEFRAG_DROP_LATEST, max_samples);
+  reorder = nn_reorder_new (NN_REORDER_MODE_NORMAL, max_samples);
+  ndelivered = 0;
+}
+
+static void teardown (void)
+{
+  nn_reorder_free (reorder);
+  nn_defrag_free (defrag);
+  nn_rbufpool_free (rbp);
+}
+
+static void deliver (struct nn_rsample_chain *sc)
+{
+  /* records the sequence numbers of the samples, gaps have no sample info */
+  struct nn_rsample_chain_elem *e = sc->first, *e1;
+  while (e)
+  {
+    e1 = e->next;
+    if (e->sampleinfo)
+    {
+      CU_ASSERT_FATAL (ndelivered < MAXSEQ);
+      delivered[ndelivered++] = e->sampleinfo->seq;
+    }
+    nn_fragchain_unref (e->fragchain);
+    e = e1;
+  }
+}
+
+static nn_reorder_result_t rx_data (seqno_t seq)
+{
+  struct nn_rmsg *rmsg = nn_rmsg_new (rbp);
+  struct nn_rsample_info sampleinfo;
+  struct nn_rdata *rdata;
+  struct nn_rsample *rsample;
+  nn_reorder_result_t res = NN_REORDER_REJECT;
+  nn_rmsg_setsize (rmsg, 64);
+  rdata = nn_rdata_new (rmsg, 0, 64, 0, 0);
+  memset (&sampleinfo, 0, sizeof (sampleinfo));
+  sampleinfo.seq = seq;
+  sampleinfo.size = 64;
+  sampleinfo.fragsize = 64;
+  if ((rsample = nn_defrag_rsample (defrag, rdata, &sampleinfo)) != NULL)
+  {
+    struct nn_rdata *fragchain = nn_rsample_fragchain (rsample);
+    struct nn_rsample_chain sc;
+    int refc_adjust = 0;
+    if ((res = nn_reorder_rsample (&sc, reorder, rsample, &refc_adjust, 0)) > 0)
+      deliver (&sc);
+    nn_fragchain_adjust_refcount (fragchain, refc_adjust);
+  }
+  nn_rmsg_commit (rmsg);
+  return res;
+}
+
+static nn_reorder_result_t rx_gap (seqno_t min, seqno_t maxp1)
+{
+  struct nn_rmsg *rmsg = nn_rmsg_new (rbp);
+  struct nn_rdata *gap;
+  struct nn_rsample_chain sc;
+  nn_reorder_result_t res;
+  int refc_adjust = 0;
+  nn_rmsg_setsize (rmsg, 64);
+  nn_defrag_notegap (defrag, min, maxp1);
+  gap = nn_rdata_newgap (rmsg);
+  if ((res = nn_reorder_gap (&sc, reorder, gap, min, maxp1, &refc_adjust)) > 0)
+    deliver (&sc);
+  nn_fragchain_adjust_refcount (gap, refc_adjust);
+  nn_rmsg_commit (rmsg);
+  return res;
+}
+
+static void check_delivered (seqno_t min, seqno_t maxp1)
+{
+  /* exactly [min,maxp1) got delivered since the last check, in order */
+  CU_ASSERT_EQUAL_FATAL (ndelivered, (uint32_t) (maxp1 - min));
+  for (uint32_t i = 0; i < ndelivered; i++)
+    CU_ASSERT_EQUAL_FATAL (delivered[i], min + i);
+  ndelivered = 0;
+}
+
+static struct nn_rx_drop_stats drops (void)
+{
+  struct nn_radmin_stats st;
+  nn_reorder_stats (reorder, &st);
+  return st.drops;
+}
+
+CU_Test(ddsi_reorder, in_order)
+{
+  setup (16);
+  for (seqno_t seq = 1; seq <= 2 * WINDOW + 10; seq++)
+  {
+    CU_ASSERT_EQUAL_FATAL (rx_data (seq), 1);
+    CU_ASSERT_EQUAL_FATAL (nn_reorder_next_seq (reorder), seq + 1);
+  }
+  check_delivered (1, 2 * WINDOW + 11);
+  /* sequence numbers that have been delivered are too old */
+  CU_ASSERT_EQUAL (rx_data (WINDOW), NN_REORDER_TOO_OLD);
+  CU_ASSERT (!nn_reorder_wantsample (reorder, WINDOW));
+  CU_ASSERT (nn_reorder_wantsample (reorder, 2 * WINDOW + 11));
+  teardown ();
+}
+
+CU_Test(ddsi_reorder, reverse)
+{
+  /* the first samples stored lie beyond the window, the later ones in
+     it, so this covers both and the transition */
+  const seqno_t n = WINDOW + 100;
+  setup (MAXSEQ);
+  for (seqno_t seq = n; seq > 1; seq--)
+    CU_ASSERT_EQUAL_FATAL (rx_data (seq), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (ndelivered, 0);
+  CU_ASSERT_EQUAL (nn_reorder_next_seq (reorder), 1);
+  CU_ASSERT (nn_reorder_wantsample (reorder, 1));
+  for (seqno_t seq = 2; seq <= n; seq++)
+    CU_ASSERT_FATAL (!nn_reorder_wantsample (reorder, seq));
+  CU_ASSERT (nn_reorder_wantsample (reorder, n + 1));
+  CU_ASSERT_EQUAL (rx_data (1), (nn_reorder_result_t) n);
+  check_delivered (1, n + 1);
+  CU_ASSERT_EQUAL (nn_reorder_next_seq (reorder), n + 1);
+  teardown ();
+}
+
+CU_Test(ddsi_reorder, random)
+{
+  /* random arrival of a range several times the window, with the odd
+     duplicate thrown in: every sample is delivered exactly once and in
+     order, duplicates are rejected as such or as too old */
+  static seqno_t perm[3000];
+  const seqno_t n = 3000;
+  seqno_t next = 1;
+  uint64_t ndup = 0;
+  setup (MAXSEQ);
+  srand (1);
+  for (seqno_t i = 0; i < n; i++)
+    perm[i] = i + 1;
+  for (seqno_t i = n - 1; i > 0; i--)
+  {
+    const seqno_t j = rand () % (i + 1), t = perm[i];
+    perm[i] = perm[j];
+    perm[j] = t;
+  }
+  for (seqno_t i = 0; i < n; i++)
+  {
+    nn_reorder_result_t res;
+    CU_ASSERT_FATAL (nn_reorder_wantsample (reorder, perm[i]));
+    res = rx_data (perm[i]);
+    CU_ASSERT_FATAL (res >= 0);
+    CU_ASSERT_EQUAL_FATAL (res, (nn_reorder_result_t) (nn_reorder_next_seq (reorder) - next));
+    check_delivered (next, nn_reorder_next_seq (reorder));
+    next = nn_reorder_next_seq (reorder);
+    if (rand () % 8 == 0)
+    {
+      const seqno_t dup = perm[rand () % (i + 1)];
+      CU_ASSERT_FATAL (!nn_reorder_wantsample (reorder, dup));
+      if (dup < next)
+        CU_ASSERT_EQUAL_FATAL (rx_data (dup), NN_REORDER_TOO_OLD);
+      else
+      {
+        CU_ASSERT_EQUAL_FATAL (rx_data (dup), NN_REORDER_REJECT);
+        ndup++;
+      }
+      CU_ASSERT_EQUAL_FATAL (ndelivered, 0);
+    }
+  }
+  CU_ASSERT_EQUAL (next, n + 1);
+  CU_ASSERT_EQUAL (drops ().duplicate, ndup);
+  teardown ();
+}
+
+CU_Test(ddsi_reorder, window_edge)
+{
+  /* samples at the last slot of the window and just beyond it, then
+     sliding the window over them one sample at a time */
+  struct nn_rx_drop_stats d;
+  setup (MAXSEQ);
+  CU_ASSERT_EQUAL (rx_data (WINDOW), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (rx_data (WINDOW + 1), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (rx_data (WINDOW + 2), NN_REORDER_ACCEPT);
+  CU_ASSERT (nn_reorder_wantsample (reorder, WINDOW - 1));
+  CU_ASSERT (!nn_reorder_wantsample (reorder, WINDOW));
+  CU_ASSERT (!nn_reorder_wantsample (reorder, WINDOW + 1));
+  CU_ASSERT (!nn_reorder_wantsample (reorder, WINDOW + 2));
+  CU_ASSERT (nn_reorder_wantsample (reorder, WINDOW + 3));
+  /* duplicates in the window and beyond it */
+  CU_ASSERT_EQUAL (rx_data (WINDOW), NN_REORDER_REJECT);
+  CU_ASSERT_EQUAL (rx_data (WINDOW + 2), NN_REORDER_REJECT);
+  d = drops ();
+  CU_ASSERT_EQUAL (d.duplicate, 2);
+  /* WINDOW+2 enters the window once 1 has been delivered */
+  for (seqno_t seq = 1; seq < WINDOW - 1; seq++)
+    CU_ASSERT_EQUAL_FATAL (rx_data (seq), 1);
+  check_delivered (1, WINDOW - 1);
+  CU_ASSERT_EQUAL (rx_data (WINDOW + 2), NN_REORDER_REJECT);
+  CU_ASSERT (nn_reorder_wantsample (reorder, WINDOW + 3));
+  CU_ASSERT_EQUAL (rx_data (WINDOW - 1), 4);
+  check_delivered (WINDOW - 1, WINDOW + 3);
+  /* a jump far beyond the window with nothing in between */
+  CU_ASSERT_EQUAL (rx_data (3 * WINDOW), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (rx_data (3 * WINDOW - 1), NN_REORDER_ACCEPT);
+  CU_ASSERT (nn_reorder_wantsample (reorder, 3 * WINDOW - 2));
+  CU_ASSERT (!nn_reorder_wantsample (reorder, 3 * WINDOW - 1));
+  CU_ASSERT_EQUAL (rx_gap (WINDOW + 3, 3 * WINDOW - 1), 2);
+  check_delivered (3 * WINDOW - 1, 3 * WINDOW + 1);
+  CU_ASSERT_EQUAL (nn_reorder_next_seq (reorder), 3 * WINDOW + 1);
+  teardown ();
+}
+
+CU_Test(ddsi_reorder, gap)
+{
+  setup (100);
+  CU_ASSERT_EQUAL (rx_data (1), 1);
+  check_delivered (1, 2);
+  CU_ASSERT_EQUAL (rx_gap (1, 2), NN_REORDER_TOO_OLD);
+
+  /* a gap adjacent to stored samples merges with them */
+  CU_ASSERT_EQUAL (rx_data (10), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (rx_data (11), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (rx_gap (5, 10), NN_REORDER_ACCEPT);
+  for (seqno_t seq = 2; seq < 5; seq++)
+    CU_ASSERT (nn_reorder_wantsample (reorder, seq));
+  for (seqno_t seq = 5; seq < 12; seq++)
+    CU_ASSERT (!nn_reorder_wantsample (reorder, seq));
+  CU_ASSERT_EQUAL (rx_data (7), NN_REORDER_REJECT);
+  /* and extends to samples arriving later */
+  CU_ASSERT_EQUAL (rx_data (12), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (rx_data (3), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (rx_data (2), 2);
+  check_delivered (2, 4);
+  /* a gap at next_seq delivers everything that follows it */
+  CU_ASSERT (rx_gap (4, 5) > 0);
+  CU_ASSERT_EQUAL (ndelivered, 3);
+  CU_ASSERT_EQUAL (delivered[0], 10);
+  CU_ASSERT_EQUAL (delivered[1], 11);
+  CU_ASSERT_EQUAL (delivered[2], 12);
+  ndelivered = 0;
+  CU_ASSERT_EQUAL (nn_reorder_next_seq (reorder), 13);
+
+  /* a gap without any samples, beyond the window, then one that
+     connects it to next_seq */
+  CU_ASSERT_EQUAL (rx_gap (WINDOW + 20, WINDOW + 30), NN_REORDER_ACCEPT);
+  CU_ASSERT (nn_reorder_wantsample (reorder, WINDOW + 19));
+  CU_ASSERT (!nn_reorder_wantsample (reorder, WINDOW + 20));
+  CU_ASSERT (!nn_reorder_wantsample (reorder, WINDOW + 29));
+  CU_ASSERT (nn_reorder_wantsample (reorder, WINDOW + 30));
+  /* the stored gap is all there is to deliver */
+  CU_ASSERT_EQUAL (rx_gap (13, WINDOW + 20), 1);
+  CU_ASSERT_EQUAL (ndelivered, 0);
+  CU_ASSERT_EQUAL (nn_reorder_next_seq (reorder), WINDOW + 30);
+  CU_ASSERT_EQUAL (rx_data (WINDOW + 30), 1);
+  check_delivered (WINDOW + 30, WINDOW + 31);
+  teardown ();
+}
+
+static void check_nackmap (seqno_t base, seqno_t maxseq, uint32_t maxsz, int notail, uint32_t numbits, const char *missing)
+{
+  /* missing[i] is the expected state of bit i, '1' for a sequence
+     number to be NACK'd; it is repeated if shorter than numbits */
+  union {
+    nn_sequence_number_set_t set;
+    char buf[NN_SEQUENCE_NUMBER_SET_SIZE (256)];
+  } u;
+  const size_t len = strlen (missing);
+  CU_ASSERT_EQUAL_FATAL (nn_reorder_nackmap (reorder, base, maxseq, &u.set, maxsz, notail), numbits);
+  CU_ASSERT_EQUAL_FATAL (u.set.numbits, numbits);
+  CU_ASSERT_EQUAL_FATAL (fromSN (u.set.bitmap_base), base);
+  for (uint32_t i = 0; i < numbits; i++)
+    CU_ASSERT_EQUAL_FATAL (nn_bitset_isset (numbits, u.set.bits, i), missing[(i < len) ? i : len - 1] == '1');
+}
+
+CU_Test(ddsi_reorder, nackmap)
+{
+  setup (256);
+  /* nothing stored: everything up to maxseq is missing, or nothing at
+     all if the tail needn't be NACK'd */
+  CU_ASSERT_EQUAL (rx_data (1), 1);
+  check_nackmap (2, 10, 256, 0, 9, "1");
+  check_nackmap (2, 10, 256, 1, 0, "");
+  check_nackmap (2, 1, 256, 0, 0, "");
+  /* 3, 5-7 and 40 present (bit i is seq 2+i) */
+  CU_ASSERT_EQUAL (rx_data (3), NN_REORDER_ACCEPT);
+  for (seqno_t seq = 5; seq <= 7; seq++)
+    CU_ASSERT_EQUAL (rx_data (seq), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (rx_data (40), NN_REORDER_ACCEPT);
+  check_nackmap (2, 50, 256, 0, 49, "1010001111111111111111111111111111111101");
+  check_nackmap (2, 50, 256, 1, 39, "101000111111111111111111111111111111110");
+  check_nackmap (2, 50, 4, 0, 4, "1010");
+  check_nackmap (2, 5, 256, 0, 4, "1010");
+  /* a map crossing a word in the ring */
+  check_nackmap (2, 100, 256, 0, 99, "1010001111111111111111111111111111111101");
+  teardown ();
+}
+
+CU_Test(ddsi_reorder, nackmap_notail)
+{
+  /* bit i is seq 2+i, so seq 200 is bit 198 */
+  char exp[257];
+  memset (exp, '1', sizeof (exp) - 1);
+  exp[sizeof (exp) - 1] = 0;
+
+  /* the only sample known lies beyond the end of the map, but inside
+     the window: with notail, all of the map must still be NACK'd */
+  setup (MAXSEQ);
+  CU_ASSERT_EQUAL (rx_data (1), 1);
+  CU_ASSERT_EQUAL (rx_data (300), NN_REORDER_ACCEPT);
+  check_nackmap (2, 300, 256, 1, 256, exp);
+  check_nackmap (2, 300, 256, 0, 256, exp);
+  check_nackmap (2, 100, 64, 1, 64, exp);
+  CU_ASSERT_EQUAL (rx_data (200), NN_REORDER_ACCEPT);
+  exp[198] = '0';
+  check_nackmap (2, 300, 256, 1, 256, exp);
+  teardown ();
+
+  /* without anything beyond the map, the tail following the last
+     known sample is not */
+  setup (MAXSEQ);
+  CU_ASSERT_EQUAL (rx_data (1), 1);
+  CU_ASSERT_EQUAL (rx_data (200), NN_REORDER_ACCEPT);
+  check_nackmap (2, 300, 256, 1, 199, exp);
+  CU_ASSERT_EQUAL (rx_data (201), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (rx_data (202), NN_REORDER_ACCEPT);
+  exp[199] = exp[200] = '0';
+  check_nackmap (2, 300, 256, 1, 201, exp);
+  teardown ();
+}
+
+CU_Test(ddsi_reorder, full)
+{
+  struct nn_radmin_stats st;
+  setup (4);
+  for (seqno_t seq = 3; seq <= 6; seq++)
+    CU_ASSERT_EQUAL (rx_data (seq), NN_REORDER_ACCEPT);
+  /* neither growing the last interval nor a new one at the end */
+  CU_ASSERT_EQUAL (rx_data (7), NN_REORDER_REJECT);
+  CU_ASSERT_EQUAL (rx_data (9), NN_REORDER_REJECT);
+  CU_ASSERT_EQUAL (drops ().reorder_full, 2);
+  CU_ASSERT_EQUAL (rx_gap (20, 25), NN_REORDER_REJECT);
+  CU_ASSERT (nn_reorder_wantsample (reorder, 20));
+  /* an earlier one pushes out the last sample */
+  CU_ASSERT_EQUAL (rx_data (2), NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL (drops ().reorder_full, 3);
+  nn_reorder_stats (reorder, &st);
+  CU_ASSERT_EQUAL (st.n_samples, 4);
+  CU_ASSERT_EQUAL (st.max_samples, 4);
+  CU_ASSERT (!nn_reorder_wantsample (reorder, 5));
+  CU_ASSERT (nn_reorder_wantsample (reorder, 6));
+  /* the NACK bitmap is limited to what it can store */
+  check_nackmap (1, 100, 256, 0, 4, "1000");
+  /* a deliverable sample is always accepted */
+  CU_ASSERT_EQUAL (rx_data (1), 5);
+  check_delivered (1, 6);
+  CU_ASSERT_EQUAL (rx_data (6), 1);
+  check_delivered (6, 7);
+  teardown ();
+}
+
+/* DEFRAG_BITMAP_MIN_FRAGS in q_radmin.c: samples of this many fragments
+   or more are tracked in a bitmap.  The sample used has a short last
+   fragment. */
+#define NFRAGS 300
+#define FRAGSIZE 100
+#define SAMPLESIZE ((NFRAGS - 1) * FRAGSIZE + 40)
+
+static int rx_frag_bytes (seqno_t seq, uint32_t size, uint32_t min, uint32_t maxp1)
+{
+  /* returns whether the sample is complete, in which case the fragment
+     chain must cover the sample without holes */
+  struct nn_rmsg *rmsg = nn_rmsg_new (rbp);
+  struct nn_rsample_info sampleinfo;
+  struct nn_rdata *rdata;
+  struct nn_rsample *rsample;
+  nn_rmsg_setsize (rmsg, 64);
+  rdata = nn_rdata_new (rmsg, min, maxp1, 0, 0);
+  memset (&sampleinfo, 0, sizeof (sampleinfo));
+  sampleinfo.seq = seq;
+  sampleinfo.size = size;
+  sampleinfo.fragsize = FRAGSIZE;
+  if ((rsample = nn_defrag_rsample (defrag, rdata, &sampleinfo)) != NULL)
+  {
+    struct nn_rdata *fragchain = nn_rsample_fragchain (rsample), *f;
+    uint32_t end = 0;
+    for (f = fragchain; f; f = f->nextfrag)
+    {
+      CU_ASSERT_FATAL (f->min <= end && f->maxp1 > end);
+      end = f->maxp1;
+    }
+    CU_ASSERT_EQUAL_FATAL (end, size);
+    nn_fragchain_adjust_refcount (fragchain, 0);
+  }
+  nn_rmsg_commit (rmsg);
+  return rsample != NULL;
+}
+
+static int rx_frag (seqno_t seq, uint32_t first, uint32_t n)
+{
+  const uint32_t maxp1 = (first + n) * FRAGSIZE;
+  return rx_frag_bytes (seq, SAMPLESIZE, first * FRAGSIZE, (maxp1 < SAMPLESIZE) ? maxp1 : SAMPLESIZE);
+}
+
+static void check_fragmap (seqno_t seq, uint32_t maxfragnum, uint32_t maxsz, uint32_t base, uint32_t numbits, const unsigned char *received)
+{
+  /* bit i is expected to be set iff fragment base+i hasn't been received */
+  union {
+    nn_fragment_number_set_t set;
+    char buf[NN_FRAGMENT_NUMBER_SET_SIZE (256)];
+  } u;
+  CU_ASSERT_EQUAL_FATAL (nn_defrag_nackmap (defrag, seq, maxfragnum, &u.set, maxsz), (int) numbits);
+  CU_ASSERT_EQUAL_FATAL (u.set.numbits, numbits);
+  if (numbits > 0)
+    CU_ASSERT_EQUAL_FATAL (u.set.bitmap_base, base);
+  for (uint32_t i = 0; i < numbits; i++)
+    CU_ASSERT_EQUAL_FATAL (nn_bitset_isset (numbits, u.set.bits, i), !received[base + i]);
+}
+
+CU_Test(ddsi_defrag, out_of_order)
+{
+  static uint32_t perm[NFRAGS];
+  static unsigned char received[NFRAGS];
+  setup (4);
+  srand (1);
+  for (uint32_t i = 0; i < NFRAGS; i++)
+    perm[i] = i;
+  for (uint32_t i = NFRAGS - 1; i > 0; i--)
+  {
+    const uint32_t j = (uint32_t) rand () % (i + 1), t = perm[i];
+    perm[i] = perm[j];
+    perm[j] = t;
+  }
+  memset (received, 0, sizeof (received));
+  for (uint32_t i = 0; i < NFRAGS; i++)
+  {
+    uint32_t first = 0, last = NFRAGS - 1;
+    CU_ASSERT_EQUAL_FATAL (rx_frag (1, perm[i], 1), i == NFRAGS - 1);
+    received[perm[i]] = 1;
+    if (i == NFRAGS - 1)
+      break;
+    /* the map runs from the first to the last missing fragment */
+    while (received[first])
+      first++;
+    while (received[last])
+      last--;
+    check_fragmap (1, UINT32_MAX, 256, first, (last - first + 1 < 256) ? last - first + 1 : 256, received);
+  }
+  /* once complete, the defragmenter no longer knows it */
+  CU_ASSERT_EQUAL (nn_defrag_nackmap (defrag, 1, UINT32_MAX, NULL, 256), -1);
+  teardown ();
+}
+
+CU_Test(ddsi_defrag, duplicate)
+{
+  setup (4);
+  for (uint32_t i = 0; i < NFRAGS; i++)
+    if (i != 7)
+      CU_ASSERT_EQUAL_FATAL (rx_frag (1, i, 1), 0);
+  /* duplicates of single fragments and of ranges don't count */
+  CU_ASSERT_EQUAL (rx_frag (1, 5, 1), 0);
+  CU_ASSERT_EQUAL (rx_frag (1, 0, 7), 0);
+  CU_ASSERT_EQUAL (rx_frag (1, NFRAGS - 1, 1), 0);
+  CU_ASSERT_EQUAL (rx_frag (1, 7, 1), 1);
+  teardown ();
+}
+
+CU_Test(ddsi_defrag, overlap)
+{
+  static unsigned char received[NFRAGS];
+  setup (4);
+  memset (received, 0, sizeof (received));
+  /* a first rdata that doesn't cover a fragment completely isn't stored */
+  CU_ASSERT_EQUAL (rx_frag_bytes (1, SAMPLESIZE, 50, 150), 0);
+  CU_ASSERT_EQUAL (nn_defrag_nackmap (defrag, 1, UINT32_MAX, NULL, 256), -1);
+  /* fragments 0-9, then a range partially overlapping 9 and 20 that
+     only provides 10-19 */
+  CU_ASSERT_EQUAL (rx_frag (1, 0, 10), 0);
+  CU_ASSERT_EQUAL (rx_frag_bytes (1, SAMPLESIZE, 950, 2050), 0);
+  memset (received, 1, 20);
+  check_fragmap (1, 30, 256, 20, 11, received);
+  /* nothing new, or only part of fragments */
+  CU_ASSERT_EQUAL (rx_frag_bytes (1, SAMPLESIZE, 100, 1900), 0);
+  CU_ASSERT_EQUAL (rx_frag_bytes (1, SAMPLESIZE, 2050, 2150), 0);
+  check_fragmap (1, 30, 256, 20, 11, received);
+  /* a range covering the remainder, but starting in the middle of 19,
+     completes it with all rdata chained without a gap */
+  CU_ASSERT_EQUAL (rx_frag_bytes (1, SAMPLESIZE, 1950, SAMPLESIZE), 1);
+  teardown ();
+}
+
+CU_Test(ddsi_defrag, last_fragment)
+{
+  static unsigned char received[NFRAGS];
+  setup (4);
+  memset (received, 0, sizeof (received));
+  /* the short last fragment is missing: the map ends at it, even when
+     asking for more than there is */
+  CU_ASSERT_EQUAL (rx_frag (1, 0, NFRAGS - 1), 0);
+  memset (received, 1, NFRAGS - 1);
+  check_fragmap (1, UINT32_MAX, 256, NFRAGS - 1, 1, received);
+  check_fragmap (1, NFRAGS + 100, 256, NFRAGS - 1, 1, received);
+  check_fragmap (1, NFRAGS - 2, 256, 0, 0, received);
+  /* only part of the last fragment doesn't complete it */
+  CU_ASSERT_EQUAL (rx_frag_bytes (1, SAMPLESIZE, SAMPLESIZE - 30, SAMPLESIZE), 0);
+  CU_ASSERT_EQUAL (rx_frag_bytes (1, SAMPLESIZE, SAMPLESIZE - 40, SAMPLESIZE), 1);
+
+  /* a sample of exactly the minimum number of full fragments, only the
+     last one received first */
+  memset (received, 0, sizeof (received));
+  CU_ASSERT_EQUAL (rx_frag_bytes (2, 256 * FRAGSIZE, 255 * FRAGSIZE, 256 * FRAGSIZE), 0);
+  received[255] = 1;
+  check_fragmap (2, UINT32_MAX, 256, 0, 255, received);
+  CU_ASSERT_EQUAL (rx_frag_bytes (2, 256 * FRAGSIZE, 0, 255 * FRAGSIZE), 1);
+  teardown ();
+}
+
+CU_Test(ddsi_defrag, nackmap)
+{
+  static unsigned char received[NFRAGS];
+  setup (4);
+  memset (received, 0, sizeof (received));
+  /* 0-9, 20, 40-299 except 100 */
+  CU_ASSERT_EQUAL (rx_frag (1, 0, 10), 0);
+  CU_ASSERT_EQUAL (rx_frag (1, 20, 1), 0);
+  CU_ASSERT_EQUAL (rx_frag (1, 40, 60), 0);
+  CU_ASSERT_EQUAL (rx_frag (1, 101, NFRAGS - 101), 0);
+  memset (received, 1, 10);
+  received[20] = 1;
+  memset (received + 40, 1, NFRAGS - 40);
+  received[100] = 0;
+  check_fragmap (1, UINT32_MAX, 256, 10, 91, received);
+  /* limited by the highest fragment known to exist and by the size */
+  check_fragmap (1, 30, 256, 10, 21, received);
+  check_fragmap (1, 99, 256, 10, 30, received);
+  check_fragmap (1, UINT32_MAX, 8, 10, 8, received);
+  check_fragmap (1, UINT32_MAX, 32, 10, 32, received);
+  /* a sample it doesn't know: all that is known to exist, or nothing */
+  memset (received, 0, sizeof (received));
+  check_fragmap (2, 9, 256, 0, 10, received);
+  check_fragmap (2, NFRAGS, 256, 0, 256, received);
+  CU_ASSERT_EQUAL (nn_defrag_nackmap (defrag, 2, UINT32_MAX, NULL, 256), -1);
+  /* a Gap makes it forget about the sample */
+  rx_gap (1, 2);
+  CU_ASSERT_EQUAL (nn_defrag_nackmap (defrag, 1, UINT32_MAX, NULL, 256), -1);
+  teardown ();
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+
+/* Compares bit-at-a-time processing of sequence number sets with the
+   word-level kernels of q_bitset.h, for the three things done with
+   them: visiting the set bits (retransmitting the samples nack'd by an
+   AckNack), extracting runs of set bits (a Gap's list) and building a
+   set from intervals (a nack bitmap from the reorder admin).  NSETS
+   sets of NUMBITS bits are generated in which a bit is set with a
+   probability of LOSS per mille, in runs of BURST bits.
+
+   usage: bitset_bench [NUMBITS [LOSS [BURST [NSETS]]]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "os/os.h"
+#include "ddsi/q_bitset.h"
+
+#define REPEAT 100
+
+static double since (os_time t0)
+{
+  os_time t1 = os_timeGetMonotonic ();
+  return (double) (t1.tv_sec - t0.tv_sec) + (double) (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static uint64_t scan_bitwise (unsigned numbits, const unsigned *bits)
+{
+  uint64_t sum = 0;
+  for (unsigned i = 0; i < numbits; i++)
+    if (nn_bitset_isset (numbits, bits, i))
+      sum += i;
+  return sum;
+}
+
+static uint64_t scan_words (unsigned numbits, const unsigned *bits)
+{
+  uint64_t sum = 0;
+  for (unsigned i = nn_bitset_find_set (numbits, bits, 0); i < numbits; i = nn_bitset_find_set (numbits, bits, i + 1))
+    sum += i;
+  return sum;
+}
+
+static uint64_t runs_bitwise (unsigned numbits, const unsigned *bits)
+{
+  uint64_t sum = 0;
+  unsigned i = 0;
+  while (i < numbits)
+  {
+    if (!nn_bitset_isset (numbits, bits, i))
+      i++;
+    else
+    {
+      unsigned j;
+      for (j = i + 1; j < numbits; j++)
+        if (!nn_bitset_isset (numbits, bits, j))
+          break;
+      sum += (uint64_t) i * j;
+      i = j;
+    }
+  }
+  return sum;
+}
+
+static uint64_t runs_words (unsigned numbits, const unsigned *bits)
+{
+  uint64_t sum = 0;
+  unsigned i = 0;
+  while ((i = nn_bitset_find_set (numbits, bits, i)) < numbits)
+  {
+    const unsigned j = nn_bitset_find_clear (numbits, bits, i + 1);
+    sum += (uint64_t) i * j;
+    i = j;
+  }
+  return sum;
+}
+
+static void build_bitwise (unsigned numbits, unsigned *bits, unsigned nivs, const unsigned *ivs)
+{
+  nn_bitset_zero (numbits, bits);
+  for (unsigned k = 0; k < nivs; k++)
+    for (unsigned i = ivs[2*k]; i < ivs[2*k+1]; i++)
+      nn_bitset_set (numbits, bits, i);
+}
+
+static void build_words (unsigned numbits, unsigned *bits, unsigned nivs, const unsigned *ivs)
+{
+  nn_bitset_zero (numbits, bits);
+  for (unsigned k = 0; k < nivs; k++)
+    nn_bitset_set_range (numbits, bits, ivs[2*k], ivs[2*k+1]);
+}
+
+int main (int argc, char **argv)
+{
+  const unsigned numbits = (argc > 1) ? (unsigned) atoi (argv[1]) : 256;
+  const unsigned loss = (argc > 2) ? (unsigned) atoi (argv[2]) : 10;
+  const unsigned burst = (argc > 3) ? (unsigned) atoi (argv[3]) : 1;
+  const unsigned nsets = (argc > 4) ? (unsigned) atoi (argv[4]) : 10000;
+  const unsigned nw = (numbits + 31) / 32;
+  unsigned *sets, *nivs, *ivs, *tmp;
+  uint64_t sum[2];
+  double dt[2];
+  os_time t0;
+  int failed = 0;
+
+  if (numbits == 0 || loss > 1000 || burst == 0 || nsets == 0)
+  {
+    fprintf (stderr, "usage: %s [NUMBITS [LOSS [BURST [NSETS]]]]\n", argv[0]);
+    return 2;
+  }
+
+  /* the sets, and the same described as intervals of set bits */
+  sets = os_malloc (nsets * nw * sizeof (*sets));
+  nivs = os_malloc (nsets * sizeof (*nivs));
+  ivs = os_malloc (nsets * (numbits + 1) * sizeof (*ivs));
+  tmp = os_malloc (nw * sizeof (*tmp));
+  srand (314159265);
+  for (unsigned s = 0; s < nsets; s++)
+  {
+    unsigned *bits = sets + s * nw, *iv = ivs + s * (numbits + 1);
+    nn_bitset_zero (numbits, bits);
+    nivs[s] = 0;
+    for (unsigned i = 0; i < numbits; )
+    {
+      if ((unsigned) (rand () % 1000) >= loss)
+        i++;
+      else
+      {
+        const unsigned end = (i + burst < numbits) ? i + burst : numbits;
+        if (nivs[s] > 0 && iv[2 * nivs[s] - 1] == i)
+          iv[2 * nivs[s] - 1] = end;
+        else
+        {
+          iv[2 * nivs[s]] = i;
+          iv[2 * nivs[s] + 1] = end;
+          nivs[s]++;
+        }
+        for (; i < end; i++)
+          nn_bitset_set (numbits, bits, i);
+      }
+    }
+  }
+
+#define RUN(k, expr) do {                                       \
+    sum[k] = 0;                                                 \
+    t0 = os_timeGetMonotonic ();                                \
+    for (unsigned r = 0; r < REPEAT; r++)                       \
+      for (unsigned s = 0; s < nsets; s++)                      \
+        sum[k] += (expr);                                       \
+    dt[k] = since (t0) / REPEAT / nsets * 1e9;                  \
+  } while (0)
+#define REPORT(name) do {                                                       \
+    printf ("%-6s bitwise %8.1f ns/set  words %8.1f ns/set  speedup %.1fx\n",  \
+            name, dt[0], dt[1], dt[0] / dt[1]);                                 \
+    if (sum[0] != sum[1]) {                                                     \
+      fprintf (stderr, "%s: results differ\n", name);                          \
+      failed = 1;                                                               \
+    }                                                                           \
+  } while (0)
+
+  printf ("%u sets of %u bits, %u/1000 set in runs of %u\n", nsets, numbits, loss, burst);
+  RUN (0, scan_bitwise (numbits, sets + s * nw));
+  RUN (1, scan_words (numbits, sets + s * nw));
+  REPORT ("scan");
+  RUN (0, runs_bitwise (numbits, sets + s * nw));
+  RUN (1, runs_words (numbits, sets + s * nw));
+  REPORT ("runs");
+  RUN (0, (build_bitwise (numbits, tmp, nivs[s], ivs + s * (numbits + 1)), (uint64_t) (memcmp (tmp, sets + s * nw, nw * sizeof (*tmp)) != 0)));
+  RUN (1, (build_words (numbits, tmp, nivs[s], ivs + s * (numbits + 1)), (uint64_t) (memcmp (tmp, sets + s * nw, nw * sizeof (*tmp)) != 0)));
+  REPORT ("build");
+  if (sum[0] != 0)
+  {
+    fprintf (stderr, "build: sets differ from the originals\n");
+    failed = 1;
+  }
+
+  os_free (tmp);
+  os_free (ivs);
+  os_free (nivs);
+  os_free (sets);
+  return failed;
+}
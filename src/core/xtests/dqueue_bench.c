@@ -0,0 +1,142 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+
+/* Measures the throughput of a delivery queue: NPRODUCERS threads
+   each enqueue NSAMPLES samples in chains of CHAINLEN, the way the
+   receive threads hand over samples, and the delivery thread runs a
+   trivial handler. Producers wait for the queue to drain when it is
+   full, instead of dropping the samples like the receive path does.
+
+   usage: dqueue_bench [NPRODUCERS [NSAMPLES [CHAINLEN [MAXSAMPLES]]]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "os/os.h"
+#include "ddsc/dds.h"
+#include "ddsi/q_radmin.h"
+
+struct producer {
+  struct nn_dqueue *q;
+  struct nn_rsample_chain_elem *elems;
+  struct nn_rsample_info sampleinfo;
+  unsigned nsamples;
+  unsigned chainlen;
+  os_threadId tid;
+};
+
+static os_atomic_uint32_t nhandled = OS_ATOMIC_UINT32_INIT (0);
+
+static int handler (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const nn_guid_t *rdguid, void *qarg)
+{
+  (void) sampleinfo; (void) fragchain; (void) rdguid; (void) qarg;
+  os_atomic_inc32 (&nhandled);
+  return 0;
+}
+
+static uint32_t producer_thread (void *varg)
+{
+  struct producer *p = varg;
+  unsigned i = 0;
+  while (i < p->nsamples)
+  {
+    struct nn_rsample_chain sc;
+    unsigned n = (p->nsamples - i < p->chainlen) ? p->nsamples - i : p->chainlen;
+    sc.first = &p->elems[i];
+    sc.last = &p->elems[i + n - 1];
+    for (unsigned k = i; k < i + n; k++)
+    {
+      p->elems[k].fragchain = NULL;
+      p->elems[k].sampleinfo = &p->sampleinfo;
+      p->elems[k].next = (k + 1 < i + n) ? &p->elems[k + 1] : NULL;
+    }
+    nn_dqueue_wait_until_empty_if_full (p->q);
+    nn_dqueue_enqueue (p->q, &sc, (nn_reorder_result_t) n);
+    i += n;
+  }
+  return 0;
+}
+
+int main (int argc, char **argv)
+{
+  const unsigned nproducers = (argc > 1) ? (unsigned) atoi (argv[1]) : 1;
+  const unsigned nsamples = (argc > 2) ? (unsigned) atoi (argv[2]) : 1000000;
+  const unsigned chainlen = (argc > 3) ? (unsigned) atoi (argv[3]) : 1;
+  const unsigned maxsamples = (argc > 4) ? (unsigned) atoi (argv[4]) : 1000;
+  struct producer *ps;
+  struct nn_dqueue *q;
+  dds_entity_t pp;
+  os_threadAttr tattr;
+  os_time t0, t1;
+  double dt;
+
+  if (nproducers == 0 || nsamples == 0 || chainlen == 0 || maxsamples == 0)
+  {
+    fprintf (stderr, "usage: %s [NPRODUCERS [NSAMPLES [CHAINLEN [MAXSAMPLES]]]]\n", argv[0]);
+    return 2;
+  }
+
+  /* the participant is only there to initialise the thread administration */
+  if ((pp = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL)) < 0)
+  {
+    fprintf (stderr, "dds_create_participant failed\n");
+    return 1;
+  }
+  if ((q = nn_dqueue_new ("bench", maxsamples, handler, NULL)) == NULL)
+  {
+    fprintf (stderr, "nn_dqueue_new failed\n");
+    return 1;
+  }
+
+  ps = os_malloc (nproducers * sizeof (*ps));
+  for (unsigned i = 0; i < nproducers; i++)
+  {
+    ps[i].q = q;
+    ps[i].elems = os_malloc (nsamples * sizeof (*ps[i].elems));
+    memset (&ps[i].sampleinfo, 0, sizeof (ps[i].sampleinfo));
+    ps[i].nsamples = nsamples;
+    ps[i].chainlen = chainlen;
+  }
+
+  os_threadAttrInit (&tattr);
+  t0 = os_timeGetMonotonic ();
+  for (unsigned i = 0; i < nproducers; i++)
+  {
+    if (os_threadCreate (&ps[i].tid, "producer", &tattr, producer_thread, &ps[i]) != os_resultSuccess)
+    {
+      fprintf (stderr, "producer %u: thread creation failed\n", i);
+      return 1;
+    }
+  }
+  for (unsigned i = 0; i < nproducers; i++)
+    os_threadWaitExit (ps[i].tid, NULL);
+  /* freeing the queue drains it */
+  nn_dqueue_free (q);
+  t1 = os_timeGetMonotonic ();
+
+  dt = (double) (t1.tv_sec - t0.tv_sec) + (double) (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  printf ("%u producers, chains of %u: %u samples in %.3fs: %.2f Msamples/s\n",
+          nproducers, chainlen, os_atomic_ld32 (&nhandled), dt, os_atomic_ld32 (&nhandled) / dt / 1e6);
+
+  for (unsigned i = 0; i < nproducers; i++)
+    os_free (ps[i].elems);
+  os_free (ps);
+  dds_delete (pp);
+  if (os_atomic_ld32 (&nhandled) != nproducers * nsamples)
+  {
+    fprintf (stderr, "%u samples handled, expected %u\n", os_atomic_ld32 (&nhandled), nproducers * nsamples);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+
+/* Measures the cost of running samples through the defragmenter and
+   the reorder admin of a reliable proxy writer, the way a receive
+   thread does it, under a simulated loss pattern.  Starting at a
+   sequence number, a burst of BURST consecutive samples is lost with
+   a probability of LOSS per mille; each burst gets repaired DELAY
+   samples later, by retransmitting the samples or, in GAP percent of
+   the cases, by a Gap.  Every 16 samples a NACK bitmap is generated,
+   as for a heartbeat.  It checks that all samples that are not
+   covered by a Gap are delivered exactly once and in order.
+
+   usage: reorder_bench [NSAMPLES [LOSS [BURST [DELAY [GAP [MAXSAMPLES]]]]]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "os/os.h"
+#include "ddsc/dds.h"
+#include "ddsi/q_protocol.h"
+#include "ddsi/q_radmin.h"
+
+struct repair {
+  uint32_t due;
+  seqno_t min, maxp1;
+  int gap;
+};
+
+struct state {
+  struct nn_rbufpool *rbp;
+  struct nn_defrag *defrag;
+  struct nn_reorder *reorder;
+  unsigned char *gapped;
+  seqno_t next_deliver;
+  uint32_t ndelivered, ngapped;
+  uint32_t nnacked;
+  int failed;
+};
+
+static void deliver (struct state *st, struct nn_rsample_chain *sc)
+{
+  struct nn_rsample_chain_elem *e = sc->first, *e1;
+  while (e)
+  {
+    /* unref may free the memory holding e */
+    e1 = e->next;
+    if (e->sampleinfo)
+    {
+      if (e->sampleinfo->seq < st->next_deliver)
+      {
+        fprintf (stderr, "delivered %"PRId64", expected %"PRId64"\n", e->sampleinfo->seq, st->next_deliver);
+        st->failed = 1;
+      }
+      for (; st->next_deliver < e->sampleinfo->seq; st->next_deliver++)
+      {
+        if (!st->gapped[st->next_deliver])
+        {
+          fprintf (stderr, "%"PRId64" skipped but not covered by a gap\n", st->next_deliver);
+          st->failed = 1;
+        }
+      }
+      st->next_deliver = e->sampleinfo->seq + 1;
+      st->ndelivered++;
+    }
+    nn_fragchain_unref (e->fragchain);
+    e = e1;
+  }
+}
+
+static void receive_data (struct state *st, seqno_t seq)
+{
+  struct nn_rmsg *rmsg = nn_rmsg_new (st->rbp);
+  struct nn_rsample_info sampleinfo;
+  struct nn_rdata *rdata;
+  struct nn_rsample *rsample;
+  nn_rmsg_setsize (rmsg, 64);
+  rdata = nn_rdata_new (rmsg, 0, 64, 0, 0);
+  memset (&sampleinfo, 0, sizeof (sampleinfo));
+  sampleinfo.seq = seq;
+  sampleinfo.size = 64;
+  sampleinfo.fragsize = 64;
+  if ((rsample = nn_defrag_rsample (st->defrag, rdata, &sampleinfo)) != NULL)
+  {
+    struct nn_rdata *fragchain = nn_rsample_fragchain (rsample);
+    struct nn_rsample_chain sc;
+    int refc_adjust = 0;
+    if (nn_reorder_rsample (&sc, st->reorder, rsample, &refc_adjust, 0) > 0)
+      deliver (st, &sc);
+    nn_fragchain_adjust_refcount (fragchain, refc_adjust);
+  }
+  nn_rmsg_commit (rmsg);
+}
+
+static void receive_gap (struct state *st, seqno_t min, seqno_t maxp1)
+{
+  struct nn_rmsg *rmsg = nn_rmsg_new (st->rbp);
+  struct nn_rdata *gap;
+  struct nn_rsample_chain sc;
+  int refc_adjust = 0;
+  nn_rmsg_setsize (rmsg, 64);
+  nn_defrag_notegap (st->defrag, min, maxp1);
+  gap = nn_rdata_newgap (rmsg);
+  if (nn_reorder_gap (&sc, st->reorder, gap, min, maxp1, &refc_adjust) > 0)
+    deliver (st, &sc);
+  nn_fragchain_adjust_refcount (gap, refc_adjust);
+  nn_rmsg_commit (rmsg);
+}
+
+static void nack (struct state *st, seqno_t maxseq)
+{
+  union {
+    nn_sequence_number_set_t set;
+    char buf[NN_SEQUENCE_NUMBER_SET_SIZE (256)];
+  } u;
+  const seqno_t base = nn_reorder_next_seq (st->reorder);
+  nn_reorder_nackmap (st->reorder, base, maxseq, &u.set, 256, 0);
+  for (uint32_t i = 0; i < u.set.numbits; i++)
+    if (u.set.bits[i / 32] & (0x80000000u >> (i % 32)))
+      st->nnacked++;
+}
+
+int main (int argc, char **argv)
+{
+  const uint32_t nsamples = (argc > 1) ? (uint32_t) atoi (argv[1]) : 1000000;
+  const uint32_t loss = (argc > 2) ? (uint32_t) atoi (argv[2]) : 0;
+  const uint32_t burst = (argc > 3) ? (uint32_t) atoi (argv[3]) : 1;
+  const uint32_t delay = (argc > 4) ? (uint32_t) atoi (argv[4]) : 10;
+  const uint32_t gappct = (argc > 5) ? (uint32_t) atoi (argv[5]) : 0;
+  const uint32_t maxsamples = (argc > 6) ? (uint32_t) atoi (argv[6]) : 1000;
+  struct repair *repairs;
+  uint32_t rd = 0, wr = 0;
+  struct state st;
+  dds_entity_t pp;
+  os_time t0, t1;
+  double dt;
+  uint32_t t;
+
+  if (nsamples == 0 || loss > 1000 || burst == 0 || gappct > 100)
+  {
+    fprintf (stderr, "usage: %s [NSAMPLES [LOSS [BURST [DELAY [GAP [MAXSAMPLES]]]]]]\n", argv[0]);
+    return 2;
+  }
+
+  /* the participant is only there to initialise the configuration */
+  if ((pp = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL)) < 0)
+  {
+    fprintf (stderr, "dds_create_participant failed\n");
+    return 1;
+  }
+
+  memset (&st, 0, sizeof (st));
+  if ((st.rbp = nn_rbufpool_new (1048576, 65536)) == NULL || nn_rbufpool_populate (st.rbp) < 0)
+  {
+    fprintf (stderr, "can't create rbufpool\n");
+    return 1;
+  }
+  st.defrag = nn_defrag_new (NN_DEFRAG_DROP_LATEST, maxsamples);
+  st.reorder = nn_reorder_new (NN_REORDER_MODE_NORMAL, maxsamples);
+  st.next_deliver = 1;
+  st.gapped = os_malloc (nsamples + 1);
+  memset (st.gapped, 0, nsamples + 1);
+  repairs = os_malloc ((nsamples + 1) * sizeof (*repairs));
+  srand (314159265);
+
+  t0 = os_timeGetMonotonic ();
+  t = 0;
+  for (seqno_t seq = 1; seq <= nsamples; t++)
+  {
+    if (loss > 0 && (uint32_t) (rand () % 1000) < loss)
+    {
+      repairs[wr].due = t + delay;
+      repairs[wr].min = seq;
+      repairs[wr].maxp1 = (seq + burst <= nsamples + 1) ? seq + burst : nsamples + 1;
+      if ((repairs[wr].gap = (uint32_t) (rand () % 100) < gappct) != 0)
+      {
+        memset (st.gapped + seq, 1, (size_t) (repairs[wr].maxp1 - seq));
+        st.ngapped += (uint32_t) (repairs[wr].maxp1 - seq);
+      }
+      seq = repairs[wr].maxp1;
+      wr++;
+    }
+    else
+    {
+      receive_data (&st, seq++);
+    }
+    while (rd < wr && repairs[rd].due <= t)
+    {
+      if (repairs[rd].gap)
+        receive_gap (&st, repairs[rd].min, repairs[rd].maxp1);
+      else
+        for (seqno_t s = repairs[rd].min; s < repairs[rd].maxp1; s++)
+          receive_data (&st, s);
+      rd++;
+    }
+    if ((t % 16) == 0)
+      nack (&st, seq - 1);
+  }
+  for (; rd < wr; rd++)
+  {
+    if (repairs[rd].gap)
+      receive_gap (&st, repairs[rd].min, repairs[rd].maxp1);
+    else
+      for (seqno_t s = repairs[rd].min; s < repairs[rd].maxp1; s++)
+        receive_data (&st, s);
+  }
+  t1 = os_timeGetMonotonic ();
+
+  dt = (double) (t1.tv_sec - t0.tv_sec) + (double) (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  printf ("%"PRIu32" samples, loss %"PRIu32"/1000 in bursts of %"PRIu32" repaired after %"PRIu32": "
+          "%"PRIu32" delivered %"PRIu32" gapped %"PRIu32" nacked in %.3fs: %.2f Msamples/s\n",
+          nsamples, loss, burst, delay, st.ndelivered, st.ngapped, st.nnacked, dt, nsamples / dt / 1e6);
+
+  nn_reorder_free (st.reorder);
+  nn_defrag_free (st.defrag);
+  nn_rbufpool_free (st.rbp);
+  os_free (repairs);
+  os_free (st.gapped);
+  dds_delete (pp);
+  if (st.failed || st.ndelivered + st.ngapped != nsamples)
+  {
+    fprintf (stderr, "%"PRIu32" delivered + %"PRIu32" gapped, expected %"PRIu32"\n", st.ndelivered, st.ngapped, nsamples);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+
+/* Measures the cost of a wakeup of a socket waitset containing many
+   sockets, each wakeup caused by a single datagram arriving on a
+   randomly chosen socket. It is built twice: once using the default
+   implementation for the platform (sockwaitset_bench) and once with
+   the select-based one (sockwaitset_bench_select).
+
+   usage: sockwaitset_bench [NSOCKS [NWAKEUPS]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "os/os.h"
+#include "ddsi/ddsi_tran.h"
+#include "ddsi/q_sockwaitset.h"
+
+struct bench_conn {
+  struct ddsi_tran_conn c;
+  os_socket sock;
+  struct sockaddr_in addr;
+};
+
+static os_socket bench_conn_handle (ddsi_tran_base_t base)
+{
+  return ((struct bench_conn *) base)->sock;
+}
+
+static int make_conn (struct bench_conn *bc)
+{
+  socklen_t addrlen = sizeof (bc->addr);
+  memset (bc, 0, sizeof (*bc));
+  bc->c.m_base.m_handle_fn = bench_conn_handle;
+  bc->c.m_connless = true;
+  if ((bc->sock = socket (AF_INET, SOCK_DGRAM, 0)) == OS_INVALID_SOCKET)
+    return -1;
+  bc->addr.sin_family = AF_INET;
+  bc->addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (bind (bc->sock, (struct sockaddr *) &bc->addr, sizeof (bc->addr)) == -1 ||
+      getsockname (bc->sock, (struct sockaddr *) &bc->addr, &addrlen) == -1)
+  {
+    os_sockFree (bc->sock);
+    return -1;
+  }
+  return 0;
+}
+
+int main (int argc, char **argv)
+{
+  const unsigned nsocks = (argc > 1) ? (unsigned) atoi (argv[1]) : 1000;
+  const unsigned nwakeups = (argc > 2) ? (unsigned) atoi (argv[2]) : 100000;
+  struct bench_conn *conns;
+  os_sockWaitset ws;
+  os_socket tx;
+  os_time t0, t1;
+  unsigned i, nevents = 0, nmismatch = 0;
+  uint32_t rnd = 1;
+  double dt;
+
+  if (nsocks == 0 || nwakeups == 0)
+  {
+    fprintf (stderr, "usage: %s [NSOCKS [NWAKEUPS]]\n", argv[0]);
+    return 2;
+  }
+  os_osInit ();
+  if ((ws = os_sockWaitsetNew ()) == NULL)
+  {
+    fprintf (stderr, "os_sockWaitsetNew failed\n");
+    return 1;
+  }
+  conns = os_malloc (nsocks * sizeof (*conns));
+  for (i = 0; i < nsocks; i++)
+  {
+    if (make_conn (&conns[i]) < 0)
+    {
+      fprintf (stderr, "socket %u: creation failed (too many open files?)\n", i);
+      return 1;
+    }
+    if (os_sockWaitsetAdd (ws, &conns[i].c) != 1)
+    {
+      fprintf (stderr, "socket %u: os_sockWaitsetAdd failed\n", i);
+      return 1;
+    }
+  }
+  tx = socket (AF_INET, SOCK_DGRAM, 0);
+
+  t0 = os_timeGetMonotonic ();
+  for (i = 0; i < nwakeups; i++)
+  {
+    os_sockWaitsetCtx ctx;
+    ddsi_tran_conn_t conn;
+    unsigned k;
+    char buf = 0;
+    int idx;
+    rnd = rnd * 1103515245u + 12345u;
+    k = (rnd >> 8) % nsocks;
+    (void) sendto (tx, &buf, 1, 0, (struct sockaddr *) &conns[k].addr, sizeof (conns[k].addr));
+    if ((ctx = os_sockWaitsetWait (ws)) == NULL)
+      continue;
+    while ((idx = os_sockWaitsetNextEvent (ctx, &conn)) >= 0)
+    {
+      struct bench_conn *bc = (struct bench_conn *) conn;
+      if ((unsigned) idx != (unsigned) (bc - conns))
+        nmismatch++;
+      (void) recv (bc->sock, &buf, 1, 0);
+      nevents++;
+    }
+  }
+  t1 = os_timeGetMonotonic ();
+
+  dt = (double) (t1.tv_sec - t0.tv_sec) + (double) (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  printf ("%u sockets: %u wakeups %u events in %.3fs: %.2f us/wakeup\n",
+          nsocks, nwakeups, nevents, dt, 1e6 * dt / nwakeups);
+
+  os_sockFree (tx);
+  os_sockWaitsetFree (ws);
+  for (i = 0; i < nsocks; i++)
+    os_sockFree (conns[i].sock);
+  os_free (conns);
+  os_osExit ();
+  if (nmismatch > 0)
+  {
+    fprintf (stderr, "%u events with an unexpected index\n", nmismatch);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+
+/* Compares the fibonacci heap and the timing wheel as a timed-event
+   queue, the way the xevent thread uses it: NEVENTS periodic events
+   with periods between 1ms and 1s (as for heartbeats and acknacks),
+   for every event handled another randomly chosen event is
+   rescheduled to an earlier time (as resched_xevent_if_earlier does
+   when data arrives).  Each event handled and each rescheduling
+   counts as one operation; every event is handled about 10 times.
+   It checks that both handle the events in the same order.
+
+   usage: twheel_bench [NEVENTS...] (default 1000 10000 100000) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "os/os.h"
+#include "util/ut_fibheap.h"
+#include "util/ut_twheel.h"
+
+struct ev {
+  ut_fibheapNode_t fhnode;
+  ut_twheelNode_t twnode;
+  int64_t t;
+  int64_t period;
+};
+
+struct queue_ops {
+  const char *name;
+  void (*init) (void);
+  void (*insert) (struct ev *ev);
+  struct ev *(*min) (void);
+  void (*extract) (struct ev *ev);
+  void (*decrease) (struct ev *ev);
+};
+
+static int cmp_ev (const void *va, const void *vb)
+{
+  const struct ev *a = va, *b = vb;
+  return (a->t == b->t) ? 0 : (a->t < b->t) ? -1 : 1;
+}
+
+static const ut_fibheapDef_t fhdef = UT_FIBHEAPDEF_INITIALIZER (offsetof (struct ev, fhnode), cmp_ev);
+static ut_fibheap_t fh;
+static void fh_init (void) { ut_fibheapInit (&fhdef, &fh); }
+static void fh_insert (struct ev *ev) { ut_fibheapInsert (&fhdef, &fh, ev); }
+static struct ev *fh_min (void) { return ut_fibheapMin (&fhdef, &fh); }
+static void fh_extract (struct ev *ev) { (void) ev; (void) ut_fibheapExtractMin (&fhdef, &fh); }
+static void fh_decrease (struct ev *ev) { ut_fibheapDecreaseKey (&fhdef, &fh, ev); }
+
+/* same tick as the xevent queue */
+static const ut_twheelDef_t twdef = UT_TWHEELDEF_INITIALIZER (offsetof (struct ev, twnode), offsetof (struct ev, t), 10);
+static ut_twheel_t tw;
+static void tw_init (void) { ut_twheelInit (&twdef, &tw); }
+static void tw_insert (struct ev *ev) { ut_twheelInsert (&twdef, &tw, ev); }
+static struct ev *tw_min (void) { return ut_twheelMin (&twdef, &tw); }
+static void tw_extract (struct ev *ev) { ut_twheelDelete (&twdef, &tw, ev); }
+static void tw_decrease (struct ev *ev) { ut_twheelUpdateKey (&twdef, &tw, ev); }
+
+static const struct queue_ops fibheap_ops = { "fibheap", fh_init, fh_insert, fh_min, fh_extract, fh_decrease };
+static const struct queue_ops twheel_ops = { "twheel", tw_init, tw_insert, tw_min, tw_extract, tw_decrease };
+
+/* Times of event i are always i modulo nevents, so that no two events
+   are ever scheduled at the same time and the order in which they are
+   handled is fully determined */
+static int64_t align (int64_t t, uint32_t i, uint32_t nevents)
+{
+  int64_t a = t - (t % nevents) + i;
+  return (a < t) ? a + nevents : a;
+}
+
+static uint32_t rnd (uint64_t *state)
+{
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint32_t) (*state >> 33);
+}
+
+static double run (const struct queue_ops *ops, struct ev *evs, uint32_t nevents, uint64_t *checksum)
+{
+  const int64_t t0 = 1000000000000ll;
+  const uint64_t nhandle = 10 * (uint64_t) nevents;
+  uint64_t state = 314159265;
+  os_time tstart, tend;
+  ops->init ();
+  for (uint32_t i = 0; i < nevents; i++)
+  {
+    evs[i].period = align (1000000 + (int64_t) (rnd (&state) % 999000000), 0, nevents);
+    evs[i].t = align (t0 + (int64_t) (rnd (&state) % 1000000000), i, nevents);
+  }
+  *checksum = 0;
+  tstart = os_timeGetMonotonic ();
+  for (uint32_t i = 0; i < nevents; i++)
+    ops->insert (&evs[i]);
+  for (uint64_t n = 0; n < nhandle; n++)
+  {
+    struct ev *ev = ops->min ();
+    const int64_t tnow = ev->t;
+    const uint32_t j = rnd (&state) % nevents;
+    const int64_t tj = align (tnow + (int64_t) (rnd (&state) % (uint32_t) evs[j].period), j, nevents);
+    ops->extract (ev);
+    *checksum = *checksum * 31 + (uint64_t) (ev - evs);
+    ev->t += ev->period;
+    ops->insert (ev);
+    if (tj < evs[j].t)
+    {
+      evs[j].t = tj;
+      ops->decrease (&evs[j]);
+    }
+  }
+  tend = os_timeGetMonotonic ();
+  return (double) (tend.tv_sec - tstart.tv_sec) + (double) (tend.tv_nsec - tstart.tv_nsec) / 1e9;
+}
+
+int main (int argc, char **argv)
+{
+  static const uint32_t defaults[] = { 1000, 10000, 100000 };
+  const int nsizes = (argc > 1) ? argc - 1 : (int) (sizeof (defaults) / sizeof (defaults[0]));
+  int failed = 0;
+
+  for (int k = 0; k < nsizes; k++)
+  {
+    const uint32_t nevents = (argc > 1) ? (uint32_t) atoi (argv[k + 1]) : defaults[k];
+    struct ev *evs;
+    uint64_t cs_fh, cs_tw;
+    double dt_fh, dt_tw, nops;
+    if (nevents == 0)
+    {
+      fprintf (stderr, "usage: %s [NEVENTS...]\n", argv[0]);
+      return 2;
+    }
+    evs = os_malloc (nevents * sizeof (*evs));
+    memset (evs, 0, nevents * sizeof (*evs));
+    dt_fh = run (&fibheap_ops, evs, nevents, &cs_fh);
+    dt_tw = run (&twheel_ops, evs, nevents, &cs_tw);
+    /* handling an event, rescheduling another: about 2 operations per event */
+    nops = 20.0 * nevents;
+    printf ("%6"PRIu32" events: fibheap %.1fns/op twheel %.1fns/op (%.2fx)\n",
+            nevents, dt_fh * 1e9 / nops, dt_tw * 1e9 / nops, dt_fh / dt_tw);
+    if (cs_fh != cs_tw)
+    {
+      fprintf (stderr, "%"PRIu32" events: fibheap and twheel handled events in a different order\n", nevents);
+      failed = 1;
+    }
+    os_free (evs);
+  }
+  return failed;
+}
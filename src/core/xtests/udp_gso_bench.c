@@ -0,0 +1,225 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+
+/* Compares the cost of sending a large sample as a sequence of
+   equally sized packets over loopback: one sendmsg per packet (as
+   DDSI does by default) versus runs of packets passed to the kernel
+   in a single sendmsg using UDP generic segmentation offload (as
+   DDSI does with Internal/SendSegmentationOffload enabled).
+
+   Each packet consists of a (dummy) RTPS header and a fragment of
+   the sample, referenced using separate iovecs like an xpack does.
+   Reported are the number of system calls and the CPU time of the
+   sending thread per MB.
+
+   usage: udp_gso_bench [MB [PACKETSIZE]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "os/os.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#define RTPS_HDR_SIZE 20
+#define MAX_SEGMENTS 64
+#define MAX_GSO_BYTES 65507
+
+struct recv_arg {
+  int sock;
+  volatile int stop;
+  uint64_t npackets;
+};
+
+static uint32_t recv_thread (void *varg)
+{
+  struct recv_arg *arg = varg;
+  static unsigned char buf[65536];
+  while (!arg->stop)
+  {
+    if (recv (arg->sock, buf, sizeof (buf), 0) > 0)
+      arg->npackets++;
+  }
+  return 0;
+}
+
+struct result {
+  uint64_t nsyscalls;
+  uint64_t npackets;
+  double cpu_s;
+  double wall_s;
+};
+
+static double to_s (os_time t)
+{
+  return (double) t.tv_sec + (double) t.tv_nsec / 1e9;
+}
+
+static int send_run (int sock, const struct sockaddr_in *dst, const unsigned char *hdr, const unsigned char *data, size_t nseg, size_t pktsize, size_t lastsize, int gso)
+{
+  struct iovec iov[2 * MAX_SEGMENTS];
+  union {
+    char buf[CMSG_SPACE (sizeof (uint16_t))];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg;
+  size_t i;
+
+  for (i = 0; i < nseg; i++)
+  {
+    iov[2*i].iov_base = (void *) hdr;
+    iov[2*i].iov_len = RTPS_HDR_SIZE;
+    iov[2*i+1].iov_base = (void *) (data + i * (pktsize - RTPS_HDR_SIZE));
+    iov[2*i+1].iov_len = ((i == nseg - 1) ? lastsize : pktsize) - RTPS_HDR_SIZE;
+  }
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_name = (void *) dst;
+  msg.msg_namelen = sizeof (*dst);
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2 * nseg;
+  if (gso)
+  {
+    struct cmsghdr *cmsg;
+    uint16_t gso_size = (uint16_t) pktsize;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof (control.buf);
+    cmsg = CMSG_FIRSTHDR (&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN (sizeof (gso_size));
+    memcpy (CMSG_DATA (cmsg), &gso_size, sizeof (gso_size));
+  }
+  return (sendmsg (sock, &msg, 0) < 0) ? -1 : 0;
+}
+
+static int run (int gso, size_t nbytes, size_t pktsize, struct result *res)
+{
+  const size_t fragsize = pktsize - RTPS_HDR_SIZE;
+  const size_t samplesize = 2 * 1024 * 1024;
+  const size_t maxseg = gso ? ((MAX_GSO_BYTES / pktsize < MAX_SEGMENTS) ? MAX_GSO_BYTES / pktsize : MAX_SEGMENTS) : 1;
+  unsigned char hdr[RTPS_HDR_SIZE] = { 'R', 'T', 'P', 'S', 2, 1, 1, 16 };
+  unsigned char *data = calloc (1, samplesize);
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof (addr);
+  struct recv_arg rarg;
+  os_threadId tid;
+  os_threadAttr tattr;
+  os_rusage_t ru0, ru1;
+  os_time t0, t1;
+  int sbuf = 4 * 1024 * 1024;
+  struct timeval rcvtimeo = { 0, 100000 };
+  int ssock, ret = 0;
+  size_t sent;
+
+  rarg.stop = 0;
+  rarg.npackets = 0;
+  rarg.sock = socket (AF_INET, SOCK_DGRAM, 0);
+  ssock = socket (AF_INET, SOCK_DGRAM, 0);
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  (void) setsockopt (rarg.sock, SOL_SOCKET, SO_RCVBUF, &sbuf, sizeof (sbuf));
+  (void) setsockopt (rarg.sock, SOL_SOCKET, SO_RCVTIMEO, &rcvtimeo, sizeof (rcvtimeo));
+  (void) setsockopt (ssock, SOL_SOCKET, SO_SNDBUF, &sbuf, sizeof (sbuf));
+  if (bind (rarg.sock, (struct sockaddr *) &addr, sizeof (addr)) < 0 ||
+      getsockname (rarg.sock, (struct sockaddr *) &addr, &addrlen) < 0)
+  {
+    perror ("bind");
+    exit (2);
+  }
+  os_threadAttrInit (&tattr);
+  os_threadCreate (&tid, "recv", &tattr, recv_thread, &rarg);
+
+  memset (res, 0, sizeof (*res));
+  os_getrusage (OS_RUSAGE_THREAD, &ru0);
+  t0 = os_timeGetMonotonic ();
+  for (sent = 0; sent < nbytes && ret == 0; sent += samplesize)
+  {
+    /* fragment the sample, then send the fragments in runs of maxseg */
+    const size_t nfrags = (samplesize + fragsize - 1) / fragsize;
+    size_t i;
+    for (i = 0; i < nfrags && ret == 0; i += maxseg)
+    {
+      const size_t nseg = (nfrags - i < maxseg) ? nfrags - i : maxseg;
+      const size_t last = (i + nseg == nfrags) ? RTPS_HDR_SIZE + samplesize - (nfrags - 1) * fragsize : pktsize;
+      if (send_run (ssock, &addr, hdr, data + i * fragsize, nseg, pktsize, last, gso) < 0)
+      {
+        ret = -1;
+        break;
+      }
+      res->nsyscalls++;
+      res->npackets += nseg;
+    }
+  }
+  t1 = os_timeGetMonotonic ();
+  os_getrusage (OS_RUSAGE_THREAD, &ru1);
+  if (ret < 0)
+  {
+    int err = errno;
+    fprintf (stderr, "sendmsg failed: %s\n", strerror (err));
+  }
+
+  res->cpu_s = to_s (ru1.utime) + to_s (ru1.stime) - to_s (ru0.utime) - to_s (ru0.stime);
+  res->wall_s = to_s (t1) - to_s (t0);
+  rarg.stop = 1;
+  os_threadWaitExit (tid, NULL);
+  close (ssock);
+  close (rarg.sock);
+  free (data);
+  return ret;
+}
+
+static void print_result (const char *name, size_t nbytes, const struct result *res)
+{
+  const double mb = (double) nbytes / 1048576.0;
+  printf ("%-8s %10"PRIu64" packets %10"PRIu64" syscalls %10.1f syscalls/MB %8.1f us-cpu/MB %8.1f MB/s\n",
+          name, res->npackets, res->nsyscalls, (double) res->nsyscalls / mb,
+          1e6 * res->cpu_s / mb, mb / res->wall_s);
+}
+
+int main (int argc, char **argv)
+{
+  size_t mb = (argc > 1) ? (size_t) atoi (argv[1]) : 256;
+  size_t pktsize = (argc > 2) ? (size_t) atoi (argv[2]) : 1400;
+  size_t nbytes;
+  struct result res;
+
+  if (mb == 0 || pktsize <= RTPS_HDR_SIZE || pktsize > 65000)
+  {
+    fprintf (stderr, "usage: %s [MB [PACKETSIZE]]\n", argv[0]);
+    return 2;
+  }
+  nbytes = mb * 1048576;
+  os_osInit ();
+  printf ("sending %zu MB in 2MB samples, packet size %zu over loopback\n", mb, pktsize);
+  if (run (0, nbytes, pktsize, &res) == 0)
+    print_result ("sendmsg", nbytes, &res);
+  if (run (1, nbytes, pktsize, &res) == 0)
+    print_result ("gso", nbytes, &res);
+  else
+    printf ("gso      not supported\n");
+  os_osExit ();
+  return 0;
+}
@@ -68,6 +68,29 @@ extern "C" {
         OS_SCHED_TIMESHARE
     } os_schedClass;
 
+    /** \brief Definition of the NUMA memory allocation policy of a thread
+     */
+    typedef enum os_numaPolicy {
+        /** Use the process (or platform) default policy */
+        OS_NUMA_DEFAULT,
+        /** Allocate memory on the node of the CPU the thread runs on */
+        OS_NUMA_LOCAL,
+        /** Allocate memory on the first of the given nodes if possible */
+        OS_NUMA_PREFERRED,
+        /** Allocate memory only on the given nodes */
+        OS_NUMA_BIND,
+        /** Interleave allocations over the given nodes */
+        OS_NUMA_INTERLEAVE
+    } os_numaPolicy;
+
+    /** \brief Maximum number of CPUs in a CPU set */
+#define OS_CPUSET_SIZE 1024
+
+    /** \brief Set of CPUs, an empty set means no restriction */
+    typedef struct os_cpuSet {
+        uint64_t bits[OS_CPUSET_SIZE / 64];
+    } os_cpuSet;
+
     /** \brief Definition of the thread attributes
      */
     typedef struct os_threadAttr {
@@ -77,6 +100,12 @@ extern "C" {
         int32_t            schedPriority;
         /** Specifies the thread stack size */
         uint32_t           stackSize;
+        /** Specifies the CPUs the thread may run on (empty: any) */
+        os_cpuSet          cpuSet;
+        /** Specifies the NUMA memory allocation policy */
+        os_numaPolicy      numaPolicy;
+        /** Specifies the NUMA nodes for the PREFERRED, BIND and INTERLEAVE policies */
+        uint64_t           numaNodes;
     } os_threadAttr;
 
     /** \brief Internal structure used to store cleanup handlers (private) */
@@ -178,6 +207,32 @@ extern "C" {
             os_threadAttr *threadAttr)
         __nonnull_all__;
 
+    /** \brief Clear all CPUs in a CPU set */
+    OSAPI_EXPORT void
+    os_cpuSetZero(
+            os_cpuSet *set)
+        __nonnull_all__;
+
+    /** \brief Add a CPU to a CPU set, returns false if out of range */
+    OSAPI_EXPORT bool
+    os_cpuSetAdd(
+            os_cpuSet *set,
+            uint32_t cpu)
+        __nonnull_all__;
+
+    /** \brief Test whether a CPU is in a CPU set */
+    OSAPI_EXPORT bool
+    os_cpuSetIsSet(
+            const os_cpuSet *set,
+            uint32_t cpu)
+        __nonnull_all__;
+
+    /** \brief Test whether a CPU set is empty */
+    OSAPI_EXPORT bool
+    os_cpuSetIsEmpty(
+            const os_cpuSet *set)
+        __nonnull_all__;
+
     /** \brief Allocate thread private memory
      *
      * Allocate heap memory of the specified \b size and
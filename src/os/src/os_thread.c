@@ -19,6 +19,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 #include "os/os.h"
 
 /** \brief Initialize thread attributes
@@ -27,6 +28,8 @@
  *   (take the platforms default scheduling class, Time-sharing for
  *   non realtime platforms, Real-time for realtime platforms)
  * - Set \b procAttr->schedPriority to \b 0
+ * - Set \b procAttr->cpuSet to the empty set (no affinity)
+ * - Set \b procAttr->numaPolicy to \b OS_NUMA_DEFAULT
  */
 void
 os_threadAttrInit (
@@ -36,6 +39,36 @@ os_threadAttrInit (
     threadAttr->schedClass = OS_SCHED_DEFAULT;
     threadAttr->schedPriority = 0;
     threadAttr->stackSize = 0;
+    os_cpuSetZero (&threadAttr->cpuSet);
+    threadAttr->numaPolicy = OS_NUMA_DEFAULT;
+    threadAttr->numaNodes = 0;
+}
+
+void os_cpuSetZero (os_cpuSet *set)
+{
+  memset (set, 0, sizeof (*set));
+}
+
+bool os_cpuSetAdd (os_cpuSet *set, uint32_t cpu)
+{
+  if (cpu >= OS_CPUSET_SIZE)
+    return false;
+  set->bits[cpu / 64] |= (uint64_t) 1 << (cpu % 64);
+  return true;
+}
+
+bool os_cpuSetIsSet (const os_cpuSet *set, uint32_t cpu)
+{
+  return cpu < OS_CPUSET_SIZE && (set->bits[cpu / 64] & ((uint64_t) 1 << (cpu % 64))) != 0;
+}
+
+bool os_cpuSetIsEmpty (const os_cpuSet *set)
+{
+  size_t i;
+  for (i = 0; i < sizeof (set->bits) / sizeof (set->bits[0]); i++)
+    if (set->bits[i] != 0)
+      return false;
+  return true;
 }
 
 int os_threadEqual (os_threadId a, os_threadId b)
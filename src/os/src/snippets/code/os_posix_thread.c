@@ -15,6 +15,10 @@
  * Implements thread management for POSIX
  */
 
+#if defined __linux && !defined _GNU_SOURCE
+#define _GNU_SOURCE /* for CPU affinity */
+#endif
+
 #include "os/os.h"
 
 #include <sys/types.h>
@@ -30,11 +34,19 @@
 #include <sys/prctl.h>
 #endif
 #include <limits.h>
+#if defined __linux
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
 
 typedef struct {
   char *threadName;
   void *arguments;
   uint32_t (*startRoutine) (void *);
+  os_cpuSet cpuSet;
+  os_numaPolicy numaPolicy;
+  uint64_t numaNodes;
 } os_threadContext;
 
 static pthread_key_t os_threadNameKey;
@@ -123,6 +135,75 @@ void os_threadModuleExit (void)
   pthread_key_delete(os_threadMemKey);
 }
 
+/** \brief Set the CPU affinity of the calling thread
+ *
+ * Failure (e.g., because none of the CPUs exist) is not fatal, the
+ * thread then simply runs on any CPU.
+ */
+static void os_threadSetAffinity (const char *name, const os_cpuSet *set)
+{
+  if (os_cpuSetIsEmpty (set))
+    return;
+#if defined __linux && defined CPU_ALLOC
+  {
+    const size_t setsize = CPU_ALLOC_SIZE (OS_CPUSET_SIZE);
+    cpu_set_t *cpuset;
+    uint32_t cpu;
+    int ret;
+    if ((cpuset = CPU_ALLOC (OS_CPUSET_SIZE)) == NULL)
+      return;
+    CPU_ZERO_S (setsize, cpuset);
+    for (cpu = 0; cpu < OS_CPUSET_SIZE; cpu++)
+      if (os_cpuSetIsSet (set, cpu))
+        CPU_SET_S (cpu, setsize, cpuset);
+    if ((ret = pthread_setaffinity_np (pthread_self (), setsize, cpuset)) != 0)
+      DDS_WARNING ("os_threadCreate(%s): pthread_setaffinity_np failed with error %d\n", name, ret);
+    CPU_FREE (cpuset);
+  }
+#else
+  DDS_WARNING ("os_threadCreate(%s): CPU affinity not supported\n", name);
+#endif
+}
+
+/** \brief Set the NUMA memory allocation policy of the calling thread
+ *
+ * The policy is a property of the calling thread. Failure is not
+ * fatal, the thread then simply uses the default policy.
+ */
+static void os_threadSetNumaPolicy (const char *name, os_numaPolicy policy, uint64_t nodes)
+{
+  if (policy == OS_NUMA_DEFAULT)
+    return;
+#if defined __linux && defined SYS_set_mempolicy
+  {
+    unsigned long mask[64 / (CHAR_BIT * sizeof (unsigned long))];
+    const unsigned long maxnode = CHAR_BIT * sizeof (mask) + 1;
+    size_t i;
+    int mode = MPOL_DEFAULT;
+    long ret;
+    for (i = 0; i < sizeof (mask) / sizeof (mask[0]); i++)
+      mask[i] = (unsigned long) (nodes >> (i * CHAR_BIT * sizeof (unsigned long)));
+    switch (policy)
+    {
+      case OS_NUMA_DEFAULT: assert (0); break;
+      case OS_NUMA_LOCAL: mode = MPOL_LOCAL; break;
+      case OS_NUMA_PREFERRED: mode = MPOL_PREFERRED; break;
+      case OS_NUMA_BIND: mode = MPOL_BIND; break;
+      case OS_NUMA_INTERLEAVE: mode = MPOL_INTERLEAVE; break;
+    }
+    if (mode == MPOL_LOCAL)
+      ret = syscall (SYS_set_mempolicy, mode, NULL, 0ul);
+    else
+      ret = syscall (SYS_set_mempolicy, mode, mask, maxnode);
+    if (ret != 0)
+      DDS_WARNING ("os_threadCreate(%s): set_mempolicy(%d) failed with error %d\n", name, mode, os_getErrno ());
+  }
+#else
+  DDS_WARNING ("os_threadCreate(%s): NUMA memory policy not supported\n", name);
+  (void) nodes;
+#endif
+}
+
 /** \brief Wrap thread start routine
  *
  * \b os_startRoutineWrapper wraps a threads starting routine.
@@ -151,6 +232,10 @@ static void *os_startRoutineWrapper (void *threadContext)
   /* allocate an array to store thread private memory references */
   os_threadMemInit ();
 
+  /* before the user routine allocates anything */
+  os_threadSetAffinity (context->threadName, &context->cpuSet);
+  os_threadSetNumaPolicy (context->threadName, context->numaPolicy, context->numaNodes);
+
   /* Call the user routine */
   resultValue = context->startRoutine (context->arguments);
 
@@ -173,7 +258,9 @@ static void *os_startRoutineWrapper (void *threadContext)
  * sets the scheduling properties with \b pthread_attr_setscope
  * to create a bounded thread, \b pthread_attr_setschedpolicy to
  * set the scheduling class and \b pthread_attr_setschedparam to
- * set the scheduling priority.
+ * set the scheduling priority. The CPU affinity and NUMA memory
+ * policy are set by the new thread itself before calling the start
+ * routine.
  * \b pthread_attr_setdetachstate is called with parameter
  * \PTHREAD_CREATE_JOINABLE to make the thread joinable, which
  * is needed to be able to wait for the threads termination
@@ -208,7 +295,7 @@ os_result os_threadCreate (os_threadId *threadId, const char *name, const os_thr
   {
 #ifdef PTHREAD_STACK_MIN
     if (tattr.stackSize < PTHREAD_STACK_MIN)
-      tattr.stackSize = PTHREAD_STACK_MIN;
+      tattr.stackSize = (uint32_t) PTHREAD_STACK_MIN;
 #endif
     if ((result = pthread_attr_setstacksize (&attr, tattr.stackSize)) != 0)
     {
@@ -272,6 +359,9 @@ os_result os_threadCreate (os_threadId *threadId, const char *name, const os_thr
   strcpy (threadContext->threadName, name);
   threadContext->startRoutine = start_routine;
   threadContext->arguments = arg;
+  threadContext->cpuSet = tattr.cpuSet;
+  threadContext->numaPolicy = tattr.numaPolicy;
+  threadContext->numaNodes = tattr.numaNodes;
   if ((create_ret = pthread_create (&threadId->v, &attr, os_startRoutineWrapper, threadContext)) != 0)
   {
     DDS_ERROR ("os_threadCreate(%s): pthread_create failed with error %d\n", name, create_ret);
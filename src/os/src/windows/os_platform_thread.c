@@ -278,6 +278,25 @@ os_threadCreate(
         DDS_INFO("SetThreadPriority failed with %i\n", os_getErrno());
     }
 
+    /* Only CPUs in the thread's processor group (the first 64 at most)
+     * can be selected; memory is allocated on the node of the CPU the
+     * thread runs on by default, other NUMA policies are not supported */
+    if (!os_cpuSetIsEmpty (&threadAttr->cpuSet)) {
+        DWORD_PTR mask = 0;
+        uint32_t cpu;
+        for (cpu = 0; cpu < 8 * sizeof (mask); cpu++) {
+            if (os_cpuSetIsSet (&threadAttr->cpuSet, cpu)) {
+                mask |= (DWORD_PTR) 1 << cpu;
+            }
+        }
+        if (mask == 0 || SetThreadAffinityMask (threadHandle, mask) == 0) {
+            DDS_WARNING("os_threadCreate(%s): SetThreadAffinityMask failed with %i\n", name, os_getErrno());
+        }
+    }
+    if (threadAttr->numaPolicy != OS_NUMA_DEFAULT && threadAttr->numaPolicy != OS_NUMA_LOCAL) {
+        DDS_INFO("os_threadCreate(%s): NUMA memory policy not supported\n", name);
+    }
+
    /* ES: dds2086: Close handle should not be performed here. Instead the handle
     * should not be closed until the os_threadWaitExit(...) call is called.
     * CloseHandle (threadHandle);
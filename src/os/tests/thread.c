@@ -623,9 +623,50 @@ CU_Test(os_thread, attr_init)
     os_threadAttrInit (&thread_os_threadAttr);
     CU_ASSERT (thread_os_threadAttr.stackSize == 0);
 
+    /* Check default attributes: no CPU affinity, default NUMA policy */
+    printf ("Starting os_thread_attr_init_004\n");
+    os_threadAttrInit (&thread_os_threadAttr);
+    CU_ASSERT (os_cpuSetIsEmpty (&thread_os_threadAttr.cpuSet));
+    CU_ASSERT (thread_os_threadAttr.numaPolicy == OS_NUMA_DEFAULT);
+
     printf ("Ending os_thread_attr_init\n");
 }
 
+CU_Test(os_thread, cpuset)
+{
+    os_cpuSet set;
+    os_cpuSetZero (&set);
+    CU_ASSERT (os_cpuSetIsEmpty (&set));
+    CU_ASSERT (os_cpuSetAdd (&set, 0));
+    CU_ASSERT (os_cpuSetAdd (&set, 65));
+    CU_ASSERT (os_cpuSetAdd (&set, OS_CPUSET_SIZE - 1));
+    CU_ASSERT (!os_cpuSetAdd (&set, OS_CPUSET_SIZE));
+    CU_ASSERT (!os_cpuSetIsEmpty (&set));
+    CU_ASSERT (os_cpuSetIsSet (&set, 0));
+    CU_ASSERT (!os_cpuSetIsSet (&set, 1));
+    CU_ASSERT (os_cpuSetIsSet (&set, 65));
+    CU_ASSERT (os_cpuSetIsSet (&set, OS_CPUSET_SIZE - 1));
+    CU_ASSERT (!os_cpuSetIsSet (&set, OS_CPUSET_SIZE));
+}
+
+CU_Test(os_thread, affinity)
+{
+    /* Pinning to CPU 0 (which always exists) must not prevent the thread from running */
+    os_threadId tid;
+    os_threadAttr tattr;
+    os_result res;
+
+    os_threadAttrInit (&tattr);
+    (void) os_cpuSetAdd (&tattr.cpuSet, 0);
+    tattr.numaPolicy = OS_NUMA_LOCAL;
+    res = os_threadCreate (&tid, "ThreadAffinity", &tattr, &threadMemory_thread, NULL);
+    CU_ASSERT_EQUAL(res, os_resultSuccess);
+    if (res == os_resultSuccess) {
+        res = os_threadWaitExit (tid, NULL);
+        CU_ASSERT_EQUAL(res, os_resultSuccess);
+    }
+}
+
 CU_Test(os_thread, memmalloc)
 {
     /* Check os_threadMemMalloc with success result for main thread */
@@ -0,0 +1,71 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef UT_TWHEEL_H
+#define UT_TWHEEL_H
+
+#include "os/os.h"
+#include "util/ut_export.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Hierarchical timing wheel: a priority queue on a signed 64-bit key
+   (typically a time stamp in ns) with O(1) insert, delete and update,
+   usable in place of a ut_fibheap with a lot of rescheduling.
+
+   Keys are divided into ticks of 2^shift key units and each level of
+   the wheel has 64 slots; a node lives at the level corresponding to
+   the most significant 6-bit digit in which its tick differs from the
+   cursor.  Finding the minimum cascades the first occupied slot down
+   until level 0 holds something, then scans the nodes of that one
+   tick, so the minimum is exact and every node moves down at most
+   once per level.  Keys below the cursor (i.e., in the past) are
+   fine, they all end up in the first slot. */
+
+#define UT_TWHEEL_LEVELS 11 /* 6 bits per level, covers a 64-bit tick */
+#define UT_TWHEEL_SLOTS 64
+
+typedef struct ut_twheelNode {
+  struct ut_twheelNode *prev, *next;
+  unsigned char level, slot;
+} ut_twheelNode_t;
+
+typedef struct ut_twheelDef {
+  uintptr_t offset;    /* of the ut_twheelNode_t in the object */
+  uintptr_t keyoffset; /* of the int64_t key in the object */
+  unsigned shift;      /* tick = key >> shift */
+} ut_twheelDef_t;
+
+typedef struct ut_twheel {
+  uint64_t now;          /* cursor, in ticks */
+  uint32_t count;
+  ut_twheelNode_t *min;  /* cached minimum, NULL if unknown or empty */
+  uint64_t occupied[UT_TWHEEL_LEVELS];
+  ut_twheelNode_t *slots[UT_TWHEEL_LEVELS][UT_TWHEEL_SLOTS];
+} ut_twheel_t;
+
+#define UT_TWHEELDEF_INITIALIZER(offset, keyoffset, shift) { (offset), (keyoffset), (shift) }
+
+UTIL_EXPORT void ut_twheelDefInit (ut_twheelDef_t *twdef, uintptr_t offset, uintptr_t keyoffset, unsigned shift);
+UTIL_EXPORT void ut_twheelInit (const ut_twheelDef_t *twdef, ut_twheel_t *tw);
+UTIL_EXPORT void *ut_twheelMin (const ut_twheelDef_t *twdef, ut_twheel_t *tw);
+UTIL_EXPORT void ut_twheelInsert (const ut_twheelDef_t *twdef, ut_twheel_t *tw, const void *vnode);
+UTIL_EXPORT void ut_twheelDelete (const ut_twheelDef_t *twdef, ut_twheel_t *tw, const void *vnode);
+UTIL_EXPORT void *ut_twheelExtractMin (const ut_twheelDef_t *twdef, ut_twheel_t *tw);
+UTIL_EXPORT void ut_twheelUpdateKey (const ut_twheelDef_t *twdef, ut_twheel_t *tw, const void *vnode); /* to be called AFTER changing the key, either way */
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* UT_TWHEEL_H */
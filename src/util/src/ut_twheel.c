@@ -0,0 +1,182 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stddef.h>
+#include <assert.h>
+
+#include "util/ut_twheel.h"
+
+#define BITS_PER_LEVEL 6
+
+static unsigned ctz64 (uint64_t x)
+{
+    assert (x != 0);
+#if defined __GNUC__
+    return (unsigned) __builtin_ctzll (x);
+#else
+    {
+        unsigned n = 0;
+        while (!(x & 1)) {
+            x >>= 1;
+            n++;
+        }
+        return n;
+    }
+#endif
+}
+
+static void *obj (const ut_twheelDef_t *twdef, const ut_twheelNode_t *node)
+{
+    return (char *) node - twdef->offset;
+}
+
+static int64_t key (const ut_twheelDef_t *twdef, const ut_twheelNode_t *node)
+{
+    return *(const int64_t *) ((const char *) node - twdef->offset + twdef->keyoffset);
+}
+
+static uint64_t tick (const ut_twheelDef_t *twdef, const ut_twheel_t *tw, const ut_twheelNode_t *node)
+{
+    const int64_t k = key (twdef, node);
+    const uint64_t t = (k < 0) ? 0 : (uint64_t) k >> twdef->shift;
+    return (t < tw->now) ? tw->now : t;
+}
+
+void ut_twheelDefInit (ut_twheelDef_t *twdef, uintptr_t offset, uintptr_t keyoffset, unsigned shift)
+{
+    twdef->offset = offset;
+    twdef->keyoffset = keyoffset;
+    twdef->shift = shift;
+}
+
+void ut_twheelInit (const ut_twheelDef_t *twdef, ut_twheel_t *tw)
+{
+    unsigned l, s;
+    OS_UNUSED_ARG(twdef);
+    tw->now = 0;
+    tw->count = 0;
+    tw->min = NULL;
+    for (l = 0; l < UT_TWHEEL_LEVELS; l++) {
+        tw->occupied[l] = 0;
+        for (s = 0; s < UT_TWHEEL_SLOTS; s++)
+            tw->slots[l][s] = NULL;
+    }
+}
+
+static void ut_twheel_link (const ut_twheelDef_t *twdef, ut_twheel_t *tw, ut_twheelNode_t *node)
+{
+    const uint64_t t = tick (twdef, tw, node);
+    const uint64_t diff = t ^ tw->now;
+    unsigned l = 0, s;
+    while (l < UT_TWHEEL_LEVELS - 1 && (diff >> (BITS_PER_LEVEL * (l + 1))) != 0)
+        l++;
+    s = (unsigned) (t >> (BITS_PER_LEVEL * l)) & (UT_TWHEEL_SLOTS - 1);
+    node->level = (unsigned char) l;
+    node->slot = (unsigned char) s;
+    node->prev = NULL;
+    node->next = tw->slots[l][s];
+    if (node->next)
+        node->next->prev = node;
+    tw->slots[l][s] = node;
+    tw->occupied[l] |= (uint64_t) 1 << s;
+    tw->count++;
+}
+
+static void ut_twheel_unlink (ut_twheel_t *tw, ut_twheelNode_t *node)
+{
+    if (node->next)
+        node->next->prev = node->prev;
+    if (node->prev)
+        node->prev->next = node->next;
+    else if ((tw->slots[node->level][node->slot] = node->next) == NULL)
+        tw->occupied[node->level] &= ~((uint64_t) 1 << node->slot);
+    assert (tw->count > 0);
+    tw->count--;
+}
+
+static void ut_twheel_cascade (const ut_twheelDef_t *twdef, ut_twheel_t *tw, unsigned l)
+{
+    /* Advance the cursor to the start of the first occupied slot of
+       level l, which is only allowed if all lower levels are empty,
+       and redistribute its nodes over the lower levels */
+    const unsigned s = ctz64 (tw->occupied[l]);
+    const unsigned hishift = BITS_PER_LEVEL * (l + 1);
+    const uint64_t hi = (hishift >= 64) ? 0 : (tw->now >> hishift) << hishift;
+    ut_twheelNode_t *node = tw->slots[l][s], *next;
+    assert (l > 0);
+    assert (((uint64_t) s << (BITS_PER_LEVEL * l)) > (tw->now & ~hi));
+    tw->now = hi | ((uint64_t) s << (BITS_PER_LEVEL * l));
+    tw->slots[l][s] = NULL;
+    tw->occupied[l] &= ~((uint64_t) 1 << s);
+    for (; node; node = next) {
+        next = node->next;
+        tw->count--;
+        ut_twheel_link (twdef, tw, node);
+        assert (node->level < l);
+    }
+}
+
+void *ut_twheelMin (const ut_twheelDef_t *twdef, ut_twheel_t *tw)
+{
+    ut_twheelNode_t *node, *min;
+    unsigned l;
+    if (tw->count == 0)
+        return NULL;
+    else if (tw->min)
+        return obj (twdef, tw->min);
+
+    while (tw->occupied[0] == 0) {
+        for (l = 1; tw->occupied[l] == 0; l++)
+            assert (l < UT_TWHEEL_LEVELS - 1);
+        ut_twheel_cascade (twdef, tw, l);
+    }
+    /* Everything in level 0 shares the high bits of the cursor and
+       none of it is before the cursor, so the first occupied slot
+       holds the minimum; within a tick the keys are unordered */
+    min = tw->slots[0][ctz64 (tw->occupied[0])];
+    for (node = min->next; node; node = node->next)
+        if (key (twdef, node) < key (twdef, min))
+            min = node;
+    tw->min = min;
+    return obj (twdef, min);
+}
+
+void ut_twheelInsert (const ut_twheelDef_t *twdef, ut_twheel_t *tw, const void *vnode)
+{
+    ut_twheelNode_t * const node = (ut_twheelNode_t *) ((char *) vnode + twdef->offset);
+    if (tw->count == 0)
+        tw->min = node;
+    else if (tw->min && key (twdef, node) < key (twdef, tw->min))
+        tw->min = node;
+    ut_twheel_link (twdef, tw, node);
+}
+
+void ut_twheelDelete (const ut_twheelDef_t *twdef, ut_twheel_t *tw, const void *vnode)
+{
+    ut_twheelNode_t * const node = (ut_twheelNode_t *) ((char *) vnode + twdef->offset);
+    ut_twheel_unlink (tw, node);
+    if (tw->min == node)
+        tw->min = NULL;
+}
+
+void *ut_twheelExtractMin (const ut_twheelDef_t *twdef, ut_twheel_t *tw)
+{
+    void *min;
+    if ((min = ut_twheelMin (twdef, tw)) != NULL)
+        ut_twheelDelete (twdef, tw, min);
+    return min;
+}
+
+void ut_twheelUpdateKey (const ut_twheelDef_t *twdef, ut_twheel_t *tw, const void *vnode)
+{
+    ut_twheelDelete (twdef, tw, vnode);
+    ut_twheelInsert (twdef, tw, vnode);
+}
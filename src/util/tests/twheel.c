@@ -0,0 +1,213 @@
+/*
+ * Copyright(c) 2019 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "os/os.h"
+#include "util/ut_twheel.h"
+#include "CUnit/Test.h"
+
+#define SHIFT 10
+
+struct tnode {
+    int64_t key;
+    ut_twheelNode_t twnode;
+};
+
+static const ut_twheelDef_t twdef = UT_TWHEELDEF_INITIALIZER(offsetof(struct tnode, twnode), offsetof(struct tnode, key), SHIFT);
+
+static int64_t extract_key(ut_twheel_t *tw)
+{
+    struct tnode *n = ut_twheelExtractMin(&twdef, tw);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(n);
+    return n->key;
+}
+
+/*****************************************************************************************/
+CU_Test(util_twheel, empty)
+{
+    ut_twheel_t tw;
+    ut_twheelInit(&twdef, &tw);
+    CU_ASSERT_PTR_NULL(ut_twheelMin(&twdef, &tw));
+    CU_ASSERT_PTR_NULL(ut_twheelExtractMin(&twdef, &tw));
+}
+
+/*****************************************************************************************/
+CU_Test(util_twheel, insert_delete)
+{
+    struct tnode n[3] = { { 3000, { 0 } }, { 1000, { 0 } }, { 2000, { 0 } } };
+    ut_twheel_t tw;
+    ut_twheelInit(&twdef, &tw);
+
+    for (int i = 0; i < 3; i++) {
+        ut_twheelInsert(&twdef, &tw, &n[i]);
+    }
+    CU_ASSERT_EQUAL(tw.count, 3);
+    CU_ASSERT_PTR_EQUAL(ut_twheelMin(&twdef, &tw), &n[1]);
+
+    /* deleting the minimum exposes the next one */
+    ut_twheelDelete(&twdef, &tw, &n[1]);
+    CU_ASSERT_PTR_EQUAL(ut_twheelMin(&twdef, &tw), &n[2]);
+
+    /* deleting something else leaves the minimum alone */
+    ut_twheelDelete(&twdef, &tw, &n[0]);
+    CU_ASSERT_PTR_EQUAL(ut_twheelMin(&twdef, &tw), &n[2]);
+
+    ut_twheelDelete(&twdef, &tw, &n[2]);
+    CU_ASSERT_EQUAL(tw.count, 0);
+    CU_ASSERT_PTR_NULL(ut_twheelMin(&twdef, &tw));
+}
+
+/*****************************************************************************************/
+CU_Test(util_twheel, update_key)
+{
+    struct tnode n[3] = { { 1000, { 0 } }, { 2000, { 0 } }, { 3000, { 0 } } };
+    ut_twheel_t tw;
+    ut_twheelInit(&twdef, &tw);
+
+    for (int i = 0; i < 3; i++) {
+        ut_twheelInsert(&twdef, &tw, &n[i]);
+    }
+    CU_ASSERT_PTR_EQUAL(ut_twheelMin(&twdef, &tw), &n[0]);
+
+    /* moving the minimum later, far enough to land at a higher level */
+    n[0].key = INT64_C(1) << 40;
+    ut_twheelUpdateKey(&twdef, &tw, &n[0]);
+    CU_ASSERT_PTR_EQUAL(ut_twheelMin(&twdef, &tw), &n[1]);
+
+    /* moving another one earlier than everything else */
+    n[2].key = 500;
+    ut_twheelUpdateKey(&twdef, &tw, &n[2]);
+    CU_ASSERT_PTR_EQUAL(ut_twheelMin(&twdef, &tw), &n[2]);
+
+    CU_ASSERT_EQUAL(extract_key(&tw), 500);
+    CU_ASSERT_EQUAL(extract_key(&tw), 2000);
+    CU_ASSERT_EQUAL(extract_key(&tw), INT64_C(1) << 40);
+    CU_ASSERT_EQUAL(tw.count, 0);
+}
+
+/*****************************************************************************************/
+CU_Test(util_twheel, levels)
+{
+    /* one key in each level of the wheel, plus a second key in each of
+       the first two ticks, inserted in reverse order */
+    struct tnode n[UT_TWHEEL_LEVELS + 2];
+    const int nlevels = (63 - SHIFT + 5) / 6;
+    int64_t prev;
+    int i, cnt = 0;
+    ut_twheel_t tw;
+    ut_twheelInit(&twdef, &tw);
+
+    for (i = 0; i < nlevels; i++) {
+        n[cnt++].key = (INT64_C(1) << (SHIFT + 6 * i)) + 1;
+    }
+    n[cnt++].key = 2;
+    n[cnt++].key = (INT64_C(1) << SHIFT) + 2;
+    for (i = cnt - 1; i >= 0; i--) {
+        ut_twheelInsert(&twdef, &tw, &n[i]);
+    }
+
+    prev = INT64_MIN;
+    for (i = 0; i < cnt; i++) {
+        const int64_t k = extract_key(&tw);
+        CU_ASSERT(k >= prev);
+        prev = k;
+    }
+    CU_ASSERT_EQUAL(prev, (INT64_C(1) << (SHIFT + 6 * (nlevels - 1))) + 1);
+    CU_ASSERT_PTR_NULL(ut_twheelMin(&twdef, &tw));
+}
+
+/*****************************************************************************************/
+CU_Test(util_twheel, past)
+{
+    /* once the cursor has moved on, keys before it (including negative
+       ones) all come out first, still in order */
+    struct tnode late = { INT64_C(1) << 30, { 0 } };
+    struct tnode n[4] = { { INT64_C(1) << 20, { 0 } }, { -5, { 0 } }, { INT64_MIN + 1, { 0 } }, { 7, { 0 } } };
+    ut_twheel_t tw;
+    ut_twheelInit(&twdef, &tw);
+
+    ut_twheelInsert(&twdef, &tw, &late);
+    ut_twheelInsert(&twdef, &tw, &n[0]);
+    CU_ASSERT_EQUAL(extract_key(&tw), INT64_C(1) << 20);
+    /* finding the next minimum moves the cursor up to its tick */
+    CU_ASSERT_PTR_EQUAL(ut_twheelMin(&twdef, &tw), &late);
+    CU_ASSERT_EQUAL(tw.now, (uint64_t) late.key >> SHIFT);
+
+    for (int i = 0; i < 4; i++) {
+        ut_twheelInsert(&twdef, &tw, &n[i]);
+    }
+    CU_ASSERT_EQUAL(extract_key(&tw), INT64_MIN + 1);
+    CU_ASSERT_EQUAL(extract_key(&tw), -5);
+    CU_ASSERT_EQUAL(extract_key(&tw), 7);
+    CU_ASSERT_EQUAL(extract_key(&tw), INT64_C(1) << 20);
+    CU_ASSERT_EQUAL(extract_key(&tw), INT64_C(1) << 30);
+    CU_ASSERT_EQUAL(tw.count, 0);
+}
+
+/*****************************************************************************************/
+CU_Test(util_twheel, random)
+{
+    /* random operations, checking the minimum against a linear scan */
+#define N 500
+    static struct tnode n[N];
+    static bool in[N];
+    int64_t base = 0;
+    ut_twheel_t tw;
+    ut_twheelInit(&twdef, &tw);
+    srand(1);
+
+    for (int i = 0; i < N; i++) {
+        in[i] = false;
+    }
+    for (int step = 0; step < 20000; step++) {
+        const int i = rand() % N;
+        struct tnode *min = NULL, *twmin;
+        const int64_t key = base - 1000 + (int64_t) (rand() % 1000000) * (INT64_C(1) << (rand() % 40)) / 1000;
+        switch (rand() % 4) {
+            case 0: case 1:
+                n[i].key = key;
+                if (in[i]) {
+                    ut_twheelUpdateKey(&twdef, &tw, &n[i]);
+                } else {
+                    ut_twheelInsert(&twdef, &tw, &n[i]);
+                    in[i] = true;
+                }
+                break;
+            case 2:
+                if (in[i]) {
+                    ut_twheelDelete(&twdef, &tw, &n[i]);
+                    in[i] = false;
+                }
+                break;
+            case 3:
+                if ((twmin = ut_twheelExtractMin(&twdef, &tw)) != NULL) {
+                    in[twmin - n] = false;
+                    base = twmin->key;
+                }
+                break;
+        }
+        for (int j = 0; j < N; j++) {
+            if (in[j] && (min == NULL || n[j].key < min->key)) {
+                min = &n[j];
+            }
+        }
+        twmin = ut_twheelMin(&twdef, &tw);
+        if (min == NULL) {
+            CU_ASSERT_PTR_NULL_FATAL(twmin);
+        } else {
+            CU_ASSERT_PTR_NOT_NULL_FATAL(twmin);
+            CU_ASSERT_EQUAL_FATAL(twmin->key, min->key);
+        }
+    }
+#undef N
+}